@@ -3,6 +3,9 @@
 #include "util/Logger.h"
 #include <ctime>
 #include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include <wx/fileconf.h>
 #include <wx/filename.h>
 #include <wx/stdpaths.h>
@@ -15,11 +18,17 @@ wxIMPLEMENT_APP(App);
 // 读取配置文件中日志设置
 // LogLevel: 默认 info
 // LogEnabled: 默认 false（关闭文件日志）
-static void LoadLogConfigFromConfig(LogLevel& level, bool& enabled)
+// LogAsync: 默认 false（同步写日志）
+// LogMaxSizeMB / LogRotateHours: 运行中按大小/时长轮转，默认 16MB / 24 小时（0 表示不限制）
+// LogMmap: 默认 false（使用内存映射追加写入）
+// [Log] 段：按模块覆盖级别，如 Engine=debug（原样返回，初始化日志后再解析）
+static void LoadLogConfigFromConfig(LogLevel& level, bool& enabled, bool& async, Util::LogFileOptions& fileOptions,
+                                    std::vector<std::pair<wxString, wxString>>& moduleLevels)
 {
     // 默认值
     level = LogLevel::Info;
     enabled = false;
+    async = false;
 
     // 获取配置文件路径
     wxFileName exePath(wxStandardPaths::Get().GetExecutablePath());
@@ -57,6 +66,67 @@ static void LoadLogConfigFromConfig(LogLevel& level, bool& enabled)
         config.Write("LogEnabled", 0L);
     }
 
+    // 读取异步日志开关，不存在则写入默认值
+    long asyncValue = 0;
+    if (config.Read("LogAsync", &asyncValue))
+    {
+        async = (asyncValue != 0);
+    }
+    else
+    {
+        config.Write("LogAsync", 0L);
+    }
+
+    // 读取日志轮转与写入方式，不存在则写入默认值
+    long maxSizeMb = static_cast<long>(fileOptions.maxFileBytes / (1024 * 1024));
+    if (!config.Read("LogMaxSizeMB", &maxSizeMb))
+    {
+        config.Write("LogMaxSizeMB", maxSizeMb);
+    }
+    fileOptions.maxFileBytes = static_cast<size_t>(std::max(0L, maxSizeMb)) * 1024 * 1024;
+
+    long rotateHours = fileOptions.rotateMinutes / 60;
+    if (!config.Read("LogRotateHours", &rotateHours))
+    {
+        config.Write("LogRotateHours", rotateHours);
+    }
+    fileOptions.rotateMinutes = static_cast<int>(std::max(0L, rotateHours)) * 60;
+
+    long mmapValue = 0;
+    if (config.Read("LogMmap", &mmapValue))
+    {
+        fileOptions.mappedWriter = (mmapValue != 0);
+    }
+    else
+    {
+        config.Write("LogMmap", 0L);
+    }
+
+    long binaryValue = 0;
+    if (config.Read("LogBinary", &binaryValue))
+    {
+        fileOptions.binaryRecords = (binaryValue != 0);
+    }
+    else
+    {
+        config.Write("LogBinary", 0L);
+    }
+
+    // 读取模块级别覆盖
+    config.SetPath("/Log");
+    wxString key;
+    long cookie = 0;
+    bool more = config.GetFirstEntry(key, cookie);
+    while (more)
+    {
+        wxString value;
+        if (config.Read(key, &value))
+        {
+            moduleLevels.emplace_back(key, value);
+        }
+        more = config.GetNextEntry(key, cookie);
+    }
+
     // 刷新配置到文件
     config.Flush();
 }
@@ -66,10 +136,29 @@ bool App::OnInit()
     // 从配置文件读取日志配置
     LogLevel logLevel;
     bool logEnabled;
-    LoadLogConfigFromConfig(logLevel, logEnabled);
+    bool logAsync;
+    Util::LogFileOptions logFileOptions;
+    std::vector<std::pair<wxString, wxString>> moduleLevels;
+    LoadLogConfigFromConfig(logLevel, logEnabled, logAsync, logFileOptions, moduleLevels);
     
-    // 初始化日志系统（传入 fileOutput 参数）
-    Logger::Instance().Initialize(logLevel, "./logs/", logEnabled);
+    // 初始化日志系统（传入 fileOutput、异步模式与文件选项）
+    Logger::Instance().Initialize(logLevel, "./logs/", logEnabled, logAsync, logFileOptions);
+
+    // 应用模块级别覆盖
+    for (const auto& [name, value] : moduleLevels)
+    {
+        Util::LogModule module;
+        LogLevel level;
+        if (Logger::ParseModule(std::string(name.ToUTF8()), module) &&
+            Logger::ParseLevel(std::string(value.ToUTF8()), level))
+        {
+            Logger::Instance().SetModuleLevel(module, level);
+        }
+        else
+        {
+            LOG_WARN("无效的模块日志级别配置: " << std::string(name.ToUTF8()) << "=" << std::string(value.ToUTF8()));
+        }
+    }
     
     LOG_INFO("GO_MIDI! 启动中...");
 
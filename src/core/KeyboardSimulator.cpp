@@ -1,3 +1,6 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Keyboard
+
 #include "KeyboardSimulator.h"
 #include "../util/Logger.h"
 #include <psapi.h>
@@ -25,163 +28,34 @@ namespace Core
         LOG_DEBUG("[KeyboardSimulator] 销毁");
     }
 
-    void KeyboardSimulator::send_input(int vk_code, int modifier, bool key_up)
+    // 向目标窗口投递单条按键消息（send_events 与 release_keys 共用的 lParam 构造）
+    static void PostKeyMessage(HWND h, int vk, bool up)
     {
-        // 优化：使用栈数组避免堆分配
-        INPUT inputs[8] = {};
-        int count = 0;
+        UINT scanCode = GetScanCode(vk);
+        LPARAM lParam = 1 | (scanCode << 16);
+        if ((vk >= VK_PRIOR && vk <= VK_DOWN) || vk == VK_INSERT || vk == VK_DELETE)
+            lParam |= ((LPARAM)1 << 24);
 
-        // 辅助 lambda 填充 INPUT 结构
-        auto add_input = [&](int vk, bool up)
+        if (up)
         {
-            if (count >= 8)
-                return;
-            INPUT &input = inputs[count++];
-
-            input.type = INPUT_KEYBOARD;
-            input.ki.wVk = static_cast<WORD>(vk);
-            input.ki.dwFlags = 0;
-
-            // 使用 vk 码而非扫描码，避免 KEYEVENTF_SCANCODE + KEYEVENTF_EXTENDEDKEY 冲突
-            // 同时省去扫描码查找开销，天然线程安全
-
-            if (up)
-            {
-                input.ki.dwFlags |= KEYEVENTF_KEYUP;
-            }
-        };
-
-        if (!key_up)
-        {
-            // 按键按下序列
-
-            // 1. 按下修饰键
-            if (modifier == 1)
-                add_input(VK_SHIFT, false);
-            if (modifier == 2)
-                add_input(VK_CONTROL, false);
-
-            // 2. 按下主键
-            add_input(vk_code, false);
-
-            // 3. 释放修饰键（瞬时策略）
-            if (modifier == 1)
-                add_input(VK_SHIFT, true);
-            if (modifier == 2)
-                add_input(VK_CONTROL, true);
+            lParam |= ((LPARAM)1 << 30);
+            lParam |= ((LPARAM)1 << 31);
+            PostMessage(h, WM_KEYUP, static_cast<WPARAM>(vk), lParam);
         }
         else
         {
-            // 按键释放序列
-            // 只释放主键
-            add_input(vk_code, true);
-
-            // 同时释放修饰键（安全措施）
-            if (modifier == 1)
-                add_input(VK_SHIFT, true);
-            if (modifier == 2)
-                add_input(VK_CONTROL, true);
-        }
-
-        if (count > 0)
-        {
-            SendInput(static_cast<UINT>(count), inputs, sizeof(INPUT));
+            PostMessage(h, WM_KEYDOWN, static_cast<WPARAM>(vk), lParam);
         }
     }
 
     void KeyboardSimulator::send_key_down(int vk_code, int modifier, void *hwnd)
     {
-        LOG_DEBUG("按键按下: VK=0x" << std::hex << vk_code << std::dec
-                                    << ", 修饰符=" << modifier
-                                    << ", 窗口=" << hwnd);
-
-        if (hwnd)
-        {
-            HWND h = static_cast<HWND>(hwnd);
-
-            auto send_msg = [&](int vk, bool up)
-            {
-                UINT scanCode = GetScanCode(vk);
-                LPARAM lParam = 1; // 重复计数 1
-                lParam |= (scanCode << 16);
-
-                bool extended = ((vk >= VK_PRIOR && vk <= VK_DOWN) || vk == VK_INSERT || vk == VK_DELETE);
-                if (extended)
-                    lParam |= ((LPARAM)1 << 24);
-
-                if (up)
-                {
-                    lParam |= ((LPARAM)1 << 30); // 前一按键状态
-                    lParam |= ((LPARAM)1 << 31); // 转换状态
-                    PostMessage(h, WM_KEYUP, vk, lParam);
-                }
-                else
-                {
-                    PostMessage(h, WM_KEYDOWN, vk, lParam);
-                }
-            };
-
-            // 1. 按下修饰键
-            if (modifier == 1)
-                send_msg(VK_SHIFT, false);
-            if (modifier == 2)
-                send_msg(VK_CONTROL, false);
-
-            // 2. 按下主键
-            send_msg(vk_code, false);
-
-            // 3. 释放修饰键（瞬时）
-            if (modifier == 1)
-                send_msg(VK_SHIFT, true);
-            if (modifier == 2)
-                send_msg(VK_CONTROL, true);
-        }
-        else
-        {
-            send_input(vk_code, modifier, false);
-        }
+        send_events({{true, vk_code, modifier, hwnd}});
     }
 
     void KeyboardSimulator::send_key_up(int vk_code, int modifier, void *hwnd)
     {
-        LOG_DEBUG("按键释放: VK=0x" << std::hex << vk_code << std::dec
-                                    << ", 修饰符=" << modifier
-                                    << ", 窗口=" << hwnd);
-
-        if (hwnd)
-        {
-            HWND h = static_cast<HWND>(hwnd);
-
-            auto send_msg = [&](int vk)
-            {
-                UINT scanCode = GetScanCode(vk);
-                LPARAM lParam = 1;
-                lParam |= (scanCode << 16);
-
-                if ((vk >= VK_PRIOR && vk <= VK_DOWN) || vk == VK_INSERT || vk == VK_DELETE)
-                {
-                    lParam |= ((LPARAM)1 << 24);
-                }
-
-                lParam |= ((LPARAM)1 << 30);
-                lParam |= ((LPARAM)1 << 31);
-
-                PostMessage(h, WM_KEYUP, vk, lParam);
-            };
-
-            // 释放主键
-            send_msg(vk_code);
-
-            // 同时释放修饰键（安全措施）
-            if (modifier == 1)
-                send_msg(VK_SHIFT);
-            if (modifier == 2)
-                send_msg(VK_CONTROL);
-        }
-        else
-        {
-            send_input(vk_code, modifier, true);
-        }
+        send_events({{false, vk_code, modifier, hwnd}});
     }
 
     void KeyboardSimulator::release_keys(const std::vector<std::pair<int, void*>>& keys)
@@ -202,15 +76,7 @@ namespace Core
                 // 有目标窗口 → PostMessage 批量释放，不等待
                 HWND h = static_cast<HWND>(hwnd);
                 for (int vk : vk_list)
-                {
-                    UINT scanCode = MapVirtualKeyW(vk, MAPVK_VK_TO_VSC);
-                    LPARAM lParam = 1 | (scanCode << 16)
-                                  | ((LPARAM)1 << 30)
-                                  | ((LPARAM)1 << 31);
-                    if ((vk >= VK_PRIOR && vk <= VK_DOWN) || vk == VK_INSERT || vk == VK_DELETE)
-                        lParam |= ((LPARAM)1 << 24);
-                    PostMessage(h, WM_KEYUP, static_cast<WPARAM>(vk), lParam);
-                }
+                    PostKeyMessage(h, vk, true);
             }
             else
             {
@@ -235,6 +101,76 @@ namespace Core
             SendInput(static_cast<UINT>(input_count), inputs, sizeof(INPUT));
     }
 
+    void KeyboardSimulator::send_events(const std::vector<KeyEvent>& events)
+    {
+        // 栈数组缓存 INPUT：每个事件最多 3 条（修饰键按下/主键/修饰键释放）
+        INPUT inputs[256] = {};
+        int input_count = 0;
+
+        auto add_input = [&](int vk, bool up)
+        {
+            if (input_count >= 256)
+            {
+                SendInput(static_cast<UINT>(input_count), inputs, sizeof(INPUT));
+                input_count = 0;
+            }
+            INPUT &input = inputs[input_count++];
+            input = {};
+            input.type = INPUT_KEYBOARD;
+            input.ki.wVk = static_cast<WORD>(vk);
+            input.ki.dwFlags = up ? KEYEVENTF_KEYUP : 0;
+        };
+
+        for (const auto& evt : events)
+        {
+            LOG_DEBUG_FMT("%s: VK=0x%X, 修饰符=%d, 窗口=%p", evt.is_note_on ? "按键按下" : "按键释放",
+                          evt.vk_code, evt.modifier, evt.window_handle);
+
+            const int mod_vk = (evt.modifier == 1) ? VK_SHIFT : (evt.modifier == 2) ? VK_CONTROL : 0;
+
+            if (evt.window_handle)
+            {
+                HWND h = static_cast<HWND>(evt.window_handle);
+                if (evt.is_note_on)
+                {
+                    // 修饰键瞬时按下 → 主键按下 → 修饰键释放
+                    if (mod_vk)
+                        PostKeyMessage(h, mod_vk, false);
+                    PostKeyMessage(h, evt.vk_code, false);
+                    if (mod_vk)
+                        PostKeyMessage(h, mod_vk, true);
+                }
+                else
+                {
+                    PostKeyMessage(h, evt.vk_code, true);
+                    if (mod_vk)
+                        PostKeyMessage(h, mod_vk, true);
+                }
+            }
+            else
+            {
+                if (evt.is_note_on)
+                {
+                    if (mod_vk)
+                        add_input(mod_vk, false);
+                    add_input(evt.vk_code, false);
+                    if (mod_vk)
+                        add_input(mod_vk, true);
+                }
+                else
+                {
+                    add_input(evt.vk_code, true);
+                    if (mod_vk)
+                        add_input(mod_vk, true);
+                }
+            }
+        }
+
+        // 同一周期内的无窗口事件只调用一次 SendInput
+        if (input_count > 0)
+            SendInput(static_cast<UINT>(input_count), inputs, sizeof(INPUT));
+    }
+
     // 辅助函数：宽字符串转 UTF-8
     static std::string WideToUtf8(const wchar_t *wideStr)
     {
@@ -9,17 +9,30 @@
 
 namespace Core {
 
+    /// 按键事件结构（用于播放线程）
+    struct KeyEvent {
+        bool is_note_on;
+        int vk_code;
+        int modifier;
+        void* window_handle;
+    };
+
     class KeyboardSimulator {
     public:
         KeyboardSimulator();
         ~KeyboardSimulator();
 
+        /// 单个按键按下/释放（等同于只含一个事件的 send_events）
         void send_key_down(int vk_code, int modifier = 0, void* hwnd = nullptr);
         void send_key_up(int vk_code, int modifier = 0, void* hwnd = nullptr);
 
         /// 批量释放按键（按窗口分组，比逐个 send_key_up 更高效）
         void release_keys(const std::vector<std::pair<int, void*>>& keys);
 
+        /// 批量发送一个调度周期内的按键事件（保持事件顺序）
+        /// 无窗口事件合并为一次 SendInput，有窗口事件逐条 PostMessage
+        void send_events(const std::vector<KeyEvent>& events);
+
         /// 窗口信息结构
         struct WindowInfo {
             HWND hwnd;
@@ -28,9 +41,6 @@ namespace Core {
             unsigned long pid;
         };
         static std::vector<WindowInfo> GetWindowList();
-
-    private:
-        void send_input(int vk_code, int modifier, bool key_up);
     };
 
 }
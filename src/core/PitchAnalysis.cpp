@@ -0,0 +1,662 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Engine
+
+#include "PitchAnalysis.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GO_MIDI_PITCH_SSE2 1
+#endif
+
+#include "../util/KeyPresets.h"
+#include "../util/Logger.h"
+
+namespace Core
+{
+    namespace
+    {
+        // 最高音加固参数（命名常量，便于调试和调整）
+        constexpr float kHighNoteBaseBoost = 1.2f;   // 最高音加固基准系数
+        constexpr float kHighNoteStepDecay = 0.1f;   // 每下降一个半音加固衰减量
+        constexpr int   kMinBoostDepth     = 4;      // 加固最少覆盖半音数
+        constexpr int   kBoostDepthPercent = 15;     // 加固深度占音域宽度的百分比
+
+        /// 单个 128 格直方图的统计量：一次扫描得到最低/最高非零音高与各阶矩
+        struct HistogramStats {
+            int lowest = -1;        ///< -1 表示直方图为空
+            int highest = -1;
+            double sum_w = 0.0;     ///< 以下各阶矩以 kMomentPivot 为原点，降低三阶矩的抵消误差
+            double sum_dw = 0.0;
+            double sum_d2w = 0.0;
+            double sum_d3w = 0.0;
+        };
+
+        constexpr double kMomentPivot = 64.0;
+
+        HistogramStats scan_histogram(const float *hist)
+        {
+            HistogramStats stats;
+            uint64_t occupied[2] = {0, 0};  ///< 非零格位图
+#ifdef GO_MIDI_PITCH_SSE2
+            const __m128d pair_step = _mm_set1_pd(2.0);
+            __m128d d = _mm_set_pd(1.0 - kMomentPivot, 0.0 - kMomentPivot);
+            __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+            for (int p = 0; p < 128; p += 4)
+            {
+                const __m128 v = _mm_loadu_ps(hist + p);
+                const __m128 positive = _mm_cmpgt_ps(v, _mm_setzero_ps());
+                occupied[p >> 6] |= static_cast<uint64_t>(_mm_movemask_ps(positive)) << (p & 63);
+                const __m128 w4 = _mm_and_ps(v, positive);  // 只统计正权重，与逐格判断一致
+
+                for (int half = 0; half < 2; ++half)
+                {
+                    const __m128d w = _mm_cvtps_pd(half == 0 ? w4 : _mm_movehl_ps(w4, w4));
+                    const __m128d dw = _mm_mul_pd(d, w);
+                    const __m128d d2w = _mm_mul_pd(d, dw);
+                    s0 = _mm_add_pd(s0, w);
+                    s1 = _mm_add_pd(s1, dw);
+                    s2 = _mm_add_pd(s2, d2w);
+                    s3 = _mm_add_pd(s3, _mm_mul_pd(d, d2w));
+                    d = _mm_add_pd(d, pair_step);
+                }
+            }
+            auto hsum = [](__m128d v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); };
+            stats.sum_w = hsum(s0);
+            stats.sum_dw = hsum(s1);
+            stats.sum_d2w = hsum(s2);
+            stats.sum_d3w = hsum(s3);
+#else
+            for (int p = 0; p < 128; ++p)
+            {
+                if (hist[p] > 0.0f)
+                {
+                    occupied[p >> 6] |= uint64_t{1} << (p & 63);
+                    const double w = hist[p];
+                    const double d = p - kMomentPivot;
+                    stats.sum_w += w;
+                    stats.sum_dw += d * w;
+                    stats.sum_d2w += d * d * w;
+                    stats.sum_d3w += d * d * d * w;
+                }
+            }
+#endif
+            for (int p = 0; p < 128; ++p)
+            {
+                if (occupied[p >> 6] >> (p & 63) & 1)
+                {
+                    if (stats.lowest < 0)
+                        stats.lowest = p;
+                    stats.highest = p;
+                }
+            }
+            return stats;
+        }
+
+        // 加权偏态系数：负值表示音符偏左分布（高音稀疏），正值表示偏右分布（高音密集）
+        float compute_skewness(const HistogramStats &stats)
+        {
+            if (stats.sum_w < 1e-10) return 0.0f;
+            const double m1 = stats.sum_dw / stats.sum_w;
+            const double m2 = stats.sum_d2w / stats.sum_w;
+            const double m3 = stats.sum_d3w / stats.sum_w;
+            // 由原点矩换算中心矩
+            double var = m2 - m1 * m1;
+            if (var < 1e-10) return 0.0f;
+            double skew = m3 - 3.0 * m1 * m2 + 2.0 * m1 * m1 * m1;
+            double sigma = std::sqrt(var);
+            return static_cast<float>(skew / (sigma * sigma * sigma));
+        }
+
+        // Apply highest pitch weighting to protect melody high points from being transposed out of range
+        void apply_high_note_boost(float *hist)
+        {
+            const HistogramStats stats = scan_histogram(hist);
+
+            // Find highest pitch (topmost non-zero weight), default to middle C
+            int highest_pitch = stats.highest >= 0 ? stats.highest : 60;
+
+            // 基于音域宽度动态计算加固深度（至少 4 个半音，通常为音域宽度的 15%）
+            int lowest_pitch = stats.lowest >= 0 ? stats.lowest : highest_pitch;
+            int pitch_range = highest_pitch - lowest_pitch;
+
+            // 基于分布偏态自适应调整加固深度：负偏态（高音稀疏）→ 加强保护
+            float skewness = compute_skewness(stats);
+            float skew_adjust = 1.0f + std::clamp(-skewness * 0.12f, -0.3f, 0.5f);
+
+            int boost_depth = std::max(kMinBoostDepth, static_cast<int>(pitch_range * kBoostDepthPercent / 100 * skew_adjust));
+            float base_boost = 1.0f + (kHighNoteBaseBoost - 1.0f) * skew_adjust;
+
+            int start_pitch = highest_pitch - boost_depth + 1;
+            if (start_pitch < 0) start_pitch = 0;
+            for (int p = start_pitch; p <= highest_pitch; ++p)
+            {
+                if (hist[p] > 0.0f)
+                {
+                    float distance = static_cast<float>(highest_pitch - p);
+                    float boost = base_boost - kHighNoteStepDecay * distance;
+                    if (boost > 1.0f)
+                        hist[p] *= boost;
+                }
+            }
+        }
+
+        /// 音符数达到该值时按线程分块累加直方图
+        constexpr size_t kParallelNoteThreshold = size_t{1} << 18;
+        /// 分块累加时所有线程私有直方图的总格数上限（音轨极多时减少线程数）
+        constexpr size_t kMaxScratchBins = size_t{1} << 22;
+
+        /// 将 notes[begin, end) 累加到 bins：前 track_count * 128 格为各音轨直方图，最后 128 格为全局直方图
+        /// 耗时主要在分散累加的访存上，逐音符计算权重后直接累加（先抽取列再批量 sqrt 反而多一遍读写）
+        void accumulate_histograms(const Midi::RawNote *notes, size_t count, size_t track_count, float *bins)
+        {
+            float *global_bins = bins + track_count * 128;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Midi::RawNote &raw = notes[i];
+                if (raw.pitch < 0 || raw.pitch >= 128)
+                    continue;
+
+                // sqrt(duration) * velocity: compress extreme duration values while preserving relative importance
+                const float weight = std::sqrt(raw.duration) * static_cast<float>(raw.velocity);
+                if (raw.track_index >= 0 && static_cast<size_t>(raw.track_index) < track_count)
+                    bins[raw.track_index * 128 + raw.pitch] += weight;
+                // 全局直方图：排除打击乐（channel 10）、Bass乐器（program 33-40）和低音提琴（program 43）
+                if (raw.channel != 10 && raw.program != 43 && (raw.program < 33 || raw.program > 40))
+                    global_bins[raw.pitch] += weight;
+            }
+        }
+
+        /// 某一音域下各目标音高的 Gaussian 权重：音域中心权重 1.0，向边缘平滑衰减至趋于 0
+        struct GaussianWeights {
+            float w[128];
+        };
+
+        const GaussianWeights &weights_for(int min_pitch, int max_pitch)
+        {
+            static std::mutex mutex;
+            static std::unordered_map<int, std::unique_ptr<GaussianWeights>> tables;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &slot = tables[min_pitch * 128 + max_pitch];
+            if (!slot)
+            {
+                slot = std::make_unique<GaussianWeights>();
+                const float center = (min_pitch + max_pitch) / 2.0f;
+                const float half_range = std::max((max_pitch - min_pitch) / 2.0f, 1.0f);
+                const float sigma = half_range * 0.4f;
+                for (int m = 0; m < 128; ++m)
+                {
+                    float dist = std::abs(static_cast<float>(m) - center);
+                    slot->w[m] = std::exp(-0.5f * (dist / sigma) * (dist / sigma));
+                }
+            }
+            return *slot;
+        }
+
+        /// 缓存文件的读取上限：MIDI 头部的音轨数为 16 位，路径长度按 Windows 长路径上限
+        constexpr uint32_t kMaxStoredTracks = 0xFFFF;
+        constexpr uint32_t kMaxStoredPathBytes = 0x8000;
+
+        template <typename T>
+        void put(std::string &out, const T &value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        /// 顺序读取缓存文件内容，越界后 ok 置为 false 且之后的读取全部失败
+        struct CacheReader {
+            const std::string &data;
+            size_t pos = 0;
+            bool ok = true;
+
+            size_t remaining() const { return data.size() - pos; }
+
+            template <typename T>
+            T get()
+            {
+                T value{};
+                if (!ok || remaining() < sizeof(T))
+                {
+                    ok = false;
+                    return value;
+                }
+                std::memcpy(&value, data.data() + pos, sizeof(T));
+                pos += sizeof(T);
+                return value;
+            }
+
+            /// 读取 count 个 T，count 超过剩余字节时失败（避免按损坏的计数分配内存）
+            template <typename T>
+            bool get_array(std::vector<T> &out, size_t count)
+            {
+                if (!ok || count > remaining() / sizeof(T))
+                    return ok = false;
+                out.resize(count);
+                std::memcpy(out.data(), data.data() + pos, count * sizeof(T));
+                pos += count * sizeof(T);
+                return true;
+            }
+        };
+    }
+
+    std::vector<Midi::RawNote> PitchAnalysis::SortedNotes(const Midi::MidiFile &midi_file)
+    {
+        size_t totalNotes = 0;
+        for (const auto &track_notes : midi_file.raw_notes_by_track)
+        {
+            totalNotes += track_notes.size();
+        }
+
+        std::vector<Midi::RawNote> notes;
+        notes.reserve(totalNotes);
+        for (const auto &track_notes : midi_file.raw_notes_by_track)
+        {
+            notes.insert(notes.end(), track_notes.begin(), track_notes.end());
+        }
+
+        // Sort raw notes by start time globally
+        std::sort(notes.begin(), notes.end(),
+                  [](const Midi::RawNote &a, const Midi::RawNote &b)
+                  {
+                      return a.start_s < b.start_s;
+                  });
+        return notes;
+    }
+
+    std::shared_ptr<const PitchAnalysis> PitchAnalysis::Build(const std::vector<Midi::RawNote> &sorted_notes,
+                                                              size_t track_count, size_t max_threads)
+    {
+        auto analysis = std::make_shared<PitchAnalysis>();
+        auto &track_hists = analysis->m_track_histograms;
+        auto &global_hist = analysis->m_global_histogram;
+
+        // Build pitch histograms with duration and velocity weighting
+        // 所有直方图存放在一块连续内存中：各音轨依次排列，最后 128 格为全局直方图
+        const size_t bin_count = (track_count + 1) * 128;
+        std::vector<float> bins(bin_count, 0.0f);
+
+        size_t thread_count = 1;
+        if (sorted_notes.size() >= kParallelNoteThreshold)
+        {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+            thread_count = std::min(thread_count, sorted_notes.size() / (kParallelNoteThreshold / 4));
+            thread_count = std::min(thread_count, std::max<size_t>(1, kMaxScratchBins / bin_count));
+            if (max_threads > 0)
+                thread_count = std::min(thread_count, max_threads);
+        }
+
+        if (thread_count <= 1)
+        {
+            accumulate_histograms(sorted_notes.data(), sorted_notes.size(), track_count, bins.data());
+        }
+        else
+        {
+            // 每个线程累加到私有直方图，结束后按块顺序合并（结果与线程调度无关）
+            std::vector<std::vector<float>> partials(thread_count - 1, std::vector<float>(bin_count, 0.0f));
+            const size_t chunk = (sorted_notes.size() + thread_count - 1) / thread_count;
+            auto run_chunk = [&](size_t t, float *out)
+            {
+                const size_t begin = std::min(sorted_notes.size(), t * chunk);
+                const size_t end = std::min(sorted_notes.size(), begin + chunk);
+                accumulate_histograms(sorted_notes.data() + begin, end - begin, track_count, out);
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < thread_count; ++t)
+                threads.emplace_back(run_chunk, t, partials[t - 1].data());
+            run_chunk(0, bins.data());
+            for (auto &th : threads)
+                th.join();
+
+            for (const auto &partial : partials)
+            {
+                for (size_t i = 0; i < bin_count; ++i)
+                    bins[i] += partial[i];
+            }
+        }
+
+        for (size_t t = 0; t <= track_count; ++t)
+        {
+            apply_high_note_boost(bins.data() + t * 128);
+        }
+
+        track_hists.resize(track_count);
+        for (size_t t = 0; t < track_count; ++t)
+        {
+            track_hists[t].assign(bins.begin() + t * 128, bins.begin() + (t + 1) * 128);
+        }
+        global_hist.assign(bins.begin() + track_count * 128, bins.end());
+
+        // 常用音域：内置键位预设各自的音域
+        for (const auto &preset : Util::Presets::kBuiltin)
+        {
+            analysis->shifts_for(preset.min_pitch, preset.max_pitch);
+        }
+
+        return analysis;
+    }
+
+    int PitchAnalysis::BestShift(const std::vector<float> &hist, int min_pitch, int max_pitch)
+    {
+        const GaussianWeights &weights = weights_for(min_pitch, max_pitch);
+
+        // 尝试 -4 到 +4 八度的移调（保持和弦性质）
+        float scores[9] = {};
+        for (int oct = -4; oct <= 4; ++oct)
+        {
+            int shift = oct * 12;
+            int low = min_pitch - shift;
+            int high = max_pitch - shift;
+            if (low < 0)
+                low = 0;
+            if (high > 127)
+                high = 127;
+            if (low <= high)
+            {
+                // 加权计数：靠近音域中心的音符获得更高权重，避免选择音符卡在键盘边界的移调
+                float &score = scores[oct + 4];
+                for (int p = low; p <= high; ++p)
+                {
+                    if (hist[p] > 0.0f)
+                    {
+                        score += hist[p] * weights.w[p + shift];
+                    }
+                }
+            }
+        }
+
+        float best_score = -1.0f;
+        int best_oct_idx = 4; // 默认不移调
+        for (int i = 0; i < 9; ++i)
+        {
+            if (scores[i] > best_score)
+            {
+                best_score = scores[i];
+                best_oct_idx = i;
+            }
+            else if (scores[i] == best_score)
+            {
+                // 相同分数时选择绝对值较小的移调
+                if (std::abs(i - 4) < std::abs(best_oct_idx - 4))
+                {
+                    best_oct_idx = i;
+                }
+            }
+        }
+        return (best_oct_idx - 4) * 12;
+    }
+
+    const PitchAnalysis::ShiftSet &PitchAnalysis::shifts_for(int min_pitch, int max_pitch) const
+    {
+        std::lock_guard<std::mutex> lock(m_shift_mutex);
+        auto [it, inserted] = m_shifts.try_emplace(min_pitch * 128 + max_pitch);
+        if (inserted)
+        {
+            ShiftSet &set = it->second;
+            set.global = BestShift(m_global_histogram, min_pitch, max_pitch);
+            set.tracks.reserve(m_track_histograms.size());
+            for (const auto &hist : m_track_histograms)
+            {
+                set.tracks.push_back(BestShift(hist, min_pitch, max_pitch));
+            }
+        }
+        // unordered_map 的节点地址在插入后保持不变，可在锁外读取
+        return it->second;
+    }
+
+    int PitchAnalysis::track_shift(int track, int min_pitch, int max_pitch) const
+    {
+        const ShiftSet &set = shifts_for(min_pitch, max_pitch);
+        if (track < 0 || track >= static_cast<int>(set.tracks.size()))
+            return 0;
+        return set.tracks[track];
+    }
+
+    int PitchAnalysis::global_shift(int min_pitch, int max_pitch) const
+    {
+        return shifts_for(min_pitch, max_pitch).global;
+    }
+
+    // ==================== PitchAnalysisCache ====================
+
+    PitchAnalysisCache &PitchAnalysisCache::Instance()
+    {
+        static PitchAnalysisCache instance;
+        return instance;
+    }
+
+    std::shared_ptr<const PitchAnalysis> PitchAnalysisCache::Find(const std::wstring &path)
+    {
+        std::error_code ec;
+        const uintmax_t size = std::filesystem::file_size(path, ec);
+        if (ec)
+            return nullptr;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(path);
+        if (it == m_entries.end())
+            return nullptr;
+        if (it->second.size != size || it->second.mtime != mtime)
+        {
+            // 文件已被修改，旧分析作废
+            m_entries.erase(it);
+            return nullptr;
+        }
+        it->second.stamp = ++m_clock;
+        return it->second.analysis;
+    }
+
+    void PitchAnalysisCache::Store(const std::wstring &path, std::shared_ptr<const PitchAnalysis> analysis)
+    {
+        if (!analysis)
+            return;
+
+        std::error_code ec;
+        const uintmax_t size = std::filesystem::file_size(path, ec);
+        if (ec)
+            return;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[path] = {size, mtime, std::move(analysis), ++m_clock};
+
+        if (m_entries.size() > MAX_ENTRIES)
+        {
+            auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                                           [](const auto &a, const auto &b)
+                                           { return a.second.stamp < b.second.stamp; });
+            m_entries.erase(oldest);
+        }
+    }
+
+    size_t PitchAnalysisCache::AnalyzeAll(const std::vector<std::wstring> &paths, const std::atomic<bool> *cancel)
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> analyzed{0};
+
+        auto worker = [&]
+        {
+            for (size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1))
+            {
+                if (cancel && cancel->load())
+                    return;
+                if (Find(paths[i]))
+                    continue;
+
+                Midi::MidiFile midi_file(paths[i]);
+                if (!midi_file.is_valid())
+                    continue;
+
+                // 文件之间已经并行，单个文件内部只用本线程累加
+                Store(paths[i], PitchAnalysis::Build(PitchAnalysis::SortedNotes(midi_file),
+                                                     midi_file.raw_notes_by_track.size(), 1));
+                analyzed.fetch_add(1);
+            }
+        };
+
+        size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+        thread_count = std::min(thread_count, paths.size());
+
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < thread_count; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &t : threads)
+            t.join();
+
+        LOG_INFO("批量音高分析完成: 新分析 " << analyzed.load() << " 个文件 / 共 " << paths.size()
+                                            << " 个（" << thread_count << " 线程）");
+        return analyzed.load();
+    }
+
+    // 缓存文件格式（小端）：
+    //   u32 magic, u32 version, u32 条目数
+    //   每个条目：u32 路径字节数 + UTF-8 路径, u64 文件大小, i64 修改时间（file_time_type 计数）,
+    //             u32 音轨数, 音轨数 × 128 个 f32, 128 个 f32 全局直方图,
+    //             u32 音域数, 每个音域：i32 键, i32 全局移调, 音轨数 × i32 音轨移调
+    bool PitchAnalysisCache::Save(const std::filesystem::path &file)
+    {
+        std::string out;
+        uint32_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            put(out, FILE_MAGIC);
+            put(out, FILE_VERSION);
+            put(out, static_cast<uint32_t>(m_entries.size()));
+            for (const auto &[path, entry] : m_entries)
+            {
+                const std::string utf8 = std::filesystem::path(path).u8string();
+                put(out, static_cast<uint32_t>(utf8.size()));
+                out += utf8;
+                put(out, static_cast<uint64_t>(entry.size));
+                put(out, static_cast<int64_t>(entry.mtime.time_since_epoch().count()));
+
+                const PitchAnalysis &analysis = *entry.analysis;
+                put(out, static_cast<uint32_t>(analysis.m_track_histograms.size()));
+                for (const auto &hist : analysis.m_track_histograms)
+                    out.append(reinterpret_cast<const char *>(hist.data()), hist.size() * sizeof(float));
+                out.append(reinterpret_cast<const char *>(analysis.m_global_histogram.data()),
+                           analysis.m_global_histogram.size() * sizeof(float));
+
+                std::lock_guard<std::mutex> shift_lock(analysis.m_shift_mutex);
+                put(out, static_cast<uint32_t>(analysis.m_shifts.size()));
+                for (const auto &[key, set] : analysis.m_shifts)
+                {
+                    put(out, static_cast<int32_t>(key));
+                    put(out, static_cast<int32_t>(set.global));
+                    for (int shift : set.tracks)
+                        put(out, static_cast<int32_t>(shift));
+                }
+                count++;
+            }
+        }
+
+        std::filesystem::path temp = file;
+        temp += ".tmp";
+        {
+            std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+            if (!stream.write(out.data(), static_cast<std::streamsize>(out.size())))
+            {
+                LOG_WARN("音高分析缓存写入失败: " << temp.u8string());
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(temp, file, ec);
+        if (ec)
+        {
+            LOG_WARN("音高分析缓存替换失败: " << file.u8string() << " (" << ec.message() << ")");
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+        LOG_DEBUG("音高分析缓存已保存: " << count << " 个文件, " << out.size() << " 字节");
+        return true;
+    }
+
+    size_t PitchAnalysisCache::Load(const std::filesystem::path &file)
+    {
+        std::ifstream stream(file, std::ios::binary);
+        if (!stream)
+            return 0;
+        const std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        CacheReader reader{data};
+        if (reader.get<uint32_t>() != FILE_MAGIC || reader.get<uint32_t>() != FILE_VERSION)
+        {
+            LOG_INFO("音高分析缓存格式不符，忽略: " << file.u8string());
+            return 0;
+        }
+        const uint32_t count = reader.get<uint32_t>();
+
+        std::vector<std::pair<std::wstring, Entry>> loaded;
+        for (uint32_t i = 0; i < count && reader.ok; ++i)
+        {
+            const uint32_t path_bytes = reader.get<uint32_t>();
+            std::vector<char> utf8;
+            if (path_bytes > kMaxStoredPathBytes || !reader.get_array(utf8, path_bytes))
+                break;
+            Entry entry{};
+            entry.size = reader.get<uint64_t>();
+            entry.mtime = std::filesystem::file_time_type(
+                std::filesystem::file_time_type::duration(reader.get<int64_t>()));
+
+            auto analysis = std::make_shared<PitchAnalysis>();
+            const uint32_t track_count = reader.get<uint32_t>();
+            if (track_count > kMaxStoredTracks)
+                reader.ok = false;
+            analysis->m_track_histograms.resize(reader.ok ? track_count : 0);
+            for (auto &hist : analysis->m_track_histograms)
+                reader.get_array(hist, 128);
+            reader.get_array(analysis->m_global_histogram, 128);
+
+            const uint32_t shift_count = reader.get<uint32_t>();
+            for (uint32_t s = 0; s < shift_count && reader.ok; ++s)
+            {
+                const int32_t key = reader.get<int32_t>();
+                PitchAnalysis::ShiftSet set;
+                set.global = reader.get<int32_t>();
+                std::vector<int32_t> tracks;
+                reader.get_array(tracks, track_count);
+                if (key < 0 || key >= 128 * 128)
+                    reader.ok = false;
+                set.tracks.assign(tracks.begin(), tracks.end());
+                analysis->m_shifts[key] = std::move(set);
+            }
+            if (!reader.ok)
+                break;
+
+            entry.analysis = std::move(analysis);
+            loaded.emplace_back(std::filesystem::u8path(utf8.begin(), utf8.end()).wstring(), std::move(entry));
+        }
+        if (!reader.ok || reader.remaining() != 0)
+        {
+            LOG_WARN("音高分析缓存已损坏，忽略: " << file.u8string());
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t added = 0;
+        for (auto &[path, entry] : loaded)
+        {
+            if (m_entries.size() >= MAX_ENTRIES)
+                break;
+            entry.stamp = ++m_clock;
+            added += m_entries.try_emplace(std::move(path), std::move(entry)).second ? 1 : 0;
+        }
+        LOG_INFO("音高分析缓存已读入: " << added << " 个文件");
+        return added;
+    }
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// 标准库
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 项目头文件
+#include "../midi/MidiParser.h"
+
+namespace Core {
+
+    /// 智能移调所需的音高分析（构建后只读，可跨线程共享）
+    class PitchAnalysis {
+    public:
+        /// 由按起始时间排序的音符构建：时值/力度加权直方图与偏态自适应的最高音加固，
+        /// 并预先计算内置键位预设音域下的移调值
+        /// max_threads 限制大文件分块累加的线程数（0 表示按硬件并发数）；已在工作线程中批量构建时传 1，
+        /// 避免每个工作线程再各自开出一组线程
+        static std::shared_ptr<const PitchAnalysis> Build(const std::vector<Midi::RawNote>& sorted_notes,
+                                                          size_t track_count, size_t max_threads = 0);
+
+        /// 合并各音轨音符并按起始时间排序（PlaybackEngine 与批量分析共用，保证累加顺序一致）
+        static std::vector<Midi::RawNote> SortedNotes(const Midi::MidiFile& midi_file);
+
+        const std::vector<std::vector<float>>& track_histograms() const { return m_track_histograms; }
+        const std::vector<float>& global_histogram() const { return m_global_histogram; }
+
+        /// 指定音域下的最佳八度移调（按音域缓存，首次查询时计算全部音轨）
+        int track_shift(int track, int min_pitch, int max_pitch) const;
+        int global_shift(int min_pitch, int max_pitch) const;
+
+        /// 在 -4 到 +4 八度中选出使音符最靠近音域中心的移调（Gaussian 权重查表）
+        static int BestShift(const std::vector<float>& hist, int min_pitch, int max_pitch);
+
+    private:
+        friend class PitchAnalysisCache;  ///< 持久化时直接读写直方图与移调缓存
+
+        struct ShiftSet {
+            int global = 0;
+            std::vector<int> tracks;
+        };
+
+        const ShiftSet& shifts_for(int min_pitch, int max_pitch) const;
+
+        std::vector<std::vector<float>> m_track_histograms;
+        std::vector<float> m_global_histogram;
+
+        mutable std::mutex m_shift_mutex;
+        mutable std::unordered_map<int, ShiftSet> m_shifts;  ///< 键：min_pitch * 128 + max_pitch
+    };
+
+    /// 按文件缓存的音高分析：键为文件路径，文件大小或修改时间变化即失效
+    /// 可保存到磁盘供下次启动使用，读回的条目同样在 Find 时按大小与修改时间校验
+    class PitchAnalysisCache {
+    public:
+        static PitchAnalysisCache& Instance();
+
+        std::shared_ptr<const PitchAnalysis> Find(const std::wstring& path);
+        void Store(const std::wstring& path, std::shared_ptr<const PitchAnalysis> analysis);
+
+        /// 多线程批量分析（已缓存的文件跳过），cancel 置位时尽快返回；返回新分析的文件数
+        size_t AnalyzeAll(const std::vector<std::wstring>& paths, const std::atomic<bool>* cancel = nullptr);
+
+        /// 写入全部条目（路径、大小、修改时间、直方图与已计算的移调值），先写临时文件再替换
+        bool Save(const std::filesystem::path& file);
+        /// 读回 Save 写入的条目（与内存中已有条目合并，内存中的优先）；
+        /// 文件不存在、版本不符或内容损坏时不加载任何条目，返回读入的条目数
+        size_t Load(const std::filesystem::path& file);
+
+    private:
+        static constexpr uint32_t FILE_MAGIC = 0x48435047;  ///< "GPCH"
+        static constexpr uint32_t FILE_VERSION = 1;
+
+        /// 缓存上限（每个文件约为 音轨数 × 512 字节）
+        static constexpr size_t MAX_ENTRIES = 1024;
+
+        struct Entry {
+            uintmax_t size;
+            std::filesystem::file_time_type mtime;
+            std::shared_ptr<const PitchAnalysis> analysis;
+            uint64_t stamp;  ///< 最近使用序号，超出上限时淘汰最久未用的条目
+        };
+
+        std::mutex m_mutex;
+        std::map<std::wstring, Entry> m_entries;
+        uint64_t m_clock = 0;
+    };
+
+}
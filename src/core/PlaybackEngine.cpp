@@ -1,9 +1,14 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Engine
+
 #include "PlaybackEngine.h"
 #include <algorithm>
 #include <chrono>
+#include <deque>
 #include <map>
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <windows.h>
 #include <mmsystem.h>
 #ifdef max
@@ -12,6 +17,10 @@
 #ifdef min
 #undef min
 #endif
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002  // Windows 10 1803+，旧版 SDK 未定义
+#endif
+#include "../util/KeyPresets.h"
 #include "../util/Logger.h"
 
 // 辅助宏：记录函数入口
@@ -26,6 +35,11 @@ namespace Core
         bool is_specific_track;
         int target_track;
         bool is_smart_transpose;
+        const Util::KeyTable* keymap;   ///< 通道独立键位表，nullptr 表示使用全局键位
+        int min_pitch;                  ///< 该通道键位的音域
+        int max_pitch;
+        int smart_shift;                ///< 智能移调的八度偏移
+        uint8_t stream;                 ///< 通道下标（默认配置为 DEFAULT_STREAM）
     };
 
     PlaybackEngine::PlaybackEngine()
@@ -69,6 +83,7 @@ namespace Core
             std::lock_guard<std::mutex> lock(m_mutex);
             m_playing = false;
             m_paused = false;
+            m_start_pending = false;
         }
 
         m_running = false;
@@ -80,215 +95,101 @@ namespace Core
         }
     }
 
-    void PlaybackEngine::load_midi(const Midi::MidiFile &midi_file)
+    void PlaybackEngine::load_midi(const Midi::MidiFile &midi_file, std::shared_ptr<const PitchAnalysis> analysis)
     {
         LOG_ENTRY();
 
+        // 合并排序与音高分析在锁外完成（命中分析缓存时跳过直方图构建）
+        std::vector<Midi::RawNote> sorted_notes = PitchAnalysis::SortedNotes(midi_file);
+        if (!analysis)
+        {
+            analysis = PitchAnalysis::Build(sorted_notes, midi_file.raw_notes_by_track.size());
+        }
+
         // Stop playback and clear state before loading new file
         stop();
 
         std::lock_guard<std::mutex> lock(m_mutex);
         m_current_time = 0.0;
         m_total_duration = midi_file.length;
+        m_loop_enabled = false;
 
-        m_all_notes.clear();
-
-        // 预估大小以减少重分配
-        size_t totalNotes = 0;
-        for (const auto &track_notes : midi_file.raw_notes_by_track)
-        {
-            totalNotes += track_notes.size();
-        }
-
-        // 内存管理：如果当前容量远大于新文件所需，释放多余内存
-        if (m_all_notes.capacity() > totalNotes * 4) {
-            m_all_notes.shrink_to_fit();
-        }
-        m_all_notes.reserve(totalNotes);
+        m_all_notes = std::move(sorted_notes);
+        m_pitch_analysis = std::move(analysis);
 
-        for (const auto &track_notes : midi_file.raw_notes_by_track)
+        m_tempo_map.clear();
+        const auto &tempo_seconds = midi_file.tempo_seconds();
+        const auto &tempo_values = midi_file.tempo_values();
+        for (size_t i = 0; i < tempo_seconds.size() && i < tempo_values.size(); ++i)
         {
-            m_all_notes.insert(m_all_notes.end(),
-                               track_notes.begin(), track_notes.end());
+            m_tempo_map.push_back({tempo_seconds[i], tempo_values[i] / 1000000.0});
         }
 
-        // Sort raw notes by start time globally
-        std::sort(m_all_notes.begin(), m_all_notes.end(),
-                  [](const Midi::RawNote &a, const Midi::RawNote &b)
-                  {
-                      return a.start_s < b.start_s;
-                  });
+        LOG_INFO("MIDI 文件已加载: 音符数=" << m_all_notes.size()
+                                            << ", 时长=" << m_total_duration << "s"
+                                            << ", 音轨数=" << midi_file.raw_notes_by_track.size());
 
-        // Optimization: Build pitch histograms with duration and velocity weighting
-        m_track_pitch_histograms.clear();
-        m_track_pitch_histograms.resize(midi_file.raw_notes_by_track.size(), std::vector<float>(128, 0.0f));
-        m_global_histogram.clear();
-        m_global_histogram.resize(128, 0.0f);
+        m_config_version++; // Trigger rebuild
+        m_all_notes_generation.fetch_add(1, std::memory_order_release);
+        m_cv.notify_all();
+    }
 
-        for (const auto &raw : m_all_notes)
+    void PlaybackEngine::play()
+    {
+        LOG_ENTRY();
         {
-            if (raw.pitch >= 0 && raw.pitch < 128)
-            {
-                if (raw.track_index >= 0 && raw.track_index < m_track_pitch_histograms.size())
-                {
-                    // sqrt(duration) * velocity: compress extreme duration values while preserving relative importance
-                    m_track_pitch_histograms[raw.track_index][raw.pitch] += std::sqrt(raw.duration) * raw.velocity;
-                }
-                // 全局直方图：排除打击乐（channel 10）、Bass乐器（program 33-40）和低音提琴（program 43）
-                if (raw.channel != 10 && raw.program != 43 && (raw.program < 33 || raw.program > 40))
-                {
-                    m_global_histogram[raw.pitch] += std::sqrt(raw.duration) * raw.velocity;
-                }
-            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_playing = true;
+            m_paused = false;
+            m_start_pending = false;  // 手动播放优先于定时启动
+            m_start_generation++;
         }
-        // 加权偏态系数：负值表示音符偏左分布（高音稀疏），正值表示偏右分布（高音密集）
-        auto compute_skewness = [](const std::vector<float>& hist, int low, int high) -> float {
-            double sum_w = 0.0, sum_pw = 0.0;
-            for (int p = low; p <= high; ++p) {
-                if (hist[p] > 0.0f) {
-                    double w = hist[p];
-                    sum_w += w;
-                    sum_pw += static_cast<double>(p) * w;
-                }
-            }
-            if (sum_w < 1e-10) return 0.0f;
-            double mean = sum_pw / sum_w;
-            double var = 0.0, skew = 0.0;
-            for (int p = low; p <= high; ++p) {
-                if (hist[p] > 0.0f) {
-                    double d = static_cast<double>(p) - mean;
-                    double w = hist[p];
-                    var += d * d * w;
-                    skew += d * d * d * w;
-                }
-            }
-            var /= sum_w;
-            if (var < 1e-10) return 0.0f;
-            double sigma = std::sqrt(var);
-            skew /= sum_w;
-            return static_cast<float>(skew / (sigma * sigma * sigma));
-        };
-
-        // 最高音加固参数（命名常量，便于调试和调整）
-        constexpr float kHighNoteBaseBoost = 1.2f;   // 最高音加固基准系数
-        constexpr float kHighNoteStepDecay = 0.1f;   // 每下降一个半音加固衰减量
-        constexpr int   kMinBoostDepth     = 4;      // 加固最少覆盖半音数
-        constexpr int   kBoostDepthPercent = 15;     // 加固深度占音域宽度的百分比
-
-        // Apply highest pitch weighting to protect melody high points from being transposed out of range
-        for (size_t t = 0; t < m_track_pitch_histograms.size(); ++t)
-        {
-            auto &hist = m_track_pitch_histograms[t];
-
-            // Find highest pitch (topmost non-zero weight)
-            int highest_pitch = 60;  // Default to middle C
-            for (int p = 127; p >= 0; --p)
-            {
-                if (hist[p] > 0.0f)
-                {
-                    highest_pitch = p;
-                    break;
-                }
-            }
-
-            // 基于音域宽度动态计算加固深度（至少 4 个半音，通常为音域宽度的 15%）
-            int lowest_pitch = highest_pitch;
-            for (int p = 0; p < highest_pitch; ++p)
-            {
-                if (hist[p] > 0.0f)
-                {
-                    lowest_pitch = p;
-                    break;
-                }
-            }
-            int pitch_range = highest_pitch - lowest_pitch;
-
-            // 基于分布偏态自适应调整加固深度：负偏态（高音稀疏）→ 加强保护
-            float skewness = compute_skewness(hist, lowest_pitch, highest_pitch);
-            float skew_adjust = 1.0f + std::clamp(-skewness * 0.12f, -0.3f, 0.5f);
+        m_cv.notify_all();
+        LOG_INFO("播放开始");
+    }
 
-            int boost_depth = std::max(kMinBoostDepth, static_cast<int>(pitch_range * kBoostDepthPercent / 100 * skew_adjust));
-            float base_boost = 1.0f + (kHighNoteBaseBoost - 1.0f) * skew_adjust;
+    void PlaybackEngine::play_at(std::chrono::system_clock::time_point target, ClockSource clock_source)
+    {
+        LOG_ENTRY();
 
-            // Apply highest pitch boost: protect melody high points from being transposed out of range
-            int start_pitch = highest_pitch - boost_depth + 1;
-            if (start_pitch < 0) start_pitch = 0;
-            for (int p = start_pitch; p <= highest_pitch; ++p)
-            {
-                if (hist[p] > 0.0f)
-                {
-                    float distance = static_cast<float>(highest_pitch - p);
-                    float boost = base_boost - kHighNoteStepDecay * distance;
-                    if (boost > 1.0f)
-                        hist[p] *= boost;
-                }
-            }
-        }
+        if (!clock_source)
+            clock_source = [] { return std::chrono::system_clock::now(); };
 
-        // Apply highest pitch weighting to global histogram
         {
-            int highest_pitch = 60;
-            for (int p = 127; p >= 0; --p)
-            {
-                if (m_global_histogram[p] > 0.0f)
-                {
-                    highest_pitch = p;
-                    break;
-                }
-            }
-
-            // 基于音域宽度动态计算加固深度
-            int lowest_pitch = highest_pitch;
-            for (int p = 0; p < highest_pitch; ++p)
+            std::lock_guard<std::mutex> send_lock(m_send_mutex);
+            std::vector<std::pair<int, void *>> keys;
             {
-                if (m_global_histogram[p] > 0.0f)
-                {
-                    lowest_pitch = p;
-                    break;
-                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_playing = false;
+                m_paused = false;
+                m_start_target = target;
+                m_start_clock = std::move(clock_source);
+                m_start_generation++;
+                m_start_pending = true;
+                keys = take_active_keys();
             }
-            int pitch_range = highest_pitch - lowest_pitch;
-
-            // 全局直方图的偏态自适应加固
-            float skewness = compute_skewness(m_global_histogram, lowest_pitch, highest_pitch);
-            float skew_adjust = 1.0f + std::clamp(-skewness * 0.12f, -0.3f, 0.5f);
-
-            int boost_depth = std::max(kMinBoostDepth, static_cast<int>(pitch_range * kBoostDepthPercent / 100 * skew_adjust));
-            float base_boost = 1.0f + (kHighNoteBaseBoost - 1.0f) * skew_adjust;
+            m_cv.notify_all();
 
-            int start_pitch = highest_pitch - boost_depth + 1;
-            if (start_pitch < 0) start_pitch = 0;
-            for (int p = start_pitch; p <= highest_pitch; ++p)
-            {
-                if (m_global_histogram[p] > 0.0f)
-                {
-                    float distance = static_cast<float>(highest_pitch - p);
-                    float boost = base_boost - kHighNoteStepDecay * distance;
-                    if (boost > 1.0f)
-                        m_global_histogram[p] *= boost;
-                }
-            }
+            // 锁外释放；持有 m_send_mutex，播放线程此前收集的陈旧事件不会在释放之后发出
+            if (!keys.empty())
+                m_simulator.release_keys(keys);
         }
 
-        LOG_INFO("MIDI 文件已加载: 音符数=" << m_all_notes.size()
-                                            << ", 时长=" << m_total_duration << "s"
-                                            << ", 音轨数=" << midi_file.raw_notes_by_track.size());
-
-        m_config_version++; // Trigger rebuild
-        m_all_notes_generation.fetch_add(1, std::memory_order_release);
-        m_cv.notify_all();
+        LOG_INFO("定时启动已设置，起始位置=" << m_current_time << "s");
     }
 
-    void PlaybackEngine::play()
+    void PlaybackEngine::cancel_scheduled_start()
     {
         LOG_ENTRY();
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_playing = true;
-            m_paused = false;
+            if (!m_start_pending)
+                return;
+            m_start_pending = false;
+            m_start_generation++;
         }
         m_cv.notify_all();
-        LOG_INFO("播放开始");
+        LOG_INFO("定时启动已取消");
     }
 
     void PlaybackEngine::pause()
@@ -314,7 +215,10 @@ namespace Core
             m_playing = false;
             m_paused = false;
             m_current_time = 0.0;
+            m_start_pending = false;
+            m_start_generation++;
         }
+        m_cv.notify_all();
 
         release_all_keys();
 
@@ -347,29 +251,36 @@ namespace Core
 
     void PlaybackEngine::release_all_keys()
     {
+        std::lock_guard<std::mutex> send_lock(m_send_mutex);
         std::vector<std::pair<int, void *>> keys;
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            if (m_active_keys.empty())
-                return;
-            keys.reserve(m_active_keys.size());
-            for (const auto &[k, count] : m_active_keys)
-                keys.push_back(k);
-            m_active_keys.clear();
+            keys = take_active_keys();
         }
-        m_simulator.release_keys(keys);
+        if (!keys.empty())
+            m_simulator.release_keys(keys);
+    }
+
+    std::vector<std::pair<int, void *>> PlaybackEngine::take_active_keys()
+    {
+        std::vector<std::pair<int, void *>> keys;
+        keys.reserve(m_active_keys.size());
+        for (const auto &[k, count] : m_active_keys)
+            keys.push_back(k);
+        m_active_keys.clear();
+        return keys;
     }
 
     bool PlaybackEngine::try_rebuild_events(std::unique_lock<std::mutex>& lock)
     {
         // 在锁内快照共享数据，离开锁后执行重建，避免长时间持锁阻塞 UI 线程
         std::vector<Midi::RawNote> notes_snapshot = m_all_notes;
-        std::vector<std::vector<float>> track_hists_snapshot = m_track_pitch_histograms;
-        std::vector<float> global_hist_snapshot = m_global_histogram;
+        std::shared_ptr<const PitchAnalysis> analysis_snapshot = m_pitch_analysis;
+        std::vector<TempoPoint> tempo_snapshot = m_tempo_map;
         int notes_gen = m_all_notes_generation.load(std::memory_order_acquire);
         lock.unlock();
 
-        rebuild_events(notes_snapshot, track_hists_snapshot, global_hist_snapshot);
+        rebuild_events(notes_snapshot, analysis_snapshot.get(), tempo_snapshot);
 
         lock.lock();
         if (m_all_notes_generation.load(std::memory_order_acquire) == notes_gen) {
@@ -380,29 +291,267 @@ namespace Core
         return false;
     }
 
+    void PlaybackEngine::remap_events()
+    {
+        const int keymap_version = m_key_manager.version();
+        const Util::KeyTable &keymap = *m_key_manager.snapshot();
+
+        int dropped_mapping = 0;
+        for (auto &evt : m_events)
+        {
+            // 通道独立键位不随全局键位变化
+            if (!evt.channel_keymap)
+            {
+                const Util::KeyMapping mapping = keymap.lookup(evt.pitch);
+                evt.vk_code = mapping.vk_code;
+                evt.modifier = mapping.modifier;
+            }
+            if (evt.vk_code == 0 && evt.is_note_on)
+                dropped_mapping++;
+        }
+        m_keymap_version = keymap_version;
+
+        // 关键帧快照记录的是按键，需随键位一起更新
+        build_keyframes();
+
+        m_stat_dropped_mapping.store(dropped_mapping, std::memory_order_relaxed);
+        m_stat_rebuild_id.fetch_add(1, std::memory_order_release);
+
+        LOG_DEBUG_FMT("键位变化，已原地改写 %zu 个事件（无映射音符 %d 个）", m_events.size(), dropped_mapping);
+    }
+
+    bool PlaybackEngine::refresh_events(std::unique_lock<std::mutex> &lock)
+    {
+        const bool offsets_changed = m_stream_offsets_dirty && load_stream_offsets();
+
+        if (m_config_version != m_built_version)
+        {
+            try_rebuild_events(lock);
+            return true;
+        }
+        if (keymap_stale())
+        {
+            // 限速、复音分配与帧量化的结果依赖按键，此时仍需完整重建
+            if (m_keymap_patchable)
+                remap_events();
+            else
+                try_rebuild_events(lock);
+            return true;
+        }
+        return offsets_changed;
+    }
+
+    bool PlaybackEngine::load_stream_offsets()
+    {
+        m_stream_offsets_dirty = false;
+
+        std::array<double, DEFAULT_STREAM + 1> offsets{};
+        const double speed = m_playback_speed;
+        for (size_t i = 0; i < m_channels.size() && i < DEFAULT_STREAM; ++i)
+            offsets[i] = m_channels[i]->latency_offset_us * 1e-6 * speed;
+        if (offsets == m_stream_offsets)
+            return false;
+
+        m_stream_offsets = offsets;
+        const auto [min_it, max_it] = std::minmax_element(offsets.begin(), offsets.end());
+        m_min_stream_offset = *min_it;
+        m_max_stream_offset = *max_it;
+        m_stream_offsets_active = (m_min_stream_offset != 0.0 || m_max_stream_offset != 0.0);
+        LOG_DEBUG_FMT("通道偏移已更新: 范围 %.3f ~ %.3f ms（乐曲时间）",
+                      m_min_stream_offset * 1000.0, m_max_stream_offset * 1000.0);
+        return true;
+    }
+
+    void PlaybackEngine::build_keyframes()
+    {
+        m_keyframes.clear();
+        if (m_events.empty())
+            return;
+
+        struct HeldState {
+            int count;
+            int modifier;
+        };
+        std::unordered_map<std::pair<int, void *>, HeldState, ActiveKeyHash> held;
+
+        m_keyframes.reserve(static_cast<size_t>(m_events.back().time / KEYFRAME_INTERVAL) + 2);
+        double next_time = 0.0;
+        for (size_t idx = 0; idx < m_events.size(); ++idx)
+        {
+            const auto &evt = m_events[idx];
+            while (evt.time >= next_time)
+            {
+                Keyframe kf{next_time, idx, {}};
+                kf.held.reserve(held.size());
+                for (const auto &[key, state] : held)
+                    kf.held.push_back({key.first, state.modifier, key.second, state.count});
+                m_keyframes.push_back(std::move(kf));
+                next_time += KEYFRAME_INTERVAL;
+            }
+
+            if (evt.vk_code == 0)
+                continue;  // 无键位映射的音符
+
+            auto key = std::make_pair(evt.vk_code, evt.window_handle);
+            if (evt.is_note_on)
+            {
+                auto &state = held[key];
+                state.count++;
+                state.modifier = evt.modifier;
+            }
+            else
+            {
+                auto it = held.find(key);
+                if (it != held.end() && --it->second.count == 0)
+                    held.erase(it);
+            }
+        }
+    }
+
+    void PlaybackEngine::restore_held_keys(size_t event_idx)
+    {
+        if (m_keyframes.empty() || event_idx == 0)
+            return;
+
+        // 1. 二分查找 event_idx 之前最近的关键帧（通道偏移下须早于所有可能未生效的事件）
+        auto kf_it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), std::min(event_idx, m_cursor_floor),
+                                      [](size_t idx, const Keyframe &kf)
+                                      { return idx < kf.event_idx; });
+        if (kf_it == m_keyframes.begin())
+            return;
+        const Keyframe &kf = *(kf_it - 1);
+
+        // 2. 从关键帧快照出发，重放关键帧到目标位置之间的事件
+        std::unordered_map<std::pair<int, void *>, std::pair<int, int>, ActiveKeyHash> held;
+        for (const auto &h : kf.held)
+            held[{h.vk_code, h.window_handle}] = {h.count, h.modifier};
+
+        const size_t end_idx = std::min(event_idx, m_events.size());
+        for (size_t idx = kf.event_idx; idx < end_idx; ++idx)
+        {
+            const auto &evt = m_events[idx];
+            if (evt.vk_code == 0)
+                continue;
+            if (m_stream_offsets_active && effective_time(evt) >= m_cursor_time)
+                continue;  // 已暂存、尚未到期的事件
+            auto key = std::make_pair(evt.vk_code, evt.window_handle);
+            if (evt.is_note_on)
+            {
+                auto &state = held[key];
+                state.first++;
+                state.second = evt.modifier;
+            }
+            else
+            {
+                auto it = held.find(key);
+                if (it != held.end() && --it->second.first == 0)
+                    held.erase(it);
+            }
+        }
+
+        // 3. 按下目标时刻应处于按下状态的按键
+        for (const auto &[key, state] : held)
+        {
+            m_active_keys[key] = state.first;
+            m_key_event_buffer.push_back({true, key.first, state.second, key.second});
+        }
+
+        if (!held.empty())
+        {
+            LOG_DEBUG_FMT("跳转恢复持续音: %zu 个按键", held.size());
+        }
+    }
+
+    void PlaybackEngine::resync_held_keys(size_t event_idx)
+    {
+        ActiveKeySet previous = std::move(m_active_keys);
+        m_active_keys.clear();
+
+        const size_t first_new = m_key_event_buffer.size();
+        restore_held_keys(event_idx);
+
+        // 已经按下的按键不重复按下
+        auto out = m_key_event_buffer.begin() + first_new;
+        for (auto it = out; it != m_key_event_buffer.end(); ++it)
+        {
+            if (previous.count({it->vk_code, it->window_handle}) == 0)
+                *out++ = *it;
+        }
+        m_key_event_buffer.erase(out, m_key_event_buffer.end());
+
+        // 新列表中不再按下的按键先释放，再按下新增的按键
+        std::vector<KeyEvent> releases;
+        for (const auto &[key, count] : previous)
+        {
+            if (m_active_keys.count(key) == 0)
+                releases.push_back({false, key.first, 0, key.second});
+        }
+        m_key_event_buffer.insert(m_key_event_buffer.begin() + first_new, releases.begin(), releases.end());
+    }
+
     void PlaybackEngine::seek(double time_s)
     {
-        LOG_DEBUG("跳转播放位置: " << time_s << "s");
+        LOG_DEBUG_FMT("跳转播放位置: %gs", time_s);
 
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_current_time = time_s;
-            m_seek_triggered = true;
-            if (m_current_time < 0)
-                m_current_time = 0;
-            if (m_current_time > m_total_duration)
-                m_current_time = m_total_duration;
+            std::lock_guard<std::mutex> send_lock(m_send_mutex);
+            std::vector<std::pair<int, void *>> keys;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_current_time = time_s;
+                m_seek_triggered = true;
+                if (m_current_time < 0)
+                    m_current_time = 0;
+                if (m_current_time > m_total_duration)
+                    m_current_time = m_total_duration;
+                keys = take_active_keys();
+            }
+
+            // 锁外释放，不阻塞播放线程；持有 m_send_mutex 保证播放线程随后恢复的按键在释放之后发送
+            if (!keys.empty())
+                m_simulator.release_keys(keys);
         }
 
-        release_all_keys();
+        LOG_DEBUG_FMT("跳转完成，当前位置=%gs", m_current_time.load());
+    }
+
+    void PlaybackEngine::set_loop(double a_s, double b_s)
+    {
+        LOG_DEBUG("设置 AB 循环: " << a_s << "s - " << b_s << "s");
+
+        if (a_s > b_s)
+            std::swap(a_s, b_s);
+        if (a_s < 0)
+            a_s = 0;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // 区间过短时回绕会退化为忙循环，直接关闭
+        if (b_s - a_s < MIN_LOOP_LENGTH)
+        {
+            m_loop_enabled = false;
+            return;
+        }
+        m_loop_a = a_s;
+        m_loop_b = b_s;
+        m_loop_enabled = true;
+        m_cv.notify_all();
+    }
 
-        LOG_DEBUG("跳转完成，当前位置=" << m_current_time << "s");
+    void PlaybackEngine::clear_loop()
+    {
+        LOG_DEBUG("清除 AB 循环");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loop_enabled = false;
     }
 
     void PlaybackEngine::set_speed(double speed)
     {
         LOG_DEBUG("设置播放速度: " << speed << "x");
+        std::lock_guard<std::mutex> lock(m_mutex);
         m_playback_speed = speed;
+        m_stream_offsets_dirty = true;  // 通道偏移按墙上时间给出，换算到乐曲时间随速度变化
+        m_cv.notify_all();
     }
 
     void PlaybackEngine::set_channel_transpose(int channel, int semitones)
@@ -485,6 +634,55 @@ namespace Core
         }
     }
 
+    void PlaybackEngine::set_channel_keymap(int channel, int preset)
+    {
+        LOG_DEBUG("设置通道 " << channel << " 键位配置: " << preset);
+
+        if (preset < -1 || preset >= static_cast<int>(Util::Presets::BUILTIN_COUNT))
+        {
+            LOG_WARN("无效的键位配置: " << preset << "，改用全局键位");
+            preset = -1;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (channel >= 0 && channel < 16 && channel < m_channels.size())
+        {
+            if (m_channels[channel]->keymap_preset != preset)
+            {
+                m_channels[channel]->keymap_preset = preset;
+                m_config_version++;
+                m_cv.notify_all();
+            }
+        }
+        else
+        {
+            LOG_WARN("无效的通道编号: " << channel);
+        }
+    }
+
+    void PlaybackEngine::set_channel_latency_offset(int channel, int offset_us)
+    {
+        LOG_DEBUG("设置通道 " << channel << " 发送偏移: " << offset_us << "us");
+
+        offset_us = std::clamp(offset_us, -MAX_CHANNEL_OFFSET_US, MAX_CHANNEL_OFFSET_US);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (channel >= 0 && channel < 16 && channel < m_channels.size())
+        {
+            if (m_channels[channel]->latency_offset_us != offset_us)
+            {
+                m_channels[channel]->latency_offset_us = offset_us;
+                // 不改变 m_config_version：事件列表不变，播放线程只需按新偏移重新定位游标
+                m_stream_offsets_dirty = true;
+                m_cv.notify_all();
+            }
+        }
+        else
+        {
+            LOG_WARN("无效的通道编号: " << channel);
+        }
+    }
+
     void PlaybackEngine::set_pitch_range(int min_pitch, int max_pitch)
     {
         LOG_DEBUG("设置音域范围: " << min_pitch << " - " << max_pitch);
@@ -512,31 +710,129 @@ namespace Core
         }
     }
 
-    void PlaybackEngine::notify_keymap_changed()
+    void PlaybackEngine::set_decompose_timing(int chord_threshold_ms, int stagger_ms, int stagger_beat_div)
     {
+        chord_threshold_ms = std::clamp(chord_threshold_ms, 0, 1000);
+        stagger_ms = std::clamp(stagger_ms, 0, 1000);
+        if (stagger_beat_div < 0)
+            stagger_beat_div = 0;
+        LOG_DEBUG("设置和弦分解时序: 判定窗口=" << chord_threshold_ms << "ms, 错开="
+                  << (stagger_beat_div > 0 ? "1/" + std::to_string(stagger_beat_div) + " 拍"
+                                           : std::to_string(stagger_ms) + "ms"));
+
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_config_version++;
-        m_cv.notify_all();
+        if (m_chord_threshold_ms != chord_threshold_ms || m_stagger_ms != stagger_ms ||
+            m_stagger_beat_div != stagger_beat_div)
+        {
+            m_chord_threshold_ms = chord_threshold_ms;
+            m_stagger_ms = stagger_ms;
+            m_stagger_beat_div = stagger_beat_div;
+            if (m_decompose)
+            {
+                m_config_version++;
+                m_cv.notify_all();
+            }
+        }
     }
 
-    // Helper structures and functions
-    // TempNote struct moved to header
-
-    static int clamp_pitch(int pitch, int min_p, int max_p, bool smart)
+    void PlaybackEngine::set_tick_rate(int hz)
     {
-        int current = pitch;
-        if (smart)
+        if (hz < 0)
+            hz = 0;
+        LOG_DEBUG("设置帧量化频率: " << hz << "Hz");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tick_rate_hz != hz)
         {
-            while (current < min_p)
-                current += 12;
-            while (current > max_p)
-                current -= 12;
-            if (current < min_p)
-                current = min_p;
-            if (current > max_p)
-                current = max_p;
+            m_tick_rate_hz = hz;
+            m_config_version++;
+            m_cv.notify_all();
         }
-        else
+    }
+
+    void PlaybackEngine::set_rate_limit(int max_notes, int window_ms)
+    {
+        if (max_notes < 0)
+            max_notes = 0;
+        if (window_ms < 1)
+            window_ms = 1;
+        LOG_DEBUG("设置输入限速: " << max_notes << " 个按键 / " << window_ms << "ms");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_rate_limit_notes != max_notes || m_rate_limit_window_ms != window_ms)
+        {
+            m_rate_limit_notes = max_notes;
+            m_rate_limit_window_ms = window_ms;
+            m_config_version++;
+            m_cv.notify_all();
+        }
+    }
+
+    void PlaybackEngine::set_polyphony(int max_voices, VoiceStealPolicy policy)
+    {
+        if (max_voices < 0)
+            max_voices = 0;
+        LOG_DEBUG("设置复音上限: " << max_voices << " 个按键, 抢占策略=" << static_cast<int>(policy));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_max_polyphony != max_voices || m_voice_steal != policy)
+        {
+            m_max_polyphony = max_voices;
+            m_voice_steal = policy;
+            m_config_version++;
+            m_cv.notify_all();
+        }
+    }
+
+    std::shared_ptr<const PitchAnalysis> PlaybackEngine::get_pitch_analysis()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pitch_analysis;
+    }
+
+    RebuildStats PlaybackEngine::get_rebuild_stats() const
+    {
+        RebuildStats stats;
+        stats.rebuild_id = m_stat_rebuild_id.load(std::memory_order_acquire);
+        stats.dropped_mapping = m_stat_dropped_mapping.load(std::memory_order_relaxed);
+        stats.dropped_rate_limit = m_stat_dropped_rate_limit.load(std::memory_order_relaxed);
+        stats.stolen_voices = m_stat_stolen_voices.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    StartStats PlaybackEngine::get_start_stats() const
+    {
+        StartStats stats;
+        stats.start_id = m_stat_start_id.load(std::memory_order_acquire);
+        stats.error_us = m_stat_start_error_us.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void PlaybackEngine::notify_keymap_changed()
+    {
+        // 新键位表已由 KeyManager 发布，播放线程比较版本号后原地改写事件
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv.notify_all();
+    }
+
+    // Helper structures and functions
+    // TempNote struct moved to header
+
+    static int clamp_pitch(int pitch, int min_p, int max_p, bool smart)
+    {
+        int current = pitch;
+        if (smart)
+        {
+            while (current < min_p)
+                current += 12;
+            while (current > max_p)
+                current -= 12;
+            if (current < min_p)
+                current = min_p;
+            if (current > max_p)
+                current = max_p;
+        }
+        else
         {
             // Manual transpose: Do not clamp.
             // If out of range, it will be dropped by key mapping check.
@@ -544,13 +840,375 @@ namespace Core
         return current;
     }
 
-    void PlaybackEngine::rebuild_events(const std::vector<Midi::RawNote>& input_notes,
-                                       const std::vector<std::vector<float>>& track_hists,
-                                       const std::vector<float>& global_hist)
+    void PlaybackEngine::decompose_chords(std::vector<TempNote>& notes, double chord_threshold_s, double stagger_s,
+                                          const std::vector<TempoPoint>& tempo_map, int stagger_beat_div)
+    {
+        // 每个窗口独立分解：只保存当前和弦的下标与上一个已定位的音符（单音模式截断用）
+        struct WindowState {
+            void* hwnd;
+            double anchor;              ///< 当前和弦第一个音符的起始时间
+            std::vector<size_t> chord;  ///< 当前和弦在 notes 中的下标
+            TempNote* last;             ///< 已定位的最后一个音符
+        };
+        std::vector<WindowState> windows;  // 目标窗口很少，线性查找即可
+
+        // 按拍错开：取和弦起点所在节拍段的每拍时长
+        auto stagger_at = [&](double time_s)
+        {
+            if (stagger_beat_div <= 0)
+                return stagger_s;
+            auto it = std::upper_bound(tempo_map.begin(), tempo_map.end(), time_s,
+                                       [](double t, const TempoPoint &p) { return t < p.time_s; });
+            const double beat_s = (it == tempo_map.begin()) ? (tempo_map.empty() ? 0.5 : tempo_map.front().beat_s)
+                                                            : std::prev(it)->beat_s;
+            return beat_s / stagger_beat_div;
+        };
+
+        // 和弦结束：按音高从低到高依次错开，整体展开限制在 next_start 之前，再按时间顺序截断为单音
+        auto flush = [&](WindowState &w, double next_start)
+        {
+            auto &chord = w.chord;
+            if (chord.size() > 1)
+            {
+                std::sort(chord.begin(), chord.end(), [&](size_t a, size_t b)
+                          { return notes[a].pitch != notes[b].pitch ? notes[a].pitch < notes[b].pitch : a < b; });
+
+                const double step = std::min(stagger_at(w.anchor), (next_start - w.anchor) / chord.size());
+                for (size_t k = 0; k < chord.size(); ++k)
+                {
+                    TempNote &n = notes[chord[k]];
+                    const double length = n.end - n.start;
+                    n.start = w.anchor + k * step;
+                    n.end = n.start + length;
+                }
+            }
+
+            for (size_t idx : chord)
+            {
+                TempNote &n = notes[idx];
+                // Enforce monophony: previous note ends when this one starts (perfect legato allowed)
+                if (w.last && w.last->end > n.start)
+                    w.last->end = n.start;
+                w.last = &n;
+            }
+            chord.clear();
+        };
+
+        for (size_t i = 0; i < notes.size(); ++i)
+        {
+            TempNote &n = notes[i];
+            if (n.end <= n.start)
+                continue;
+
+            auto it = std::find_if(windows.begin(), windows.end(),
+                                   [&](const WindowState &w) { return w.hwnd == n.hwnd; });
+            if (it == windows.end())
+            {
+                windows.push_back({n.hwnd, 0.0, {}, nullptr});
+                it = std::prev(windows.end());
+            }
+
+            WindowState &w = *it;
+            if (!w.chord.empty() && n.start - w.anchor >= chord_threshold_s)
+                flush(w, n.start);
+            if (w.chord.empty())
+                w.anchor = n.start;
+            w.chord.push_back(i);
+        }
+
+        for (auto &w : windows)
+        {
+            if (!w.chord.empty())
+                flush(w, std::numeric_limits<double>::infinity());
+        }
+    }
+
+    void PlaybackEngine::quantize_notes(std::vector<TempNote>& notes, double tick_s)
+    {
+        // 按 (窗口, 按键) 分组，组内按起始时间排序
+        std::vector<TempNote*> order;
+        order.reserve(notes.size());
+        for (auto &n : notes)
+        {
+            if (n.end > n.start)
+                order.push_back(&n);
+        }
+        std::sort(order.begin(), order.end(), [](const TempNote *a, const TempNote *b)
+                  {
+                      if (a->hwnd != b->hwnd)
+                          return std::less<void *>()(a->hwnd, b->hwnd);
+                      if (a->vk != b->vk)
+                          return a->vk < b->vk;
+                      return a->start < b->start;
+                  });
+
+        // 使用整数帧序号计算，保证同一帧内的事件时间完全相等，
+        // 最终排序时 Note Off 稳定地排在同帧 Note On 之前
+        auto to_tick = [tick_s](double t)
+        { return static_cast<long long>(std::llround(t / tick_s)); };
+
+        TempNote *prev = nullptr;
+        long long prev_on = 0;
+        long long prev_off = 0;
+        for (TempNote *n : order)
+        {
+            if (prev && (prev->hwnd != n->hwnd || prev->vk != n->vk))
+                prev = nullptr;
+
+            long long on = to_tick(n->start);
+            long long off = to_tick(n->end);
+
+            if (prev)
+            {
+                // 同一按键重复触发：前一音符至少按住一帧，且释放后至少空出一帧再按下
+                if (on < prev_on + 2)
+                    on = prev_on + 2;
+                if (prev_off > on - 1)
+                    prev_off = on - 1;
+                prev->end = prev_off * tick_s;
+            }
+
+            // 每个音符至少按住一帧，避免同帧按下/释放被游戏合并丢弃
+            if (off < on + 1)
+                off = on + 1;
+
+            n->start = on * tick_s;
+            n->end = off * tick_s;
+            prev = n;
+            prev_on = on;
+            prev_off = off;
+        }
+    }
+
+    int PlaybackEngine::apply_polyphony_limit(std::vector<TempNote>& notes, int max_voices, VoiceStealPolicy policy)
+    {
+        // 按 (窗口, 起始时间) 排序扫描：和弦分解按音高改写起始时间，notes 本身在窗口内不一定有序
+        std::vector<TempNote*> order;
+        order.reserve(notes.size());
+        for (auto &n : notes)
+        {
+            if (n.end > n.start && n.vk != 0)
+                order.push_back(&n);
+        }
+        std::sort(order.begin(), order.end(), [](const TempNote *a, const TempNote *b)
+                  {
+                      if (a->hwnd != b->hwnd)
+                          return std::less<void *>()(a->hwnd, b->hwnd);
+                      if (a->start != b->start)
+                          return a->start < b->start;
+                      return a < b;
+                  });
+
+        // 当前窗口的释放时间小顶堆，堆顶为最早释放的按键；容量固定为 max_voices，扫描中不再分配
+        std::vector<TempNote*> heap;
+        heap.reserve(static_cast<size_t>(max_voices));
+        auto releases_later = [](const TempNote *a, const TempNote *b) { return a->end > b->end; };
+
+        // 抢占候选的先后：起始更早者优先，同时起音按音符顺序（保证结果确定）
+        auto older = [](const TempNote *a, const TempNote *b)
+        { return a->start != b->start ? a->start < b->start : a < b; };
+
+        int stolen = 0;
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            TempNote &n = *order[i];
+            if (i > 0 && order[i - 1]->hwnd != n.hwnd)
+                heap.clear();
+
+            // 释放已结束的按键（Note Off 与同时刻的 Note On 不冲突）
+            while (!heap.empty() && heap.front()->end <= n.start)
+            {
+                std::pop_heap(heap.begin(), heap.end(), releases_later);
+                heap.pop_back();
+            }
+
+            if (static_cast<int>(heap.size()) < max_voices)
+            {
+                heap.push_back(&n);
+                std::push_heap(heap.begin(), heap.end(), releases_later);
+                continue;
+            }
+
+            // 已满：从正在按住的按键与新音符中选出被抢占者
+            TempNote *victim = nullptr;
+            switch (policy)
+            {
+            case VoiceStealPolicy::Oldest:
+                victim = *std::min_element(heap.begin(), heap.end(), older);
+                break;
+
+            case VoiceStealPolicy::Quietest:
+                victim = &n;
+                for (TempNote *v : heap)
+                {
+                    if (v->velocity < victim->velocity || (v->velocity == victim->velocity && older(v, victim)))
+                        victim = v;
+                }
+                break;
+
+            case VoiceStealPolicy::KeepOuter:
+            {
+                // 最高音（旋律）与最低音（低音）不参与抢占；候选不足时退化为抢占最早按下的按键
+                TempNote *highest = &n;
+                TempNote *lowest = &n;
+                for (TempNote *v : heap)
+                {
+                    if (v->pitch > highest->pitch)
+                        highest = v;
+                    if (v->pitch < lowest->pitch)
+                        lowest = v;
+                }
+                auto consider = [&](TempNote *v)
+                {
+                    if (v != highest && v != lowest && (!victim || older(v, victim)))
+                        victim = v;
+                };
+                for (TempNote *v : heap)
+                    consider(v);
+                consider(&n);
+                if (!victim)
+                    victim = *std::min_element(heap.begin(), heap.end(), older);
+                break;
+            }
+            }
+
+            stolen++;
+            if (victim == &n)
+            {
+                n.end = n.start; // Mark invalid
+                continue;
+            }
+
+            // 被抢占的按键在新音符按下时提前释放（与新音符同时起音的则整个丢弃）
+            *std::find(heap.begin(), heap.end(), victim) = heap.back();
+            heap.pop_back();
+            std::make_heap(heap.begin(), heap.end(), releases_later);
+            victim->end = std::max(victim->start, n.start);
+
+            heap.push_back(&n);
+            std::push_heap(heap.begin(), heap.end(), releases_later);
+        }
+        return stolen;
+    }
+
+    int PlaybackEngine::apply_rate_limit(std::vector<TempNote>& notes, int max_notes, double window_s,
+                                          double onset_cluster_s)
+    {
+        // 按 (窗口, 起始时间, 音高) 排序，保证结果确定
+        std::vector<TempNote*> order;
+        order.reserve(notes.size());
+        for (auto &n : notes)
+        {
+            if (n.end > n.start)
+                order.push_back(&n);
+        }
+        std::sort(order.begin(), order.end(), [](const TempNote *a, const TempNote *b)
+                  {
+                      if (a->hwnd != b->hwnd)
+                          return std::less<void *>()(a->hwnd, b->hwnd);
+                      if (a->start != b->start)
+                          return a->start < b->start;
+                      return a->pitch < b->pitch;
+                  });
+
+        // 按起音簇（起始时间相差 < onset_cluster_s，与和弦判定窗口一致）依次处理：
+        // 簇内外声部（最高音与最低音）优先，其余按力度从高到低；
+        // 只有加入后包含它的任意 window_s 区间内按键数仍不超过 max_notes 时才保留（滑动窗口，而非固定分桶）
+        int dropped = 0;
+        std::deque<double> kept;        // 当前窗口最近保留音符的起始时间（升序）
+        std::vector<size_t> cluster;
+
+        // 加入 t 后，只需检查右端点为 t 或其后已保留音符、且包含 t 的区间 (p - window_s, p]
+        auto fits = [&](double t)
+        {
+            auto count_window = [&](double p)
+            {
+                const auto first = std::upper_bound(kept.begin(), kept.end(), p - window_s);
+                const auto last = std::upper_bound(kept.begin(), kept.end(), p);
+                return static_cast<int>(last - first) + 1;
+            };
+            if (count_window(t) > max_notes)
+                return false;
+            for (auto it = std::upper_bound(kept.begin(), kept.end(), t); it != kept.end() && *it - window_s < t; ++it)
+            {
+                if (count_window(*it) > max_notes)
+                    return false;
+            }
+            return true;
+        };
+
+        size_t i = 0;
+        while (i < order.size())
+        {
+            if (i == 0 || order[i]->hwnd != order[i - 1]->hwnd)
+                kept.clear();
+            while (!kept.empty() && kept.front() <= order[i]->start - window_s)
+                kept.pop_front();
+
+            size_t j = i + 1;
+            int lo = order[i]->pitch;
+            int hi = order[i]->pitch;
+            while (j < order.size() && order[j]->hwnd == order[i]->hwnd &&
+                   order[j]->start - order[i]->start < onset_cluster_s)
+            {
+                lo = std::min(lo, order[j]->pitch);
+                hi = std::max(hi, order[j]->pitch);
+                j++;
+            }
+
+            cluster.clear();
+            for (size_t k = i; k < j; ++k)
+                cluster.push_back(k);
+            auto is_outer = [&](size_t k) { return order[k]->pitch == lo || order[k]->pitch == hi; };
+            std::sort(cluster.begin(), cluster.end(), [&](size_t a, size_t b)
+                      {
+                          if (is_outer(a) != is_outer(b))
+                              return is_outer(a);
+                          if (order[a]->velocity != order[b]->velocity)
+                              return order[a]->velocity > order[b]->velocity;
+                          return a < b;
+                      });
+
+            for (size_t k : cluster)
+            {
+                TempNote *n = order[k];
+                if (fits(n->start))
+                {
+                    kept.insert(std::upper_bound(kept.begin(), kept.end(), n->start), n->start);
+                }
+                else
+                {
+                    n->end = n->start; // Mark invalid
+                    dropped++;
+                }
+            }
+
+            i = j;
+        }
+        return dropped;
+    }
+
+    void PlaybackEngine::rebuild_events(const std::vector<Midi::RawNote>& input_notes, const PitchAnalysis* analysis,
+                                        const std::vector<TempoPoint>& tempo_map)
     {
         LOG_DEBUG("重建事件列表");
 
+        // 先读版本再读键位表：期间若有新表发布，下一轮会再原地改写一次
+        const int keymap_version = m_key_manager.version();
+        const Util::KeyTable &keymap = *m_key_manager.snapshot();
+        // 限速、复音分配与帧量化按按键计算，启用时无映射音符须在此丢弃，键位变化只能完整重建
+        const int rate_limit = m_rate_limit_notes;
+        const int tick_rate = m_tick_rate_hz;
+        const int max_voices = m_max_polyphony;
+        const bool keep_unmapped = (rate_limit <= 0 && tick_rate <= 0 && max_voices <= 0);
+        m_keymap_version = keymap_version;
+        m_keymap_patchable = keep_unmapped;
+
         m_events.clear();
+        m_keyframes.clear();
+        m_stat_dropped_mapping.store(0, std::memory_order_relaxed);
+        m_stat_dropped_rate_limit.store(0, std::memory_order_relaxed);
+        m_stat_stolen_voices.store(0, std::memory_order_relaxed);
 
         // 内存管理：如果容量远大于可能需要的最大值，释放多余内存
         size_t max_events = input_notes.size() * 2;
@@ -573,10 +1231,14 @@ namespace Core
         int total_added = 0;
 
         std::vector<ChannelSettings *> active_configs;
-        for (const auto &ch : m_channels)
+        std::vector<uint8_t> active_streams;
+        for (size_t i = 0; i < m_channels.size() && i < DEFAULT_STREAM; ++i)
         {
-            if (ch->enabled)
-                active_configs.push_back(ch.get());
+            if (m_channels[i]->enabled)
+            {
+                active_configs.push_back(m_channels[i].get());
+                active_streams.push_back(static_cast<uint8_t>(i));
+            }
         }
 
         // Fallback: If no channels enabled, use default global config (match Python behavior)
@@ -588,13 +1250,15 @@ namespace Core
             default_global.transpose = 0;
             default_global.window_handle = nullptr;
             active_configs.push_back(&default_global);
+            active_streams.push_back(DEFAULT_STREAM);
         }
 
         // 即用即走：配置快照作为局部变量
         std::vector<ValidConfig> valid_configs;
 
-        for (auto *ch_config : active_configs)
+        for (size_t i = 0; i < active_configs.size(); ++i)
         {
+            auto *ch_config = active_configs[i];
             if (!ch_config->enabled)
                 continue;
 
@@ -612,104 +1276,37 @@ namespace Core
             vc.target_track = ch_config->track_index;
             vc.is_specific_track = (vc.target_track != -1);
             vc.is_smart_transpose = (ch_config->transpose == 0);
-            valid_configs.push_back(vc);
-        }
-
-        // 优化：使用栈数组替代 vector，消除堆分配
-        // 使用 float 支持时值加权直方图
-        // 八度移调（模12），保持和弦性质不变
-        auto compute_best_shift = [&](const std::vector<float> &hist)
-        {
-            const float center = (m_min_pitch + m_max_pitch) / 2.0f;
-            const float half_range = std::max((m_max_pitch - m_min_pitch) / 2.0f, 1.0f);
-            
-            // 尝试 -4 到 +4 八度的移调（保持和弦性质）
-            float scores[9] = {};
-            for (int oct = -4; oct <= 4; ++oct)
-            {
-                int shift = oct * 12;
-                int low = m_min_pitch - shift;
-                int high = m_max_pitch - shift;
-                if (low < 0)
-                    low = 0;
-                if (high > 127)
-                    high = 127;
-                if (low <= high)
-                {
-                    // 加权计数：靠近音域中心（m_min_pitch ~ m_max_pitch 的中央）的音符获得更高权重
-                    // 边界权重趋近于 0，中心权重 = 1.0，避免选择音符卡在键盘边界的移调
-                    float &score = scores[oct + 4];
-                    for (int p = low; p <= high; ++p)
-                    {
-                        if (hist[p] > 0.0f)
-                        {
-                            float mapped = static_cast<float>(p + shift);
-                            float dist = std::abs(mapped - center);
-                            // Gaussian 加权：音域中心权重 1.0，向边缘平滑衰减至趋于 0
-                            // 相比线性衰减，Gaussian 在中心附近更平缓、在边界更陡峭，
-                            // 避免移调结果将音符挤在键盘最边缘
-                            const float sigma = half_range * 0.4f;
-                            float weight = std::exp(-0.5f * (dist / sigma) * (dist / sigma));
-                            score += hist[p] * weight;
-                        }
-                    }
-                }
-            }
-            
-            float best_score = -1.0f;
-            int best_oct_idx = 4; // 默认不移调
-            for (int i = 0; i < 9; ++i)
+            vc.keymap = nullptr;
+            vc.min_pitch = m_min_pitch;
+            vc.max_pitch = m_max_pitch;
+            vc.smart_shift = 0;
+            vc.stream = active_streams[i];
+
+            // 通道键位配置：在此一次性解析为查找表指针与音域，逐音符映射时无额外开销
+            const int preset = ch_config->keymap_preset;
+            if (preset >= 0 && preset < static_cast<int>(Util::Presets::BUILTIN_COUNT))
             {
-                if (scores[i] > best_score)
-                {
-                    best_score = scores[i];
-                    best_oct_idx = i;
-                }
-                else if (scores[i] == best_score)
-                {
-                    // 相同分数时选择绝对值较小的移调
-                    if (std::abs(i - 4) < std::abs(best_oct_idx - 4))
-                    {
-                        best_oct_idx = i;
-                    }
-                }
+                const auto &profile = Util::Presets::kBuiltin[preset];
+                vc.keymap = profile.table;
+                vc.min_pitch = profile.min_pitch;
+                vc.max_pitch = profile.max_pitch;
             }
-            return (best_oct_idx - 4) * 12;
-        };
+            valid_configs.push_back(vc);
+        }
 
-        // 计算移调值：支持混合模式
+        // 计算移调值：支持混合模式，按各配置自己的音域评分（结果由 PitchAnalysis 按音域缓存）
         // - 特定音轨配置：使用该音轨独立计算的移调值
         // - 全部音轨配置：使用全局直方图计算的统一移调值（相对移调，保持音轨音高关系）
-        std::vector<int> track_best_shifts(track_hists.size(), 0);
-        int global_shift = 0;
-
-        // 先检查配置类型，按需计算
-        bool has_global_config = false;
-        bool has_specific_track_config = false;
-        for (const auto &vc : valid_configs)
+        for (auto &vc : valid_configs)
         {
+            // 音域为全范围 (0-127) 时禁用智能移调，避免对打击乐等特殊音轨产生干扰
+            if (!analysis || !vc.is_smart_transpose || (vc.min_pitch == 0 && vc.max_pitch == 127))
+                continue;
+
             if (vc.is_specific_track)
-                has_specific_track_config = true;
+                vc.smart_shift = analysis->track_shift(vc.target_track, vc.min_pitch, vc.max_pitch);
             else
-                has_global_config = true;
-        }
-
-        // 音域为全范围 (0-127) 时禁用智能移调，避免对打击乐等特殊音轨产生干扰
-        bool is_full_range = (m_min_pitch == 0 && m_max_pitch == 127);
-
-        // 仅在有特定音轨配置且非全范围时才计算独立移调值
-        if (has_specific_track_config && !is_full_range)
-        {
-            for (size_t i = 0; i < track_hists.size(); ++i)
-            {
-                track_best_shifts[i] = compute_best_shift(track_hists[i]);
-            }
-        }
-
-        // 全局配置：使用预计算的全局直方图计算统一移调值
-        if (has_global_config && !is_full_range)
-        {
-            global_shift = compute_best_shift(global_hist);
+                vc.smart_shift = analysis->global_shift(vc.min_pitch, vc.max_pitch);
         }
 
         // Optimization: Iterate input_notes ONCE (Cache Locality)
@@ -736,24 +1333,12 @@ namespace Core
                 // 智能移调：特定音轨用独立移调，全部音轨用统一移调
                 if (vc.is_smart_transpose)
                 {
-                    if (vc.is_specific_track)
-                    {
-                        // 特定音轨：使用该音轨独立计算的移调值
-                        if (raw.track_index >= 0 && raw.track_index < static_cast<int>(track_best_shifts.size()))
-                        {
-                            transpose += track_best_shifts[raw.track_index];
-                        }
-                    }
-                    else
-                    {
-                        // 全部音轨：使用全局统一移调值（相对移调，保持音轨音高关系）
-                        transpose += global_shift;
-                    }
+                    transpose += vc.smart_shift;
                 }
 
                 int raw_pitch = raw.pitch + transpose;
 
-                int current_pitch = clamp_pitch(raw_pitch, m_min_pitch, m_max_pitch, vc.is_smart_transpose);
+                int current_pitch = clamp_pitch(raw_pitch, vc.min_pitch, vc.max_pitch, vc.is_smart_transpose);
 
                 // Moved mapping to later stage
 
@@ -763,7 +1348,10 @@ namespace Core
                                  0, // modifier placeholder
                                  vc.settings->window_handle,
                                  current_pitch,
-                                 raw.track_index});
+                                 raw.track_index,
+                                 raw.velocity,
+                                 vc.keymap,
+                                 vc.stream});
                 total_added++;
             }
         }
@@ -839,94 +1427,27 @@ namespace Core
         // 4. Decompose Logic (Run last if enabled)
         if (m_decompose)
         {
-            const double CHORD_THRESHOLD = 0.03;
-            const double STAGGER = 0.05;
-
-            std::unordered_map<void *, std::vector<TempNote>> grouped;
-            for (const auto &n : notes)
-            {
-                if (n.end > n.start)
-                {
-                    grouped[n.hwnd].push_back(n);
-                }
-            }
-
-            std::vector<TempNote> mono_notes;
-            mono_notes.reserve(notes.size());
-
-            for (auto &group : grouped)
-            {
-                auto &g = group.second;
-                std::sort(g.begin(), g.end(), [](const TempNote &a, const TempNote &b)
-                          { return a.start < b.start; });
-
-                size_t i = 0;
-                while (i < g.size())
-                {
-                    size_t j = i + 1;
-                    while (j < g.size() && (g[j].start - g[i].start) < CHORD_THRESHOLD)
-                    {
-                        j++;
-                    }
-
-                    if (j - i > 1)
-                    {
-                        std::sort(g.begin() + i, g.begin() + j, [](const TempNote &a, const TempNote &b)
-                                  { return a.pitch < b.pitch; });
-
-                        for (size_t k = 1; k < j - i; ++k)
-                        {
-                            double shift = k * STAGGER;
-                            g[i + k].start += shift;
-                            g[i + k].end += shift;
-                        }
-                    }
-
-                    i = j;
-                }
-
-                std::sort(g.begin(), g.end(), [](const TempNote &a, const TempNote &b)
-                          { return a.start < b.start; });
-
-                for (size_t k = 0; k + 1 < g.size(); ++k)
-                {
-                    // Enforce gap between notes in monophonic mode
-                    // Removed MONO_GAP to allow perfect legato
-                    double max_end = g[k + 1].start;
-                    if (g[k].end > max_end)
-                    {
-                        g[k].end = max_end;
-                    }
-                }
-
-                for (const auto &n : g)
-                {
-                    if (n.end > n.start)
-                    {
-                        mono_notes.push_back(n);
-                    }
-                }
-            }
-
-            notes = std::move(mono_notes);
+            decompose_chords(notes, m_chord_threshold_ms / 1000.0, m_stagger_ms / 1000.0,
+                             tempo_map, m_stagger_beat_div);
         }
 
         // 5. Key Mapping (Moved to end)
+        // 可原地改写时保留无映射音符（vk 为 0，播放时跳过），换键位后无需重建
         int dropped_mapping_late = 0;
         for (auto &note : notes)
         {
             if (note.end <= note.start)
                 continue; // Skip invalid notes
 
-            auto mapping = m_key_manager.get_mapping(note.pitch);
+            const Util::KeyMapping mapping = (note.keymap ? *note.keymap : keymap).lookup(note.pitch);
+            note.vk = mapping.vk_code;
+            note.modifier = mapping.modifier;
             if (mapping.vk_code == 0)
             {
                 dropped_mapping_late++;
-                note.end = note.start; // Mark as invalid
-                continue;
+                if (!keep_unmapped)
+                    note.end = note.start; // Mark as invalid
             }
-            note.vk = mapping.vk_code;
-            note.modifier = mapping.modifier;
         }
 
         if (dropped_mapping_late > 0)
@@ -934,27 +1455,252 @@ namespace Core
             LOG_WARN("键位映射丢弃统计: 丢弃数量=" << dropped_mapping_late);
         }
 
+        // 5.1 Frame Quantization (optional)
+        // 游戏每帧只轮询一次输入，亚毫秒级的发送时间没有意义，按目标帧率吸附到网格。
+        // 量化会推迟同一按键的重复按下，须在复音与限速之前完成，二者按最终时间计算预算；
+        // 其后的步骤只会提前释放（吸附到另一音符的起点，仍在网格上）或丢弃音符，不破坏网格与释放间隔
+        if (tick_rate > 0)
+        {
+            quantize_notes(notes, 1.0 / tick_rate);
+            LOG_DEBUG("事件已按 " << tick_rate << "Hz 帧网格量化");
+        }
+
+        // 5.2 Voice Allocation (optional)
+        // 游戏同时按住的按键数有限，超出上限时按策略抢占，避免按键被游戏忽略或卡住
+        int stolen_voices = 0;
+        if (max_voices > 0)
+        {
+            stolen_voices = apply_polyphony_limit(notes, max_voices, m_voice_steal);
+            if (stolen_voices > 0)
+            {
+                LOG_DEBUG("复音分配抢占统计: 抢占数量=" << stolen_voices << " (上限 " << max_voices << " 个按键)");
+            }
+        }
+
+        // 5.3 Input Rate Limiter (optional)
+        // 密集段落可能超出游戏输入缓冲，在重建时按优先级确定性地丢弃，播放热循环无需额外判断
+        int dropped_rate_limit = 0;
+        if (rate_limit > 0)
+        {
+            dropped_rate_limit = apply_rate_limit(notes, rate_limit, m_rate_limit_window_ms / 1000.0,
+                                                  m_chord_threshold_ms / 1000.0);
+            if (dropped_rate_limit > 0)
+            {
+                LOG_WARN("输入限速丢弃统计: 丢弃数量=" << dropped_rate_limit
+                         << " (上限 " << rate_limit << " 个按键 / " << m_rate_limit_window_ms << "ms)");
+            }
+        }
+
         // 6. Generate Events
         m_events.reserve(notes.size() * 2);
         for (const auto &note : notes)
         {
             if (note.end > note.start)
             {
+                const bool channel_keymap = (note.keymap != nullptr);
                 // Note On 事件
-                m_events.push_back({note.start, true, note.vk, note.modifier, note.hwnd});
+                m_events.push_back({note.start, true, note.vk, note.modifier, note.hwnd, note.pitch, channel_keymap,
+                                    note.stream});
                 // Note Off 事件
-                m_events.push_back({note.end, false, note.vk, note.modifier, note.hwnd});
+                m_events.push_back({note.end, false, note.vk, note.modifier, note.hwnd, note.pitch, channel_keymap,
+                                    note.stream});
             }
         }
 
         // 7. Final Sort
         std::sort(m_events.begin(), m_events.end());
 
-        LOG_INFO("事件重建完成: 原始音符=" << notes.size()
+        m_stat_dropped_mapping.store(dropped_mapping_late, std::memory_order_relaxed);
+        m_stat_dropped_rate_limit.store(dropped_rate_limit, std::memory_order_relaxed);
+        m_stat_stolen_voices.store(stolen_voices, std::memory_order_relaxed);
+        m_stat_rebuild_id.fetch_add(1, std::memory_order_release);
+
+        // 8. Keyframe Index
+        build_keyframes();
+
+        LOG_INFO("事件重建完成: 原始音符=" << input_notes.size()
                                            << ", 过滤后音符=" << notes.size()
                                            << ", 事件数=" << m_events.size());
     }
 
+    size_t PlaybackEngine::seek_event_cursor(double time)
+    {
+        // Binary search for efficiency
+        // 通道偏移下 time 之前开始的事件可能尚未到期：从 time - 最大偏移处定位（无偏移时即 time）
+        auto it = std::lower_bound(m_events.begin(), m_events.end(), time - m_max_stream_offset,
+                                   [](const ProcessedEvent &evt, double t)
+                                   {
+                                       return evt.time < t;
+                                   });
+        size_t idx = std::distance(m_events.begin(), it);
+        m_cursor_time = time;
+        m_cursor_floor = idx;
+        m_pending_events.clear();
+
+        // 偏移窗口内的事件：生效时间已过的视为已发送（由 restore_held_keys 恢复），其余暂存待发
+        if (m_stream_offsets_active)
+        {
+            for (; idx < m_events.size() && m_events[idx].time + m_min_stream_offset < time; ++idx)
+            {
+                const auto &evt = m_events[idx];
+                const double t = effective_time(evt);
+                if (evt.vk_code != 0 && t >= time)
+                    stage_event(idx, t);
+            }
+        }
+        return idx;
+    }
+
+    void PlaybackEngine::stage_event(size_t index, double time)
+    {
+        m_pending_events.push_back({time, static_cast<uint32_t>(index)});
+        std::push_heap(m_pending_events.begin(), m_pending_events.end(), std::greater<>());
+    }
+
+    void PlaybackEngine::collect_due_events(size_t &next_event_idx, double limit, bool inclusive)
+    {
+        if (m_stream_offsets_active)
+        {
+            // 归并各通道事件流：游标按 时间 + 最小偏移 送入可能到期的事件，小顶堆按生效时间发送
+            // （堆中只有偏移范围内的事件，规模与事件总数无关）
+            while (next_event_idx < m_events.size())
+            {
+                const auto &evt = m_events[next_event_idx];
+                const double earliest = evt.time + m_min_stream_offset;
+                if (inclusive ? (earliest > limit) : (earliest >= limit))
+                    break;
+                if (evt.vk_code != 0)
+                    stage_event(next_event_idx, effective_time(evt));
+                next_event_idx++;
+            }
+
+            while (!m_pending_events.empty())
+            {
+                const double t = m_pending_events.front().time;
+                if (inclusive ? (t > limit) : (t >= limit))
+                    break;
+                std::pop_heap(m_pending_events.begin(), m_pending_events.end(), std::greater<>());
+                const auto &evt = m_events[m_pending_events.back().index];
+                m_pending_events.pop_back();
+                if (evt.vk_code != 0)
+                    dispatch_event(evt);
+            }
+            return;
+        }
+
+        while (next_event_idx < m_events.size())
+        {
+            const auto &evt = m_events[next_event_idx];
+
+            if (inclusive ? (evt.time > limit) : (evt.time >= limit))
+                break;
+
+            if (evt.vk_code != 0)  // 当前键位下无映射的音符不发送
+                dispatch_event(evt);
+            next_event_idx++;
+        }
+    }
+
+    void PlaybackEngine::dispatch_event(const ProcessedEvent &evt)
+    {
+        // 收集事件
+        m_key_event_buffer.push_back({evt.is_note_on, evt.vk_code, evt.modifier, evt.window_handle});
+
+        // 更新 active_keys：引用计数，防止同一按键多次 Note On 后单次 Note Off 提前释放
+        if (evt.is_note_on)
+        {
+            auto [it, inserted] = m_active_keys.try_emplace(std::make_pair(evt.vk_code, evt.window_handle), 1);
+            if (!inserted)
+                it->second++;  // 已存在，引用计数 +1
+        }
+        else
+        {
+            auto it = m_active_keys.find(std::make_pair(evt.vk_code, evt.window_handle));
+            if (it != m_active_keys.end())
+            {
+                if (--it->second == 0)
+                    m_active_keys.erase(it);  // 引用计数归零才真正移除
+            }
+        }
+    }
+
+    bool PlaybackEngine::run_scheduled_start(std::unique_lock<std::mutex> &lock, size_t &next_event_idx,
+                                             std::chrono::high_resolution_clock::time_point &last_loop_time,
+                                             void *precision_timer)
+    {
+        const int generation = m_start_generation;
+        const auto target = m_start_target;
+        const ClockSource clock = m_start_clock;
+
+        // 1. 预备首批事件：起始位置仍在持续的音符 + 恰好位于起始位置的按下事件
+        //    触发时只剩一次批量发送
+        next_event_idx = seek_event_cursor(m_current_time);
+        m_active_keys.clear();
+        m_key_event_buffer.clear();
+        restore_held_keys(next_event_idx);
+        collect_due_events(next_event_idx, m_current_time, true);
+
+        // 改期、取消、跳转或配置变化都会作废已预备的首批事件，由调用方重新预备
+        auto still_valid = [&]
+        {
+            return m_running && m_start_pending && m_start_generation == generation &&
+                   !m_seek_triggered && m_config_version == m_built_version && !keymap_stale();
+        };
+        auto abandon = [&]
+        {
+            m_active_keys.clear();  // 预备的按键尚未发送，直接丢弃
+            m_key_event_buffer.clear();
+            return false;
+        };
+
+        // 2. 粗等待：条件变量分段睡眠，可被取消/改期/关闭立即打断
+        while (still_valid())
+        {
+            const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(target - clock()).count();
+            if (remaining <= START_COARSE_MARGIN_US)
+                break;
+            const long long chunk_us = std::min<long long>(remaining - START_COARSE_MARGIN_US, 50000);
+            m_cv.wait_for(lock, std::chrono::microseconds(chunk_us));
+        }
+        if (!still_valid())
+            return abandon();
+
+        // 3. 精等待（锁外）：高精度可等待定时器睡到目标前 START_SPIN_MARGIN_US，再自旋对齐时钟源
+        lock.unlock();
+        const auto remaining_us = std::chrono::duration_cast<std::chrono::microseconds>(target - clock()).count();
+        if (precision_timer && remaining_us > START_SPIN_MARGIN_US)
+        {
+            LARGE_INTEGER due;
+            due.QuadPart = -(remaining_us - START_SPIN_MARGIN_US) * 10;  // 相对时间，100ns 单位
+            if (SetWaitableTimer(precision_timer, &due, 0, nullptr, nullptr, FALSE))
+                WaitForSingleObject(precision_timer, INFINITE);
+        }
+        while (m_running && m_start_pending && m_start_generation == generation && clock() < target)
+            std::this_thread::yield();
+        lock.lock();
+
+        if (!still_valid())
+            return abandon();
+
+        // 4. 触发：持锁发送首批事件；stop/seek 在同一把锁内取走按键并作废本次启动，
+        //    其锁外释放只会发生在本次发送之后或本次启动被放弃时
+        const auto fire_tp = clock();
+        if (!m_key_event_buffer.empty())
+            m_simulator.send_events(m_key_event_buffer);
+        m_key_event_buffer.clear();
+        last_loop_time = std::chrono::high_resolution_clock::now();
+
+        m_start_pending = false;
+        m_playing = true;
+        m_paused = false;
+
+        const long long error_us = std::chrono::duration_cast<std::chrono::microseconds>(fire_tp - target).count();
+        m_stat_start_error_us.store(error_us, std::memory_order_relaxed);
+        m_stat_start_id.fetch_add(1, std::memory_order_release);
+        LOG_INFO("定时启动触发，启动误差=" << error_us << "us");
+        return true;
+    }
+
     void PlaybackEngine::playback_thread()
     {
         // 提高定时器精度以获得准确的 sleep
@@ -985,6 +1731,12 @@ namespace Core
                 LOG_DEBUG("播放线程亲和性设置为逻辑处理器 " << cpuIdx);
             }
         }
+
+        // 定时启动精等待用的高精度可等待定时器（Windows 10 1803+），不支持时退化为普通定时器
+        HANDLE precision_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (!precision_timer)
+            precision_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
         size_t next_event_idx = 0;
         auto last_loop_time = std::chrono::high_resolution_clock::now();
 
@@ -992,57 +1744,67 @@ namespace Core
         {
             std::unique_lock<std::mutex> lock(m_mutex);
 
-            // Check for config changes or new file
-            if (m_config_version != m_built_version)
-            {
-                try_rebuild_events(lock);
+            // 使用成员变量缓冲区避免重复分配
+            m_key_event_buffer.clear();
 
+            // Check for config changes, keymap changes or new file
+            if (refresh_events(lock))
+            {
                 // Reset index based on current time (Binary search for efficiency)
-                auto it = std::lower_bound(m_events.begin(), m_events.end(), m_current_time.load(),
-                                           [](const ProcessedEvent &evt, double time)
-                                           {
-                                               return evt.time < time;
-                                           });
-                next_event_idx = std::distance(m_events.begin(), it);
+                next_event_idx = seek_event_cursor(m_current_time);
+
+                // 播放中换键位或改配置：按新事件列表同步已按下的按键，避免旧按键卡住
+                if (m_playing && !m_paused && !m_start_pending && !m_seek_triggered)
+                    resync_held_keys(next_event_idx);
             }
 
             // Wait if paused or not playing
-            while (m_running && (!m_playing || m_paused))
+            bool resumed = false;
+            while (m_running && (!m_playing || m_paused) && !m_start_pending)
             {
+                resumed = true;
                 m_cv.wait(lock);
                 last_loop_time = std::chrono::high_resolution_clock::now();
 
                 // If seeked/unpaused, update index
-                if (m_config_version != m_built_version)
-                {
-                    try_rebuild_events(lock);
-                }
+                refresh_events(lock);
 
                 // Re-sync index
-                next_event_idx = 0;
-                // Optimization: Binary search
-                auto it = std::lower_bound(m_events.begin(), m_events.end(), m_current_time.load(),
-                                           [](const ProcessedEvent &evt, double time)
-                                           {
-                                               return evt.time < time;
-                                           });
-                next_event_idx = std::distance(m_events.begin(), it);
+                next_event_idx = seek_event_cursor(m_current_time);
             }
 
             if (!m_running)
                 break;
 
+            if (m_start_pending)
+            {
+                // 等待期间的跳转已体现在 m_current_time 中，由首批事件预备处理
+                m_seek_triggered = false;
+                if (run_scheduled_start(lock, next_event_idx, last_loop_time, precision_timer))
+                    continue;
+                if (!m_running || !m_playing || m_paused || m_start_pending)
+                    continue;
+
+                // 定时启动被手动播放取代：预备的首批事件未发送，按当前位置重新同步
+                next_event_idx = seek_event_cursor(m_current_time);
+                last_loop_time = std::chrono::high_resolution_clock::now();
+                resumed = true;
+            }
+
             if (m_seek_triggered)
             {
                 m_seek_triggered = false;
-                auto it = std::lower_bound(m_events.begin(), m_events.end(), m_current_time.load(),
-                                           [](const ProcessedEvent &evt, double time)
-                                           {
-                                               return evt.time < time;
-                                           });
-                next_event_idx = std::distance(m_events.begin(), it);
+                next_event_idx = seek_event_cursor(m_current_time);
                 // 重置计时器，避免 seek 后 m_current_time 多跳一个 dt
                 last_loop_time = std::chrono::high_resolution_clock::now();
+
+                // 关键帧查找 + 短重放：恢复跳转点之前开始、仍在持续的音符
+                restore_held_keys(next_event_idx);
+            }
+            else if (resumed)
+            {
+                // 暂停恢复：暂停时释放了所有按键，按当前位置重新按下持续音
+                restore_held_keys(next_event_idx);
             }
 
             // Lock is still held here
@@ -1052,70 +1814,73 @@ namespace Core
             std::chrono::duration<double> dt = now - last_loop_time;
             last_loop_time = now;
 
-            m_current_time = m_current_time.load() + (dt.count() * m_playback_speed);
+            double new_time = m_current_time.load() + (dt.count() * m_playback_speed);
 
-            // 使用成员变量缓冲区避免重复分配
-            m_key_event_buffer.clear();
-
-            while (next_event_idx < m_events.size())
+            // AB 循环：在播放线程内于 B 点精确回绕，B 点之后的事件不会被发送
+            const double loop_a = m_loop_a.load();
+            const double loop_b = m_loop_b.load();
+            const bool looping = m_loop_enabled && loop_b > loop_a;
+            while (looping && new_time >= loop_b)
             {
-                const auto &evt = m_events[next_event_idx];
-
-                if (evt.time > m_current_time)
-                    break;
-
-                // 收集事件
-                m_key_event_buffer.push_back({evt.is_note_on, evt.vk_code, evt.modifier, evt.window_handle});
+                collect_due_events(next_event_idx, loop_b, false);
+
+                // 释放跨越边界仍按下的按键
+                for (const auto &[key, count] : m_active_keys)
+                    m_key_event_buffer.push_back({false, key.first, 0, key.second});
+                m_active_keys.clear();
+
+                // 时间保持连续：超出 B 点的部分计入 A 点之后
+                // （设置循环时已远超 B 点的情况直接回到 A 点）
+                double overshoot = new_time - loop_b;
+                if (overshoot >= loop_b - loop_a)
+                    overshoot = 0.0;
+                new_time = loop_a + overshoot;
+                next_event_idx = seek_event_cursor(loop_a);
+                restore_held_keys(next_event_idx);
+            }
 
-                // 更新 active_keys：引用计数，防止同一按键多次 Note On 后单次 Note Off 提前释放
-                if (evt.is_note_on)
-                {
-                    auto [it, inserted] = m_active_keys.try_emplace(std::make_pair(evt.vk_code, evt.window_handle), 1);
-                    if (!inserted)
-                        it->second++;  // 已存在，引用计数 +1
-                }
-                else
-                {
-                    auto it = m_active_keys.find(std::make_pair(evt.vk_code, evt.window_handle));
-                    if (it != m_active_keys.end())
-                    {
-                        if (--it->second == 0)
-                            m_active_keys.erase(it);  // 引用计数归零才真正移除
-                    }
-                }
+            m_current_time = new_time;
+            collect_due_events(next_event_idx, new_time, true);
 
-                next_event_idx++;
-            }
+            // 下一个事件的时间须在持锁时取得：事件列表与暂存堆都受 m_mutex 保护
+            // 负的通道偏移可使生效时间早于 0，以无穷大表示没有待发事件
+            double next_time = std::numeric_limits<double>::infinity();
+            if (next_event_idx < m_events.size())
+                next_time = m_events[next_event_idx].time + m_min_stream_offset;
+            if (!m_pending_events.empty())
+                next_time = std::min(next_time, m_pending_events.front().time);
+            if (looping)
+                next_time = std::min(next_time, loop_b);
 
             // 在锁外执行按键发送，减少锁持有时间
             lock.unlock();
 
-            // 二次检查：如果在收集事件期间有 stop/pause/seek 清空了按键，
-            // 丢弃已收集的陈旧事件，避免发送被 release_all_keys() 盖过的按键
             {
-                std::lock_guard<std::mutex> check_lock(m_mutex);
-                if (!m_playing || m_paused || m_seek_triggered)
-                    m_key_event_buffer.clear();
-            }
+                // 与 stop/pause/seek 的锁外释放串行：先发送的批次会被随后的释放覆盖，
+                // 释放已开始的则在二次检查中丢弃
+                std::lock_guard<std::mutex> send_lock(m_send_mutex);
 
-            for (const auto& evt : m_key_event_buffer)
-            {
-                if (evt.is_note_on)
+                // 二次检查：如果在收集事件期间有 stop/pause/seek 清空了按键，
+                // 丢弃已收集的陈旧事件，避免发送被 release_all_keys() 盖过的按键
                 {
-                    m_simulator.send_key_down(evt.vk_code, evt.modifier, evt.window_handle);
+                    std::lock_guard<std::mutex> check_lock(m_mutex);
+                    if (!m_playing || m_paused || m_seek_triggered)
+                        m_key_event_buffer.clear();
                 }
-                else
+
+                // 同一调度周期（量化模式下即同一帧）内的事件批量发送
+                if (!m_key_event_buffer.empty())
                 {
-                    m_simulator.send_key_up(evt.vk_code, evt.modifier, evt.window_handle);
+                    m_simulator.send_events(m_key_event_buffer);
                 }
             }
 
             // Calculate dynamic sleep time
             double sleep_ms = 15.0; // Default max sleep for UI responsiveness
 
-            if (next_event_idx < m_events.size())
+            if (next_time != std::numeric_limits<double>::infinity())
             {
-                double time_to_next = m_events[next_event_idx].time - m_current_time;
+                double time_to_next = next_time - m_current_time;
                 if (time_to_next > 0)
                 {
                     // Convert to wall time
@@ -1166,6 +1931,8 @@ namespace Core
                 break;
         }
 
+        if (precision_timer)
+            CloseHandle(precision_timer);
         timeEndPeriod(1);
     }
 
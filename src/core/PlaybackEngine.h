@@ -2,7 +2,9 @@
 
 // 标准库
 #include <thread>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
@@ -14,6 +16,7 @@
 // 项目头文件
 #include "../midi/MidiParser.h"
 #include "KeyboardSimulator.h"
+#include "PitchAnalysis.h"
 #include "../util/KeyManager.h"
 
 namespace Core {
@@ -28,35 +31,67 @@ namespace Core {
         }
     };
 
-    /// 按键事件结构（用于播放线程）
-    struct KeyEvent {
-        bool is_note_on;
-        int vk_code;
-        int modifier;
-        void* window_handle;
-    };
-
     /// 通道设置 (0-15)
     struct ChannelSettings {
         std::atomic<int> transpose{0};
         std::atomic<bool> enabled{true};
         std::atomic<void*> window_handle{nullptr};
         std::atomic<int> track_index{-1};  ///< -1 表示所有轨道
+        std::atomic<int> keymap_preset{-1};  ///< 通道独立键位（内置预设下标，含其音域），-1 表示使用全局键位
+        std::atomic<int> latency_offset_us{0};  ///< 发送时间偏移（微秒，正值延后），在发送时生效，无需重建
+    };
+
+    /// 最近一次事件重建的统计（供 UI 显示丢弃情况）
+    struct RebuildStats {
+        int rebuild_id = 0;            ///< 每次重建完成后递增
+        int dropped_mapping = 0;       ///< 无键位映射而丢弃的音符数
+        int dropped_rate_limit = 0;    ///< 输入限速丢弃的音符数
+        int stolen_voices = 0;         ///< 复音上限抢占（提前释放或丢弃）的音符数
+    };
+
+    /// 复音数达到上限时的抢占策略
+    enum class VoiceStealPolicy {
+        Oldest,     ///< 提前释放最早按下的按键
+        Quietest,   ///< 抢占力度最小的音符（新音符最弱时直接丢弃）
+        KeepOuter,  ///< 保留最高音与最低音，抢占最早按下的内声部
+    };
+
+    /// 最近一次定时启动的结果（供 UI 显示启动误差）
+    struct StartStats {
+        int start_id = 0;              ///< 每次定时启动触发后递增
+        long long error_us = 0;        ///< 实际触发时刻 - 目标时刻（微秒，正数表示迟到）
     };
 
+    /// 定时启动使用的时钟源（如 NTP 校正后的当前时间）
+    using ClockSource = std::function<std::chrono::system_clock::time_point()>;
+
     using ActiveKeySet = std::unordered_map<std::pair<int, void*>, int, ActiveKeyHash>;
 
+    /// 测试钩子：由 tests/ 中的测试程序定义，直接驱动事件重建并读取结果
+    struct PlaybackEngineTestAccess;
+
     class PlaybackEngine {
+        friend struct PlaybackEngineTestAccess;
+
     public:
         PlaybackEngine();
         ~PlaybackEngine();
 
-        void load_midi(const Midi::MidiFile& midi_file);
+        /// 加载 MIDI 文件；analysis 为该文件已缓存的音高分析，为空时现场构建
+        void load_midi(const Midi::MidiFile& midi_file, std::shared_ptr<const PitchAnalysis> analysis = nullptr);
+        /// 当前文件的音高分析（供调用方写入分析缓存）
+        std::shared_ptr<const PitchAnalysis> get_pitch_analysis();
         void play();
+        /// 在绝对时刻 target 从当前位置开始播放：播放线程预先收集首批事件，
+        /// 按 clock_source 的时间精确等待后发送（clock_source 为空时使用系统时钟）
+        void play_at(std::chrono::system_clock::time_point target, ClockSource clock_source);
+        void cancel_scheduled_start();
         void pause();
         void stop();
         void shutdown();    ///< 停止播放并退出播放线程（仅关闭时调用）
         void seek(double time_s);
+        void set_loop(double a_s, double b_s);  ///< 在播放线程内于 B 点精确回绕到 A 点
+        void clear_loop();
         
         /// 配置接口
         void set_speed(double speed);
@@ -64,15 +99,31 @@ namespace Core {
         void set_channel_enable(int channel, bool enabled);
         void set_channel_window(int channel, void* hwnd);
         void set_channel_track(int channel, int track_index);  ///< -1 表示所有轨道
+        /// 为通道（及其目标窗口）指定独立键位：内置预设下标，-1 表示使用全局键位与音域
+        void set_channel_keymap(int channel, int preset);
+        /// 通道发送时间偏移（微秒，正值延后、负值提前），用于对齐输入延迟不同的客户端；
+        /// 播放线程按偏移合并各通道事件流，修改时只重新定位游标，不重建事件列表
+        void set_channel_latency_offset(int channel, int offset_us);
+        static constexpr int MAX_CHANNEL_OFFSET_US = 1000000;
         void set_pitch_range(int min_pitch, int max_pitch);
         void set_decompose(bool decompose);
+        /// 和弦分解时序：起始相差不足 chord_threshold_ms 的音符视为和弦，按音高依次错开 stagger_ms；
+        /// stagger_beat_div > 0 时改为每次错开 1/stagger_beat_div 拍（随曲速变化）
+        void set_decompose_timing(int chord_threshold_ms, int stagger_ms, int stagger_beat_div);
+        void set_tick_rate(int hz);  ///< 按游戏帧率量化事件时间，0 表示不量化
+        void set_rate_limit(int max_notes, int window_ms);  ///< 每窗口任意 window_ms 区间内最多按键数，0 表示不限制
+        void set_polyphony(int max_voices, VoiceStealPolicy policy);  ///< 每窗口同时按住的按键上限，0 表示不限制
+        /// 键位已更新：播放线程按音高原地改写事件的按键，无需完整重建
         void notify_keymap_changed();
         
         bool is_playing() const { return m_playing; }
         bool is_paused() const { return m_paused; }
+        bool is_start_pending() const { return m_start_pending; }
         double get_current_time() const { return m_current_time; }
 
         Util::KeyManager& get_key_manager() { return m_key_manager; }
+        RebuildStats get_rebuild_stats() const;
+        StartStats get_start_stats() const;
 
     private:
         struct ProcessedEvent {
@@ -81,6 +132,9 @@ namespace Core {
             int vk_code;
             int modifier;
             void* window_handle;
+            int pitch;              ///< 映射前的音高，键位变化时据此原地改写 vk_code/modifier
+            bool channel_keymap;    ///< 使用通道独立键位，全局键位变化时不改写
+            uint8_t stream;         ///< 来源通道（DEFAULT_STREAM 表示默认配置），发送时据此叠加通道偏移
 
             bool operator<(const ProcessedEvent& other) const {
                 if (std::abs(time - other.time) > 1e-6)
@@ -90,6 +144,30 @@ namespace Core {
             }
         };
 
+        /// 某一时刻仍处于按下状态的按键（引用计数与 m_active_keys 一致）
+        struct HeldKey {
+            int vk_code;
+            int modifier;
+            void* window_handle;
+            int count;
+        };
+
+        /// 跳转关键帧：time 之前的事件全部生效后的按键快照
+        struct Keyframe {
+            double time;
+            size_t event_idx;           ///< 第一个 time >= Keyframe::time 的事件下标
+            std::vector<HeldKey> held;
+        };
+
+        /// 关键帧间隔（秒）：跳转时最多重放一个间隔内的事件
+        static constexpr double KEYFRAME_INTERVAL = 2.0;
+        /// 定时启动：距目标超过该值时用条件变量分段睡眠（可被取消打断）
+        static constexpr long long START_COARSE_MARGIN_US = 3000;
+        /// 定时启动：高精度定时器醒来后留给自旋对齐的余量
+        static constexpr long long START_SPIN_MARGIN_US = 500;
+        /// AB 循环最短区间（秒）
+        static constexpr double MIN_LOOP_LENGTH = 0.05;
+
         struct TempNote {
             double start;
             double end;
@@ -98,32 +176,113 @@ namespace Core {
             void* hwnd;
             int pitch;
             int track;
+            int velocity;
+            const Util::KeyTable* keymap;  ///< 通道独立键位表，nullptr 表示使用全局键位
+            uint8_t stream;
+        };
+
+        /// 节拍图中的一段：起始时间与每拍时长（秒）
+        struct TempoPoint {
+            double time_s;
+            double beat_s;
         };
 
         void playback_thread();
-        void rebuild_events(const std::vector<Midi::RawNote>& input_notes,
-                            const std::vector<std::vector<float>>& track_hists,
-                            const std::vector<float>& global_hist);
+        /// 单遍流式分解和弦（notes 须按起始时间排序）：每个窗口只缓冲当前和弦，按音高错开后原地改写，
+        /// 和弦展开不越过同一窗口下一个和弦的起点；tempo_map 非空时错开量按 1/stagger_beat_div 拍计算
+        static void decompose_chords(std::vector<TempNote>& notes, double chord_threshold_s, double stagger_s,
+                                     const std::vector<TempoPoint>& tempo_map, int stagger_beat_div);
+        /// 将音符起止时间吸附到帧网格，并保证同一按键的释放间隔至少一帧
+        static void quantize_notes(std::vector<TempNote>& notes, double tick_s);
+        /// 按窗口限制任意 window_s 滑动区间内的按键数，超出预算时按优先级丢弃音符，返回丢弃数量；
+        /// 起始时间相差不足 onset_cluster_s 的音符视为同一起音簇，簇内按外声部、力度排定优先级
+        static int apply_rate_limit(std::vector<TempNote>& notes, int max_notes, double window_s,
+                                    double onset_cluster_s);
+        /// 按窗口分配复音：按 (窗口, 起始时间) 排序后线性扫描，每窗口一个容量为 max_voices 的
+        /// 释放时间小顶堆，超出上限时按策略提前释放或丢弃音符，返回被抢占的音符数
+        static int apply_polyphony_limit(std::vector<TempNote>& notes, int max_voices, VoiceStealPolicy policy);
+        void rebuild_events(const std::vector<Midi::RawNote>& input_notes, const PitchAnalysis* analysis,
+                            const std::vector<TempoPoint>& tempo_map);
 
         /// 释放所有活跃按键（stop/pause 共用）
         void release_all_keys();
+        /// 取出并清空 m_active_keys，由调用方在释放 m_mutex 后发送释放事件；调用时需持有 m_mutex
+        std::vector<std::pair<int, void*>> take_active_keys();
+        /// 收集 next_event_idx 起到 limit 为止的到期事件，并更新 m_active_keys
+        /// inclusive 为 false 时不包含恰好位于 limit 的事件（用于 AB 循环边界）
+        void collect_due_events(size_t& next_event_idx, double limit, bool inclusive);
+        /// 发送单个事件：追加到 m_key_event_buffer 并更新 m_active_keys 引用计数
+        void dispatch_event(const ProcessedEvent& evt);
+        /// 将事件游标定位到 time 处，并重新暂存偏移窗口内尚未生效的事件
+        /// 调用时需持有 m_mutex
+        size_t seek_event_cursor(double time);
+        /// 根据 m_events 生成跳转关键帧索引（rebuild_events 末尾调用）
+        void build_keyframes();
+        /// 恢复 event_idx 处应处于按下状态的按键：更新 m_active_keys 并追加按下事件到 m_key_event_buffer
+        /// 须紧接 seek_event_cursor 调用（通道偏移下按其定位结果判断哪些事件已生效），调用时需持有 m_mutex
+        void restore_held_keys(size_t event_idx);
+        /// 事件列表变化后按 event_idx 处的状态同步按键：只释放不再按下的、只按下新增的
+        /// 调用时需持有 m_mutex
+        void resync_held_keys(size_t event_idx);
+        /// 定时启动：预先收集首批事件，等待到目标时刻后发送并进入播放状态
+        /// 调用时需持有 m_mutex（精等待阶段会临时解锁），被取消/改期/跳转时返回 false
+        bool run_scheduled_start(std::unique_lock<std::mutex>& lock, size_t& next_event_idx,
+                                 std::chrono::high_resolution_clock::time_point& last_loop_time,
+                                 void* precision_timer);
         /// 在锁外重建事件列表，成功后更新 m_built_version
         /// 调用时需持有 m_mutex（方法内会临时解锁再重锁）
         bool try_rebuild_events(std::unique_lock<std::mutex>& lock);
+        /// 按当前键位表原地改写 m_events 的 vk_code/modifier（O(事件数)，无需排序）并重建关键帧
+        void remap_events();
+        /// 配置变化时完整重建，仅键位变化时原地改写，通道偏移变化时只需重新定位游标；
+        /// 返回是否需要重新定位事件游标，调用时需持有 m_mutex
+        bool refresh_events(std::unique_lock<std::mutex>& lock);
+        bool keymap_stale() const { return m_keymap_version != m_key_manager.version(); }
+        /// 读取各通道偏移并换算为乐曲时间（随播放速度缩放），返回偏移是否变化
+        bool load_stream_offsets();
+        double effective_time(const ProcessedEvent& evt) const { return evt.time + m_stream_offsets[evt.stream]; }
+        /// 已越过游标、尚未到期的事件放入按生效时间排序的小顶堆
+        void stage_event(size_t index, double time);
 
         /// 核心数据：持久化持有
         std::vector<Midi::RawNote> m_all_notes;
         std::vector<ProcessedEvent> m_events;
+        std::vector<Keyframe> m_keyframes;      ///< 每 KEYFRAME_INTERVAL 秒一个按键快照
+
+        /// 通道偏移合并（受 m_mutex 保护）：每个通道的事件流按时间有序、偏移为常量，
+        /// 游标按 时间 + 最小偏移 送入，暂存的事件按 时间 + 通道偏移 依次发送
+        static constexpr uint8_t DEFAULT_STREAM = 16;   ///< 未启用任何通道时的默认配置，偏移恒为 0
+        struct PendingEvent {
+            double time;            ///< 生效时间（含通道偏移）
+            uint32_t index;         ///< m_events 下标
+
+            /// 小顶堆比较：生效时间相同时按下标，保持同一时刻 Note Off 先于 Note On
+            bool operator>(const PendingEvent& other) const {
+                if (time != other.time)
+                    return time > other.time;
+                return index > other.index;
+            }
+        };
+        std::array<double, DEFAULT_STREAM + 1> m_stream_offsets{};  ///< 各通道偏移（乐曲时间，秒）
+        double m_min_stream_offset{0.0};
+        double m_max_stream_offset{0.0};
+        bool m_stream_offsets_active{false};    ///< 存在非零偏移，无偏移时保持原有的顺序遍历
+        bool m_stream_offsets_dirty{false};     ///< 通道偏移或播放速度已修改，待播放线程读取
+        double m_cursor_time{0.0};              ///< 最近一次定位游标的目标时间
+        size_t m_cursor_floor{0};               ///< 此下标之前的事件均已生效（跳转关键帧须在此之前）
+        std::vector<PendingEvent> m_pending_events;
         
-        /// 每轨道的音高统计缓存（用于智能移调）
-        std::vector<std::vector<float>> m_track_pitch_histograms;
-        
-        /// 全局音高直方图（排除打击乐 channel 10，预计算）
-        std::vector<float> m_global_histogram;
+        /// 音高直方图与各音域移调缓存（用于智能移调，构建后只读）
+        std::shared_ptr<const PitchAnalysis> m_pitch_analysis;
+
+        /// 当前文件的节拍图（用于按拍错开的和弦分解）
+        std::vector<TempoPoint> m_tempo_map;
         
         std::atomic<int> m_config_version{0};   ///< 触发重建的版本号
         std::atomic<int> m_all_notes_generation{0}; ///< m_all_notes 的代数，用于检测锁外重建时的并发修改
         int m_built_version{-1};                ///< 最后构建的版本
+        int m_keymap_version{-1};               ///< m_events 所用键位表的版本（播放线程访问）
+        bool m_keymap_patchable{false};         ///< m_events 保留了无映射音符，可原地改写键位
         bool m_seek_triggered{false};           ///< 跳转触发标志
 
         std::thread m_thread;
@@ -133,6 +292,31 @@ namespace Core {
         std::atomic<double> m_current_time;
         std::atomic<double> m_playback_speed;
         std::atomic<bool> m_decompose{false};
+        std::atomic<int> m_chord_threshold_ms{30};  ///< 和弦判定窗口
+        std::atomic<int> m_stagger_ms{50};          ///< 和弦分解错开时长
+        std::atomic<int> m_stagger_beat_div{0};     ///< > 0 时按 1/n 拍错开（忽略 m_stagger_ms）
+        std::atomic<bool> m_loop_enabled{false};
+        std::atomic<double> m_loop_a{0.0};
+        std::atomic<double> m_loop_b{0.0};
+        std::atomic<int> m_tick_rate_hz{0};     ///< 目标游戏帧率（0 表示不量化）
+        std::atomic<int> m_rate_limit_notes{0}; ///< 每窗口任意时间片长度区间内最多按键数（0 表示不限制）
+        std::atomic<int> m_rate_limit_window_ms{100};
+        std::atomic<int> m_max_polyphony{0};    ///< 每窗口同时按住的按键上限（0 表示不限制）
+        std::atomic<VoiceStealPolicy> m_voice_steal{VoiceStealPolicy::Oldest};
+
+        /// 定时启动（目标与时钟源受 m_mutex 保护）
+        std::atomic<bool> m_start_pending{false};
+        std::atomic<int> m_start_generation{0}; ///< 每次改期/取消递增，用于作废已预备的首批事件
+        std::chrono::system_clock::time_point m_start_target;
+        ClockSource m_start_clock;
+
+        /// 重建统计（播放线程写，UI 线程读）
+        std::atomic<int> m_stat_rebuild_id{0};
+        std::atomic<int> m_stat_dropped_mapping{0};
+        std::atomic<int> m_stat_dropped_rate_limit{0};
+        std::atomic<int> m_stat_stolen_voices{0};
+        std::atomic<int> m_stat_start_id{0};
+        std::atomic<long long> m_stat_start_error_us{0};
         
         /// 音频/MIDI 设置
         std::atomic<int> m_min_pitch{48};
@@ -146,9 +330,12 @@ namespace Core {
         
         /// 事件缓冲区（复用避免重复分配）
         std::vector<KeyEvent> m_key_event_buffer;
+
         
         /// 同步原语
         std::mutex m_mutex;
+        /// 串行化播放线程的批量发送与 stop/pause/seek 的锁外按键释放（须先于 m_mutex 加锁）
+        std::mutex m_send_mutex;
         std::condition_variable m_cv;
 
         KeyboardSimulator m_simulator;
@@ -0,0 +1,176 @@
+#include "TimingWheel.h"
+#include <cmath>
+
+namespace Core {
+
+    namespace {
+        /// 64 位字中最低位 1 的位置（word 非零）
+        int lowest_bit(uint64_t word) {
+            int bit = 0;
+            while ((word & 1) == 0) {
+                word >>= 1;
+                ++bit;
+            }
+            return bit;
+        }
+    }
+
+    TimingWheel::TimingWheel(double tick_s)
+        : m_tick_s(tick_s > 0.0 ? tick_s : 0.0001) {
+    }
+
+    uint64_t TimingWheel::to_tick(double time_s) const {
+        if (!(time_s > 0.0))
+            return 0;
+        const double ticks = std::floor(time_s / m_tick_s);
+        return ticks >= static_cast<double>(MAX_TICK) ? MAX_TICK : static_cast<uint64_t>(ticks);
+    }
+
+    void TimingWheel::reset(double now_s) {
+        for (auto& level : m_levels) {
+            level.slots.fill(Slot{});
+            level.occupied.fill(0);
+        }
+        // 节点全部回收到空闲链表（代数递增，旧句柄失效）
+        m_free = NIL;
+        for (int32_t i = static_cast<int32_t>(m_nodes.size()) - 1; i >= 0; --i) {
+            Node& node = m_nodes[i];
+            if (node.level >= 0)
+                ++node.generation;
+            node.level = -1;
+            node.next = m_free;
+            m_free = i;
+        }
+        m_size = 0;
+        m_now = to_tick(now_s);
+    }
+
+    TimingWheel::Handle TimingWheel::insert(double time_s, uint32_t payload) {
+        int32_t index;
+        if (m_free != NIL) {
+            index = m_free;
+            m_free = m_nodes[index].next;
+        } else {
+            index = static_cast<int32_t>(m_nodes.size());
+            m_nodes.push_back(Node{0.0, 0, 1, NIL, NIL, -1, 0});
+        }
+
+        Node& node = m_nodes[index];
+        node.time = time_s;
+        node.payload = payload;
+        link(index);
+        ++m_size;
+        return (static_cast<Handle>(node.generation) << 32) | static_cast<uint32_t>(index + 1);
+    }
+
+    bool TimingWheel::cancel(Handle handle) {
+        const uint32_t low = static_cast<uint32_t>(handle);
+        if (low == 0 || low > m_nodes.size())
+            return false;
+        const int32_t index = static_cast<int32_t>(low - 1);
+        const Node& node = m_nodes[index];
+        if (node.level < 0 || node.generation != static_cast<uint32_t>(handle >> 32))
+            return false;
+        release(index);
+        return true;
+    }
+
+    void TimingWheel::link(int32_t index) {
+        Node& node = m_nodes[index];
+        const uint64_t tick = std::max(to_tick(node.time), m_now);
+
+        // 与当前刻度的最高不同字节决定层级：同一块内放第 0 层，依此类推
+        int level = 0;
+        while (level < LEVELS - 1 && (tick >> (SLOT_BITS * (level + 1))) != (m_now >> (SLOT_BITS * (level + 1))))
+            ++level;
+        const int slot = static_cast<int>((tick >> (SLOT_BITS * level)) & SLOT_MASK);
+
+        Slot& s = m_levels[level].slots[slot];
+        node.level = static_cast<int16_t>(level);
+        node.slot = static_cast<uint16_t>(slot);
+        node.next = NIL;
+        node.prev = s.tail;
+        if (s.tail != NIL)
+            m_nodes[s.tail].next = index;
+        else
+            s.head = index;
+        s.tail = index;
+        m_levels[level].occupied[slot >> 6] |= uint64_t{1} << (slot & 63);
+    }
+
+    void TimingWheel::unlink(int32_t index) {
+        Node& node = m_nodes[index];
+        Level& level = m_levels[node.level];
+        Slot& s = level.slots[node.slot];
+        if (node.prev != NIL)
+            m_nodes[node.prev].next = node.next;
+        else
+            s.head = node.next;
+        if (node.next != NIL)
+            m_nodes[node.next].prev = node.prev;
+        else
+            s.tail = node.prev;
+        if (s.head == NIL)
+            level.occupied[node.slot >> 6] &= ~(uint64_t{1} << (node.slot & 63));
+    }
+
+    void TimingWheel::release(int32_t index) {
+        unlink(index);
+        Node& node = m_nodes[index];
+        node.level = -1;
+        ++node.generation;
+        node.next = m_free;
+        m_free = index;
+        --m_size;
+    }
+
+    void TimingWheel::cascade() {
+        // 从最高的回绕层开始逐层下放，保证下层槽收到上层条目后再继续下放
+        int top = 1;
+        while (top < LEVELS - 1 && ((m_now >> (SLOT_BITS * top)) & SLOT_MASK) == 0)
+            ++top;
+        for (int level = top; level >= 1; --level) {
+            const int slot = static_cast<int>((m_now >> (SLOT_BITS * level)) & SLOT_MASK);
+            Slot& s = m_levels[level].slots[slot];
+            int32_t i = s.head;
+            s = Slot{};
+            m_levels[level].occupied[slot >> 6] &= ~(uint64_t{1} << (slot & 63));
+            // 按原顺序重新放入，同一刻度内保持插入顺序
+            while (i != NIL) {
+                const int32_t next = m_nodes[i].next;
+                link(i);
+                i = next;
+            }
+        }
+    }
+
+    int TimingWheel::find_occupied(int level, int from) const {
+        const auto& occupied = m_levels[level].occupied;
+        for (int word = from >> 6; word < SLOTS / 64; ++word) {
+            uint64_t bits = occupied[word];
+            if (word == (from >> 6))
+                bits &= ~uint64_t{0} << (from & 63);
+            if (bits)
+                return word * 64 + lowest_bit(bits);
+        }
+        return SLOTS;
+    }
+
+    double TimingWheel::next_due() const {
+        if (m_size == 0)
+            return -1.0;
+        // 逐层查找当前位置之后第一个非空槽，返回该槽覆盖范围的起点
+        for (int level = 0; level < LEVELS; ++level) {
+            const int shift = SLOT_BITS * level;
+            const int current = static_cast<int>((m_now >> shift) & SLOT_MASK);
+            const int slot = find_occupied(level, current);
+            if (slot < SLOTS) {
+                const uint64_t base = (m_now >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                const uint64_t tick = std::max(base + (static_cast<uint64_t>(slot) << shift), m_now);
+                return tick * m_tick_s;
+            }
+        }
+        return m_now * m_tick_s;
+    }
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// 标准库
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Core {
+
+    /// 分层时间轮：插入、取消 O(1)，到期按刻度推进（空槽由位图跳过）
+    /// 4 层 × 256 槽，默认刻度 0.1ms，可覆盖约 119 小时；同一刻度内按插入顺序到期
+    /// 播放线程仍按下标遍历排好序的事件列表：静态时间线上时间轮慢一个数量级，
+    /// 只有频繁插入/取消的时间线才有收益（见 tests/timing_wheel_bench.cpp）
+    class TimingWheel {
+    public:
+        using Handle = uint64_t;  ///< 0 表示无效句柄
+        static constexpr Handle INVALID_HANDLE = 0;
+
+        explicit TimingWheel(double tick_s = 0.0001);
+
+        /// 清空所有条目并将当前时间设为 now_s
+        void reset(double now_s);
+
+        /// 插入 time_s 到期的条目（早于当前时间的在下次 expire 时立即到期）
+        Handle insert(double time_s, uint32_t payload);
+
+        /// 取消尚未到期的条目，句柄已到期或已取消时返回 false
+        bool cancel(Handle handle);
+
+        /// 推进到 limit_s，按时间顺序对到期条目调用 on_due(payload, time_s)；
+        /// inclusive 为 false 时恰好位于 limit_s 的条目保留到下次
+        template <typename F>
+        void expire(double limit_s, bool inclusive, F&& on_due);
+
+        /// 最早待到期条目时间的下界（只需不晚于实际到期时间，用于计算睡眠时长），无条目时返回 -1
+        double next_due() const;
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+    private:
+        static constexpr int LEVELS = 4;
+        static constexpr int SLOT_BITS = 8;
+        static constexpr int SLOTS = 1 << SLOT_BITS;
+        static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+        static constexpr uint64_t MAX_TICK = (uint64_t{1} << (LEVELS * SLOT_BITS)) - 1;
+        static constexpr int32_t NIL = -1;
+
+        struct Node {
+            double time;
+            uint32_t payload;
+            uint32_t generation;    ///< 每次释放递增，使旧句柄失效
+            int32_t prev;
+            int32_t next;
+            int16_t level;          ///< -1 表示空闲
+            uint16_t slot;
+        };
+
+        struct Slot {
+            int32_t head = NIL;
+            int32_t tail = NIL;
+        };
+
+        struct Level {
+            std::array<Slot, SLOTS> slots;
+            std::array<uint64_t, SLOTS / 64> occupied{};  ///< 非空槽位图
+        };
+
+        uint64_t to_tick(double time_s) const;
+        void link(int32_t index);       ///< 按与当前刻度的距离放入对应层的槽尾
+        void unlink(int32_t index);
+        void release(int32_t index);
+        void cascade();                 ///< 当前刻度跨过 256 边界后，将上层对应槽下放
+        /// 在 level 层的 [from, SLOTS) 中查找第一个非空槽，没有时返回 SLOTS
+        int find_occupied(int level, int from) const;
+
+        double m_tick_s;
+        uint64_t m_now = 0;             ///< 当前刻度（已处理到此刻度之前的所有条目）
+        size_t m_size = 0;
+        std::array<Level, LEVELS> m_levels;
+        std::vector<Node> m_nodes;
+        int32_t m_free = NIL;
+        std::vector<std::pair<int32_t, uint32_t>> m_scratch;  ///< 到期槽处理时的临时 (下标, 代数)
+    };
+
+    template <typename F>
+    void TimingWheel::expire(double limit_s, bool inclusive, F&& on_due) {
+        const uint64_t target = to_tick(limit_s);
+        while (true) {
+            // 处理当前刻度所在槽：到期的移出后回调；回调中插入的已过期条目也落在此槽，重新扫描直到没有到期条目
+            const int slot = static_cast<int>(m_now & SLOT_MASK);
+            do {
+                m_scratch.clear();
+                for (int32_t i = m_levels[0].slots[slot].head; i != NIL; i = m_nodes[i].next) {
+                    const double t = m_nodes[i].time;
+                    if (m_now < target || (inclusive ? t <= limit_s : t < limit_s))
+                        m_scratch.push_back({i, m_nodes[i].generation});
+                }
+                for (size_t k = 0; k < m_scratch.size(); ++k) {
+                    const int32_t i = m_scratch[k].first;
+                    if (m_nodes[i].generation != m_scratch[k].second)
+                        continue;  // 已在回调中被取消
+                    const uint32_t payload = m_nodes[i].payload;
+                    const double t = m_nodes[i].time;
+                    release(i);
+                    on_due(payload, t);
+                }
+            } while (!m_scratch.empty());
+
+            if (m_now >= target)
+                break;
+
+            // 跳到本块内下一个非空槽；本块已空则进入下一块并下放上层条目
+            const uint64_t block_end = m_now | SLOT_MASK;
+            const int next = find_occupied(0, slot + 1);
+            if (next < SLOTS) {
+                m_now = std::min<uint64_t>((m_now & ~SLOT_MASK) + next, target);
+            } else if (block_end >= target) {
+                m_now = target;
+            } else {
+                m_now = block_end + 1;
+                cascade();
+            }
+        }
+    }
+
+}
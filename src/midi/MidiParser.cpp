@@ -1,3 +1,6 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Midi
+
 #include "MidiParser.h"
 #include <cstring>
 #include <tuple>
@@ -41,6 +41,9 @@ namespace Midi {
         std::vector<std::vector<RawNote>> raw_notes_by_track;
 
         double get_initial_bpm() const;
+        /// 节拍图：各段起始时间（秒）与每拍微秒数，按时间升序
+        const std::vector<double>& tempo_seconds() const { return m_tempo_seconds; }
+        const std::vector<int>& tempo_values() const { return m_tempo_values; }
         std::pair<int, int> get_initial_time_signature() const;
 
         bool is_valid() const { return m_valid; }
@@ -1,3 +1,6 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE UI
+
 #include <wx/tglbtn.h>
 #include "MainFrame.h"
 #include "UIHelpers.h"
@@ -47,6 +50,12 @@ static void AllowDragDropForAdmin(HWND hwnd) {
 #include "../util/KeyManager.h"
 #include "../core/KeyboardSimulator.h"
 
+// 音高分析缓存文件：与 config.ini 同目录
+static std::filesystem::path PitchCachePath() {
+    wxFileName exePath(wxStandardPaths::Get().GetExecutablePath());
+    return wxFileName(exePath.GetPath(), "pitch_cache.bin").GetFullPath().ToStdWstring();
+}
+
 class MidiDropTarget : public wxFileDropTarget {
 public:
     explicit MidiDropTarget(MainFrame* frame) : m_frame(frame) {}
@@ -75,6 +84,7 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_BUTTON(ID_IMPORT_BTN, MainFrame::OnImportFile)
     EVT_BUTTON(ID_REMOVE_BTN, MainFrame::OnRemoveFile)
     EVT_BUTTON(ID_CLEAR_BTN, MainFrame::OnClearList)
+    EVT_BUTTON(ID_ANALYZE_BTN, MainFrame::OnAnalyzeAll)
     EVT_TEXT(ID_SEARCH_CTRL, MainFrame::OnSearch)
     EVT_LIST_ITEM_SELECTED(ID_PLAYLIST_CTRL, MainFrame::OnPlaylistSelected)
     EVT_LIST_ITEM_ACTIVATED(ID_PLAYLIST_CTRL, MainFrame::OnPlaylistActivated)
@@ -115,12 +125,12 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_BUTTON(ID_SCHEDULE_BTN, MainFrame::OnSchedule)
     
     // Custom events
-    EVT_COMMAND(ID_NTP_TIMER, wxEVT_COMMAND_BUTTON_CLICKED, MainFrame::OnNtpSyncComplete)
-    EVT_COMMAND(ID_SCHEDULE_TRIGGER, wxEVT_COMMAND_BUTTON_CLICKED, MainFrame::OnScheduleTrigger)
     
     EVT_TIMER(ID_PLAYBACK_TIMER, MainFrame::OnTimer)
     EVT_TIMER(ID_STATUS_TIMER, MainFrame::OnStatusTimer)
     EVT_TIMER(ID_HELP_SCROLL_TIMER, MainFrame::OnHelpScrollTimer)
+    EVT_COMMAND(ID_GROUP_START, wxEVT_COMMAND_BUTTON_CLICKED, MainFrame::OnGroupStart)
+    EVT_COMMAND(ID_ANALYZE_DONE, wxEVT_COMMAND_BUTTON_CLICKED, MainFrame::OnAnalyzeDone)
 wxEND_EVENT_TABLE()
 
 MainFrame::MainFrame()
@@ -163,7 +173,22 @@ MainFrame::MainFrame()
     m_helpScrollTimer.SetOwner(this, ID_HELP_SCROLL_TIMER);
     InitHelpMessages();
 
+    // 局域网从机：集体开始消息在对时线程中收到，转到 UI 线程处理
+    Util::NtpClient::SetGroupStartHandler([this](const Util::GroupStart& msg) {
+        if (m_isShuttingDown.load()) {
+            return;
+        }
+        auto* evt = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_GROUP_START);
+        evt->SetClientData(new Util::GroupStart(msg));
+        wxQueueEvent(this, evt);
+    });
+
+    // 先恢复本机时钟漂移档案，启动后 GetNow 即可直接使用
+    LoadNtpProfile();
     Util::NtpClient::StartAutoSync();
+
+    // 读回上次运行的音高分析（条目在使用时按文件大小与修改时间校验）
+    Core::PitchAnalysisCache::Instance().Load(PitchCachePath());
     
     // Initialize State Machine
     m_stateMachine.SetStateChangeCallback([this](UI::PlaybackStatus oldState, UI::PlaybackStatus newState) {
@@ -212,7 +237,9 @@ void MainFrame::OnClose(wxCloseEvent& event)
     // 停止播放引擎（释放按键等）
     m_engine.stop();
 
-    // 强制关闭NTP客户端
+    // 保存时钟漂移档案后强制关闭NTP客户端
+    SaveNtpProfile();
+    Util::NtpClient::SetGroupStartHandler(nullptr);
     Util::NtpClient::ForceShutdown();
 
     // 保存最后选中的文件
@@ -241,6 +268,9 @@ void MainFrame::OnClose(wxCloseEvent& event)
         }
     }
 
+    // 后台批量分析已退出，保存音高分析缓存供下次启动使用
+    Core::PitchAnalysisCache::Instance().Save(PitchCachePath());
+
     LOG_INFO("关闭完成，销毁窗口");
     event.Skip();  // 继续默认关闭流程，触发析构
 }
@@ -375,6 +405,7 @@ void MainFrame::InitPlaylistPanel(wxPanel* parent, wxBoxSizer* mainSizer) {
     m_importBtn = new wxButton(panel, ID_IMPORT_BTN, wxString::FromUTF8("导入文件"));
     m_removeBtn = new wxButton(panel, ID_REMOVE_BTN, wxString::FromUTF8("移除选中"));
     m_clearBtn = new wxButton(panel, ID_CLEAR_BTN, wxString::FromUTF8("清空列表"));
+    m_analyzeBtn = new wxButton(panel, ID_ANALYZE_BTN, wxString::FromUTF8("分析全部"));
     m_searchCtrl = new wxTextCtrl(panel, ID_SEARCH_CTRL, "", wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER);
     m_searchCtrl->SetHint(wxString::FromUTF8("搜索..."));
     m_searchCtrl->SetMinSize(FromDIP(wxSize(-1, 26)));
@@ -382,6 +413,7 @@ void MainFrame::InitPlaylistPanel(wxPanel* parent, wxBoxSizer* mainSizer) {
     toolbarSizer->Add(m_importBtn, 0, wxALL, 2);
     toolbarSizer->Add(m_removeBtn, 0, wxALL, 2);
     toolbarSizer->Add(m_clearBtn, 0, wxALL, 2);
+    toolbarSizer->Add(m_analyzeBtn, 0, wxALL, 2);
     toolbarSizer->Add(m_searchCtrl, 1, wxALL | wxEXPAND, 2);
     
     sizer->Add(toolbarSizer, 0, wxEXPAND | wxALL, 2);
@@ -546,8 +578,15 @@ wxPanel* MainFrame::CreateChannelConfig(wxPanel* parent, int index) {
     windowChoice->Append(UIConstants::DEFAULT_WINDOW);
     windowChoice->SetSelection(0);
     
+    // 通道发送偏移：对齐输入延迟不同的客户端，修改时不重建事件列表
+    const int maxOffsetMs = Core::PlaybackEngine::MAX_CHANNEL_OFFSET_US / 1000;
+    wxSpinCtrl* offsetCtrl = new wxSpinCtrl(panel, wxID_ANY, "0", wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS | wxTE_CENTRE, -maxOffsetMs, maxOffsetMs, 0);
+    offsetCtrl->SetMinSize(FromDIP(wxSize(55, -1)));
+    offsetCtrl->SetToolTip(wxString::FromUTF8("发送偏移（毫秒）：正值延后、负值提前，用于对齐多个客户端"));
+    
     row1->Add(enableBtn, 0, wxALL | wxALIGN_CENTER_VERTICAL, 2);
     row1->Add(windowChoice, 1, wxALL | wxEXPAND, 2);
+    row1->Add(offsetCtrl, 0, wxALL | wxALIGN_CENTER_VERTICAL, 2);
     
     sizer->Add(row1, 0, wxEXPAND, 2);
     
@@ -563,16 +602,24 @@ wxPanel* MainFrame::CreateChannelConfig(wxPanel* parent, int index) {
     trackChoice->Append(UIConstants::DEFAULT_TRACK);
     trackChoice->SetSelection(0);
     
+    // 通道独立键位（同一首曲子同时驱动不同游戏的客户端）
+    wxChoice* keymapChoice = new wxChoice(panel, wxID_ANY);
+    keymapChoice->Append(UIConstants::CHANNEL_KEYMAP_GLOBAL);
+    keymapChoice->Append(UIConstants::DEFAULT_KEYMAP);  // 内置预设 0: FF14
+    keymapChoice->Append(UIConstants::KEYMAP_YYSLS);    // 内置预设 1: 燕云十六声
+    keymapChoice->SetSelection(0);
+    
     row2->Add(transposeCtrl, 0, wxALL | wxALIGN_CENTER_VERTICAL, 2);
 
     row2->Add(trackChoice, 1, wxALL | wxEXPAND, 2);
+    row2->Add(keymapChoice, 0, wxALL | wxEXPAND, 2);
     
     sizer->Add(row2, 0, wxEXPAND, 2);
     
     panel->SetSizer(sizer);
     
     // Store controls
-    ChannelControls controls = { enableBtn, windowChoice, transposeCtrl, trackChoice, index };
+    ChannelControls controls = { enableBtn, windowChoice, transposeCtrl, trackChoice, keymapChoice, offsetCtrl, index };
     m_channelConfigs.push_back(controls);
     
     // Bind events using lambdas to capture index
@@ -642,6 +689,22 @@ wxPanel* MainFrame::CreateChannelConfig(wxPanel* parent, int index) {
         }
         SaveFileConfig();
     });
+
+    keymapChoice->Bind(wxEVT_CHOICE, [this, index](wxCommandEvent& e) {
+        int sel = e.GetSelection();
+        m_engine.set_channel_keymap(index, sel == wxNOT_FOUND ? -1 : sel - 1);
+        SaveFileConfig();
+    });
+
+    offsetCtrl->Bind(wxEVT_SPINCTRL, [this, index](wxSpinEvent& e) {
+        m_engine.set_channel_latency_offset(index, e.GetValue() * 1000);
+        SaveFileConfig();
+    });
+
+    offsetCtrl->Bind(wxEVT_TEXT_ENTER, [this, index, offsetCtrl](wxCommandEvent& e) {
+        m_engine.set_channel_latency_offset(index, offsetCtrl->GetValue() * 1000);
+        SaveFileConfig();
+    });
     
     // Initialize state
     bool initialEnable = (index == 0);
@@ -657,6 +720,8 @@ void MainFrame::UpdateChannelUI(int index, bool enabled) {
         c.windowChoice->Enable(enabled);
         c.transposeCtrl->Enable(enabled);
         c.trackChoice->Enable(enabled);
+        c.keymapChoice->Enable(enabled);
+        c.offsetCtrl->Enable(enabled);
     }
 }
 
@@ -676,12 +741,14 @@ void MainFrame::InitKeymapPanel(wxPanel* parent, wxBoxSizer* mainSizer) {
     m_latencyCompCtrl->SetToolTip(wxString::FromUTF8("请输入游戏内ping值，单人演奏可以忽略"));
     m_latencyCompCtrl->Bind(wxEVT_SPINCTRL, [this](wxSpinEvent& event) {
         m_latency_comp_us.store(static_cast<long long>(event.GetPosition()) * 1000LL);
+        ApplyScheduledStart();
         event.Skip();
     });
     m_latencyCompCtrl->Bind(wxEVT_TEXT, [this](wxCommandEvent& event) {
         if (m_latencyCompCtrl) {
             int val = m_latencyCompCtrl->GetValue();
             m_latency_comp_us.store(static_cast<long long>(val) * 1000LL);
+            ApplyScheduledStart();
         }
         event.Skip();
     });
@@ -1042,6 +1109,7 @@ bool MainFrame::PlayIndex(int viewIndex, bool autoPlay, bool showDialog) {
         m_abLoopEnabled = false;
         m_abPointA_ms = -1.0;
         m_abPointB_ms = -1.0;
+        m_engine.clear_loop();
         m_progressSlider->ClearABPoints();
 
         LOG("Creating MidiFile...");
@@ -1062,7 +1130,14 @@ bool MainFrame::PlayIndex(int viewIndex, bool autoPlay, bool showDialog) {
         LOG("Midi parsed successfully. Length: " + std::to_string(m_current_midi->length));
         
         LOG("Loading midi into engine...");
-        m_engine.load_midi(*m_current_midi);
+        // 音高分析按文件缓存：命中时跳过直方图构建，未命中时缓存引擎刚构建的分析
+        const std::wstring widePath = path.ToStdWstring();
+        auto analysis = Core::PitchAnalysisCache::Instance().Find(widePath);
+        const bool analysisCached = analysis != nullptr;
+        m_engine.load_midi(*m_current_midi, std::move(analysis));
+        if (!analysisCached) {
+            Core::PitchAnalysisCache::Instance().Store(widePath, m_engine.get_pitch_analysis());
+        }
         LOG("Engine loaded midi.");
 
 
@@ -1368,6 +1443,12 @@ void MainFrame::OnSliderChange(wxCommandEvent& event) {
 
 void MainFrame::OnABPointSetA(wxCommandEvent& event) {
     m_abPointA_ms = static_cast<double>(event.GetInt());
+
+    // 循环已启用时重设 A 点，引擎的回绕区间随之更新（与拖动 AB 点一致）
+    if (m_abLoopEnabled && m_abPointB_ms > m_abPointA_ms) {
+        m_engine.set_loop(m_abPointA_ms / 1000.0, m_abPointB_ms / 1000.0);
+    }
+
     UpdateStatusText(wxString::Format(wxString::FromUTF8("A点: %02d:%02d"),
         static_cast<int>(m_abPointA_ms / 1000) / 60,
         static_cast<int>(m_abPointA_ms / 1000) % 60));
@@ -1386,6 +1467,11 @@ void MainFrame::OnABPointSetB(wxCommandEvent& event) {
     // 同步更新 slider 中的 AB 点值
     m_progressSlider->SetABPoints(static_cast<int>(m_abPointA_ms), static_cast<int>(m_abPointB_ms));
 
+    // 循环回绕由播放线程在 B 点精确完成
+    if (m_abPointA_ms >= 0) {
+        m_engine.set_loop(m_abPointA_ms / 1000.0, m_abPointB_ms / 1000.0);
+    }
+
     // 如果有加载的 MIDI 文件，跳转到 A 点并播放
     if (m_current_midi && m_current_midi->length > 0) {
         m_engine.seek(m_abPointA_ms / 1000.0);
@@ -1410,6 +1496,7 @@ void MainFrame::OnABPointClear(wxCommandEvent& event) {
     m_abPointA_ms = -1.0;
     m_abPointB_ms = -1.0;
     m_abLoopEnabled = false;
+    m_engine.clear_loop();
     UpdateStatusText(wxString::FromUTF8("已清除AB点"));
 }
 
@@ -1431,6 +1518,10 @@ void MainFrame::OnABPointDrag(wxCommandEvent& event) {
         double maxAB = std::max(m_abPointA_ms, m_abPointB_ms);
         m_abPointA_ms = minAB;
         m_abPointB_ms = maxAB;
+
+        if (m_abLoopEnabled) {
+            m_engine.set_loop(m_abPointA_ms / 1000.0, m_abPointB_ms / 1000.0);
+        }
     }
 }
 
@@ -1543,172 +1634,189 @@ void MainFrame::OnDeleteKeymap(wxCommandEvent& event) {
 void MainFrame::OnSchedule(wxCommandEvent& event) {
     if (m_is_scheduled) {
         // Cancel schedule
-        m_is_scheduled = false;
-        m_active_schedule_token.store(0);
-        m_schedule_token.fetch_add(1);
-        m_schedule_target_epoch_us.store(0);
-        m_scheduleBtn->SetLabel(wxString::FromUTF8("定时"));
-        m_schedMin->Enable(true);
-        m_schedSec->Enable(true);
-        UpdateStatusText(wxString::FromUTF8("定时已取消"));
-        if (m_stateMachine.GetCurrentState() == UI::PlaybackStatus::Scheduled) {
-            m_stateMachine.TransitionTo(UI::PlaybackStatus::Idle);
-        }
+        m_engine.cancel_scheduled_start();
+        FinishSchedule(wxString::FromUTF8("定时已取消"));
     } else {
         // Start schedule
-        m_is_scheduled = true;
-        m_scheduleBtn->SetLabel(wxString::FromUTF8("取消"));
-        m_schedMin->Enable(false);
-        m_schedSec->Enable(false);
-        
         int mins = m_schedMin->GetValue();
         int secs = m_schedSec->GetValue();
-        wxString schedInfo = wxString::Format(wxString::FromUTF8("目标: %02d:%02d"), mins, secs);
-        m_stateMachine.SetContextInfo(schedInfo);
-        m_stateMachine.TransitionTo(UI::PlaybackStatus::Scheduled);
-        UpdateStatusText(wxString::Format(wxString::FromUTF8("定时已启动 (目标: %02d:%02d)"), mins, secs));
-
-        const auto token = m_schedule_token.fetch_add(1) + 1;
-        m_active_schedule_token.store(token);
-        StartBackgroundTask([this, token, mins, secs]() {
-            const bool success = Util::NtpClient::IsSynced();
-
-            if (!m_isShuttingDown.load() && m_is_scheduled && m_active_schedule_token.load() == token) {
-                wxCommandEvent* event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_NTP_TIMER);
-                event->SetClientData(new std::pair<bool, wxString>(success,
-                    wxString::Format(wxString::FromUTF8("定时已启动 (目标: %02d:%02d)"), mins, secs)));
-                wxQueueEvent(this, event);
-            }
 
-            auto now = Util::NtpClient::GetNow();
-            auto now_c = std::chrono::system_clock::to_time_t(now);
-            struct tm parts;
-            localtime_s(&parts, &now_c);
+        auto now = Util::NtpClient::GetNow();
+        auto now_c = std::chrono::system_clock::to_time_t(now);
+        struct tm parts;
+        localtime_s(&parts, &now_c);
 
-            struct tm target_parts = parts;
-            target_parts.tm_min = mins;
-            target_parts.tm_sec = secs;
-            target_parts.tm_isdst = -1;
+        struct tm target_parts = parts;
+        target_parts.tm_min = mins;
+        target_parts.tm_sec = secs;
+        target_parts.tm_isdst = -1;
 
-            auto target_c = mktime(&target_parts);
-            if (target_c == (time_t)-1) {
-                return;
-            }
+        auto target_c = mktime(&target_parts);
+        if (target_c == (time_t)-1) {
+            UpdateStatusText(wxString::FromUTF8("定时目标时间无效"));
+            return;
+        }
 
-            auto target_tp = std::chrono::system_clock::from_time_t(target_c);
-            if (target_tp <= now) {
-                target_tp += std::chrono::hours(1);
+        auto target_tp = std::chrono::system_clock::from_time_t(target_c);
+        if (target_tp <= now) {
+            target_tp += std::chrono::hours(1);
+        }
+
+        // 局域网主机：集体开始从头播放，并通知所有从机在同一时刻开始
+        wxString peerText;
+        if (Util::NtpClient::GetPeerMode() == Util::PeerMode::Leader && m_current_midi) {
+            if (m_engine.is_playing()) {
+                wxCommandEvent dummy;
+                OnStop(dummy);
             }
+            Util::GroupStart msg;
+            msg.song = wxFileName(m_current_path).GetFullName().ToUTF8().data();
+            msg.start_time = target_tp;
+            const int reached = Util::NtpClient::BroadcastGroupStart(msg);
+            peerText = wxString::Format(wxString::FromUTF8(" - 已通知 %d 台从机"), reached);
+        }
 
-            // 在进入循环前，先存入原始目标时间（不含补偿）
-            // 这样 OnScheduleTrigger 可以根据最新的 latency_comp 实时计算抖动
-            m_schedule_target_epoch_us.store(
-                (long long)std::chrono::duration_cast<std::chrono::microseconds>(target_tp.time_since_epoch()).count()
-            );
+        BeginSchedule(target_tp);
 
-            while (!m_isShuttingDown.load() && m_active_schedule_token.load() == token) {
-                now = Util::NtpClient::GetNow();
-                const auto latency_us = m_latency_comp_us.load();
-                // 正数表示提前触发（抵消网络延迟）
-                // 目标时间 = 原始目标 - 延迟值
-                const auto effective_target_tp = target_tp - std::chrono::microseconds(latency_us);
+        const wxString baseText = wxString::Format(wxString::FromUTF8("定时已启动 (目标: %02d:%02d)"), mins, secs);
+        if (Util::NtpClient::IsSynced()) {
+            UpdateStatusText(baseText + wxString::FromUTF8(" - 时间已同步") + peerText);
+        } else {
+            UpdateStatusText(baseText + wxString::FromUTF8(" - 时间同步中...") + peerText);
+        }
+    }
+}
 
-                // 睡眠等待逻辑基于 effective_target_tp (含补偿)
-                if (now >= effective_target_tp) {
-                    break;
-                }
-                const auto remaining = effective_target_tp - now;
-
-                if (remaining > std::chrono::microseconds(2000)) {
-                    auto sleep_for = std::chrono::duration_cast<std::chrono::microseconds>(remaining) - std::chrono::microseconds(500);
-                    if (sleep_for > std::chrono::milliseconds(50)) {
-                        sleep_for = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::milliseconds(50));
-                    } else if (sleep_for < std::chrono::microseconds(200)) {
-                        sleep_for = std::chrono::microseconds(200);
-                    }
-                    std::this_thread::sleep_for(sleep_for);
-                    continue;
-                }
+void MainFrame::BeginSchedule(std::chrono::system_clock::time_point target_tp) {
+    // 存入原始目标时间（不含补偿），延迟补偿变化时据此重新下发
+    m_schedule_target_epoch_us.store(
+        (long long)std::chrono::duration_cast<std::chrono::microseconds>(target_tp.time_since_epoch()).count()
+    );
+    m_schedule_start_id = m_engine.get_start_stats().start_id;
+    m_is_scheduled = true;
 
-                const auto fine_latency_us = m_latency_comp_us.load();
-                // 正数表示提前触发
-                const auto fine_effective_target_tp = target_tp - std::chrono::microseconds(fine_latency_us);
-                
-                while (!m_isShuttingDown.load() && m_active_schedule_token.load() == token) {
-                    now = Util::NtpClient::GetNow();
-                    if (now >= fine_effective_target_tp) {
-                        break;
-                    }
-                    const auto fine_remaining = fine_effective_target_tp - now;
-                    if (fine_remaining > std::chrono::microseconds(200)) {
-                        std::this_thread::sleep_for(std::chrono::microseconds(100));
-                    } else {
-                        std::this_thread::yield();
-                    }
-                }
-                break; // 显式退出外层循环
-            }
+    auto target_c = std::chrono::system_clock::to_time_t(target_tp);
+    struct tm parts;
+    localtime_s(&parts, &target_c);
+    m_schedMin->SetValue(parts.tm_min);
+    m_schedSec->SetValue(parts.tm_sec);
 
-            if (m_isShuttingDown.load() || m_active_schedule_token.load() != token) {
-                return;
-            }
+    m_scheduleBtn->SetLabel(wxString::FromUTF8("取消"));
+    m_schedMin->Enable(false);
+    m_schedSec->Enable(false);
 
-            auto* evt = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_SCHEDULE_TRIGGER);
-            evt->SetClientData(new unsigned long long(token));
-            wxQueueEvent(this, evt);
-        });
-    }
+    wxString schedInfo = wxString::Format(wxString::FromUTF8("目标: %02d:%02d"), parts.tm_min, parts.tm_sec);
+    m_stateMachine.SetContextInfo(schedInfo);
+    m_stateMachine.TransitionTo(UI::PlaybackStatus::Scheduled);
+
+    // 未选择歌曲时暂不下发，OnTimer 在歌曲加载后补发
+    ApplyScheduledStart();
 }
 
-void MainFrame::OnNtpSyncComplete(wxCommandEvent& event) {
-    // 安全地处理来自后台线程的NTP同步结果
-    if (m_isShuttingDown.load()) {
+void MainFrame::OnAnalyzeAll(wxCommandEvent& event) {
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < m_playlistManager.GetPlaylistCount(); ++i) {
+        const Util::Playlist* playlist = m_playlistManager.GetPlaylist(i);
+        if (!playlist) continue;
+        for (const auto& file : playlist->files) {
+            paths.push_back(file.ToStdWstring());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    if (paths.empty()) {
+        UpdateStatusText(wxString::FromUTF8("播放列表为空"));
         return;
     }
-    
-    std::pair<bool, wxString>* data = static_cast<std::pair<bool, wxString>*>(event.GetClientData());
-    if (data) {
-        bool success = data->first;
-        wxString baseText = data->second;
-        
-        if (success) {
-            UpdateStatusText(baseText + wxString::FromUTF8(" - 时间已同步"));
-        } else {
-            UpdateStatusText(baseText + wxString::FromUTF8(" - 时间同步中..."));
+
+    m_analyzeBtn->Disable();
+    UpdateStatusText(wxString::Format(wxString::FromUTF8("正在分析 %zu 个文件..."), paths.size()));
+
+    StartBackgroundTask([this, paths = std::move(paths)]() {
+        const size_t analyzed = Core::PitchAnalysisCache::Instance().AnalyzeAll(paths, &m_isShuttingDown);
+        if (m_isShuttingDown.load()) {
+            return;
         }
-        
-        delete data; // 清理动态分配的数据
-    }
+        auto* evt = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_ANALYZE_DONE);
+        evt->SetInt(static_cast<int>(analyzed));
+        evt->SetExtraLong(static_cast<long>(paths.size()));
+        wxQueueEvent(this, evt);
+    });
 }
 
-void MainFrame::OnScheduleTrigger(wxCommandEvent& event) {
-    if (m_isShuttingDown.load()) {
+void MainFrame::OnAnalyzeDone(wxCommandEvent& event) {
+    m_analyzeBtn->Enable();
+    UpdateStatusText(wxString::Format(wxString::FromUTF8("分析完成: 新分析 %d 个，共 %ld 个文件"),
+                                      event.GetInt(), event.GetExtraLong()));
+}
+
+void MainFrame::OnGroupStart(wxCommandEvent& event) {
+    std::unique_ptr<Util::GroupStart> msg(static_cast<Util::GroupStart*>(event.GetClientData()));
+    if (!msg || m_isShuttingDown.load()) {
         return;
     }
 
-    auto* token_ptr = static_cast<unsigned long long*>(event.GetClientData());
-    const auto token = token_ptr ? *token_ptr : 0ull;
-    if (token_ptr) {
-        delete token_ptr;
+    const wxString song = wxString::FromUTF8(msg->song.c_str());
+
+    // 新的集体开始覆盖本地定时
+    if (m_is_scheduled) {
+        m_engine.cancel_scheduled_start();
+        m_is_scheduled = false;
     }
 
-    if (!m_is_scheduled || m_active_schedule_token.load() != token) {
-        return;
+    // 按文件名在当前播放列表中查找主机指定的歌曲，集体开始从头播放
+    if (!m_current_midi || wxFileName(m_current_path).GetFullName() != song) {
+        int found = -1;
+        for (int row = 0; row < m_playlistCtrl->GetItemCount(); ++row) {
+            long modelIndex = m_playlistCtrl->GetItemData(row);
+            if (modelIndex >= 0 && modelIndex < static_cast<long>(m_playlist_files.size()) &&
+                wxFileName(m_playlist_files[modelIndex]).GetFullName() == song) {
+                found = row;
+                break;
+            }
+        }
+        if (found < 0 || !PlayIndex(found, false)) {
+            FinishSchedule(wxString::Format(wxString::FromUTF8("集体开始: 当前播放列表中没有 %s"), song));
+            return;
+        }
+    } else if (m_engine.is_playing()) {
+        wxCommandEvent dummy;
+        OnStop(dummy);
     }
 
+    BeginSchedule(msg->start_time);
+
+    auto target_c = std::chrono::system_clock::to_time_t(msg->start_time);
+    struct tm parts;
+    localtime_s(&parts, &target_c);
+    UpdateStatusText(wxString::Format(wxString::FromUTF8("集体开始: %s (目标: %02d:%02d)"), song, parts.tm_min, parts.tm_sec));
+}
+
+void MainFrame::ApplyScheduledStart() {
     const auto target_us = m_schedule_target_epoch_us.load();
+    if (!m_is_scheduled || target_us == 0 || !m_current_midi) {
+        return;
+    }
 
-    UpdateStatusText(wxString::FromUTF8("定时任务触发"));
+    // 正数表示提前触发（抵消网络延迟）：目标时间 = 原始目标 - 延迟值
+    const auto effective_target_tp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(target_us - m_latency_comp_us.load())));
 
+    // 播放线程预先收集首批事件，按 NTP 校正后的时钟精确触发，不再经过 UI 事件队列
+    m_engine.play_at(effective_target_tp, &Util::NtpClient::GetNow);
+}
+
+void MainFrame::FinishSchedule(const wxString& statusText) {
     m_is_scheduled = false;
-    m_active_schedule_token.store(0);
     m_schedule_target_epoch_us.store(0);
     m_scheduleBtn->SetLabel(wxString::FromUTF8("定时"));
     m_schedMin->Enable(true);
     m_schedSec->Enable(true);
-
-    wxCommandEvent dummy;
-    OnPlay(dummy);
+    UpdateStatusText(statusText);
+    if (m_stateMachine.GetCurrentState() == UI::PlaybackStatus::Scheduled) {
+        m_stateMachine.TransitionTo(UI::PlaybackStatus::Idle);
+    }
 }
 
 // Global Hook Implementation
@@ -1852,16 +1960,39 @@ void MainFrame::OnTimer(wxTimerEvent& event) {
          }
     }
 
-    if (m_engine.is_playing()) {
-        double t = m_engine.get_current_time();
+    // 定时启动由播放引擎在目标时刻触发，这里只同步界面状态
+    if (m_is_scheduled && !m_engine.is_start_pending()) {
+        const Core::StartStats start = m_engine.get_start_stats();
+        const auto target_us = m_schedule_target_epoch_us.load();
+        const auto now_us = (long long)std::chrono::duration_cast<std::chrono::microseconds>(now_ntp.time_since_epoch()).count();
+        if (start.start_id != m_schedule_start_id) {
+            FinishSchedule(wxString::Format(wxString::FromUTF8("定时任务触发 (启动误差 %.2fms)"), start.error_us / 1000.0));
+        } else if (m_engine.is_playing()) {
+            // 手动播放取代了定时启动
+            FinishSchedule(wxString::FromUTF8("定时已取消"));
+        } else if (now_us >= target_us) {
+            FinishSchedule(wxString::FromUTF8("定时已过期"));
+        } else {
+            // 停止或切换歌曲会清除引擎中的定时，重新下发
+            ApplyScheduledStart();
+        }
+    }
 
-        // AB Point Loop: 如果到达B点，跳回A点
-        if (m_abLoopEnabled && m_abPointA_ms >= 0 && m_abPointB_ms > m_abPointA_ms) {
-            double currentTime_ms = t * 1000.0;
-            if (currentTime_ms >= m_abPointB_ms) {
-                m_engine.seek(m_abPointA_ms / 1000.0);
-            }
+    // 事件重建完成后提示限速丢弃与复音抢占的音符数
+    const Core::RebuildStats stats = m_engine.get_rebuild_stats();
+    static int lastRebuildId = 0;
+    if (stats.rebuild_id != lastRebuildId) {
+        lastRebuildId = stats.rebuild_id;
+        if (stats.dropped_rate_limit > 0) {
+            UpdateStatusText(wxString::Format(wxString::FromUTF8("输入限速: 已丢弃 %d 个音符"), stats.dropped_rate_limit));
+        } else if (stats.stolen_voices > 0) {
+            UpdateStatusText(wxString::Format(wxString::FromUTF8("复音上限: 已抢占 %d 个音符"), stats.stolen_voices));
         }
+    }
+
+    if (m_engine.is_playing()) {
+        // AB 点循环由播放引擎在 B 点精确回绕（见 PlaybackEngine::set_loop）
+        double t = m_engine.get_current_time();
 
         // 优化：减少UI更新频率
         static int updateCounter = 0;
@@ -2059,6 +2190,24 @@ void MainFrame::SaveFileConfig() {
             m_config->DeleteEntry(prefix + "Track");
         }
 
+        // 6. Keymap（内置预设下标，跟随全局时不保存）
+        int keymapSel = c.keymapChoice->GetSelection();
+        if (keymapSel > 0) {
+            m_config->Write(prefix + "Keymap", keymapSel - 1);
+            channelHasConfig = true;
+        } else {
+            m_config->DeleteEntry(prefix + "Keymap");
+        }
+
+        // 7. Offset（毫秒）
+        int offsetMs = c.offsetCtrl->GetValue();
+        if (offsetMs != 0) {
+            m_config->Write(prefix + "OffsetMs", offsetMs);
+            channelHasConfig = true;
+        } else {
+            m_config->DeleteEntry(prefix + "OffsetMs");
+        }
+
         if (channelHasConfig) {
             fileHasConfig = true;
         } else {
@@ -2089,11 +2238,73 @@ void MainFrame::LoadGlobalConfig() {
     bool decompose = false;
     m_config->Read("Decompose", &decompose, false);
 
+    // 高级设置（仅 config.ini）：和弦判定窗口与错开时长，StaggerBeatDiv > 0 时按 1/n 拍错开
+    int chordThresholdMs = 30;
+    int staggerMs = 50;
+    int staggerBeatDiv = 0;
+    m_config->Read("ChordThresholdMs", &chordThresholdMs, 30);
+    m_config->Read("StaggerMs", &staggerMs, 50);
+    m_config->Read("StaggerBeatDiv", &staggerBeatDiv, 0);
+
     int latencyComp = 0;
     m_config->Read("LatencyComp", &latencyComp, 0);
 
+    // 高级设置（仅 config.ini）：按游戏帧率量化按键时间，0 表示关闭
+    int tickRate = 0;
+    m_config->Read("TickRate", &tickRate, 0);
+
+    // 高级设置（仅 config.ini）：每个窗口每 RateLimitWindowMs 毫秒最多按键数，0 表示不限制
+    int rateLimit = 0;
+    int rateLimitWindowMs = 100;
+    m_config->Read("RateLimit", &rateLimit, 0);
+    m_config->Read("RateLimitWindowMs", &rateLimitWindowMs, 100);
+
+    // 高级设置（仅 config.ini）：每个窗口同时按住的按键上限与抢占策略（oldest / quietest / outer）
+    int maxPolyphony = 0;
+    wxString voiceSteal = "oldest";
+    m_config->Read("MaxPolyphony", &maxPolyphony, 0);
+    m_config->Read("VoiceSteal", &voiceSteal, "oldest");
+    Core::VoiceStealPolicy stealPolicy = Core::VoiceStealPolicy::Oldest;
+    if (voiceSteal.IsSameAs("quietest", false)) {
+        stealPolicy = Core::VoiceStealPolicy::Quietest;
+    } else if (voiceSteal.IsSameAs("outer", false)) {
+        stealPolicy = Core::VoiceStealPolicy::KeepOuter;
+    }
+
+    // 高级设置（仅 config.ini）：NTP 服务器（逗号分隔）与端口，留空使用内置列表
+    wxString ntpServers;
+    int ntpPort = 123;
+    m_config->Read("NtpServers", &ntpServers, "");
+    m_config->Read("NtpPort", &ntpPort, 123);
+
+    // 高级设置（仅 config.ini）：局域网对时，off / leader / follower
+    wxString peerMode = "off";
+    wxString peerLeader;
+    int peerPort = 47123;
+    m_config->Read("PeerMode", &peerMode, "off");
+    m_config->Read("PeerLeader", &peerLeader, "");
+    m_config->Read("PeerPort", &peerPort, 47123);
+
     m_config->SetPath("/");
 
+    std::vector<std::string> servers;
+    for (const auto& token : wxSplit(ntpServers, ',')) {
+        wxString server = token;
+        server.Trim(true).Trim(false);
+        if (!server.IsEmpty()) {
+            servers.push_back(server.ToStdString());
+        }
+    }
+    Util::NtpClient::SetServers(servers, ntpPort);
+
+    Util::PeerMode mode = Util::PeerMode::Off;
+    if (peerMode.IsSameAs("leader", false)) {
+        mode = Util::PeerMode::Leader;
+    } else if (peerMode.IsSameAs("follower", false)) {
+        mode = Util::PeerMode::Follower;
+    }
+    Util::NtpClient::SetPeerMode(mode, peerLeader.Trim(true).Trim(false).ToStdString(), peerPort);
+
     m_minPitchCtrl->SetValue(minPitch);
     m_maxPitchCtrl->SetValue(maxPitch);
 
@@ -2105,6 +2316,10 @@ void MainFrame::LoadGlobalConfig() {
         ? wxString::FromUTF8("和弦分解") 
         : wxString::FromUTF8("普通模式"));
     m_engine.set_decompose(decompose);
+    m_engine.set_decompose_timing(chordThresholdMs, staggerMs, staggerBeatDiv);
+    m_engine.set_tick_rate(tickRate);
+    m_engine.set_rate_limit(rateLimit, rateLimitWindowMs);
+    m_engine.set_polyphony(maxPolyphony, stealPolicy);
 
     if (m_latencyCompCtrl) {
         m_latencyCompCtrl->SetValue(latencyComp);
@@ -2131,6 +2346,51 @@ void MainFrame::SaveGlobalConfig() {
     m_config->Flush();
 }
 
+void MainFrame::LoadNtpProfile() {
+    m_config->SetPath("/NtpProfile");
+
+    // 档案按机器区分：配置文件随便携目录复制到其它电脑时不使用
+    wxString machine;
+    m_config->Read("Machine", &machine, "");
+
+    Util::DriftProfile profile;
+    double savedAt = 0.0;
+    m_config->Read("FreqPpm", &profile.freq_ppm, 0.0);
+    m_config->Read("FreqVarPpm2", &profile.freq_var_ppm2, 0.0);
+    m_config->Read("OffsetMs", &profile.offset_ms, 0.0);
+    m_config->Read("DelayMs", &profile.delay_ms, 0.0);
+    m_config->Read("SyncCount", &profile.sync_count, 0);
+    m_config->Read("SavedAt", &savedAt, 0.0);
+
+    m_config->SetPath("/");
+
+    if (machine.IsEmpty() || machine != wxGetHostName()) {
+        return;
+    }
+    profile.saved_at = static_cast<long long>(savedAt);
+    Util::NtpClient::LoadDriftProfile(profile);
+}
+
+void MainFrame::SaveNtpProfile() {
+    Util::DriftProfile profile;
+    if (!Util::NtpClient::GetDriftProfile(profile)) {
+        return;
+    }
+
+    m_config->SetPath("/NtpProfile");
+
+    m_config->Write("Machine", wxGetHostName());
+    m_config->Write("FreqPpm", profile.freq_ppm);
+    m_config->Write("FreqVarPpm2", profile.freq_var_ppm2);
+    m_config->Write("OffsetMs", profile.offset_ms);
+    m_config->Write("DelayMs", profile.delay_ms);
+    m_config->Write("SyncCount", profile.sync_count);
+    m_config->Write("SavedAt", static_cast<double>(profile.saved_at));
+
+    m_config->SetPath("/");
+    m_config->Flush();
+}
+
 void MainFrame::LoadPlaylistConfig() {
     m_playlistCtrl->DeleteAllItems();
     
@@ -2543,6 +2803,25 @@ void MainFrame::LoadFileConfig(const wxString& filename) {
         } else {
             m_engine.set_channel_track(c.channelIndex, -1);
         }
+
+        // 5. Keymap
+        int keymapPreset = -1;
+        if (hasConfig) {
+            m_config->Read(prefix + "Keymap", &keymapPreset, -1);
+        }
+        if (keymapPreset + 1 < 0 || keymapPreset + 1 >= static_cast<int>(c.keymapChoice->GetCount())) {
+            keymapPreset = -1;
+        }
+        c.keymapChoice->SetSelection(keymapPreset + 1);
+        m_engine.set_channel_keymap(c.channelIndex, keymapPreset);
+
+        // 6. Offset（毫秒）
+        int offsetMs = 0;
+        if (hasConfig) {
+            m_config->Read(prefix + "OffsetMs", &offsetMs, 0);
+        }
+        c.offsetCtrl->SetValue(offsetMs);
+        m_engine.set_channel_latency_offset(c.channelIndex, c.offsetCtrl->GetValue() * 1000);
     }
     
     if (hasConfig) {
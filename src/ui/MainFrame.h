@@ -31,6 +31,7 @@ enum {
     ID_IMPORT_BTN = 1001,
     ID_REMOVE_BTN,
     ID_CLEAR_BTN,
+    ID_ANALYZE_BTN,
     ID_SEARCH_CTRL,
     ID_PLAYLIST_CTRL,
     
@@ -62,9 +63,9 @@ enum {
     // Timer IDs
     ID_PLAYBACK_TIMER = 2001,
     ID_STATUS_TIMER,
-    ID_NTP_TIMER,
-    ID_SCHEDULE_TRIGGER,
-    ID_HELP_SCROLL_TIMER
+    ID_HELP_SCROLL_TIMER,
+    ID_GROUP_START,
+    ID_ANALYZE_DONE
 };
 
 // Structure to hold controls for a single channel
@@ -74,6 +75,8 @@ struct ChannelControls {
     wxSpinCtrl* transposeCtrl;
 
     wxChoice* trackChoice;
+    wxChoice* keymapChoice;   ///< 通道独立键位：0 跟随全局，其余为内置预设下标 + 1
+    wxSpinCtrl* offsetCtrl;   ///< 通道发送偏移（毫秒）
     int channelIndex;
 };
 
@@ -98,6 +101,8 @@ private:
     void OnImportFile(wxCommandEvent& event);
     void OnRemoveFile(wxCommandEvent& event);
     void OnClearList(wxCommandEvent& event);
+    void OnAnalyzeAll(wxCommandEvent& event);   ///< 后台批量分析所有播放列表中的文件
+    void OnAnalyzeDone(wxCommandEvent& event);
     void OnSearch(wxCommandEvent& event);
     void OnPlaylistSelected(wxListEvent& event);
     void OnPlaylistActivated(wxListEvent& event);
@@ -135,10 +140,10 @@ private:
     void OnSaveKeymap(wxCommandEvent& event);
     void OnDeleteKeymap(wxCommandEvent& event);
     void OnSchedule(wxCommandEvent& event);
-
-    // Custom event handlers
-    void OnNtpSyncComplete(wxCommandEvent& event);
-    void OnScheduleTrigger(wxCommandEvent& event);
+    void ApplyScheduledStart();     ///< 将定时目标（扣除延迟补偿）下发给播放引擎
+    void FinishSchedule(const wxString& statusText);
+    void BeginSchedule(std::chrono::system_clock::time_point target_tp);
+    void OnGroupStart(wxCommandEvent& event);   ///< 局域网从机收到集体开始消息
     
     // Global Hook
     void InstallGlobalHook();
@@ -195,6 +200,8 @@ private:
     void SaveFileConfig();
     void LoadGlobalConfig();
     void SaveGlobalConfig();
+    void LoadNtpProfile();
+    void SaveNtpProfile();
     void LoadPlaylistConfig();
     void SavePlaylistConfig();
     void LoadKeymapConfig();
@@ -210,6 +217,7 @@ private:
     wxButton* m_importBtn;
     wxButton* m_removeBtn;
     wxButton* m_clearBtn;
+    wxButton* m_analyzeBtn;
     wxTextCtrl* m_searchCtrl;
     wxListView* m_playlistCtrl;
     
@@ -298,8 +306,7 @@ private:
     // Schedule
     bool m_is_scheduled = false;
     std::atomic<long long> m_schedule_target_epoch_us{0};
-    std::atomic<unsigned long long> m_schedule_token{0};
-    std::atomic<unsigned long long> m_active_schedule_token{0};
+    int m_schedule_start_id = 0;    ///< 定时开始时引擎的启动计数，变化即表示已触发
     
     // State Machine
     UI::PlaybackStateMachine m_stateMachine;
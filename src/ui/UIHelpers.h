@@ -14,6 +14,7 @@ namespace UIConstants {
     const wxString DEFAULT_TRACK = wxString::FromUTF8("全部音轨");
     const wxString DEFAULT_KEYMAP = wxString::FromUTF8("默认键位");
     const wxString KEYMAP_YYSLS = wxString::FromUTF8("燕云十六声");
+    const wxString CHANNEL_KEYMAP_GLOBAL = wxString::FromUTF8("全局键位");  // 通道键位：跟随全局
     
     // 播放模式
     const wxString MODE_SINGLE = wxString::FromUTF8("单曲播放");
@@ -1,5 +1,11 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Keymap
+
 #include "KeyManager.h"
+#include "KeyPresets.h"
+#include "KeymapSyntax.h"
 #include "Logger.h"
+#include "TextEncoding.h"
 #include <windows.h>
 #include <algorithm>
 #include <cctype>
@@ -8,11 +14,14 @@
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
-#include <regex>
 #include <sstream>
 
 namespace
 {
+    using Util::KeymapSyntax::normalize_line;
+    using Util::KeymapSyntax::parse_decimal;
+    using Util::KeymapSyntax::parse_keymap_line;
+
     std::string to_lower_copy(std::string s)
     {
         std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c)
@@ -31,30 +40,6 @@ namespace
         return s.substr(start, end - start);
     }
 
-    void replace_all(std::string &s, const std::string &from, const std::string &to)
-    {
-        if (from.empty())
-            return;
-        size_t pos = 0;
-        while ((pos = s.find(from, pos)) != std::string::npos)
-        {
-            s.replace(pos, from.size(), to);
-            pos += to.size();
-        }
-    }
-
-    std::string normalize_line(std::string s)
-    {
-        replace_all(s, u8"：", ":");
-        replace_all(s, u8"＝", "=");
-        replace_all(s, u8"－", "-");
-        replace_all(s, u8"＋", "+");
-        replace_all(s, u8"　", " ");
-        replace_all(s, u8"（", "(");
-        replace_all(s, u8"）", ")");
-        return s;
-    }
-
     bool is_digits(const std::string &s)
     {
         if (s.empty())
@@ -63,98 +48,6 @@ namespace
                            { return std::isdigit(c); });
     }
 
-    // 编码信息结构体
-    struct EncodingInfo
-    {
-        const char *name;
-        UINT codepage;
-        int priority; // 优先级，数值越小优先级越高
-    };
-
-    // 使用字节频率分析来估算编码类型
-    EncodingInfo analyze_encoding(const std::vector<char> &buffer)
-    {
-        if (buffer.empty())
-            return {"System", GetACP(), 100};
-
-        // 统计字节频率
-        int high_bytes = 0;      // 0x80-0xFF 范围内的字节数
-        int null_bytes = 0;      // 0x00 字节数
-        int ascii_printable = 0; // 可打印 ASCII 字符数
-        int total = static_cast<int>(buffer.size());
-
-        for (int i = 0; i < total; ++i)
-        {
-            unsigned char c = static_cast<unsigned char>(buffer[i]);
-            if (c >= 0x80)
-                high_bytes++;
-            else if (c == 0)
-                null_bytes++;
-            else if (c >= 0x20 && c < 0x7F)
-                ascii_printable++;
-        }
-
-        double high_byte_ratio = static_cast<double>(high_bytes) / total;
-
-        // 如果高层字节很少，可能是纯 ASCII 或 UTF-8
-        if (high_byte_ratio < 0.01)
-        {
-            // 可能是 ASCII 或 UTF-8，优先级较低
-            return {"UTF-8", CP_UTF8, 50};
-        }
-
-        // 分析高层字节模式来猜测编码
-        // GBK/GB2312: 高字节范围 0xA1-0xF7, 低字节范围 0xA1-0xFE
-        // Big5: 高字节范围 0xA1-0xF9, 低字节范围 0x40-0x7E 或 0xA1-0xFE
-        // Shift-JIS: 高字节范围 0x81-0x9F 或 0xE0-0xFC
-        // ISO-8859-1: 高字节通常是 0xC0-0xFF 的欧洲字符
-        // Windows-1252: 高字节范围 0x80-0x9F 有特殊字符
-
-        // 检查是否有明显的 GBK/GB2312 特征
-        bool has_gbk_pattern = false;
-        bool has_big5_pattern = false;
-        bool has_sjis_pattern = false;
-        bool has_western_pattern = false;
-
-        for (int i = 0; i < total - 1; ++i)
-        {
-            unsigned char c1 = static_cast<unsigned char>(buffer[i]);
-            unsigned char c2 = static_cast<unsigned char>(buffer[i + 1]);
-
-            if (c1 >= 0xA1 && c1 <= 0xF7 && c2 >= 0xA1 && c2 <= 0xFE)
-            {
-                has_gbk_pattern = true;
-            }
-            else if (c1 >= 0xA1 && c1 <= 0xF9 &&
-                     ((c2 >= 0x40 && c2 <= 0x7E) || (c2 >= 0xA1 && c2 <= 0xFE)))
-            {
-                has_big5_pattern = true;
-            }
-            else if ((c1 >= 0x81 && c1 <= 0x9F) || (c1 >= 0xE0 && c1 <= 0xFC))
-            {
-                if ((c2 >= 0x40 && c2 <= 0x7E) || (c2 >= 0x80 && c2 <= 0xFC))
-                    has_sjis_pattern = true;
-            }
-            else if (c1 >= 0xC0 && c1 <= 0xFF && c2 >= 0x80 && c2 <= 0xFF)
-            {
-                // 可能是西欧字符
-                has_western_pattern = true;
-            }
-        }
-
-        // 根据特征返回最可能的编码
-        if (has_gbk_pattern)
-            return {"GBK", 936, 10};
-        if (has_big5_pattern)
-            return {"Big5", 950, 20};
-        if (has_sjis_pattern)
-            return {"Shift-JIS", 932, 30};
-        if (has_western_pattern)
-            return {"Windows-1252", 1252, 40};
-
-        // 如果没有明显特征，使用默认优先级
-        return {"System", GetACP(), 100};
-    }
 
     // 尝试使用指定编码转换
     bool try_convert_to_utf8(const std::vector<char> &buffer, UINT codepage, std::string &result)
@@ -218,7 +111,13 @@ namespace
             return "";
         }
 
-        std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        // 一次读入整个文件
+        file.seekg(0, std::ios::end);
+        const std::streamoff file_size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        std::vector<char> buffer(file_size > 0 ? static_cast<size_t>(file_size) : 0);
+        if (!buffer.empty())
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         LOG_DEBUG("[read_file_with_encoding] 文件大小 (字节): " << buffer.size());
         if (buffer.empty())
         {
@@ -238,131 +137,42 @@ namespace
         }
 
         // 尝试作为 UTF-8 处理（不带 BOM）- 严格的 UTF-8 有效性检查
-        bool is_utf8 = true;
-        size_t i = 0;
-        while (i < buffer.size())
-        {
-            unsigned char c = static_cast<unsigned char>(buffer[i]);
-
-            if (c < 0x80)
-            {
-                // ASCII 字符
-                i++;
-            }
-            else if (c < 0xC0)
-            {
-                // 独立的高位字节，不是有效的 UTF-8 开始
-                is_utf8 = false;
-                break;
-            }
-            else if (c < 0xE0)
-            {
-                // 2 字节序列
-                if (i + 1 >= buffer.size() ||
-                    (static_cast<unsigned char>(buffer[i + 1]) & 0xC0) != 0x80)
-                {
-                    is_utf8 = false;
-                    break;
-                }
-                i += 2;
-            }
-            else if (c < 0xF0)
-            {
-                // 3 字节序列
-                if (i + 2 >= buffer.size() ||
-                    (static_cast<unsigned char>(buffer[i + 1]) & 0xC0) != 0x80 ||
-                    (static_cast<unsigned char>(buffer[i + 2]) & 0xC0) != 0x80)
-                {
-                    is_utf8 = false;
-                    break;
-                }
-                // 验证 UTF-16 代签（surrogate pair in UTF-8）
-                if (c == 0xED && static_cast<unsigned char>(buffer[i + 1]) > 0x9F)
-                {
-                    is_utf8 = false;
-                    break;
-                }
-                i += 3;
-            }
-            else if (c < 0xF8)
-            {
-                // 4 字节序列
-                if (i + 3 >= buffer.size() ||
-                    (static_cast<unsigned char>(buffer[i + 1]) & 0xC0) != 0x80 ||
-                    (static_cast<unsigned char>(buffer[i + 2]) & 0xC0) != 0x80 ||
-                    (static_cast<unsigned char>(buffer[i + 3]) & 0xC0) != 0x80)
-                {
-                    is_utf8 = false;
-                    break;
-                }
-                // 验证 Unicode 范围（不能超过 U+10FFFF）
-                if (c == 0xF4 && static_cast<unsigned char>(buffer[i + 1]) > 0x8F)
-                {
-                    is_utf8 = false;
-                    break;
-                }
-                i += 4;
-            }
-            else
-            {
-                // 无效的 UTF-8 开始字节
-                is_utf8 = false;
-                break;
-            }
-        }
-
-        if (is_utf8)
+        if (Util::TextEncoding::IsValidUtf8(buffer.data(), buffer.size()))
         {
             LOG_DEBUG("[read_file_with_encoding] 检测到 UTF-8 (无 BOM)");
             return std::string(buffer.begin(), buffer.end());
         }
 
-        // UTF-8 检测失败，使用字节频率分析来辅助检测编码
-        EncodingInfo encoding = analyze_encoding(buffer);
-        LOG_DEBUG("[read_file_with_encoding] 分析出的编码: " << encoding.name << ", codepage: " << encoding.codepage);
-
-        // 按优先级尝试不同的编码转换
-        // 编码优先级列表：GBK, GB2312, Big5, Shift-JIS, Windows-1252, ISO-8859-1, 系统默认
-        const EncodingInfo encodings[] = {
-            {"GBK", 936, 10},
-            {"GB2312", 936, 15}, // GB2312 也使用代码页 936
-            {"Big5", 950, 20},
-            {"Shift-JIS", 932, 30},
-            {"Windows-1252", 1252, 40},
-            {"ISO-8859-1", 28591, 50}, // ISO-8859-1
-            {"System", GetACP(), 100}};
-
-        // 如果分析结果优先级更高，优先尝试
-        std::string result;
-        if (encoding.priority < 100)
+        // UTF-8 检测失败，单遍扫描同时为 GBK/Big5/Shift-JIS 评分
+        const Util::EncodingAnalysis analysis = Util::TextEncoding::Classify(buffer.data(), buffer.size());
+        LOG_DEBUG("[read_file_with_encoding] 编码评分: "
+                  << analysis.ranked[0].name << "=" << analysis.ranked[0].score << ", "
+                  << analysis.ranked[1].name << "=" << analysis.ranked[1].score << ", "
+                  << analysis.ranked[2].name << "=" << analysis.ranked[2].score);
+
+        // 尝试顺序：高字节极少时先按 UTF-8 容错转换；然后是有双字节字符的候选（按得分），
+        // 最后是单字节编码与系统默认编码
+        std::vector<std::pair<const char *, UINT>> attempts;
+        if (analysis.high_bytes * 100 < buffer.size())
+            attempts.push_back({"UTF-8", CP_UTF8});
+        for (const auto &candidate : analysis.ranked)
         {
-            if (try_convert_to_utf8(buffer, encoding.codepage, result))
-            {
-                LOG_DEBUG("[read_file_with_encoding] 使用分析出的编码转换成功: " << encoding.name);
-                return result;
-            }
-            else
-            {
-                LOG_DEBUG("[read_file_with_encoding] 使用分析出的编码转换失败: " << encoding.name);
-            }
+            if (candidate.pairs > 0)
+                attempts.push_back({candidate.name, candidate.codepage});
         }
+        attempts.push_back({"Windows-1252", 1252});
+        attempts.push_back({"ISO-8859-1", 28591});
+        attempts.push_back({"System", GetACP()});
 
-        // 按优先级顺序尝试其他编码
-        for (const auto &enc : encodings)
+        std::string result;
+        for (const auto &[name, codepage] : attempts)
         {
-            // 跳过已经尝试过的编码
-            if (encoding.priority < 100 && enc.codepage == encoding.codepage)
-                continue;
-
-            if (try_convert_to_utf8(buffer, enc.codepage, result))
+            if (try_convert_to_utf8(buffer, codepage, result))
             {
-                LOG_DEBUG("[read_file_with_encoding] 使用编码转换成功: " << enc.name);
+                LOG_DEBUG("[read_file_with_encoding] 使用编码转换成功: " << name);
                 return result;
             }
-            else
-            {
-                LOG_DEBUG("[read_file_with_encoding] 使用编码转换失败: " << enc.name);
-            }
+            LOG_DEBUG("[read_file_with_encoding] 使用编码转换失败: " << name);
         }
 
         // 所有编码都失败，返回原始数据
@@ -398,17 +208,13 @@ namespace Util
     KeyManager::KeyManager()
     {
         LOG_DEBUG("[KeyManager] 初始化，加载默认键位映射");
-        init_default_map();
+        load_preset(0);
     }
 
-    KeyMapping KeyManager::get_mapping(int note)
+    KeyMapping KeyManager::get_mapping(int note) const
     {
         // 优化：使用 O(1) 缓存数组查找，避免 std::map 的 O(log n) 开销
-        if (note >= 0 && note < 128 && m_lookup_valid[note])
-        {
-            return m_lookup_cache[note];
-        }
-        return {0, 0};
+        return snapshot()->lookup(note);
     }
 
     /// 加载键位配置
@@ -431,8 +237,8 @@ namespace Util
         std::string line;
         int line_count = 0;
         int valid_count = 0;
-        // 优化：静态缓存正则表达式，避免每次调用重新编译
-        static const std::regex re(R"((?:音符\s+)?([A-G][#bB]?\d+|\d+)(?:\s*\(.*?\))?[\s]*[:=\-\s]+[\s]*([^\s]+))", std::regex::icase | std::regex::optimize);
+        std::string key_part;
+        std::string value_part;
         while (std::getline(lines, line))
         {
             line_count++;
@@ -444,16 +250,16 @@ namespace Util
                 continue;
 
             line = normalize_line(line);
-            std::smatch match;
-            if (std::regex_search(line, match, re))
+            if (parse_keymap_line(line, key_part, value_part))
             {
-                std::string key_part = match[1].str();
-                std::string value_part = match[2].str();
-
                 int pitch = -1;
                 if (is_digits(key_part))
                 {
-                    pitch = std::stoi(key_part);
+                    if (!parse_decimal(key_part, 0, key_part.size(), pitch))
+                    {
+                        LOG_WARN("音符编号超出范围: " << key_part << " (行 " << line_count << ")");
+                        continue;
+                    }
                 }
                 else
                 {
@@ -495,8 +301,9 @@ namespace Util
     {
         LOG_DEBUG("[KeyManager] 保存键位配置 (宽字符路径)");
 
+        const auto &note_map = get_map();
         std::vector<int> keys;
-        for (const auto &pair : m_note_map)
+        for (const auto &pair : note_map)
         {
             keys.push_back(pair.first);
         }
@@ -506,8 +313,8 @@ namespace Util
         entries.reserve(keys.size());
         for (int k : keys)
         {
-            auto it = m_note_map.find(k);
-            if (it == m_note_map.end())
+            auto it = note_map.find(k);
+            if (it == note_map.end())
                 continue;
             std::string key_str = format_key_string(it->second.vk_code, it->second.modifier);
             if (key_str.empty())
@@ -576,151 +383,70 @@ namespace Util
 
     const std::map<int, KeyMapping> &KeyManager::get_map() const
     {
+        // 切换预设只替换查找表，有序映射在首次读取时再生成
+        if (m_note_map_dirty)
+        {
+            const KeyTable *table = snapshot();
+            m_note_map.clear();
+            for (int note = 0; note < KeyTable::NOTE_COUNT; ++note)
+            {
+                if (table->valid[note])
+                    m_note_map.emplace_hint(m_note_map.end(), note, table->keys[note]);
+            }
+            m_note_map_dirty = false;
+        }
         return m_note_map;
     }
 
     void KeyManager::reset_to_default()
     {
         LOG_DEBUG("[KeyManager] 重置为默认键位映射");
-        init_default_map();
+        load_preset(0);
     }
 
     void KeyManager::load_yysls_preset()
     {
         LOG_DEBUG("[KeyManager] 加载燕云十六声键位预设");
-        init_yysls_map();
+        load_preset(1);
     }
 
-    void KeyManager::init_default_map()
+    bool KeyManager::load_preset(size_t index)
     {
-        m_note_map.clear();
-
-        LOG_DEBUG("加载 FF14 默认键位映射");
-
-        // Default mapping from original python source (key_manager.py)
-        // Note: Default mapping does not use modifiers (Shift=1, Ctrl=2)
-
-        // High range / Special chars
-        m_note_map[48] = {'I', 0};      // i
-        m_note_map[50] = {'O', 0};      // o
-        m_note_map[52] = {'P', 0};      // p
-        m_note_map[53] = {VK_OEM_4, 0}; // [
-        m_note_map[55] = {VK_OEM_6, 0}; // ]
-        m_note_map[57] = {VK_OEM_5, 0}; // \ (backslash)
-        m_note_map[59] = {VK_OEM_7, 0}; // ' (quote)
-
-        // Mid range (QWERTY row)
-        m_note_map[60] = {'Q', 0};
-        m_note_map[62] = {'W', 0};
-        m_note_map[64] = {'E', 0};
-        m_note_map[65] = {'R', 0};
-        m_note_map[67] = {'T', 0};
-        m_note_map[69] = {'Y', 0};
-        m_note_map[71] = {'U', 0};
-
-        // Low range / Numbers
-        m_note_map[81] = {'N', 0};
-        m_note_map[83] = {'M', 0};
-        m_note_map[49] = {'8', 0};
-        m_note_map[51] = {'9', 0};
-        m_note_map[54] = {'0', 0};
-        m_note_map[56] = {VK_OEM_MINUS, 0}; // -
-        m_note_map[58] = {VK_OEM_PLUS, 0};  // =
-
-        // Numbers row
-        m_note_map[61] = {'2', 0};
-        m_note_map[63] = {'3', 0};
-        m_note_map[66] = {'5', 0};
-        m_note_map[68] = {'6', 0};
-        m_note_map[70] = {'7', 0};
-
-        // H, J
-        m_note_map[80] = {'H', 0};
-        m_note_map[82] = {'J', 0};
-
-        // Bottom row (ZXCV...)
-        m_note_map[72] = {'Z', 0};
-        m_note_map[73] = {'S', 0};
-        m_note_map[74] = {'X', 0};
-        m_note_map[75] = {'D', 0};
-        m_note_map[76] = {'C', 0};
-        m_note_map[77] = {'V', 0};
-        m_note_map[78] = {'G', 0};
-        m_note_map[79] = {'B', 0};
-        m_note_map[84] = {VK_OEM_2, 0}; // /
-        rebuild_lookup_cache();
+        if (index >= Presets::BUILTIN_COUNT)
+        {
+            LOG_WARN("内置键位预设不存在: " << index);
+            return false;
+        }
+
+        const Presets::BuiltinPreset &preset = Presets::kBuiltin[index];
+        publish(preset.table);
+        m_note_map_dirty = true;
 
-        LOG_DEBUG("默认键位映射已加载: " << m_note_map.size() << " 个映射");
+        LOG_DEBUG("内置键位预设已加载: " << preset.name);
+        return true;
     }
 
-    void KeyManager::init_yysls_map()
+    void KeyManager::publish(const KeyTable *table)
     {
-        m_note_map.clear();
-
-        LOG_DEBUG("加载燕云十六声键位映射");
-
-        // 音符 48-83 (C3-B5)，映射自 keymaps/燕云十六声默认键位.txt
-        // 排列顺序：下行左手区 (48-59)、中行右手区 (60-71)、上行右手区 (72-83)
-        //
-        // 修饰符: +=Shift(1), -=Ctrl(2)
-        // 下行左手区 (z/x/c/v/b/n/m)
-        m_note_map[48] = {'Z', 0};       // C3 → z
-        m_note_map[49] = {'Z', 1};       // C#3 → z+ (Shift)
-        m_note_map[50] = {'X', 0};       // D3 → x
-        m_note_map[51] = {'C', 2};       // D#3 → c- (Ctrl)
-        m_note_map[52] = {'C', 0};       // E3 → c
-        m_note_map[53] = {'V', 0};       // F3 → v
-        m_note_map[54] = {'V', 1};       // F#3 → v+ (Shift)
-        m_note_map[55] = {'B', 0};       // G3 → b
-        m_note_map[56] = {'B', 1};       // G#3 → b+ (Shift)
-        m_note_map[57] = {'N', 0};       // A3 → n
-        m_note_map[58] = {'M', 2};       // A#3 → m- (Ctrl)
-        m_note_map[59] = {'M', 0};       // B3 → m
-
-        // 中行主区 (a/s/d/f/g/h/j)
-        m_note_map[60] = {'A', 0};       // C4 → a
-        m_note_map[61] = {'A', 1};       // C#4 → a+ (Shift)
-        m_note_map[62] = {'S', 0};       // D4 → s
-        m_note_map[63] = {'D', 2};       // D#4 → d- (Ctrl)
-        m_note_map[64] = {'D', 0};       // E4 → d
-        m_note_map[65] = {'F', 0};       // F4 → f
-        m_note_map[66] = {'F', 1};       // F#4 → f+ (Shift)
-        m_note_map[67] = {'G', 0};       // G4 → g
-        m_note_map[68] = {'G', 1};       // G#4 → g+ (Shift)
-        m_note_map[69] = {'H', 0};       // A4 → h
-        m_note_map[70] = {'J', 2};       // A#4 → j- (Ctrl)
-        m_note_map[71] = {'J', 0};       // B4 → j
-
-        // 上行主区 (q/w/e/r/t/y/u)
-        m_note_map[72] = {'Q', 0};       // C5 → q
-        m_note_map[73] = {'Q', 1};       // C#5 → q+ (Shift)
-        m_note_map[74] = {'W', 0};       // D5 → w
-        m_note_map[75] = {'E', 2};       // D#5 → e- (Ctrl)
-        m_note_map[76] = {'E', 0};       // E5 → e
-        m_note_map[77] = {'R', 0};       // F5 → r
-        m_note_map[78] = {'R', 1};       // F#5 → r+ (Shift)
-        m_note_map[79] = {'T', 0};       // G5 → t
-        m_note_map[80] = {'T', 1};       // G#5 → t+ (Shift)
-        m_note_map[81] = {'Y', 0};       // A5 → y
-        m_note_map[82] = {'U', 2};       // A#5 → u- (Ctrl)
-        m_note_map[83] = {'U', 0};       // B5 → u
-
-        rebuild_lookup_cache();
-
-        LOG_DEBUG("燕云十六声键位映射已加载: " << m_note_map.size() << " 个映射");
+        // 先发布指针再递增版本：读者看到新版本时一定能读到新表
+        m_active.store(table, std::memory_order_release);
+        m_version.fetch_add(1, std::memory_order_acq_rel);
     }
 
     void KeyManager::rebuild_lookup_cache()
     {
-        std::memset(m_lookup_valid, 0, sizeof(m_lookup_valid));
+        m_note_map_dirty = false;
+        auto table = std::make_unique<KeyTable>();
         for (const auto &pair : m_note_map)
         {
-            if (pair.first >= 0 && pair.first < 128)
+            if (pair.first >= 0 && pair.first < KeyTable::NOTE_COUNT)
             {
-                m_lookup_cache[pair.first] = pair.second;
-                m_lookup_valid[pair.first] = true;
+                table->keys[pair.first] = pair.second;
+                table->valid[pair.first] = true;
             }
         }
+        publish(table.get());
+        m_owned_tables.push_back(std::move(table));
     }
 
     std::string KeyManager::format_key_string(int vk, int modifier) const
@@ -780,37 +506,7 @@ namespace Util
 
     bool KeyManager::get_pitch_from_name(const std::string &name, int &pitch) const
     {
-        std::regex re(R"(^\s*([A-Ga-g])([#bB]?)(-?\d+)\s*$)");
-        std::smatch match;
-        if (!std::regex_match(name, match, re))
-            return false;
-
-        std::string note = match[1].str();
-        std::string acc = match[2].str();
-        std::string octave_str = match[3].str();
-
-        std::string key = to_lower_copy(note);
-        if (!acc.empty())
-        {
-            char c = acc[0];
-            if (c == '#' || c == 'b' || c == 'B')
-            {
-                key += (c == '#') ? "#" : "b";
-            }
-        }
-
-        static const std::map<std::string, int> notes_map = {
-            {"c", 0}, {"c#", 1}, {"db", 1}, {"d", 2}, {"d#", 3}, {"eb", 3}, {"e", 4}, {"f", 5}, {"f#", 6}, {"gb", 6}, {"g", 7}, {"g#", 8}, {"ab", 8}, {"a", 9}, {"a#", 10}, {"bb", 10}, {"b", 11}};
-
-        auto it = notes_map.find(key);
-        if (it == notes_map.end())
-            return false;
-        int octave = std::stoi(octave_str);
-        int value = (octave + 1) * 12 + it->second;
-        if (value < 0 || value > 127)
-            return false;
-        pitch = value;
-        return true;
+        return Util::KeymapSyntax::parse_note_name(name, pitch);
     }
 
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 // 标准库
+#include <atomic>
 #include <map>
+#include <memory>
 #include <cstring>
 #include <vector>
 #include <string>
@@ -13,11 +15,31 @@ namespace Util {
         int modifier;  ///< 0: 无, 1: Shift, 2: Ctrl
     };
 
+    /// 音符 → 按键查找表（MIDI 音符范围 0-127），内置预设在编译期生成
+    /// 发布后不再修改，播放线程可无锁读取
+    struct KeyTable {
+        static constexpr int NOTE_COUNT = 128;
+        KeyMapping keys[NOTE_COUNT]{};
+        bool valid[NOTE_COUNT]{};
+
+        /// 无映射时返回 {0, 0}
+        KeyMapping lookup(int note) const {
+            if (note >= 0 && note < NOTE_COUNT && valid[note])
+                return keys[note];
+            return {0, 0};
+        }
+    };
+
     class KeyManager {
     public:
         KeyManager();
         
-        KeyMapping get_mapping(int note);
+        KeyMapping get_mapping(int note) const;
+
+        /// 当前生效的查找表（任意线程可读，指针在 KeyManager 生命周期内有效）
+        const KeyTable* snapshot() const { return m_active.load(std::memory_order_acquire); }
+        /// 查找表版本号，每次发布新表递增（先读版本再读 snapshot，可保证不漏掉更新）
+        int version() const { return m_version.load(std::memory_order_acquire); }
         
         /// 加载键位配置（宽字符路径）
         bool load_config(const std::wstring& path);
@@ -30,15 +52,22 @@ namespace Util {
         void reset_to_default();
         void load_yysls_preset();
 
+        /// 切换到内置预设（下标见 KeyPresets.h），直接发布编译期生成的查找表
+        bool load_preset(size_t index);
+
     private:
-        std::map<int, KeyMapping> m_note_map;
-        /// 优化：O(1) 查找缓存数组（MIDI 音符范围 0-127）
-        KeyMapping m_lookup_cache[128]{};
-        bool m_lookup_valid[128]{};
+        /// 按音符排序的映射（仅 UI 线程访问），由 get_map 按需从查找表生成
+        mutable std::map<int, KeyMapping> m_note_map;
+        mutable bool m_note_map_dirty = false;
+        /// 当前生效的不可变查找表，get_mapping 直接读取
+        std::atomic<const KeyTable*> m_active{nullptr};
+        std::atomic<int> m_version{0};
+        /// 由自定义映射生成的查找表；旧表保留到析构，播放线程持有的指针始终有效
+        /// （每张约 1KB，仅在用户修改键位时产生）
+        std::vector<std::unique_ptr<const KeyTable>> m_owned_tables;
         
+        void publish(const KeyTable* table);
         void rebuild_lookup_cache();
-        void init_default_map();
-        void init_yysls_map();
         std::string format_key_string(int vk, int modifier) const;
         bool parse_key_string(const std::string& key_str, int& vk, int& modifier) const;
         std::string get_note_name(int midi_pitch) const;
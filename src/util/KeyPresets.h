@@ -0,0 +1,173 @@
+#pragma once
+
+// 标准库
+#include <cstddef>
+
+// 系统头文件（VK_* 常量）
+#include <windows.h>
+
+// 项目头文件
+#include "KeyManager.h"
+
+namespace Util {
+
+    /// 预设描述中的一条映射：音符 → 按键 + 修饰符
+    struct PresetEntry {
+        int note;
+        int vk_code;
+        int modifier;  ///< 0: 无, 1: Shift, 2: Ctrl
+    };
+
+    namespace Presets {
+
+        /// 校验预设描述：音符在 0-127 且不重复、按键非空、修饰符合法；
+        /// allowSharedKeys 为 false 时，同一按键 + 修饰符不得对应不同音符
+        template <size_t N>
+        constexpr bool Validate(const PresetEntry (&entries)[N], bool allowSharedKeys = false) {
+            for (size_t i = 0; i < N; ++i) {
+                const PresetEntry& e = entries[i];
+                if (e.note < 0 || e.note >= KeyTable::NOTE_COUNT)
+                    return false;
+                if (e.vk_code <= 0 || e.vk_code > 0xFF)
+                    return false;
+                if (e.modifier < 0 || e.modifier > 2)
+                    return false;
+                for (size_t j = i + 1; j < N; ++j) {
+                    if (entries[j].note == e.note)
+                        return false;
+                    if (!allowSharedKeys && entries[j].vk_code == e.vk_code && entries[j].modifier == e.modifier)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        /// 由预设描述生成 128 项查找表
+        template <size_t N>
+        constexpr KeyTable Build(const PresetEntry (&entries)[N]) {
+            KeyTable table{};
+            for (size_t i = 0; i < N; ++i) {
+                table.keys[entries[i].note] = {entries[i].vk_code, entries[i].modifier};
+                table.valid[entries[i].note] = true;
+            }
+            return table;
+        }
+
+        // ==================== FF14 默认键位 ====================
+        // 映射自原 Python 版 key_manager.py，不使用修饰符
+
+        constexpr PresetEntry kFf14Entries[] = {
+            // 高音区 / 符号键
+            {48, 'I', 0},           // i
+            {50, 'O', 0},           // o
+            {52, 'P', 0},           // p
+            {53, VK_OEM_4, 0},      // [
+            {55, VK_OEM_6, 0},      // ]
+            {57, VK_OEM_5, 0},      // \ (backslash)
+            {59, VK_OEM_7, 0},      // ' (quote)
+
+            // 中音区（QWERTY 行）
+            {60, 'Q', 0},
+            {62, 'W', 0},
+            {64, 'E', 0},
+            {65, 'R', 0},
+            {67, 'T', 0},
+            {69, 'Y', 0},
+            {71, 'U', 0},
+
+            // 低音区 / 数字键
+            {81, 'N', 0},
+            {83, 'M', 0},
+            {49, '8', 0},
+            {51, '9', 0},
+            {54, '0', 0},
+            {56, VK_OEM_MINUS, 0},  // -
+            {58, VK_OEM_PLUS, 0},   // =
+
+            // 数字行
+            {61, '2', 0},
+            {63, '3', 0},
+            {66, '5', 0},
+            {68, '6', 0},
+            {70, '7', 0},
+
+            // H, J
+            {80, 'H', 0},
+            {82, 'J', 0},
+
+            // 底行（ZXCV...）
+            {72, 'Z', 0},
+            {73, 'S', 0},
+            {74, 'X', 0},
+            {75, 'D', 0},
+            {76, 'C', 0},
+            {77, 'V', 0},
+            {78, 'G', 0},
+            {79, 'B', 0},
+            {84, VK_OEM_2, 0},      // /
+        };
+        static_assert(Validate(kFf14Entries), "FF14 预设存在重复音符或重复按键");
+
+        // ==================== 燕云十六声 ====================
+        // 音符 48-83 (C3-B5)，映射自 keymaps/燕云十六声默认键位.txt
+        // 修饰符: +=Shift(1), -=Ctrl(2)
+
+        constexpr PresetEntry kYyslsEntries[] = {
+            // 下行左手区 (z/x/c/v/b/n/m)
+            {48, 'Z', 0}, {49, 'Z', 1}, {50, 'X', 0}, {51, 'C', 2},     // C3 C#3 D3 D#3
+            {52, 'C', 0}, {53, 'V', 0}, {54, 'V', 1}, {55, 'B', 0},     // E3 F3 F#3 G3
+            {56, 'B', 1}, {57, 'N', 0}, {58, 'M', 2}, {59, 'M', 0},     // G#3 A3 A#3 B3
+
+            // 中行主区 (a/s/d/f/g/h/j)
+            {60, 'A', 0}, {61, 'A', 1}, {62, 'S', 0}, {63, 'D', 2},     // C4 C#4 D4 D#4
+            {64, 'D', 0}, {65, 'F', 0}, {66, 'F', 1}, {67, 'G', 0},     // E4 F4 F#4 G4
+            {68, 'G', 1}, {69, 'H', 0}, {70, 'J', 2}, {71, 'J', 0},     // G#4 A4 A#4 B4
+
+            // 上行主区 (q/w/e/r/t/y/u)
+            {72, 'Q', 0}, {73, 'Q', 1}, {74, 'W', 0}, {75, 'E', 2},     // C5 C#5 D5 D#5
+            {76, 'E', 0}, {77, 'R', 0}, {78, 'R', 1}, {79, 'T', 0},     // E5 F5 F#5 G5
+            {80, 'T', 1}, {81, 'Y', 0}, {82, 'U', 2}, {83, 'U', 0},     // G#5 A5 A#5 B5
+        };
+        static_assert(Validate(kYyslsEntries), "燕云十六声预设存在重复音符或重复按键");
+
+        // ==================== 编译期生成的查找表 ====================
+
+        inline constexpr KeyTable kFf14Table = Build(kFf14Entries);
+        inline constexpr KeyTable kYyslsTable = Build(kYyslsEntries);
+
+        /// 预设覆盖的最低/最高音符（用作通道独立键位的音域）
+        template <size_t N>
+        constexpr int MinNote(const PresetEntry (&entries)[N]) {
+            int lo = KeyTable::NOTE_COUNT - 1;
+            for (size_t i = 0; i < N; ++i)
+                lo = entries[i].note < lo ? entries[i].note : lo;
+            return lo;
+        }
+
+        template <size_t N>
+        constexpr int MaxNote(const PresetEntry (&entries)[N]) {
+            int hi = 0;
+            for (size_t i = 0; i < N; ++i)
+                hi = entries[i].note > hi ? entries[i].note : hi;
+            return hi;
+        }
+
+        /// 内置预设（下标与界面中的内置键位选项一致）
+        struct BuiltinPreset {
+            const char* name;
+            const KeyTable* table;
+            int min_pitch;
+            int max_pitch;
+        };
+
+        inline constexpr BuiltinPreset kBuiltin[] = {
+            {"FF14", &kFf14Table, MinNote(kFf14Entries), MaxNote(kFf14Entries)},
+            {"燕云十六声", &kYyslsTable, MinNote(kYyslsEntries), MaxNote(kYyslsEntries)},
+            // 新增内置预设：添加描述数组 + static_assert(Validate(...)) + Build，再在此登记
+        };
+
+        constexpr size_t BUILTIN_COUNT = sizeof(kBuiltin) / sizeof(kBuiltin[0]);
+
+    }
+
+}
@@ -0,0 +1,233 @@
+#include "KeymapSyntax.h"
+#include <cctype>
+#include <climits>
+#include <map>
+
+namespace
+{
+    void replace_all(std::string &s, const std::string &from, const std::string &to)
+    {
+        if (from.empty())
+            return;
+        size_t pos = 0;
+        while ((pos = s.find(from, pos)) != std::string::npos)
+        {
+            s.replace(pos, from.size(), to);
+            pos += to.size();
+        }
+    }
+
+    /// 与正则 \s 相同的空白字符集（C locale）
+    inline bool is_space_char(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    inline bool is_digit_char(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    /// [A-G]（不区分大小写）
+    inline bool is_note_letter(char c)
+    {
+        return (c >= 'a' && c <= 'g') || (c >= 'A' && c <= 'G');
+    }
+
+    /// [:=\-\s]
+    inline bool is_separator_char(char c)
+    {
+        return c == ':' || c == '=' || c == '-' || is_space_char(c);
+    }
+}
+
+namespace Util::KeymapSyntax
+{
+
+    std::string normalize_line(std::string s)
+    {
+        replace_all(s, u8"：", ":");
+        replace_all(s, u8"＝", "=");
+        replace_all(s, u8"－", "-");
+        replace_all(s, u8"＋", "+");
+        replace_all(s, u8"　", " ");
+        replace_all(s, u8"（", "(");
+        replace_all(s, u8"）", ")");
+        return s;
+    }
+
+    /// 从 pos 开始匹配「分隔符 + 按键」：[\s]*[:=\-\s]+[\s]*([^\s]+)
+    /// 分隔符至少一个；分隔符一直延伸到行尾时，按正则回溯规则把最后一个非空白分隔符让给按键
+    bool match_key_value(const std::string &s, size_t pos, size_t &value_begin, size_t &value_end)
+    {
+        const size_t n = s.size();
+        size_t q = pos;
+        while (q < n && is_separator_char(s[q]))
+            ++q;
+        if (q == pos)
+            return false;
+
+        if (q < n)
+        {
+            value_begin = q;
+        }
+        else
+        {
+            size_t k = n;
+            while (k > pos + 1 && is_space_char(s[k - 1]))
+                --k;
+            if (k <= pos + 1)
+                return false;
+            value_begin = k - 1;
+        }
+
+        value_end = value_begin;
+        while (value_end < n && !is_space_char(s[value_end]))
+            ++value_end;
+        return true;
+    }
+
+    /// 从 pos 开始匹配「音符 [备注] 分隔符 按键」，音符部分不含「音符」前缀
+    bool match_note_entry(const std::string &s, size_t pos, std::string &key_part, std::string &value_part)
+    {
+        const size_t n = s.size();
+        size_t k = pos;
+        if (k < n && is_note_letter(s[k]))
+        {
+            // [A-G][#bB]?\d+（升降号之后必须是数字，回溯不会产生其他结果）
+            ++k;
+            if (k < n && (s[k] == '#' || s[k] == 'b' || s[k] == 'B'))
+                ++k;
+            const size_t digits = k;
+            while (k < n && is_digit_char(s[k]))
+                ++k;
+            if (k == digits)
+                return false;
+        }
+        else if (k < n && is_digit_char(s[k]))
+        {
+            while (k < n && is_digit_char(s[k]))
+                ++k;
+        }
+        else
+        {
+            return false;
+        }
+
+        size_t value_begin = 0;
+        size_t value_end = 0;
+        bool matched = false;
+
+        // 可选备注 \s*\(.*?\)：懒惰匹配，依次尝试每个 ')'（'.' 不跨越换行）
+        size_t c = k;
+        while (c < n && is_space_char(s[c]))
+            ++c;
+        if (c < n && s[c] == '(')
+        {
+            for (size_t r = c + 1; r < n && s[r] != '\n' && s[r] != '\r'; ++r)
+            {
+                if (s[r] == ')' && match_key_value(s, r + 1, value_begin, value_end))
+                {
+                    matched = true;
+                    break;
+                }
+            }
+        }
+        if (!matched && !match_key_value(s, k, value_begin, value_end))
+            return false;
+
+        key_part.assign(s, pos, k - pos);
+        value_part.assign(s, value_begin, value_end - value_begin);
+        return true;
+    }
+
+    /// 在整行中查找第一处映射（对应 regex_search 从左到右逐个起点尝试）
+    bool parse_keymap_line(const std::string &line, std::string &key_part, std::string &value_part)
+    {
+        static const std::string kNotePrefix = u8"音符";
+        for (size_t p = 0; p < line.size(); ++p)
+        {
+            if (line.compare(p, kNotePrefix.size(), kNotePrefix) == 0)
+            {
+                // 可选前缀「音符」+ 至少一个空白；前缀不成立时该起点以 '音' 开头，不可能匹配
+                size_t k = p + kNotePrefix.size();
+                const size_t spaces = k;
+                while (k < line.size() && is_space_char(line[k]))
+                    ++k;
+                if (k > spaces && match_note_entry(line, k, key_part, value_part))
+                    return true;
+                continue;
+            }
+            if (match_note_entry(line, p, key_part, value_part))
+                return true;
+        }
+        return false;
+    }
+
+    bool parse_decimal(const std::string &s, size_t begin, size_t end, int &value)
+    {
+        long long v = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            v = v * 10 + (s[i] - '0');
+            if (v > INT_MAX)
+                return false;
+        }
+        value = static_cast<int>(v);
+        return true;
+    }
+
+    bool parse_note_name(const std::string &name, int &pitch)
+    {
+        // 格式：\s*[A-Ga-g][#bB]?-?\d+\s*
+        const size_t n = name.size();
+        size_t i = 0;
+        while (i < n && is_space_char(name[i]))
+            ++i;
+        if (i >= n || !is_note_letter(name[i]))
+            return false;
+
+        std::string key(1, static_cast<char>(std::tolower(static_cast<unsigned char>(name[i]))));
+        ++i;
+        if (i < n && (name[i] == '#' || name[i] == 'b' || name[i] == 'B'))
+        {
+            key += (name[i] == '#') ? "#" : "b";
+            ++i;
+        }
+
+        bool negative = false;
+        if (i < n && name[i] == '-')
+        {
+            negative = true;
+            ++i;
+        }
+        const size_t digits = i;
+        while (i < n && is_digit_char(name[i]))
+            ++i;
+        const size_t digits_end = i;
+        if (digits_end == digits)
+            return false;
+        while (i < n && is_space_char(name[i]))
+            ++i;
+        if (i != n)
+            return false;
+
+        static const std::map<std::string, int> notes_map = {
+            {"c", 0}, {"c#", 1}, {"db", 1}, {"d", 2}, {"d#", 3}, {"eb", 3}, {"e", 4}, {"f", 5}, {"f#", 6}, {"gb", 6}, {"g", 7}, {"g#", 8}, {"ab", 8}, {"a", 9}, {"a#", 10}, {"bb", 10}, {"b", 11}};
+
+        auto it = notes_map.find(key);
+        if (it == notes_map.end())
+            return false;
+        int octave = 0;
+        if (!parse_decimal(name, digits, digits_end, octave) || octave > 100)
+            return false;
+        if (negative)
+            octave = -octave;
+        int value = (octave + 1) * 12 + it->second;
+        if (value < 0 || value > 127)
+            return false;
+        pitch = value;
+        return true;
+    }
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace Util {
+
+    /// 键位配置文本的词法解析（平台无关，由 KeyManager 使用，可单独测试）
+    ///
+    /// 键位行语义与原 std::regex 实现完全一致（regex_search，ECMAScript，icase）：
+    ///   (?:音符\s+)?([A-G][#bB]?\d+|\d+)(?:\s*\(.*?\))?[\s]*[:=\-\s]+[\s]*([^\s]+)
+    /// 音名语义与原正则 ^\s*([A-Ga-g])([#bB]?)(-?\d+)\s*$ 加八度范围检查一致
+    namespace KeymapSyntax {
+
+        /// 全角标点（：＝－＋　（））替换为对应的半角字符
+        std::string normalize_line(std::string s);
+
+        /// 解析 [begin, end) 内的非负十进制整数（调用方保证全为数字），超出 int 范围时返回 false
+        bool parse_decimal(const std::string& s, size_t begin, size_t end, int& value);
+
+        /// 从 pos 开始匹配「分隔符 + 按键」：[\s]*[:=\-\s]+[\s]*([^\s]+)
+        /// @param value_begin, value_end 成功时为按键部分的范围
+        bool match_key_value(const std::string& s, size_t pos, size_t& value_begin, size_t& value_end);
+
+        /// 从 pos 开始匹配「音符 [备注] 分隔符 按键」，音符部分不含「音符」前缀
+        bool match_note_entry(const std::string& s, size_t pos, std::string& key_part, std::string& value_part);
+
+        /// 在整行中查找第一处映射（对应 regex_search 从左到右逐个起点尝试）
+        /// @param key_part 音名或音符编号
+        /// @param value_part 按键字符串（含 +/- 修饰符）
+        bool parse_keymap_line(const std::string& line, std::string& key_part, std::string& value_part);
+
+        /// 音名转 MIDI 音高：\s*[A-Ga-g][#bB]?-?\d+\s*，结果须在 0-127 内
+        bool parse_note_name(const std::string& name, int& pitch);
+
+    }
+
+}
@@ -0,0 +1,668 @@
+#include "LogFormat.h"
+
+// 标准库
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace Util
+{
+
+    /// 按参数类型取整数/浮点值（格式说明与参数类型不符时做数值转换）
+    static long long ArgAsInt(const LogArg &arg)
+    {
+        switch (arg.type)
+        {
+        case LogArg::Type::Double:
+            return static_cast<long long>(arg.d);
+        case LogArg::Type::String:
+        case LogArg::Type::Pointer:
+            return static_cast<long long>(reinterpret_cast<uintptr_t>(arg.p));
+        default:
+            return arg.i;
+        }
+    }
+
+    static double ArgAsDouble(const LogArg &arg)
+    {
+        switch (arg.type)
+        {
+        case LogArg::Type::Double:
+            return arg.d;
+        case LogArg::Type::UInt:
+            return static_cast<double>(arg.u);
+        case LogArg::Type::Int:
+            return static_cast<double>(arg.i);
+        default:
+            return 0.0;
+        }
+    }
+
+    /// 不带标志、宽度与精度的常见说明符（%d %u %x %X %s）直接转换，结果与 snprintf 相同
+    static bool AppendPlainArg(std::string &out, char conv, const LogArg &arg)
+    {
+        char num[24];
+        std::to_chars_result result{};
+        switch (conv)
+        {
+        case 'd':
+        case 'i':
+            result = std::to_chars(num, num + sizeof(num), ArgAsInt(arg));
+            break;
+        case 'u':
+            result = std::to_chars(num, num + sizeof(num), static_cast<unsigned long long>(ArgAsInt(arg)));
+            break;
+        case 'x':
+        case 'X':
+            result = std::to_chars(num, num + sizeof(num), static_cast<unsigned long long>(ArgAsInt(arg)), 16);
+            if (conv == 'X')
+            {
+                std::transform(num, result.ptr, num, [](char c) { return static_cast<char>(std::toupper(c)); });
+            }
+            break;
+        case 's':
+        {
+            // 与 snprintf 到 256 字节缓冲一致：最多 255 字节
+            const char *text = (arg.type == LogArg::Type::String && arg.s) ? arg.s : "(null)";
+            out.append(text, strnlen(text, 255));
+            return true;
+        }
+        default:
+            return false;
+        }
+        out.append(num, result.ptr);
+        return true;
+    }
+
+    void AppendLogEvent(std::string &out, const char *format, const LogArg *args, size_t count)
+    {
+        size_t next = 0;
+        char spec[32];
+        char buf[256];
+
+        for (const char *p = format; *p; ++p)
+        {
+            if (*p != '%')
+            {
+                // 连续的普通字符一次追加
+                const char *end = std::strchr(p, '%');
+                if (!end)
+                {
+                    out += p;
+                    break;
+                }
+                out.append(p, end);
+                p = end - 1;
+                continue;
+            }
+            if (p[1] == '%')
+            {
+                out += '%';
+                ++p;
+                continue;
+            }
+
+            // 收集标志、宽度与精度；长度修饰符忽略，按捕获的参数类型重新指定
+            size_t n = 0;
+            spec[n++] = '%';
+            const char *q = p + 1;
+            while (*q && std::strchr("-+ #0123456789.", *q) && n < sizeof(spec) - 4)
+            {
+                spec[n++] = *q++;
+            }
+            while (*q && std::strchr("hljztL", *q))
+            {
+                ++q;
+            }
+            const char conv = *q;
+            if (!conv)
+            {
+                break;
+            }
+            p = q;
+
+            if (next >= count)
+            {
+                out += "<?>";
+                continue;
+            }
+            const LogArg &arg = args[next++];
+            if (n == 1 && AppendPlainArg(out, conv, arg))
+            {
+                continue;
+            }
+
+            int len = -1;
+            switch (conv)
+            {
+            case 'd':
+            case 'i':
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec, ArgAsInt(arg));
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec, static_cast<unsigned long long>(ArgAsInt(arg)));
+                break;
+            case 'c':
+                spec[n++] = 'c';
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec, static_cast<int>(ArgAsInt(arg)));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec[n++] = conv;
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec, ArgAsDouble(arg));
+                break;
+            case 's':
+                spec[n++] = 's';
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec,
+                                    (arg.type == LogArg::Type::String && arg.s) ? arg.s : "(null)");
+                break;
+            case 'p':
+                spec[n++] = 'p';
+                spec[n] = '\0';
+                len = std::snprintf(buf, sizeof(buf), spec, arg.p);
+                break;
+            default:
+                out += "<?>";
+                break;
+            }
+            if (len > 0)
+            {
+                out.append(buf, std::min(static_cast<size_t>(len), sizeof(buf) - 1));
+            }
+        }
+    }
+
+    void AppendLogLinePrefix(std::string &out, LogLevel level, std::chrono::system_clock::time_point time,
+                             const std::string &threadId, const char *file, int line, const char *func)
+    {
+        AppendLogTimestamp(out, time);
+        out += " [";
+        out += threadId;
+        out += "] [";
+        out += LogLevelName(level);
+        out += "] ";
+        if (!file || !*file)
+        {
+            return;
+        }
+        out += '[';
+        out += LogFileName(file);
+        out += ':';
+        char num[16];
+        out.append(num, std::to_chars(num, num + sizeof(num), line).ptr);
+        out += ' ';
+        out += func;
+        out += "] ";
+    }
+
+    const char *LogLevelName(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::Debug:
+            return "DEBUG";
+        case LogLevel::Info:
+            return "INFO";
+        case LogLevel::Warning:
+            return "WARN";
+        case LogLevel::Error:
+            return "ERROR";
+        case LogLevel::Fatal:
+            return "FATAL";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    void AppendLogTimestamp(std::string &out, std::chrono::system_clock::time_point now)
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      now.time_since_epoch()) %
+                  1000;
+
+        // 同一秒内复用已格式化的日期时间部分，避免每行调用 localtime/put_time
+        thread_local std::time_t cachedSecond = -1;
+        thread_local char cachedText[32] = {};
+        thread_local size_t cachedLen = 0;
+
+        std::time_t t = std::chrono::system_clock::to_time_t(now);
+        if (t != cachedSecond)
+        {
+            std::tm tm;
+#ifdef _WIN32
+            localtime_s(&tm, &t);
+#else
+            localtime_r(&t, &tm);
+#endif
+            cachedLen = std::strftime(cachedText, sizeof(cachedText), "%Y-%m-%d %H:%M:%S", &tm);
+            cachedSecond = t;
+        }
+
+        const int msec = static_cast<int>(ms.count());
+        const char frac[4] = {'.', static_cast<char>('0' + msec / 100), static_cast<char>('0' + msec / 10 % 10),
+                              static_cast<char>('0' + msec % 10)};
+        out.append(cachedText, cachedLen);
+        out.append(frac, sizeof(frac));
+    }
+
+    const char *LogFileName(const char *path)
+    {
+        const char *name = path;
+        const char *p = path;
+
+        while (*p)
+        {
+            if (*p == '/' || *p == '\\')
+            {
+                name = p + 1;
+            }
+            ++p;
+        }
+
+        return name;
+    }
+
+    // ============================================================================
+    // 二进制日志
+    // ============================================================================
+
+    namespace
+    {
+        enum RecordType : unsigned char
+        {
+            RECORD_END = 0, ///< 内存映射写入的零填充区域
+            RECORD_SITE = 1,
+            RECORD_THREAD = 2,
+            RECORD_EVENT = 3,
+            RECORD_TEXT = 4,
+            RECORD_NOTE = 5
+        };
+
+        template <typename T>
+        void Put(std::string &out, T value)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        void PutString(std::string &out, const char *text, size_t size)
+        {
+            Put<uint32_t>(out, static_cast<uint32_t>(size));
+            out.append(text, size);
+        }
+
+        void PutString(std::string &out, const char *text)
+        {
+            PutString(out, text ? text : "", text ? std::strlen(text) : 0);
+        }
+
+        /// 单个字符串字段的长度上限：损坏的长度字段不能触发超大分配
+        constexpr uint32_t MAX_DECODED_STRING = 16u * 1024 * 1024;
+        /// 格式化点表与线程表的长度上限
+        constexpr uint32_t MAX_DECODED_TABLE = 1u << 20;
+
+        /// 顺序读取二进制记录，任何一次读取不完整即置 ok = false；
+        /// 字段值不合理（长度超出剩余数据等）时另外记下原因
+        struct Reader
+        {
+            std::istream &in;
+            bool ok = true;
+            std::string failure;
+            std::istream::pos_type end = -1; ///< 流的结束位置；不可定位的流为 -1，只按长度上限检查
+
+            explicit Reader(std::istream &stream) : in(stream)
+            {
+                const auto start = in.tellg();
+                if (start != std::istream::pos_type(-1) && in.seekg(0, std::ios::end))
+                {
+                    end = in.tellg();
+                    in.seekg(start);
+                }
+                in.clear();
+            }
+
+            void Fail(const std::string &reason)
+            {
+                if (ok)
+                {
+                    failure = reason;
+                }
+                ok = false;
+            }
+
+            template <typename T>
+            T Get()
+            {
+                T value{};
+                char bytes[sizeof(T)];
+                if (ok && in.read(bytes, sizeof(T)))
+                {
+                    std::memcpy(&value, bytes, sizeof(T));
+                }
+                else
+                {
+                    ok = false;
+                }
+                return value;
+            }
+
+            std::string GetString()
+            {
+                const uint32_t size = Get<uint32_t>();
+                std::string text;
+                if (!ok || size == 0)
+                {
+                    return text;
+                }
+                const auto position = in.tellg();
+                if (size > MAX_DECODED_STRING ||
+                    (end != std::istream::pos_type(-1) && position != std::istream::pos_type(-1) &&
+                     static_cast<std::streamoff>(size) > end - position))
+                {
+                    Fail("字符串长度 " + std::to_string(size) + " 超出剩余数据");
+                    return text;
+                }
+                text.resize(size);
+                ok = static_cast<bool>(in.read(&text[0], size));
+                return text;
+            }
+
+            /// 表编号：编码器按首次出现的顺序连续编号，只能重定义已有编号或追加下一个
+            bool TableIndex(uint32_t index, size_t size, const char *what)
+            {
+                if (ok && (index > size || index >= MAX_DECODED_TABLE))
+                {
+                    Fail(std::string(what) + "编号 " + std::to_string(index) + " 不连续（已有 " +
+                         std::to_string(size) + " 个）");
+                }
+                return ok;
+            }
+        };
+
+        /// 解码端的格式化点：字符串由解码器持有
+        struct DecodedSite
+        {
+            LogLevel level = LogLevel::Info;
+            int line = 0;
+            std::string file;
+            std::string func;
+            std::string format;
+        };
+    }
+
+    void LogBinaryEncoder::Begin(std::string &out, std::chrono::system_clock::time_point epoch)
+    {
+        m_epoch = epoch;
+        m_sites.clear();
+        m_threads.clear();
+        out.append(MAGIC, sizeof(MAGIC));
+        Put<uint32_t>(out, VERSION);
+        Put<int64_t>(out, std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()).count());
+    }
+
+    int64_t LogBinaryEncoder::RelativeNs(std::chrono::system_clock::time_point time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_epoch).count();
+    }
+
+    uint32_t LogBinaryEncoder::ThreadIndex(std::string &out, const std::string &threadId)
+    {
+        const auto it = m_threads.find(threadId);
+        if (it != m_threads.end())
+        {
+            return it->second;
+        }
+        const uint32_t index = static_cast<uint32_t>(m_threads.size());
+        m_threads.emplace(threadId, index);
+        Put<unsigned char>(out, RECORD_THREAD);
+        Put<uint32_t>(out, index);
+        PutString(out, threadId.data(), threadId.size());
+        return index;
+    }
+
+    void LogBinaryEncoder::AppendEvent(std::string &out, const LogSite &site, std::chrono::system_clock::time_point time,
+                                       const std::string &threadId, const LogArg *args, size_t count)
+    {
+        uint32_t siteIndex = 0;
+        const auto it = m_sites.find(&site);
+        if (it != m_sites.end())
+        {
+            siteIndex = it->second;
+        }
+        else
+        {
+            // 格式化点在每个文件中首次出现时写入定义，之后只引用编号
+            siteIndex = static_cast<uint32_t>(m_sites.size());
+            m_sites.emplace(&site, siteIndex);
+            Put<unsigned char>(out, RECORD_SITE);
+            Put<uint32_t>(out, siteIndex);
+            Put<unsigned char>(out, static_cast<unsigned char>(site.level));
+            Put<int32_t>(out, site.line);
+            PutString(out, site.file);
+            PutString(out, site.func);
+            PutString(out, site.format);
+        }
+        const uint32_t threadIndex = ThreadIndex(out, threadId);
+
+        Put<unsigned char>(out, RECORD_EVENT);
+        Put<uint32_t>(out, siteIndex);
+        Put<uint32_t>(out, threadIndex);
+        Put<int64_t>(out, RelativeNs(time));
+        Put<unsigned char>(out, static_cast<unsigned char>(count));
+        for (size_t i = 0; i < count; ++i)
+        {
+            const LogArg &arg = args[i];
+            if (arg.type == LogArg::Type::String && arg.s)
+            {
+                // 指针在进程外无意义，字符串参数写入内容
+                Put<unsigned char>(out, static_cast<unsigned char>(arg.type));
+                PutString(out, arg.s);
+            }
+            else
+            {
+                // 空字符串指针按空指针记录，%s / %p 的输出与写线程一致
+                const LogArg::Type type = (arg.type == LogArg::Type::String) ? LogArg::Type::Pointer : arg.type;
+                Put<unsigned char>(out, static_cast<unsigned char>(type));
+                Put<uint64_t>(out, arg.u);
+            }
+        }
+    }
+
+    void LogBinaryEncoder::AppendText(std::string &out, LogLevel level, std::chrono::system_clock::time_point time,
+                                      const std::string &threadId, const char *file, int line, const char *func,
+                                      const std::string &message)
+    {
+        const uint32_t threadIndex = ThreadIndex(out, threadId);
+        Put<unsigned char>(out, RECORD_TEXT);
+        Put<unsigned char>(out, static_cast<unsigned char>(level));
+        Put<uint32_t>(out, threadIndex);
+        Put<int64_t>(out, RelativeNs(time));
+        Put<int32_t>(out, line);
+        PutString(out, file);
+        PutString(out, func);
+        PutString(out, message.data(), message.size());
+    }
+
+    void LogBinaryEncoder::AppendNote(std::string &out, const std::string &message)
+    {
+        Put<unsigned char>(out, RECORD_NOTE);
+        PutString(out, message.data(), message.size());
+    }
+
+    bool DecodeLogBinary(std::istream &in, std::ostream &out, std::string &error)
+    {
+        char magic[sizeof(LogBinaryEncoder::MAGIC)] = {};
+        Reader reader(in);
+        if (!in.read(magic, sizeof(magic)) ||
+            std::memcmp(magic, LogBinaryEncoder::MAGIC, sizeof(magic)) != 0)
+        {
+            error = "不是二进制日志文件";
+            return false;
+        }
+        const uint32_t version = reader.Get<uint32_t>();
+        if (!reader.ok || version != LogBinaryEncoder::VERSION)
+        {
+            error = "不支持的二进制日志版本: " + std::to_string(version);
+            return false;
+        }
+        const auto epoch = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(reader.Get<int64_t>())));
+
+        std::vector<DecodedSite> sites;
+        std::vector<std::string> threads;
+        std::string line;
+        std::vector<std::string> strings;
+        const std::string unknownThread = "?";
+
+        while (reader.ok)
+        {
+            const int type = in.get();
+            if (type == std::char_traits<char>::eof() || type == RECORD_END)
+            {
+                return true;
+            }
+
+            line.clear();
+            switch (type)
+            {
+            case RECORD_SITE:
+            {
+                const uint32_t index = reader.Get<uint32_t>();
+                DecodedSite site;
+                site.level = static_cast<LogLevel>(reader.Get<unsigned char>());
+                site.line = reader.Get<int32_t>();
+                site.file = reader.GetString();
+                site.func = reader.GetString();
+                site.format = reader.GetString();
+                if (reader.TableIndex(index, sites.size(), "格式化点"))
+                {
+                    if (index == sites.size())
+                    {
+                        sites.emplace_back();
+                    }
+                    sites[index] = std::move(site);
+                }
+                continue;
+            }
+            case RECORD_THREAD:
+            {
+                const uint32_t index = reader.Get<uint32_t>();
+                std::string name = reader.GetString();
+                if (reader.TableIndex(index, threads.size(), "线程"))
+                {
+                    if (index == threads.size())
+                    {
+                        threads.emplace_back();
+                    }
+                    threads[index] = std::move(name);
+                }
+                continue;
+            }
+            case RECORD_EVENT:
+            {
+                const uint32_t siteIndex = reader.Get<uint32_t>();
+                const uint32_t threadIndex = reader.Get<uint32_t>();
+                const int64_t timeNs = reader.Get<int64_t>();
+                const size_t count = reader.Get<unsigned char>();
+                if (!reader.ok || siteIndex >= sites.size() || count > Logger::MAX_LOG_ARGS)
+                {
+                    error = "事件记录引用了未定义的格式化点或参数过多";
+                    return false;
+                }
+                LogArg args[Logger::MAX_LOG_ARGS];
+                strings.assign(count, std::string());
+                for (size_t i = 0; i < count && reader.ok; ++i)
+                {
+                    args[i].type = static_cast<LogArg::Type>(reader.Get<unsigned char>());
+                    if (args[i].type == LogArg::Type::String)
+                    {
+                        strings[i] = reader.GetString();
+                        args[i].s = strings[i].c_str();
+                    }
+                    else
+                    {
+                        args[i].u = reader.Get<uint64_t>();
+                    }
+                }
+                if (!reader.ok)
+                {
+                    break;
+                }
+                const DecodedSite &site = sites[siteIndex];
+                AppendLogLinePrefix(line, site.level,
+                                    epoch + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                                std::chrono::nanoseconds(timeNs)),
+                                    threadIndex < threads.size() ? threads[threadIndex] : unknownThread,
+                                    site.file.c_str(), site.line, site.func.c_str());
+                AppendLogEvent(line, site.format.c_str(), args, count);
+                break;
+            }
+            case RECORD_TEXT:
+            {
+                const LogLevel level = static_cast<LogLevel>(reader.Get<unsigned char>());
+                const uint32_t threadIndex = reader.Get<uint32_t>();
+                const int64_t timeNs = reader.Get<int64_t>();
+                const int lineNo = reader.Get<int32_t>();
+                const std::string file = reader.GetString();
+                const std::string func = reader.GetString();
+                const std::string message = reader.GetString();
+                if (!reader.ok)
+                {
+                    break;
+                }
+                AppendLogLinePrefix(line, level,
+                                    epoch + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                                std::chrono::nanoseconds(timeNs)),
+                                    threadIndex < threads.size() ? threads[threadIndex] : unknownThread,
+                                    file.c_str(), lineNo, func.c_str());
+                line += message;
+                break;
+            }
+            case RECORD_NOTE:
+                line = reader.GetString();
+                break;
+            default:
+                error = "未知的记录类型: " + std::to_string(type);
+                return false;
+            }
+
+            if (reader.ok)
+            {
+                line += '\n';
+                out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            }
+        }
+
+        error = reader.failure.empty() ? "记录不完整（文件被截断）" : reader.failure;
+        return false;
+    }
+
+} // namespace Util
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Logger.h"
+
+// 标准库
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+
+namespace Util
+{
+
+    // ============================================================================
+    // 文本格式：写线程与离线解码工具共用，保证二者输出的行完全一致
+    // ============================================================================
+
+    /// 日志级别名称（DEBUG / INFO / WARN / ERROR / FATAL）
+    const char* LogLevelName(LogLevel level);
+
+    /// 提取文件名（不含路径）
+    const char* LogFileName(const char* path);
+
+    /// 追加本地时间戳：YYYY-MM-DD HH:MM:SS.mmm
+    void AppendLogTimestamp(std::string& out, std::chrono::system_clock::time_point time);
+
+    /// 追加行前缀：时间戳 [线程] [级别] [文件:行 函数]（file 为空时省略位置）
+    void AppendLogLinePrefix(std::string& out, LogLevel level, std::chrono::system_clock::time_point time,
+                             const std::string& threadId, const char* file, int line, const char* func);
+
+    /// 按 printf 风格格式串展开延迟格式化参数（长度修饰符忽略，按捕获的参数类型输出）
+    void AppendLogEvent(std::string& out, const char* format, const LogArg* args, size_t count);
+
+    // ============================================================================
+    // 二进制日志（LogFileOptions::binaryRecords）
+    // ============================================================================
+    //
+    // 写线程不做任何格式化，延迟格式化记录只写入格式化点编号、原始参数与时间戳，
+    // 由 log_decode 工具离线还原为与文本日志相同的行。字段均为小端序：
+    //
+    //   文件头   "GOMIDIBL" u32 版本 i64 时间基准（Unix 纳秒）
+    //   格式化点 u8=1 u32 编号 u8 级别 i32 行号 str 文件 str 函数 str 格式串   （每个文件首次出现时写入）
+    //   线程     u8=2 u32 编号 str 线程标识                                     （同上）
+    //   事件     u8=3 u32 格式化点 u32 线程 i64 时间 u8 参数个数 {u8 类型 值}...
+    //            值为 8 字节原始值，字符串参数为 str
+    //   文本     u8=4 u8 级别 u32 线程 i64 时间 i32 行号 str 文件 str 函数 str 消息
+    //   备注     u8=5 str 消息（原样输出，无行前缀）
+    //
+    // str 为 u32 长度 + 字节；时间为相对文件头基准的纳秒数。
+    // 内存映射写入在进程崩溃时文件尾部留有零填充，类型字节为 0 即视为结束。
+
+    /// 二进制记录编码器（由写线程独占使用）
+    class LogBinaryEncoder
+    {
+    public:
+        static constexpr char MAGIC[8] = {'G', 'O', 'M', 'I', 'D', 'I', 'B', 'L'};
+        static constexpr uint32_t VERSION = 1;
+
+        /// 开始一个新文件：写入文件头并清空格式化点与线程表
+        void Begin(std::string& out, std::chrono::system_clock::time_point epoch);
+
+        /// 延迟格式化记录
+        void AppendEvent(std::string& out, const LogSite& site, std::chrono::system_clock::time_point time,
+                         const std::string& threadId, const LogArg* args, size_t count);
+
+        /// 已格式化的文本记录（流式日志与日志系统自身的消息）
+        void AppendText(std::string& out, LogLevel level, std::chrono::system_clock::time_point time,
+                        const std::string& threadId, const char* file, int line, const char* func,
+                        const std::string& message);
+
+        /// 无行前缀的备注（如丢弃条数）
+        void AppendNote(std::string& out, const std::string& message);
+
+    private:
+        uint32_t ThreadIndex(std::string& out, const std::string& threadId);
+        int64_t RelativeNs(std::chrono::system_clock::time_point time) const;
+
+        std::chrono::system_clock::time_point m_epoch;
+        std::unordered_map<const LogSite*, uint32_t> m_sites;
+        std::unordered_map<std::string, uint32_t> m_threads;
+    };
+
+    /// 把二进制日志还原为文本日志
+    /// @param error 失败时的原因（文件头无效、记录截断、编号或长度字段损坏等）；已解码的行仍会写出
+    /// @return 全部解码成功返回 true
+    bool DecodeLogBinary(std::istream& in, std::ostream& out, std::string& error);
+
+} // namespace Util
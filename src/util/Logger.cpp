@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "LogFormat.h"
 
 // 标准库
 #include <iostream>
@@ -6,6 +7,9 @@
 #include <algorithm>
 #include <vector>
 #include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
 
 // Windows
 #include <windows.h>
@@ -13,13 +17,256 @@
 namespace Util
 {
 
+    /// 异步模式下的一条待写日志
+    /// 流式日志：消息在调用线程中移入，时间戳格式化与行拼接推迟到写线程
+    /// 延迟格式化日志：只含格式化点指针、原始参数与 steady 时间戳，格式化完全推迟到写线程；
+    /// 字符串参数复制到 message（以 NUL 分隔），参数中保存其偏移，记录在缓冲间移动后仍然有效
+    struct Logger::LogRecord
+    {
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time;
+        const char *file = "";
+        int line = 0;
+        const char *func = "";
+        std::string message;
+        const std::string *threadId = nullptr; ///< 指向所属缓冲的线程标识
+
+        const LogSite *site = nullptr; ///< 非空表示延迟格式化记录
+        std::chrono::steady_clock::time_point steady;
+        unsigned char argc = 0;
+        std::array<LogArg, MAX_LOG_ARGS> args;
+
+        /// 复制调用方的字符串参数（调用方的字符串在入队后可能立即失效）
+        void CaptureStrings()
+        {
+            for (size_t i = 0; i < argc; ++i)
+            {
+                LogArg &arg = args[i];
+                if (arg.type != LogArg::Type::String)
+                {
+                    continue;
+                }
+                if (!arg.s)
+                {
+                    // 空指针按 %s 输出 "(null)"，与同步模式一致
+                    arg.type = LogArg::Type::Pointer;
+                    arg.p = nullptr;
+                    continue;
+                }
+                const char *text = arg.s;
+                arg.u = message.size();
+                message.append(text, strnlen(text, MAX_LOG_STRING_BYTES));
+                message += '\0';
+            }
+        }
+
+        /// 写线程使用的参数：把字符串偏移换算为指向 message 的指针
+        const LogArg *ResolvedArgs(std::array<LogArg, MAX_LOG_ARGS> &out) const
+        {
+            for (size_t i = 0; i < argc; ++i)
+            {
+                out[i] = args[i];
+                if (out[i].type == LogArg::Type::String)
+                {
+                    out[i].s = message.c_str() + args[i].u;
+                }
+            }
+            return out.data();
+        }
+    };
+
+    /// 每线程单生产者/单消费者环形缓冲
+    /// 生产者为写日志的线程，消费者为写线程；head/tail 分别只由一方写入，无需加锁
+    struct Logger::LogRing
+    {
+        explicit LogRing(size_t capacity) : slots(capacity) {}
+
+        /// @param used 写入后的占用槽位数
+        bool TryPush(LogRecord &&record, size_t &used)
+        {
+            const size_t h = head.load(std::memory_order_relaxed);
+            used = h - tail.load(std::memory_order_acquire);
+            if (used >= slots.size())
+            {
+                return false;
+            }
+            slots[h % slots.size()] = std::move(record);
+            head.store(h + 1, std::memory_order_release);
+            ++used;
+            return true;
+        }
+
+        template <typename Fn>
+        void Drain(Fn &&fn)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            const size_t h = head.load(std::memory_order_acquire);
+            for (; t != h; ++t)
+            {
+                fn(std::move(slots[t % slots.size()]));
+            }
+            tail.store(t, std::memory_order_release);
+        }
+
+        bool Empty() const
+        {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        std::vector<LogRecord> slots;
+        std::string threadId;
+        std::atomic<unsigned long long> dropped{0}; ///< 缓冲满时丢弃的条数
+        unsigned long long reportedDropped = 0;     ///< 写线程已补记的丢弃条数
+        std::atomic<bool> orphaned{false};          ///< 所属线程已退出，排空后可回收
+    };
+
+    /// 内存映射追加写入
+    /// 文件按块扩展并整体映射，写入只是内存拷贝，由系统在后台写回磁盘；
+    /// 关闭时截断到实际长度（运行中文件末尾为尚未使用的零填充区域）
+    class MappedLogFile
+    {
+    public:
+        static constexpr size_t CHUNK_BYTES = 4 * 1024 * 1024;
+
+        ~MappedLogFile() { Close(); }
+
+        bool Open(const std::filesystem::path &path)
+        {
+            m_file = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                                 nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            m_size = 0;
+            return Remap(CHUNK_BYTES);
+        }
+
+        bool Write(const char *data, size_t size)
+        {
+            if (!m_view)
+            {
+                return false;
+            }
+            if (m_size + size > m_capacity)
+            {
+                const size_t needed = m_size + size;
+                if (!Remap((needed + CHUNK_BYTES - 1) / CHUNK_BYTES * CHUNK_BYTES))
+                {
+                    return false;
+                }
+            }
+            std::memcpy(m_view + m_size, data, size);
+            m_size += size;
+            return true;
+        }
+
+        void Flush()
+        {
+            if (m_view && m_size > 0)
+            {
+                FlushViewOfFile(m_view, m_size);
+            }
+        }
+
+        void Close()
+        {
+            Unmap();
+            if (m_file != INVALID_HANDLE_VALUE)
+            {
+                LARGE_INTEGER end;
+                end.QuadPart = static_cast<LONGLONG>(m_size);
+                SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN);
+                SetEndOfFile(m_file);
+                CloseHandle(m_file);
+                m_file = INVALID_HANDLE_VALUE;
+            }
+        }
+
+        bool IsOpen() const { return m_view != nullptr; }
+
+    private:
+        void Unmap()
+        {
+            if (m_view)
+            {
+                UnmapViewOfFile(m_view);
+                m_view = nullptr;
+            }
+            if (m_mapping)
+            {
+                CloseHandle(m_mapping);
+                m_mapping = nullptr;
+            }
+            m_capacity = 0;
+        }
+
+        /// 映射大于文件当前长度时系统自动扩展文件
+        bool Remap(size_t capacity)
+        {
+            Unmap();
+            const unsigned long long cap = capacity;
+            m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE,
+                                           static_cast<DWORD>(cap >> 32), static_cast<DWORD>(cap & 0xFFFFFFFFull),
+                                           nullptr);
+            if (!m_mapping)
+            {
+                return false;
+            }
+            m_view = static_cast<char *>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, capacity));
+            if (!m_view)
+            {
+                CloseHandle(m_mapping);
+                m_mapping = nullptr;
+                return false;
+            }
+            m_capacity = capacity;
+            return true;
+        }
+
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+        char *m_view = nullptr;
+        size_t m_capacity = 0;
+        size_t m_size = 0;
+    };
+
+    /// 线程退出时标记其缓冲为孤儿，由写线程排空后回收
+    struct ThreadRingHolder
+    {
+        std::shared_ptr<Logger::LogRing> ring;
+        ~ThreadRingHolder()
+        {
+            if (ring)
+            {
+                ring->orphaned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    static thread_local ThreadRingHolder t_ringHolder;
+
     Logger &Logger::Instance()
     {
         static Logger instance;
         return instance;
     }
 
-    bool Logger::Initialize(LogLevel level, const std::string &logDir, bool fileOutput)
+    Logger::Logger()
+    {
+        m_moduleOverrides.fill(-1);
+        ApplyModuleLevelsLocked();
+    }
+
+    Logger::~Logger()
+    {
+        StopWriter();
+    }
+
+    bool Logger::Initialize(LogLevel level, const std::string &logDir, bool fileOutput, bool async,
+                            const LogFileOptions &fileOptions)
     {
         std::lock_guard<std::mutex> lock(m_mutex);
 
@@ -29,7 +276,10 @@ namespace Util
         }
 
         m_level.store(level);
+        ApplyModuleLevelsLocked();
         m_fileOutput.store(fileOutput);
+        m_logDir = logDir;
+        m_fileOptions = fileOptions;
 
         // 只有启用文件输出时才创建日志目录和文件
         if (fileOutput)
@@ -60,7 +310,7 @@ namespace Util
 
         // 记录初始化信息
         std::ostringstream oss;
-        oss << "Logger initialized. Level: " << LevelToString(level);
+        oss << "Logger initialized. Level: " << LogLevelName(level);
         if (fileOutput)
         {
             oss << ", Log file: " << m_currentLogFile;
@@ -72,11 +322,20 @@ namespace Util
 
         // 直接输出到控制台和文件（此时已初始化）
         std::cout << "[Logger] " << oss.str() << std::endl;
-        if (m_fileStream.is_open())
+        if (IsFileOpenLocked())
         {
-            m_fileStream << GetTimestamp() << " [" << GetThreadId() << "] [INFO] "
-                         << oss.str() << std::endl;
-            m_fileStream.flush();
+            WriteFileNoteLocked(oss.str());
+            FlushFileLocked(false);
+        }
+
+        m_systemEpoch = std::chrono::system_clock::now();
+        m_steadyEpoch = std::chrono::steady_clock::now();
+
+        if (async)
+        {
+            m_writerStop = false;
+            m_writerThread = std::thread(&Logger::WriterThread, this);
+            m_async.store(true, std::memory_order_release);
         }
 
         return true;
@@ -84,6 +343,9 @@ namespace Util
 
     void Logger::Shutdown()
     {
+        // 先停止写线程，确保缓冲中的日志全部写出
+        StopWriter();
+
         std::lock_guard<std::mutex> lock(m_mutex);
 
         if (!m_initialized)
@@ -92,11 +354,10 @@ namespace Util
         }
 
         // 记录关闭信息
-        if (m_fileStream.is_open())
+        if (IsFileOpenLocked())
         {
-            m_fileStream << GetTimestamp() << " [" << GetThreadId() << "] [INFO] "
-                         << "Logger shutting down." << std::endl;
-            m_fileStream.close();
+            WriteFileNoteLocked("Logger shutting down.");
+            CloseFileLocked();
         }
 
         m_initialized = false;
@@ -104,7 +365,33 @@ namespace Util
 
     void Logger::SetLevel(LogLevel level)
     {
+        std::lock_guard<std::mutex> lock(m_mutex);
         m_level.store(level);
+        ApplyModuleLevelsLocked();
+    }
+
+    void Logger::SetModuleLevel(LogModule module, LogLevel level)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_moduleOverrides[static_cast<size_t>(module)] = static_cast<int>(level);
+        ApplyModuleLevelsLocked();
+    }
+
+    void Logger::ClearModuleLevel(LogModule module)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_moduleOverrides[static_cast<size_t>(module)] = -1;
+        ApplyModuleLevelsLocked();
+    }
+
+    void Logger::ApplyModuleLevelsLocked()
+    {
+        const int global = static_cast<int>(m_level.load());
+        for (size_t i = 0; i < m_moduleLevels.size(); ++i)
+        {
+            const int level = m_moduleOverrides[i] >= 0 ? m_moduleOverrides[i] : global;
+            m_moduleLevels[i].store(level, std::memory_order_relaxed);
+        }
     }
 
     LogLevel Logger::GetLevel() const
@@ -151,6 +438,34 @@ namespace Util
         return false;
     }
 
+    bool Logger::ParseModule(const std::string &moduleStr, LogModule &module)
+    {
+        std::string lowerStr = moduleStr;
+        for (auto &c : lowerStr)
+        {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+
+        static const std::pair<const char *, LogModule> kModules[] = {
+            {"general", LogModule::General},
+            {"engine", LogModule::Engine},
+            {"keyboard", LogModule::Keyboard},
+            {"midi", LogModule::Midi},
+            {"keymap", LogModule::Keymap},
+            {"ntp", LogModule::Ntp},
+            {"ui", LogModule::UI},
+        };
+        for (const auto &[name, value] : kModules)
+        {
+            if (lowerStr == name)
+            {
+                module = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
     void Logger::SetConsoleOutput(bool enable)
     {
         m_consoleOutput.store(enable);
@@ -161,22 +476,102 @@ namespace Util
         m_fileOutput.store(enable);
     }
 
-    void Logger::Log(LogLevel level, const char *file, int line, const char *func, const std::string &message)
+    void Logger::Log(LogLevel level, const char *file, int line, const char *func, std::string message)
     {
-        if (!m_initialized || !ShouldLog(level))
+        // 级别过滤已由日志宏按模块完成
+        if (!m_initialized)
         {
             return;
         }
 
-        // 格式化日志行（在锁外进行，减少锁持有时间）
-        std::ostringstream oss;
-        oss << GetTimestamp()
-            << " [" << GetThreadId() << "] "
-            << "[" << LevelToString(level) << "] "
-            << "[" << ExtractFileName(file) << ":" << line << " " << func << "] "
-            << message;
+        if (m_async.load(std::memory_order_acquire))
+        {
+            LogRecord record;
+            record.level = level;
+            record.time = std::chrono::system_clock::now();
+            record.file = file;
+            record.line = line;
+            record.func = func;
+            record.message = std::move(message);
+
+            if (EnqueueAsync(std::move(record)))
+            {
+                return;
+            }
+            message = std::move(record.message);
+        }
+
+        WriteSync(level, file, line, func, message);
+    }
+
+    void Logger::LogEvent(const LogSite &site, const LogArg *args, size_t count)
+    {
+        if (!m_initialized)
+        {
+            return;
+        }
 
-        std::string logLine = oss.str();
+        if (m_async.load(std::memory_order_acquire))
+        {
+            LogRecord record;
+            record.level = site.level;
+            record.file = site.file;
+            record.line = site.line;
+            record.func = site.func;
+            record.site = &site;
+            record.steady = std::chrono::steady_clock::now();
+            record.argc = static_cast<unsigned char>(count);
+            std::copy(args, args + count, record.args.begin());
+            record.CaptureStrings();
+
+            if (EnqueueAsync(std::move(record)))
+            {
+                return;
+            }
+        }
+
+        WriteSync(site.level, site.file, site.line, site.func, FormatEvent(site, args, count));
+    }
+
+    bool Logger::EnqueueAsync(LogRecord &&record)
+    {
+        const LogLevel level = record.level;
+        if (PushAsync(std::move(record)))
+        {
+            // 检查 m_async 与入队之间可能恰好开始停止：写线程的最后一次排空若未看到本条记录，
+            // 由调用线程自行排空（与 StopWriter 的 m_async 写入构成 Dekker 式配对，需全序栅栏）
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!m_async.load(std::memory_order_relaxed))
+            {
+                DrainRings();
+                return true;
+            }
+            if (level >= LogLevel::Fatal)
+            {
+                Flush(); // Fatal：等待之前的全部日志落盘
+            }
+            else if (level >= LogLevel::Error)
+            {
+                WakeWriter();
+            }
+            return true;
+        }
+
+        // 缓冲已满：Error 以下直接丢弃（写线程稍后补记丢弃条数），Error 及以上退回同步写出
+        if (level < LogLevel::Error)
+        {
+            t_ringHolder.ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void Logger::WriteSync(LogLevel level, const char *file, int line, const char *func, const std::string &message)
+    {
+        // 格式化日志行（在锁外进行，减少锁持有时间）
+        const auto now = std::chrono::system_clock::now();
+        const std::string threadId = GetThreadId();
+        std::string logLine = FormatLine(level, now, threadId, file, line, func, message);
 
         // 获取锁并输出
         std::lock_guard<std::mutex> lock(m_mutex);
@@ -184,105 +579,360 @@ namespace Util
         // 输出到控制台
         if (m_consoleOutput.load())
         {
-            // 根据级别选择输出流和颜色
-            HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-            WORD originalColor = 7; // 默认灰白色
+            WriteConsole(level, logLine);
+        }
 
-            if (hConsole != INVALID_HANDLE_VALUE)
+        // 输出到文件
+        if (m_fileOutput.load() && IsFileOpenLocked())
+        {
+            if (m_binaryEncoder)
             {
-                CONSOLE_SCREEN_BUFFER_INFO csbi;
-                if (GetConsoleScreenBufferInfo(hConsole, &csbi))
-                {
-                    originalColor = csbi.wAttributes;
-                }
-
-                // 设置颜色
-                WORD color = originalColor;
-                switch (level)
-                {
-                case LogLevel::Debug:
-                    color = 8; // 深灰色
-                    break;
-                case LogLevel::Info:
-                    color = 7; // 白色
-                    break;
-                case LogLevel::Warning:
-                    color = 14; // 黄色
-                    break;
-                case LogLevel::Error:
-                    color = 12; // 红色
-                    break;
-                case LogLevel::Fatal:
-                    color = 79; // 白底红字
-                    break;
-                }
-                SetConsoleTextAttribute(hConsole, color);
+                std::string record;
+                m_binaryEncoder->AppendText(record, level, now, threadId, file, line, func, message);
+                WriteFileLocked(record.data(), record.size());
             }
-
-            std::cout << logLine << std::endl;
-
-            // 恢复颜色
-            if (hConsole != INVALID_HANDLE_VALUE)
+            else
             {
-                SetConsoleTextAttribute(hConsole, originalColor);
+                logLine += '\n';
+                WriteFileLocked(logLine.data(), logLine.size());
             }
+            // 同步模式逐行刷新；Fatal 级别同时刷到磁盘
+            FlushFileLocked(level >= LogLevel::Fatal);
+            MaybeRotateLocked();
         }
+    }
 
-        // 输出到文件
-        if (m_fileOutput.load() && m_fileStream.is_open())
+    void Logger::Flush()
+    {
+        if (!m_async.load(std::memory_order_acquire))
         {
-            m_fileStream << logLine << std::endl;
-            // 对于 Error 和 Fatal 级别，立即刷新
-            if (level >= LogLevel::Error)
+            std::lock_guard<std::mutex> lock(m_mutex);
+            FlushFileLocked(true);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        const unsigned long long request = ++m_flushRequested;
+        m_writerCv.notify_all();
+        // 设置超时，避免写线程异常时调用方永久阻塞
+        m_writerCv.wait_for(lock, std::chrono::seconds(2),
+                            [&]
+                            { return m_flushDone >= request || m_writerStop; });
+    }
+
+    std::string Logger::FormatLine(LogLevel level, std::chrono::system_clock::time_point time,
+                                   const std::string &threadId, const char *file, int line,
+                                   const char *func, const std::string &message)
+    {
+        std::string out;
+        AppendLogLinePrefix(out, level, time, threadId, file, line, func);
+        out += message;
+        return out;
+    }
+
+    std::string Logger::FormatEvent(const LogSite &site, const LogArg *args, size_t count)
+    {
+        std::string out;
+        AppendLogEvent(out, site.format, args, count);
+        return out;
+    }
+
+    void Logger::WriteConsole(LogLevel level, const std::string &line)
+    {
+        // 根据级别选择输出流和颜色
+        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+        WORD originalColor = 7; // 默认灰白色
+
+        if (hConsole != INVALID_HANDLE_VALUE)
+        {
+            CONSOLE_SCREEN_BUFFER_INFO csbi;
+            if (GetConsoleScreenBufferInfo(hConsole, &csbi))
+            {
+                originalColor = csbi.wAttributes;
+            }
+
+            // 设置颜色
+            WORD color = originalColor;
+            switch (level)
             {
-                m_fileStream.flush();
+            case LogLevel::Debug:
+                color = 8; // 深灰色
+                break;
+            case LogLevel::Info:
+                color = 7; // 白色
+                break;
+            case LogLevel::Warning:
+                color = 14; // 黄色
+                break;
+            case LogLevel::Error:
+                color = 12; // 红色
+                break;
+            case LogLevel::Fatal:
+                color = 79; // 白底红字
+                break;
             }
+            SetConsoleTextAttribute(hConsole, color);
+        }
+
+        std::cout << line << '\n';
+
+        // 恢复颜色
+        if (hConsole != INVALID_HANDLE_VALUE)
+        {
+            SetConsoleTextAttribute(hConsole, originalColor);
         }
     }
 
-    bool Logger::ShouldLog(LogLevel level) const
+    bool Logger::PushAsync(LogRecord &&record)
     {
-        return static_cast<int>(level) >= static_cast<int>(m_level.load());
+        auto &ring = t_ringHolder.ring;
+        if (!ring)
+        {
+            // 线程首次写日志：创建并登记本线程的缓冲
+            ring = std::make_shared<LogRing>(RING_CAPACITY);
+            ring->threadId = GetThreadId();
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.push_back(ring);
+        }
+        record.threadId = &ring->threadId;
+        size_t used = 0;
+        if (!ring->TryPush(std::move(record), used))
+        {
+            return false;
+        }
+        // 缓冲过半时提前唤醒写线程，突发日志不必等到下一个写出周期
+        if (used == RING_CAPACITY / 2)
+        {
+            WakeWriter();
+        }
+        return true;
+    }
+
+    void Logger::WakeWriter()
+    {
+        // 写线程的等待条件须包含该标志，否则 notify 只是一次虚假唤醒，写线程会继续等到周期结束
+        m_drainRequested.store(true, std::memory_order_release);
+        m_writerCv.notify_one();
     }
 
-    const char *Logger::LevelToString(LogLevel level)
+    void Logger::WriterThread()
     {
-        switch (level)
+        while (true)
         {
-        case LogLevel::Debug:
-            return "DEBUG";
-        case LogLevel::Info:
-            return "INFO";
-        case LogLevel::Warning:
-            return "WARN";
-        case LogLevel::Error:
-            return "ERROR";
-        case LogLevel::Fatal:
-            return "FATAL";
-        default:
-            return "UNKNOWN";
+            unsigned long long flushTarget = 0;
+            bool flushPending = false;
+            bool stop = false;
+            {
+                std::unique_lock<std::mutex> lock(m_writerMutex);
+                m_writerCv.wait_for(lock, std::chrono::milliseconds(WRITER_INTERVAL_MS),
+                                    [&]
+                                    { return m_writerStop || m_flushRequested != m_flushDone ||
+                                             m_drainRequested.load(std::memory_order_acquire); });
+                m_drainRequested.store(false, std::memory_order_relaxed);
+                flushTarget = m_flushRequested;
+                flushPending = flushTarget != m_flushDone;
+                stop = m_writerStop;
+            }
+
+            DrainRings();
+
+            // 只在有未完成的 Flush 请求或停止时刷新（m_flushRequested 在首次 Flush 后一直非零）
+            if (flushPending || stop)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    std::cout.flush();
+                    FlushFileLocked(true);
+                }
+                std::lock_guard<std::mutex> lock(m_writerMutex);
+                if (flushTarget > m_flushDone)
+                {
+                    m_flushDone = flushTarget;
+                    m_writerCv.notify_all();
+                }
+            }
+
+            if (stop)
+            {
+                break;
+            }
         }
     }
 
-    std::string Logger::GetTimestamp()
+    void Logger::DrainRings()
     {
-        auto now = std::chrono::system_clock::now();
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      now.time_since_epoch()) %
-                  1000;
+        // 通常只有写线程排空；停止期间调用线程也可能排空，各缓冲的消费端需串行
+        std::lock_guard<std::mutex> drainLock(m_drainMutex);
+        std::vector<std::shared_ptr<LogRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            rings = m_rings;
+        }
 
-        std::time_t t = std::chrono::system_clock::to_time_t(now);
-        std::tm tm;
+        // 复用上次排空的缓冲，避免每批记录重新分配与逐步扩容
+        std::vector<LogRecord> &batch = m_drainBatch;
+        batch.clear();
+        std::vector<std::string> dropNotes;
+        bool orphanFound = false;
+        size_t sources = 0;
+        for (auto &ring : rings)
+        {
+            const size_t before = batch.size();
+            ring->Drain([&](LogRecord &&record)
+                        {
+                            if (record.site)
+                            {
+                                record.time = m_systemEpoch + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                                                  record.steady - m_steadyEpoch);
+                            }
+                            batch.push_back(std::move(record)); });
+            sources += batch.size() != before ? 1 : 0;
 
-        localtime_s(&tm, &t);
+            const unsigned long long dropped = ring->dropped.load(std::memory_order_relaxed);
+            if (dropped != ring->reportedDropped)
+            {
+                std::ostringstream oss;
+                oss << "[Logger] 线程 " << ring->threadId << " 日志缓冲已满，丢弃 "
+                    << (dropped - ring->reportedDropped) << " 条日志";
+                dropNotes.push_back(oss.str());
+                ring->reportedDropped = dropped;
+            }
+            orphanFound |= ring->orphaned.load(std::memory_order_acquire);
+        }
 
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
-            << '.' << std::setfill('0') << std::setw(3) << ms.count();
+        // 回收所属线程已退出且已排空的缓冲
+        if (orphanFound)
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(),
+                                         [](const std::shared_ptr<LogRing> &r)
+                                         {
+                                             return r->orphaned.load(std::memory_order_acquire) && r->Empty();
+                                         }),
+                          m_rings.end());
+        }
 
-        return oss.str();
+        if (batch.empty() && dropNotes.empty())
+        {
+            return;
+        }
+
+        // 各线程缓冲内部有序，来自多个缓冲时合并后按时间排序恢复全局顺序
+        if (sources > 1)
+        {
+            std::stable_sort(batch.begin(), batch.end(),
+                             [](const LogRecord &a, const LogRecord &b)
+                             { return a.time < b.time; });
+        }
+
+        // 在锁外完成格式化：所有行直接拼接到一块缓冲，文件只写一次
+        // 二进制日志且不输出控制台时完全不做文本格式化
+        const bool console = m_consoleOutput.load();
+        const bool file = m_fileOutput.load();
+        const bool binary = m_fileOptions.binaryRecords;
+        std::string &chunk = m_drainChunk;
+        chunk.clear();
+        std::vector<size_t> lineEnds;
+        std::array<LogArg, MAX_LOG_ARGS> resolved;
+        if (console || !binary)
+        {
+            chunk.reserve(batch.size() * 128);
+            lineEnds.reserve(batch.size() + dropNotes.size());
+            for (const auto &record : batch)
+            {
+                AppendLogLinePrefix(chunk, record.level, record.time, *record.threadId,
+                                    record.file, record.line, record.func);
+                if (record.site)
+                {
+                    AppendLogEvent(chunk, record.site->format, record.ResolvedArgs(resolved), record.argc);
+                }
+                else
+                {
+                    chunk += record.message;
+                }
+                chunk += '\n';
+                lineEnds.push_back(chunk.size());
+            }
+            for (const auto &note : dropNotes)
+            {
+                chunk += note;
+                chunk += '\n';
+                lineEnds.push_back(chunk.size());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (console)
+        {
+            size_t begin = 0;
+            for (size_t i = 0; i < lineEnds.size(); ++i)
+            {
+                const LogLevel level = i < batch.size() ? batch[i].level : LogLevel::Warning;
+                WriteConsole(level, chunk.substr(begin, lineEnds[i] - begin - 1));
+                begin = lineEnds[i];
+            }
+        }
+        if (file && IsFileOpenLocked())
+        {
+            if (m_binaryEncoder)
+            {
+                // 编码需持有 m_mutex：格式化点与线程表随文件轮转一起重置
+                std::string records;
+                records.reserve(batch.size() * 48);
+                for (const auto &record : batch)
+                {
+                    if (record.site)
+                    {
+                        m_binaryEncoder->AppendEvent(records, *record.site, record.time, *record.threadId,
+                                                     record.ResolvedArgs(resolved), record.argc);
+                    }
+                    else
+                    {
+                        m_binaryEncoder->AppendText(records, record.level, record.time, *record.threadId,
+                                                    record.file, record.line, record.func, record.message);
+                    }
+                }
+                for (const auto &note : dropNotes)
+                {
+                    m_binaryEncoder->AppendNote(records, note);
+                }
+                WriteFileLocked(records.data(), records.size());
+            }
+            else
+            {
+                WriteFileLocked(chunk.data(), chunk.size());
+            }
+            FlushFileLocked(false);
+            // 轮转在写线程中进行，调用线程只写环形缓冲，不受影响
+            MaybeRotateLocked();
+        }
+    }
+
+    void Logger::StopWriter()
+    {
+        if (!m_writerThread.joinable())
+        {
+            return;
+        }
+
+        // 之后的日志走同步路径；写线程退出前会排空全部缓冲，
+        // 在此之前已通过检查、随后才入队的记录由其调用线程自行排空（见 EnqueueAsync）
+        m_async.store(false, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_writerStop = true;
+        }
+        m_writerCv.notify_all();
+        m_writerThread.join();
+        DrainRings();
     }
 
+    bool Logger::ShouldLog(LogLevel level) const
+    {
+        return static_cast<int>(level) >= static_cast<int>(m_level.load());
+    }
+
+
     std::string Logger::GetThreadId()
     {
         std::ostringstream oss;
@@ -293,33 +943,178 @@ namespace Util
     bool Logger::CreateLogFile(const std::string &logDir)
     {
         // 先清理旧日志
-        RotateOldLogs(logDir, 5);
+        RotateOldLogs(logDir, m_fileOptions.maxFiles);
 
-        // 生成日志文件名：GO_MIDI_YYYYMMDD_HHMMSS.log
+        // 生成日志文件名：GO_MIDI_YYYYMMDD_HHMMSS.log（二进制日志为 .binlog，同一秒内轮转时追加序号）
         auto now = std::chrono::system_clock::now();
         std::time_t t = std::chrono::system_clock::to_time_t(now);
         std::tm tm;
 
         localtime_s(&tm, &t);
 
-        std::ostringstream filename;
-        filename << logDir << "/GO_MIDI_"
-                 << std::put_time(&tm, "%Y%m%d_%H%M%S")
-                 << ".log";
+        std::ostringstream stem;
+        stem << logDir << "/GO_MIDI_"
+             << std::put_time(&tm, "%Y%m%d_%H%M%S");
 
-        m_currentLogFile = filename.str();
+        const char *extension = m_fileOptions.binaryRecords ? ".binlog" : ".log";
+        m_currentLogFile = stem.str() + extension;
+        for (int seq = 1; std::filesystem::exists(std::filesystem::path(m_currentLogFile)); ++seq)
+        {
+            m_currentLogFile = stem.str() + "_" + std::to_string(seq) + extension;
+        }
 
         // 使用 filesystem::path 正确处理可能包含中文字符的路径
-        m_fileStream.open(std::filesystem::path(m_currentLogFile), std::ios::out | std::ios::app);
+        const std::filesystem::path path(m_currentLogFile);
+        if (m_fileOptions.mappedWriter)
+        {
+            m_mappedFile = std::make_unique<MappedLogFile>();
+            if (!m_mappedFile->Open(path))
+            {
+                // 映射失败时退回普通文件流
+                std::cerr << "[Logger] Failed to map log file, falling back to stream: " << m_currentLogFile << std::endl;
+                m_mappedFile.reset();
+            }
+        }
+        if (!m_mappedFile && !OpenFileStreamLocked())
+        {
+            return false;
+        }
+
+        m_fileBytes = 0;
+        m_fileOpenedAt = std::chrono::steady_clock::now();
+
+        if (m_fileOptions.binaryRecords)
+        {
+            // 每个文件独立解码：写入文件头，格式化点与线程表从头开始
+            if (!m_binaryEncoder)
+            {
+                m_binaryEncoder = std::make_unique<LogBinaryEncoder>();
+            }
+            std::string header;
+            m_binaryEncoder->Begin(header, std::chrono::system_clock::now());
+            WriteFileLocked(header.data(), header.size());
+        }
+        return true;
+    }
+
+    void Logger::WriteFileNoteLocked(const std::string &message)
+    {
+        const auto now = std::chrono::system_clock::now();
+        std::string out;
+        if (m_binaryEncoder)
+        {
+            m_binaryEncoder->AppendText(out, LogLevel::Info, now, GetThreadId(), "", 0, "", message);
+        }
+        else
+        {
+            AppendLogLinePrefix(out, LogLevel::Info, now, GetThreadId(), "", 0, "");
+            out += message;
+            out += '\n';
+        }
+        WriteFileLocked(out.data(), out.size());
+    }
+
+    bool Logger::IsFileOpenLocked() const
+    {
+        return m_mappedFile ? m_mappedFile->IsOpen() : m_fileStream.is_open();
+    }
+
+    bool Logger::OpenFileStreamLocked()
+    {
+        std::ios::openmode mode = std::ios::out | std::ios::app;
+        if (m_fileOptions.binaryRecords)
+        {
+            mode |= std::ios::binary;
+        }
+        m_fileStream.open(std::filesystem::path(m_currentLogFile), mode);
         if (!m_fileStream.is_open())
         {
             std::cerr << "[Logger] Failed to open log file: " << m_currentLogFile << std::endl;
             return false;
         }
-
         return true;
     }
 
+    void Logger::WriteFileLocked(const char *data, size_t size)
+    {
+        if (m_mappedFile)
+        {
+            if (m_mappedFile->Write(data, size))
+            {
+                m_fileBytes += size;
+                return;
+            }
+
+            // 扩展映射失败（磁盘或地址空间不足）：截断到已写长度后改用普通文件流续写同一文件
+            std::cerr << "[Logger] Failed to extend mapped log file, falling back to stream: " << m_currentLogFile
+                      << std::endl;
+            m_mappedFile->Close();
+            m_mappedFile.reset();
+            if (!OpenFileStreamLocked())
+            {
+                return;
+            }
+        }
+
+        if (!m_fileStream.write(data, static_cast<std::streamsize>(size)))
+        {
+            // 写入失败不计入文件大小；清除错误状态以便后续写入重试
+            m_fileStream.clear();
+            return;
+        }
+        m_fileBytes += size;
+    }
+
+    void Logger::FlushFileLocked(bool toDisk)
+    {
+        if (m_mappedFile)
+        {
+            // 映射写入的数据已在系统缓存中，进程崩溃也不会丢失；仅在需要落盘时刷新
+            if (toDisk)
+            {
+                m_mappedFile->Flush();
+            }
+        }
+        else if (m_fileStream.is_open())
+        {
+            m_fileStream.flush();
+        }
+    }
+
+    void Logger::CloseFileLocked()
+    {
+        if (m_mappedFile)
+        {
+            m_mappedFile->Close();
+            m_mappedFile.reset();
+        }
+        if (m_fileStream.is_open())
+        {
+            m_fileStream.close();
+        }
+    }
+
+    void Logger::MaybeRotateLocked()
+    {
+        const bool sizeExceeded = m_fileOptions.maxFileBytes > 0 && m_fileBytes >= m_fileOptions.maxFileBytes;
+        const bool ageExceeded = m_fileOptions.rotateMinutes > 0 &&
+                                 std::chrono::steady_clock::now() - m_fileOpenedAt >=
+                                     std::chrono::minutes(m_fileOptions.rotateMinutes);
+        if (!sizeExceeded && !ageExceeded)
+        {
+            return;
+        }
+
+        const std::string previous = m_currentLogFile;
+        CloseFileLocked();
+        if (!CreateLogFile(m_logDir))
+        {
+            return;
+        }
+
+        WriteFileNoteLocked("Log rotated, previous file: " + previous);
+    }
+
     void Logger::RotateOldLogs(const std::string &logDir, int maxFiles)
     {
         try
@@ -337,8 +1132,8 @@ namespace Util
                 if (entry.is_regular_file())
                 {
                     std::string filename = entry.path().filename().string();
-                    if (filename.find("GO_MIDI_") == 0 &&
-                        filename.find(".log") == filename.length() - 4)
+                    const std::string ext = entry.path().extension().string();
+                    if (filename.find("GO_MIDI_") == 0 && (ext == ".log" || ext == ".binlog"))
                     {
                         logFiles.push_back(entry.path());
                     }
@@ -365,21 +1160,5 @@ namespace Util
         }
     }
 
-    const char *Logger::ExtractFileName(const char *path)
-    {
-        const char *name = path;
-        const char *p = path;
-
-        while (*p)
-        {
-            if (*p == '/' || *p == '\\')
-            {
-                name = p + 1;
-            }
-            ++p;
-        }
-
-        return name;
-    }
 
 } // namespace Util
\ No newline at end of file
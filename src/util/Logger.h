@@ -11,6 +11,9 @@
 #include <thread>
 #include <atomic>
 #include <array>
+#include <vector>
+#include <condition_variable>
+#include <type_traits>
 
 namespace Util
 {
@@ -27,14 +30,185 @@ namespace Util
         Fatal = 4
     };
 
+    /// 日志模块
+    /// 源文件在第一个 #include 之前用 `#define LOG_MODULE Engine` 声明所属模块，未声明时为 General
+    enum class LogModule : int
+    {
+        General = 0,
+        Engine,     ///< PlaybackEngine
+        Keyboard,   ///< KeyboardSimulator
+        Midi,       ///< MidiParser
+        Keymap,     ///< KeyManager
+        Ntp,        ///< NtpClient
+        UI,         ///< 界面
+        Count
+    };
+
+// 编译期最低日志级别（0=Debug ... 4=Fatal，5 移除全部），低于该级别的日志调用在编译期整体移除
+// GO_MIDI_LOG_MIN_LEVEL 为全局默认值，GO_MIDI_LOG_MIN_LEVEL_<模块> 可按模块单独指定
+#ifndef GO_MIDI_LOG_MIN_LEVEL
+#define GO_MIDI_LOG_MIN_LEVEL 0
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_GENERAL
+#define GO_MIDI_LOG_MIN_LEVEL_GENERAL GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_ENGINE
+#define GO_MIDI_LOG_MIN_LEVEL_ENGINE GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_KEYBOARD
+#define GO_MIDI_LOG_MIN_LEVEL_KEYBOARD GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_MIDI
+#define GO_MIDI_LOG_MIN_LEVEL_MIDI GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_KEYMAP
+#define GO_MIDI_LOG_MIN_LEVEL_KEYMAP GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_NTP
+#define GO_MIDI_LOG_MIN_LEVEL_NTP GO_MIDI_LOG_MIN_LEVEL
+#endif
+#ifndef GO_MIDI_LOG_MIN_LEVEL_UI
+#define GO_MIDI_LOG_MIN_LEVEL_UI GO_MIDI_LOG_MIN_LEVEL
+#endif
+
+    /// 模块的编译期最低级别
+    constexpr int CompiledMinLevel(LogModule module)
+    {
+        switch (module)
+        {
+        case LogModule::Engine:
+            return GO_MIDI_LOG_MIN_LEVEL_ENGINE;
+        case LogModule::Keyboard:
+            return GO_MIDI_LOG_MIN_LEVEL_KEYBOARD;
+        case LogModule::Midi:
+            return GO_MIDI_LOG_MIN_LEVEL_MIDI;
+        case LogModule::Keymap:
+            return GO_MIDI_LOG_MIN_LEVEL_KEYMAP;
+        case LogModule::Ntp:
+            return GO_MIDI_LOG_MIN_LEVEL_NTP;
+        case LogModule::UI:
+            return GO_MIDI_LOG_MIN_LEVEL_UI;
+        default:
+            return GO_MIDI_LOG_MIN_LEVEL_GENERAL;
+        }
+    }
+
+    /// 日志文件选项
+    struct LogFileOptions
+    {
+        size_t maxFileBytes = 16 * 1024 * 1024; ///< 单个文件大小上限，超出后轮转；0 表示不限制
+        int rotateMinutes = 24 * 60;             ///< 单个文件最长使用时长（分钟），超出后轮转；0 表示不限制
+        int maxFiles = 5;                        ///< 轮转时最多保留的旧日志文件数
+        bool mappedWriter = false;               ///< 使用内存映射追加写入（按块扩展文件，写入即内存拷贝）
+        bool binaryRecords = false;              ///< 文件写入二进制记录（.binlog），由 log_decode 工具离线还原为文本
+    };
+
+    class MappedLogFile;
+    class LogBinaryEncoder;
+
+    /// 格式化点：LOG_*_FMT 宏处的静态描述（级别、位置与 printf 风格格式串）
+    /// 以静态变量的地址标识，日志记录只保存指针，格式串在写线程中才解析
+    struct LogSite
+    {
+        LogLevel level;
+        const char* file;
+        int line;
+        const char* func;
+        const char* format;
+    };
+
+    /// 延迟格式化的参数：按原始值捕获，不做任何字符串转换
+    /// 字符串参数在调用时只保存指针；异步模式下入队前复制到记录中（每个最多 MAX_LOG_STRING_BYTES 字节），
+    /// 因此可以传入临时字符串（std::string、c_str()、栈上缓冲）
+    struct LogArg
+    {
+        enum class Type : unsigned char
+        {
+            Int,
+            UInt,
+            Double,
+            String,
+            Pointer
+        };
+
+        Type type = Type::Int;
+        union
+        {
+            long long i;
+            unsigned long long u;
+            double d;
+            const char* s;
+            const void* p;
+        };
+
+        LogArg() : i(0) {}
+    };
+
+    template <typename T>
+    struct LogArgUnsupported : std::false_type
+    {
+    };
+
+    /// 将参数打包为 LogArg（仅支持算术类型、枚举、指针与字符串）
+    template <typename T>
+    inline LogArg MakeLogArg(const T& value)
+    {
+        LogArg arg;
+        if constexpr (std::is_enum_v<T>)
+        {
+            arg.type = LogArg::Type::Int;
+            arg.i = static_cast<long long>(value);
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            arg.type = LogArg::Type::Int;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            arg.type = LogArg::Type::UInt;
+            arg.u = value;
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            arg.type = LogArg::Type::Double;
+            arg.d = value;
+        }
+        else if constexpr (std::is_convertible_v<const T&, const char*>)
+        {
+            arg.type = LogArg::Type::String;
+            arg.s = value;
+        }
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            arg.type = LogArg::Type::String;
+            arg.s = value.c_str();
+        }
+        else if constexpr (std::is_pointer_v<T>)
+        {
+            arg.type = LogArg::Type::Pointer;
+            arg.p = value;
+        }
+        else
+        {
+            static_assert(LogArgUnsupported<T>::value, "LOG_*_FMT 仅支持算术类型、枚举、指针与字符串");
+        }
+        return arg;
+    }
+
     /// 轻量级高性能日志系统
     ///
     /// 特性：
     /// - 线程安全：使用互斥锁保护输出
-    /// - 异步友好：最小化锁持有时间
+    /// - 异步模式：调用线程只写入本线程的无锁环形缓冲，由后台写线程批量输出；
+    ///   缓冲满时丢弃 Error 以下级别的日志（计数后补记），Fatal 日志会等待全部写出
+    /// - 延迟格式化：LOG_*_FMT 宏只捕获格式化点、原始参数与 steady 时间戳，
+    ///   异步模式下字符串格式化完全在写线程中进行，适合热路径常开的跟踪日志
     /// - 双输出：同时输出到控制台和文件
-    /// - 日志轮转：最多保留5份日志文件
-    /// - 可配置：运行时可调整日志级别
+    /// - 日志轮转：启动时及运行中按大小/时长轮转（异步模式下由写线程完成，不阻塞调用线程），
+    ///   默认最多保留5份旧日志文件
+    /// - 可配置：运行时可调整日志级别，并可按模块单独覆盖（如只对 Engine 打开 Debug）
+    /// - 编译期裁剪：低于 GO_MIDI_LOG_MIN_LEVEL(_<模块>) 的调用不生成任何代码
     ///
     /// 使用方式：
     /// @code
@@ -54,6 +228,9 @@ namespace Util
     /// LOG_ERROR("错误信息: " << error_code);
     /// LOG_FATAL("致命错误");
     ///
+    /// // 热路径使用延迟格式化（printf 风格，参数为数值/指针/字符串）
+    /// LOG_DEBUG_FMT("按键按下: VK=0x%X, 修饰符=%d", vk, modifier);
+    ///
     /// // 关闭（程序退出时调用）
     /// Logger::Instance().Shutdown();
     /// @endcode
@@ -67,18 +244,34 @@ namespace Util
         /// @param level 最低输出级别
         /// @param logDir 日志目录，默认为 "./logs/"
         /// @param fileOutput 是否启用文件输出，默认为 true
+        /// @param async 是否启用异步模式，默认为 false
+        /// @param fileOptions 日志文件轮转与写入方式
         /// @return true 初始化成功，false 初始化失败
-        bool Initialize(LogLevel level = LogLevel::Info, const std::string& logDir = "./logs/", bool fileOutput = true);
+        bool Initialize(LogLevel level = LogLevel::Info, const std::string& logDir = "./logs/", bool fileOutput = true,
+                        bool async = false, const LogFileOptions& fileOptions = LogFileOptions());
 
-        /// 关闭日志系统
+        /// 关闭日志系统（异步模式下先写出全部缓冲）
         void Shutdown();
 
+        /// 等待异步缓冲中的日志全部写出并刷新文件（同步模式下仅刷新文件）
+        void Flush();
+
         /// 设置日志级别
         void SetLevel(LogLevel level);
 
         /// 获取当前日志级别
         LogLevel GetLevel() const;
 
+        /// 设置模块级别，覆盖全局级别（仅影响该模块）
+        void SetModuleLevel(LogModule module, LogLevel level);
+
+        /// 清除模块级别覆盖，恢复使用全局级别
+        void ClearModuleLevel(LogModule module);
+
+        /// 从字符串获取模块 (general, engine, keyboard, midi, keymap, ntp, ui)
+        /// @return 解析成功返回 true
+        static bool ParseModule(const std::string& moduleStr, LogModule& module);
+
         /// 从字符串获取日志级别
         /// @param levelStr 日志级别字符串 (debug, info, warn, error, fatal)
         /// @return 解析成功返回 true
@@ -92,33 +285,119 @@ namespace Util
 
         /// 核心日志输出函数
         /// 此函数是线程安全的，且设计为最小化性能影响：
-        /// 1. 先在调用线程中格式化消息（无锁）
-        /// 2. 然后获取锁并输出（最小锁持有时间）
-        void Log(LogLevel level, const char* file, int line, const char* func, const std::string& message);
+        /// - 同步模式：在调用线程中格式化整行，然后获取锁并输出（最小锁持有时间）
+        /// - 异步模式：消息移入本线程环形缓冲即返回，时间戳格式化与 I/O 均在写线程完成
+        void Log(LogLevel level, const char* file, int line, const char* func, std::string message);
+
+        /// 延迟格式化日志（由 LOG_*_FMT 宏调用）
+        /// 异步模式下只把格式化点指针与原始参数写入定长记录，不分配内存
+        template <typename... Args>
+        void LogFmt(const LogSite& site, const Args&... args)
+        {
+            static_assert(sizeof...(Args) <= MAX_LOG_ARGS, "LOG_*_FMT 参数过多");
+            const LogArg packed[] = {MakeLogArg(args)..., LogArg{}};
+            LogEvent(site, packed, sizeof...(Args));
+        }
+
+        /// 最多捕获的参数个数
+        static constexpr size_t MAX_LOG_ARGS = 6;
+        /// 异步模式下每个字符串参数最多复制的字节数，超出部分截断（与格式化时单个参数的输出上限一致）
+        static constexpr size_t MAX_LOG_STRING_BYTES = 255;
 
         /// 检查指定级别是否会被输出（用于性能敏感代码中避免不必要的字符串格式化）
         bool ShouldLog(LogLevel level) const;
 
+        /// 检查指定模块的指定级别是否会被输出（考虑模块级别覆盖）
+        bool ShouldLog(LogModule module, LogLevel level) const
+        {
+            return static_cast<int>(level) >=
+                   m_moduleLevels[static_cast<size_t>(module)].load(std::memory_order_relaxed);
+        }
+
     private:
-        Logger() = default;
-        ~Logger() = default;
+        struct LogRecord;   ///< 异步模式下的一条待写日志
+        struct LogRing;     ///< 每线程单生产者/单消费者环形缓冲
+        friend struct ThreadRingHolder;
+
+        /// 每线程环形缓冲的槽位数（缓冲满时按丢弃策略处理）
+        static constexpr size_t RING_CAPACITY = 4096;
+        /// 写线程批量写出的周期
+        static constexpr int WRITER_INTERVAL_MS = 20;
+
+        Logger();
+        ~Logger();
         Logger(const Logger&) = delete;
         Logger& operator=(const Logger&) = delete;
 
-        static const char* LevelToString(LogLevel level);  ///< 获取日志级别名称
-        static std::string GetTimestamp();                  ///< 获取当前时间戳字符串
         static std::string GetThreadId();                   ///< 获取当前线程ID
         bool CreateLogFile(const std::string& logDir);      ///< 创建日志文件并处理轮转
         void RotateOldLogs(const std::string& logDir, int maxFiles);  ///< 清理旧日志
-        static const char* ExtractFileName(const char* path);         ///< 提取文件名（不含路径）
+
+        // 以下文件操作均需持有 m_mutex
+        bool IsFileOpenLocked() const;
+        bool OpenFileStreamLocked();                     ///< 以追加方式打开 m_currentLogFile（二进制日志不做换行转换）
+        void WriteFileLocked(const char* data, size_t size);
+        void FlushFileLocked(bool toDisk);               ///< toDisk 时内存映射写入也刷到磁盘
+        void CloseFileLocked();
+        void MaybeRotateLocked();                        ///< 超过大小或时长上限时切换到新文件
+        void WriteFileNoteLocked(const std::string& message);  ///< 写入日志系统自身的 INFO 消息（无位置信息）
+
+        /// 格式化一整行：时间戳 [线程] [级别] [文件:行 函数] 消息（行格式见 LogFormat.h）
+        static std::string FormatLine(LogLevel level, std::chrono::system_clock::time_point time,
+                                      const std::string& threadId, const char* file, int line,
+                                      const char* func, const std::string& message);
+        /// 带颜色输出到控制台（调用时需持有 m_mutex）
+        void WriteConsole(LogLevel level, const std::string& line);
+
+        void LogEvent(const LogSite& site, const LogArg* args, size_t count);
+        /// 按格式化点的格式串展开参数（写线程或同步模式下调用）
+        static std::string FormatEvent(const LogSite& site, const LogArg* args, size_t count);
+
+        bool PushAsync(LogRecord&& record);     ///< 写入本线程环形缓冲，满时返回 false
+        bool EnqueueAsync(LogRecord&& record);  ///< 写入缓冲并按丢弃策略处理，返回 false 表示需同步写出
+        void WakeWriter();                      ///< 不等写出周期，立即唤醒写线程排空缓冲
+        /// 同步写出一行（在调用线程中格式化并输出）
+        void WriteSync(LogLevel level, const char* file, int line, const char* func, const std::string& message);
+        void WriterThread();                     ///< 异步写线程主循环
+        void DrainRings();                       ///< 取出所有缓冲中的日志，按时间排序后批量写出
+        void StopWriter();
+        void ApplyModuleLevelsLocked(); ///< 按全局级别与覆盖重算各模块生效级别（需持有 m_mutex）
 
         std::atomic<LogLevel> m_level{LogLevel::Info};
+        /// 各模块生效级别（全局级别或覆盖值），日志宏热路径只读取这一项
+        std::array<std::atomic<int>, static_cast<size_t>(LogModule::Count)> m_moduleLevels;
+        /// 各模块覆盖级别，-1 表示未覆盖（受 m_mutex 保护）
+        std::array<int, static_cast<size_t>(LogModule::Count)> m_moduleOverrides;
         std::atomic<bool> m_consoleOutput{true};
         std::atomic<bool> m_fileOutput{true};
         std::mutex m_mutex;
         std::ofstream m_fileStream;
+        std::unique_ptr<MappedLogFile> m_mappedFile;  ///< 启用内存映射写入时代替 m_fileStream
+        std::unique_ptr<LogBinaryEncoder> m_binaryEncoder; ///< 二进制日志编码器（受 m_mutex 保护）
         std::string m_currentLogFile;
+        std::string m_logDir;
+        LogFileOptions m_fileOptions;
+        size_t m_fileBytes{0};                         ///< 当前文件已写入字节数
+        std::chrono::steady_clock::time_point m_fileOpenedAt;
         bool m_initialized{false};
+
+        /// 异步模式
+        std::atomic<bool> m_async{false};
+        /// 延迟格式化记录使用 steady 时间戳，写线程据此换算为系统时间
+        std::chrono::system_clock::time_point m_systemEpoch;
+        std::chrono::steady_clock::time_point m_steadyEpoch;
+        std::thread m_writerThread;
+        std::mutex m_writerMutex;                   ///< 保护下列写线程控制状态
+        std::condition_variable m_writerCv;
+        bool m_writerStop{false};
+        std::atomic<bool> m_drainRequested{false};  ///< 提前唤醒写线程排空缓冲（不持锁设置）
+        unsigned long long m_flushRequested{0};     ///< Flush 请求序号
+        unsigned long long m_flushDone{0};          ///< 写线程已完成的 Flush 序号
+        std::mutex m_ringsMutex;                    ///< 仅在线程首次写日志登记缓冲时竞争
+        std::mutex m_drainMutex;                    ///< 串行化缓冲的消费端（写线程与停止期间的调用线程）
+        std::vector<LogRecord> m_drainBatch;        ///< 排空时复用的记录缓冲（受 m_drainMutex 保护，保留容量）
+        std::string m_drainChunk;                   ///< 排空时复用的文本缓冲（同上）
+        std::vector<std::shared_ptr<LogRing>> m_rings;
     };
 
 } // namespace Util
@@ -135,17 +414,39 @@ using LogLevel = Util::LogLevel;
 // 日志宏定义
 // ============================================================================
 
+/// 当前源文件所属模块（在第一个 #include 之前定义以覆盖）
+#ifndef LOG_MODULE
+#define LOG_MODULE General
+#endif
+
 /// 内部日志实现宏（不直接使用，请使用 LOG、LOG_DEBUG 等宏）
-#define LOG_IMPL(level, message)                                  \
-    do                                                            \
-    {                                                             \
-        if (Logger::Instance().ShouldLog(level))                  \
-        {                                                         \
-            std::ostringstream _oss;                              \
-            _oss << message;                                      \
-            Logger::Instance().Log(                               \
-                level, __FILE__, __LINE__, __func__, _oss.str()); \
-        }                                                         \
+/// 级别低于模块编译期最低级别时整个调用被 if constexpr 丢弃
+#define LOG_IMPL(level, message)                                                                \
+    do                                                                                          \
+    {                                                                                           \
+        if constexpr (static_cast<int>(level) >= Util::CompiledMinLevel(Util::LogModule::LOG_MODULE)) \
+        {                                                                                       \
+            if (Logger::Instance().ShouldLog(Util::LogModule::LOG_MODULE, level))               \
+            {                                                                                   \
+                std::ostringstream _oss;                                                        \
+                _oss << message;                                                                \
+                Logger::Instance().Log(                                                         \
+                    level, __FILE__, __LINE__, __func__, _oss.str());                           \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+/// 运行期级别的日志实现宏（级别可为变量，不做编译期裁剪）
+#define LOG_IMPL_RUNTIME(level, message)                                      \
+    do                                                                        \
+    {                                                                         \
+        if (Logger::Instance().ShouldLog(Util::LogModule::LOG_MODULE, level)) \
+        {                                                                     \
+            std::ostringstream _oss;                                          \
+            _oss << message;                                                  \
+            Logger::Instance().Log(                                           \
+                level, __FILE__, __LINE__, __func__, _oss.str());             \
+        }                                                                     \
     } while (0)
 
 /// 兼容旧代码的 LOG 宏（单参数，默认 INFO 级别）
@@ -162,4 +463,26 @@ using LogLevel = Util::LogLevel;
 #define LOG_FATAL(message) LOG_IMPL(LogLevel::Fatal, message)
 
 /// 带级别的日志宏（双参数版本）
-#define LOG_LEVEL(level, message) LOG_IMPL(level, message)
+#define LOG_LEVEL(level, message) LOG_IMPL_RUNTIME(level, message)
+
+/// 内部延迟格式化宏（不直接使用，请使用 LOG_DEBUG_FMT 等宏）
+/// 格式化点为静态常量，参数按原始值捕获，不构造 ostringstream
+#define LOG_FMT_IMPL(level, format, ...)                                             \
+    do                                                                               \
+    {                                                                                \
+        if constexpr (static_cast<int>(level) >= Util::CompiledMinLevel(Util::LogModule::LOG_MODULE)) \
+        {                                                                            \
+            if (Logger::Instance().ShouldLog(Util::LogModule::LOG_MODULE, level))    \
+            {                                                                        \
+                static const Util::LogSite _log_site{level, __FILE__, __LINE__,      \
+                                                     __func__, format};              \
+                Logger::Instance().LogFmt(_log_site, ##__VA_ARGS__);                 \
+            }                                                                        \
+        }                                                                            \
+    } while (0)
+
+/// 级别特定延迟格式化宏（printf 风格格式串）
+#define LOG_DEBUG_FMT(format, ...) LOG_FMT_IMPL(LogLevel::Debug, format, ##__VA_ARGS__)
+#define LOG_INFO_FMT(format, ...) LOG_FMT_IMPL(LogLevel::Info, format, ##__VA_ARGS__)
+#define LOG_WARN_FMT(format, ...) LOG_FMT_IMPL(LogLevel::Warning, format, ##__VA_ARGS__)
+#define LOG_ERROR_FMT(format, ...) LOG_FMT_IMPL(LogLevel::Error, format, ##__VA_ARGS__)
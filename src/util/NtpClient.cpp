@@ -1,8 +1,13 @@
+// 日志模块（须在包含 Logger.h 之前定义）
+#define LOG_MODULE Ntp
+
 #include "NtpClient.h"
 #include "Logger.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "SocketCompat.h"
 #include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
 #include <algorithm>
 #include <cmath>
 
@@ -14,13 +19,30 @@ namespace Util
 {
 
     std::atomic<bool> NtpClient::s_synced{false};
-    std::chrono::system_clock::time_point NtpClient::s_base_ntp;
-    std::chrono::steady_clock::time_point NtpClient::s_base_steady;
-    double NtpClient::s_skew{1.0};
+    std::atomic<unsigned int> NtpClient::s_clock_seq{0};
+    std::atomic<long long> NtpClient::s_base_ntp{0};
+    std::atomic<long long> NtpClient::s_base_steady{0};
+    std::atomic<double> NtpClient::s_skew{1.0};
 
     // Anchor definitions
     std::chrono::system_clock::time_point NtpClient::s_anchor_ntp;
     std::chrono::steady_clock::time_point NtpClient::s_anchor_steady;
+    NtpClient::ClockFilter NtpClient::s_filter;
+
+    std::vector<std::string> NtpClient::s_servers = {
+        "ntp.aliyun.com",
+        "ntp.tencent.com",
+        "cn.pool.ntp.org",
+        "pool.ntp.org"};
+    int NtpClient::s_port{123};
+    std::atomic<PeerMode> NtpClient::s_peer_mode{PeerMode::Off};
+    std::string NtpClient::s_peer_leader;
+    int NtpClient::s_peer_port{47123};
+    std::mutex NtpClient::s_config_mutex;
+
+    std::thread NtpClient::s_peer_thread;
+    std::function<void(const GroupStart &)> NtpClient::s_group_start_handler;
+    std::mutex NtpClient::s_peer_mutex;
 
     std::mutex NtpClient::s_mutex;
     std::condition_variable NtpClient::s_cv;
@@ -30,16 +52,42 @@ namespace Util
     std::atomic<long long> NtpClient::s_last_delay_ms{0};
     std::atomic<long long> NtpClient::s_last_offset_ms{0};
     std::atomic<int> NtpClient::s_sync_count{0};
+    std::atomic<bool> NtpClient::s_clock_stable{false};
+    std::atomic<bool> NtpClient::s_profile_loaded{false};
+    int NtpClient::s_profile_sync_count{0};
+
+    static const unsigned long long NTP_TIMESTAMP_DELTA = 2208988800ull;
 
-    static long long DurationToMs(const std::chrono::system_clock::duration &d)
+    /// Marzullo 交集算法：求被最多区间同时覆盖的区域 [best_lo, best_hi]，返回覆盖数量
+    static int Marzullo(const std::vector<std::pair<double, double>> &intervals, double &best_lo, double &best_hi)
     {
-        return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+        // (位置, 类型)：-1 为区间起点，+1 为终点；同一位置起点排在终点之前，使端点相接的区间视为相交
+        std::vector<std::pair<double, int>> edges;
+        edges.reserve(intervals.size() * 2);
+        for (const auto &iv : intervals)
+        {
+            edges.push_back({iv.first, -1});
+            edges.push_back({iv.second, +1});
+        }
+        std::sort(edges.begin(), edges.end());
+
+        int best = 0;
+        int count = 0;
+        for (size_t i = 0; i + 1 < edges.size(); ++i)
+        {
+            count -= edges[i].second;
+            if (count > best)
+            {
+                best = count;
+                best_lo = edges[i].first;
+                best_hi = edges[i + 1].first;
+            }
+        }
+        return best;
     }
 
     static std::chrono::system_clock::time_point NtpTimestampToTimePoint(uint32_t seconds_be, uint32_t fraction_be)
     {
-        const unsigned long long NTP_TIMESTAMP_DELTA = 2208988800ull;
-
         const uint32_t seconds = ntohl(seconds_be);
         const uint32_t fraction = ntohl(fraction_be);
 
@@ -51,202 +99,392 @@ namespace Util
         return base + extra;
     }
 
-    bool NtpClient::SyncOnceMs(const char *server_name, int timeout_ms, double &offset_ms, double &delay_ms)
+    // 采样参数：每轮向所有服务器各发一个请求，所有回复在同一时间窗口内收集
+    static constexpr int NORMAL_ROUNDS = 8;
+    static constexpr int FAST_ROUNDS = 2;
+    static constexpr int ROUND_INTERVAL_MS = 50;
+    static constexpr int NORMAL_TIMEOUT_MS = 1000;  // 最后一轮发送后的等待时间
+    static constexpr int FAST_TIMEOUT_MS = 200;
+    static constexpr size_t FAST_TARGET_SAMPLES = 3; // 快速模式凑够 3 个样本即结束（强制跨服务器校验）
+
+    // 时钟滤波参数（相位单位 ms，频率单位 ms/s）
+    static constexpr double HARD_STEP_MS = 5000.0;                // 超过该偏差直接重置
+    static constexpr double MIN_MEASUREMENT_VARIANCE_MS2 = 0.01;  // 测量噪声下限 (0.1ms)^2
+    static constexpr double INITIAL_FREQ_VARIANCE = 0.01;         // 初始频偏不确定度 (100ppm)^2
+    static constexpr double PHASE_NOISE_MS2_PER_S = 1e-4;         // 相位随机游走（路由变化等）
+    static constexpr double FREQ_NOISE_PER_S = 1e-10;             // 频率随机游走（温漂）
+    static constexpr double MAX_FREQ_MS_PER_S = 1.0;              // 频偏上限 1000ppm
+    static constexpr double INNOVATION_GATE = 5.0;                // 新息门限（标准差倍数）
+    static constexpr int MAX_CONSECUTIVE_REJECTS = 3;
+    static constexpr double STABLE_INNOVATION_SIGMAS = 2.0;      // 新息小于该倍数标准差视为稳定
+    static constexpr double STABLE_PHASE_SIGMA_MS = 1.0;         // 且相位标准差低于 1ms
+
+    // 自动同步轮询间隔：稳定后逐次加倍，异常时回落
+    static constexpr int MIN_POLL_INTERVAL_S = 10;
+    static constexpr int MAX_POLL_INTERVAL_S = 320;
+
+    // 漂移档案
+    static constexpr long long PROFILE_MAX_AGE_S = 7 * 24 * 3600;  // 超过 7 天的档案视为过期
+    static constexpr double PROFILE_OFFSET_SIGMA_MS = 10.0;        // 恢复偏差的基础不确定度
+    static constexpr double PROFILE_OFFSET_SIGMA_MS_PER_HOUR = 50.0; // 随档案年龄增长的不确定度
+    static constexpr int PROFILE_MIN_SYNCS = 3;                    // 本次运行至少同步几次才保存
+
+    /// 将时间点编码为 NTP 时间戳（网络字节序）
+    static void TimePointToNtpTimestamp(const std::chrono::system_clock::time_point &tp,
+                                        uint32_t &seconds_be, uint32_t &fraction_be)
     {
-        LOG_DEBUG("[NtpClient] 同步服务器: " << server_name << ", 超时: " << timeout_ms << "ms");
+        const auto since_epoch = tp.time_since_epoch();
+        const auto secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+        const double frac = std::chrono::duration<double>(since_epoch - secs).count();
 
-        SOCKET sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-        if (sockfd == INVALID_SOCKET)
-        {
-            LOG_WARN("创建 socket 失败");
-            return false;
-        }
-
-        DWORD timeout = (DWORD)timeout_ms;
-        setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+        seconds_be = htonl((uint32_t)((unsigned long long)secs.count() + NTP_TIMESTAMP_DELTA));
+        fraction_be = htonl((uint32_t)(frac * 4294967296.0));
+    }
 
-        struct addrinfo hints = {0};
+    // 局域网对时
+    static constexpr int PEER_POLL_MS = 100;                // 对时线程轮询间隔（兼顾退出响应）
+    static constexpr int PEER_HELLO_INTERVAL_MS = 2000;     // 从机登记间隔
+    static constexpr int PEER_SUBSCRIBER_TTL_MS = 10000;    // 超过该时间未登记的从机视为离线
+    static constexpr int PEER_START_REPEAT = 3;             // UDP 无重传，集体开始消息重复发送
+    static constexpr int PEER_MAX_PACKET = 512;
+    static const char PEER_HELLO[] = "GOMIDI_HELLO";
+    static const char PEER_START[] = "GOMIDI_START ";
+
+    /// 主机记录的从机（地址 + 最近登记时间），受 s_peer_mutex 保护
+    struct PeerSubscriber
+    {
+        struct sockaddr_in addr;
+        std::chrono::steady_clock::time_point last_seen;
+    };
+    static std::vector<PeerSubscriber> s_peer_subscribers;
+    /// 主机应答与登记使用的 socket，集体开始消息也从该端口发出，从机据此核对来源（受 s_peer_mutex 保护）
+    static Net::Socket s_peer_leader_socket = Net::INVALID;
+
+    static bool ResolveIPv4(const std::string &host, int port, struct sockaddr_in &addr)
+    {
+        struct addrinfo hints = {};
         hints.ai_family = AF_INET;
         hints.ai_socktype = SOCK_DGRAM;
 
         struct addrinfo *result = nullptr;
-        if (getaddrinfo(server_name, "123", &hints, &result) != 0)
+        const std::string port_str = std::to_string(port);
+        if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &result) != 0 || !result)
         {
-            LOG_WARN("解析服务器地址失败: " << server_name);
-            closesocket(sockfd);
             return false;
         }
+        memset(&addr, 0, sizeof(addr));
+        memcpy(&addr, result->ai_addr, result->ai_addrlen);
+        freeaddrinfo(result);
+        return true;
+    }
 
-        struct sockaddr_in serv_addr;
-        memset(&serv_addr, 0, sizeof(serv_addr));
-        // Use the first result
-        if (result)
+    bool NtpClient::CollectSamples(bool fast_mode, std::vector<Sample> &samples)
+    {
+        std::vector<std::string> servers;
+        int port = 123;
+        const bool follower = s_peer_mode.load() == PeerMode::Follower;
         {
-            memcpy(&serv_addr, result->ai_addr, result->ai_addrlen);
+            std::lock_guard<std::mutex> lock(s_config_mutex);
+            if (follower)
+            {
+                // 从机只以局域网主机为时间源，未指定主机时广播请求
+                servers = {s_peer_leader.empty() ? std::string("255.255.255.255") : s_peer_leader};
+                port = s_peer_port;
+            }
+            else
+            {
+                servers = s_servers;
+                port = s_port;
+            }
         }
-        freeaddrinfo(result);
 
-        unsigned char packet[48] = {0};
-        packet[0] = 0x1B;
+        // 1. 解析所有服务器地址
+        struct Target
+        {
+            std::string name;
+            struct sockaddr_in addr;
+        };
+        std::vector<Target> targets;
+        for (const auto &server_name : servers)
+        {
+            Target target;
+            target.name = server_name;
+            if (!ResolveIPv4(server_name, port, target.addr))
+            {
+                LOG_WARN("解析服务器地址失败: " << server_name);
+                continue;
+            }
+            targets.push_back(target);
+        }
 
-        const auto t0 = std::chrono::system_clock::now();
-        if (sendto(sockfd, (char *)packet, 48, 0, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+        if (targets.empty())
         {
-            LOG_WARN("发送 NTP 请求失败: " << server_name);
-            closesocket(sockfd);
             return false;
         }
 
-        struct sockaddr_in from;
-        int fromlen = sizeof(from);
-        if (recvfrom(sockfd, (char *)packet, 48, 0, (struct sockaddr *)&from, &fromlen) < 0)
+        // 2. 单个非阻塞 socket 负责所有服务器
+        Net::Socket sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sockfd == Net::INVALID)
         {
-            LOG_WARN("接收 NTP 响应超时: " << server_name);
-            closesocket(sockfd);
+            LOG_WARN("创建 socket 失败");
             return false;
         }
-        const auto t3 = std::chrono::system_clock::now();
-
-        uint32_t recv_sec_be = 0;
-        uint32_t recv_frac_be = 0;
-        uint32_t tx_sec_be = 0;
-        uint32_t tx_frac_be = 0;
-
-        memcpy(&recv_sec_be, packet + 32, 4);
-        memcpy(&recv_frac_be, packet + 36, 4);
-        memcpy(&tx_sec_be, packet + 40, 4);
-        memcpy(&tx_frac_be, packet + 44, 4);
 
-        const auto t1 = NtpTimestampToTimePoint(recv_sec_be, recv_frac_be);
-        const auto t2 = NtpTimestampToTimePoint(tx_sec_be, tx_frac_be);
-
-        const auto offset = ((t1 - t0) + (t2 - t3)) / 2;
-        const auto delay = (t3 - t0) - (t2 - t1);
-
-        offset_ms = (double)std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(offset).count();
-        delay_ms = (double)std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delay).count();
-
-        closesocket(sockfd);
-
-        if (std::isfinite(offset_ms) && std::isfinite(delay_ms) && delay_ms >= 0.0)
+        if (!Net::SetNonBlocking(sockfd))
         {
-            LOG_DEBUG("NTP 同步成功: " << server_name << ", offset=" << offset_ms << "ms, delay=" << delay_ms << "ms");
-            return true;
+            LOG_WARN("设置非阻塞 socket 失败");
+            Net::Close(sockfd);
+            return false;
         }
-        else
+        if (follower)
         {
-            LOG_WARN("NTP 响应无效: " << server_name);
-            return false;
+            Net::EnableBroadcast(sockfd);
         }
-    }
-
-    bool NtpClient::Sync(long &offset_sec)
-    {
-        LOG_DEBUG("[NtpClient] 开始同步");
 
-        offset_sec = 0;
-
-        WSADATA wsaData;
-        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        // 3. 按轮次发送，poll 等待回复，直到全部回复或窗口超时
+        struct Pending
         {
-            LOG_ERROR("WSAStartup 失败");
-            return false;
-        }
+            size_t target;
+            std::chrono::system_clock::time_point t0;
+        };
+        std::unordered_map<unsigned long long, Pending> pending;
 
-        const char *ntp_servers[] = {
-            "ntp.aliyun.com",
-            "ntp.tencent.com",
-            "cn.pool.ntp.org",
-            "pool.ntp.org"};
+        const int rounds = fast_mode ? FAST_ROUNDS : NORMAL_ROUNDS;
+        const auto reply_timeout = std::chrono::milliseconds(fast_mode ? FAST_TIMEOUT_MS : NORMAL_TIMEOUT_MS);
+        int round = 0;
+        uint16_t seq = 0;
+        auto next_send = std::chrono::steady_clock::now();
+        auto deadline = next_send + reply_timeout;
 
-        struct Sample
+        while (!s_auto_sync_stop.load())
         {
-            double offset_ms;
-            double delay_ms;
-        };
+            auto now = std::chrono::steady_clock::now();
+            if (round < rounds && now >= next_send)
+            {
+                for (size_t i = 0; i < targets.size(); ++i)
+                {
+                    unsigned char packet[48] = {0};
+                    packet[0] = 0x1B;
+
+                    const auto t0 = std::chrono::system_clock::now();
+                    uint32_t tx_sec_be = 0;
+                    uint32_t tx_frac_be = 0;
+                    TimePointToNtpTimestamp(t0, tx_sec_be, tx_frac_be);
+                    // fraction 低 16 位替换为序号，保证同一窗口内每个请求的 transmit 时间戳唯一，
+                    // 服务器会原样回填到 originate 字段
+                    tx_frac_be = htonl((ntohl(tx_frac_be) & 0xFFFF0000u) | seq++);
+                    memcpy(packet + 40, &tx_sec_be, 4);
+                    memcpy(packet + 44, &tx_frac_be, 4);
+
+                    if (sendto(sockfd, (char *)packet, 48, 0, (struct sockaddr *)&targets[i].addr, sizeof(targets[i].addr)) < 0)
+                    {
+                        LOG_WARN("发送 NTP 请求失败: " << targets[i].name);
+                        continue;
+                    }
 
-        // 1. 收集所有服务器的样本
-        std::vector<Sample> all_samples;
-        double min_delay = 1e9;
+                    unsigned long long key = 0;
+                    memcpy(&key, packet + 40, 8);
+                    pending[key] = {i, t0};
+                }
+                round++;
+                now = std::chrono::steady_clock::now();
+                next_send = now + std::chrono::milliseconds(ROUND_INTERVAL_MS);
+                deadline = now + reply_timeout;
+            }
+
+            if (round >= rounds && pending.empty())
+            {
+                break; // 所有请求均已回复
+            }
+            if (fast_mode && samples.size() >= FAST_TARGET_SAMPLES)
+            {
+                break;
+            }
+            if (now >= deadline)
+            {
+                break;
+            }
 
-        // 快速启动策略：如果未同步，使用快速模式
-        bool fast_mode = !s_synced.load();
-        // 极速模式：每个服务器最多2个样本，总共只要3个样本（强制跨服务器校验），超时仅200ms
-        int max_samples_per_server = fast_mode ? 2 : 8;
-        int target_total_samples = fast_mode ? 3 : 1000;
+            const auto wake = (round < rounds) ? std::min(next_send, deadline) : deadline;
+            const int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1;
 
-        for (const char *server_name : ntp_servers)
-        {
-            if (s_auto_sync_stop.load())
+            Net::PollFd pfd = {};
+            pfd.fd = sockfd;
+            pfd.events = Net::POLL_READ;
+            const int ready = Net::Poll(&pfd, 1, wait_ms);
+            if (ready < 0)
             {
-                WSACleanup();
-                return false;
+                LOG_WARN("等待套接字失败，错误码: " << Net::LastError());
+                break;
+            }
+            if (ready == 0)
+            {
+                continue;
             }
 
-            // 每个服务器多采几次，增加样本量
-            for (int i = 0; i < max_samples_per_server; ++i)
+            // 读空接收队列
+            while (true)
             {
-                if (s_auto_sync_stop.load())
+                unsigned char packet[48] = {0};
+                struct sockaddr_in from;
+                socklen_t fromlen = sizeof(from);
+                const int received = recvfrom(sockfd, (char *)packet, 48, 0, (struct sockaddr *)&from, &fromlen);
+                if (received < 0)
                 {
-                    WSACleanup();
-                    return false;
+                    break; // EWOULDBLOCK：队列已空
+                }
+                const auto t3 = std::chrono::system_clock::now();
+                if (received < 48)
+                {
+                    continue;
+                }
+
+                // originate 字段是服务器回填的我方 transmit 时间戳，用于匹配请求
+                unsigned long long key = 0;
+                memcpy(&key, packet + 24, 8);
+                const auto it = pending.find(key);
+                if (it == pending.end())
+                {
+                    continue; // 过期或伪造的回复
+                }
+                // 回复必须来自请求发往的服务器；广播请求的应答者地址事先未知，只核对端口
+                const Target &target = targets[it->second.target];
+                const bool broadcast_target = target.addr.sin_addr.s_addr == htonl(INADDR_BROADCAST);
+                if (from.sin_port != target.addr.sin_port ||
+                    (!broadcast_target && from.sin_addr.s_addr != target.addr.sin_addr.s_addr))
+                {
+                    LOG_DEBUG("[NtpClient] 丢弃非目标服务器的回复: " << target.name);
+                    continue; // 保留请求，继续等待真正的回复
+                }
+                const Pending request = it->second;
+                pending.erase(it);
+
+                const int leap = packet[0] >> 6;
+                const int mode = packet[0] & 0x07;
+                const int stratum = packet[1];
+                // LI=3 或 stratum>=16 表示服务器自身未同步（如尚未对上公网的局域网主机），stratum=0 为 KoD
+                if (mode != 4 || leap == 3 || stratum == 0 || stratum >= 16)
+                {
+                    LOG_WARN("NTP 响应无效: " << target.name << " (mode=" << mode << ", LI=" << leap
+                             << ", stratum=" << stratum << ")");
+                    continue;
                 }
-                double off = 0.0;
-                double del = 0.0;
 
-                // 快速模式下超时时间极短，优先保证响应速度
-                int timeout = fast_mode ? 200 : 1000;
+                uint32_t recv_sec_be = 0;
+                uint32_t recv_frac_be = 0;
+                uint32_t tx_sec_be = 0;
+                uint32_t tx_frac_be = 0;
+
+                memcpy(&recv_sec_be, packet + 32, 4);
+                memcpy(&recv_frac_be, packet + 36, 4);
+                memcpy(&tx_sec_be, packet + 40, 4);
+                memcpy(&tx_frac_be, packet + 44, 4);
+
+                const auto t1 = NtpTimestampToTimePoint(recv_sec_be, recv_frac_be);
+                const auto t2 = NtpTimestampToTimePoint(tx_sec_be, tx_frac_be);
 
-                if (SyncOnceMs(server_name, timeout, off, del))
+                const auto offset = ((t1 - request.t0) + (t2 - t3)) / 2;
+                const auto delay = (t3 - request.t0) - (t2 - t1);
+
+                const double offset_ms = (double)std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(offset).count();
+                const double delay_ms = (double)std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delay).count();
+
+                if (std::isfinite(offset_ms) && std::isfinite(delay_ms) && delay_ms > 0.0)
                 {
-                    if (del > 0.0)
-                    {
-                        all_samples.push_back({off, del});
-                        if (del < min_delay)
-                        {
-                            min_delay = del;
-                        }
-                    }
+                    LOG_DEBUG("NTP 样本: " << target.name << ", offset=" << offset_ms << "ms, delay=" << delay_ms << "ms");
+                    samples.push_back({offset_ms, delay_ms, request.target});
+                }
+                else
+                {
+                    LOG_WARN("NTP 响应无效: " << target.name);
                 }
             }
+        }
+
+        Net::Close(sockfd);
+
+        if (!pending.empty())
+        {
+            LOG_DEBUG("[NtpClient] " << pending.size() << " 个请求未在窗口内回复");
+        }
+        return !samples.empty();
+    }
+
+    std::vector<bool> NtpClient::SelectTruechimers(const std::vector<Sample> &samples)
+    {
+        // 每个服务器取 delay 最小的样本，真实偏差必然落在 [offset - delay/2, offset + delay/2] 内
+        size_t server_count = 0;
+        for (const auto &s : samples)
+        {
+            server_count = std::max(server_count, s.server + 1);
+        }
+        std::vector<bool> truechimers(server_count, false);
+        std::vector<const Sample *> best(server_count, nullptr);
+        for (const auto &s : samples)
+        {
+            if (!best[s.server] || s.delay_ms < best[s.server]->delay_ms)
+            {
+                best[s.server] = &s;
+            }
+        }
 
-            // 如果已经收集到足够样本，提前结束（仅限快速模式）
-            if (fast_mode && all_samples.size() >= target_total_samples)
+        std::vector<std::pair<double, double>> intervals;
+        std::vector<size_t> servers;
+        for (size_t i = 0; i < server_count; ++i)
+        {
+            if (best[i])
             {
-                break;
+                intervals.push_back({best[i]->offset_ms - best[i]->delay_ms / 2.0, best[i]->offset_ms + best[i]->delay_ms / 2.0});
+                servers.push_back(i);
             }
         }
 
-        if (all_samples.empty())
+        double lo = 0.0;
+        double hi = 0.0;
+        const int agreed = Marzullo(intervals, lo, hi);
+        const bool has_majority = agreed * 2 > (int)intervals.size();
+        for (size_t i = 0; i < intervals.size(); ++i)
         {
-            LOG_WARN("NTP 同步失败: 无有效样本");
-            WSACleanup();
-            return false;
+            // 没有多数一致时无法判断谁出错，全部保留
+            const bool overlaps = intervals[i].first <= hi && intervals[i].second >= lo;
+            truechimers[servers[i]] = !has_majority || overlaps;
+            if (has_majority && !overlaps)
+            {
+                LOG_WARN("NTP 服务器与多数服务器不一致，已剔除: 下标 " << servers[i]
+                         << ", offset=" << best[servers[i]]->offset_ms << "ms");
+            }
         }
+        return truechimers;
+    }
 
-        // 2. 过滤：只保留 delay 较小的样本 (比如 min_delay * 1.5 或 min_delay + 30ms)
-        // 这里的策略是：保留 delay 最小的前 50% 样本，或者绝对 delay 小于一定阈值的样本
+    void NtpClient::CombineSamples(const std::vector<Sample> &samples, const std::vector<bool> &truechimers,
+                                   double &offset_ms, double &delay_ms)
+    {
+        // 过滤：只保留 delay 较小的样本
         // 考虑到网络抖动，我们使用 min_delay 作为基准
+        double min_delay = 1e9;
+        for (const auto &s : samples)
+        {
+            if (truechimers[s.server])
+            {
+                min_delay = std::min(min_delay, s.delay_ms);
+            }
+        }
+
         double delay_threshold = min_delay * 1.5;
         if (delay_threshold < min_delay + 10.0)
             delay_threshold = min_delay + 10.0; // 至少允许 10ms 浮动
 
         std::vector<Sample> good_samples;
-        for (const auto &s : all_samples)
+        for (const auto &s : samples)
         {
-            if (s.delay_ms <= delay_threshold)
+            if (truechimers[s.server] && s.delay_ms <= delay_threshold)
             {
                 good_samples.push_back(s);
             }
         }
 
-        if (good_samples.empty())
-        {
-            // 如果没有样本符合要求（理论上 min_delay 那个肯定符合），回退到使用所有样本
-            good_samples = all_samples;
-        }
-
-        // 3. 加权平均：Weight = 1 / (Delay^2)
+        // 加权平均：Weight = 1 / (Delay^2)
         // Delay 越小，权重越大
         double total_weight = 0.0;
         double weighted_offset_sum = 0.0;
@@ -260,110 +498,194 @@ namespace Util
             weighted_delay_sum += s.delay_ms * weight;
         }
 
-        double final_offset_ms = weighted_offset_sum / total_weight;
-        double final_delay_ms = weighted_delay_sum / total_weight;
+        offset_ms = weighted_offset_sum / total_weight;
+        delay_ms = weighted_delay_sum / total_weight;
+    }
 
-        // 4. 更新逻辑
-        const auto steady_now = std::chrono::steady_clock::now();
-        const auto local_now = std::chrono::system_clock::now();
-        const auto now_est = local_now + std::chrono::duration_cast<std::chrono::system_clock::duration>(
-                                             std::chrono::duration<double, std::milli>(final_offset_ms));
+    void NtpClient::ClockFilter::Reset(double variance_ms2)
+    {
+        phase_ms = 0.0;
+        freq_ms_per_s = 0.0;
+        p00 = variance_ms2;
+        p01 = 0.0;
+        p11 = INITIAL_FREQ_VARIANCE;
+        rejected = 0;
+        initialized = true;
+    }
+
+    void NtpClient::ClockFilter::Predict(double dt_s)
+    {
+        if (dt_s <= 0.0)
+            return;
 
-        const auto current_now = GetNow();
-        const auto error = now_est - current_now;
-        const auto abs_err_ms = std::llabs(DurationToMs(error));
+        // x = F x，F = [[1, dt], [0, 1]]
+        phase_ms += freq_ms_per_s * dt_s;
 
-        int current_count = s_sync_count.load();
+        // P = F P F^T + Q（相位与频率均为随机游走）
+        p00 += dt_s * (2.0 * p01 + dt_s * p11) + PHASE_NOISE_MS2_PER_S * dt_s;
+        p01 += dt_s * p11;
+        p11 += FREQ_NOISE_PER_S * dt_s;
+    }
 
-        // 计算并更新时钟漂移 (Skew) - 优化版：使用锚点 (Anchor Point) 机制
-        // 必须在更新 s_base_ntp 之前进行
+    bool NtpClient::ClockFilter::Update(double measured_ms, double variance_ms2)
+    {
+        // 观测矩阵 H = [1, 0]
+        const double innovation = measured_ms - phase_ms;
+        const double s = p00 + variance_ms2;
+        if (innovation * innovation > INNOVATION_GATE * INNOVATION_GATE * s)
         {
-            std::lock_guard<std::mutex> lock(s_mutex);
+            return false;
+        }
 
-            // 初始化锚点（如果是第一次同步或重置）
-            // 策略：在初始化阶段（前5次同步）持续更新锚点，直到进入稳定阶段才固定下来
-            static bool anchor_initialized = false;
-            if (!s_synced.load() || !anchor_initialized || abs_err_ms > 5000 || current_count < 5)
-            {
-                s_anchor_ntp = now_est;
-                s_anchor_steady = steady_now;
-                anchor_initialized = true;
-                s_skew = 1.0; // 重置 Skew
-            }
-            else
-            {
-                auto steady_delta = steady_now - s_anchor_steady;
-                double steady_delta_sec = std::chrono::duration<double>(steady_delta).count();
+        const double k0 = p00 / s;
+        const double k1 = p01 / s;
+        phase_ms += k0 * innovation;
+        freq_ms_per_s += k1 * innovation;
 
-                // 只有当间隔足够长 (>60s) 时才开始更新漂移
-                // 间隔越长，网络抖动 (Jitter) 对斜率计算的影响越小
-                if (steady_delta_sec > 60.0)
-                {
-                    auto real_delta = now_est - s_anchor_ntp;
-                    double real_delta_sec = std::chrono::duration<double>(real_delta).count();
+        // 频偏不应超过 +/- 1000ppm (0.1%)
+        freq_ms_per_s = std::max(-MAX_FREQ_MS_PER_S, std::min(MAX_FREQ_MS_PER_S, freq_ms_per_s));
 
-                    double measured_skew = real_delta_sec / steady_delta_sec;
+        // P = (I - K H) P
+        const double new_p00 = (1.0 - k0) * p00;
+        const double new_p01 = (1.0 - k0) * p01;
+        const double new_p11 = p11 - k1 * p01;
+        p00 = new_p00;
+        p01 = new_p01;
+        p11 = new_p11;
 
-                    // 简单的异常过滤：漂移不应超过 +/- 1000ppm (0.1%)
-                    if (std::abs(measured_skew - 1.0) < 0.001)
-                    {
-                        // 使用 EWMA 平滑更新 Skew
-                        // 由于使用了长时段锚点，测量值本身已经很稳定，可以使用较大的 alpha 加快收敛
-                        double skew_alpha = 0.3;
-                        s_skew = s_skew * (1.0 - skew_alpha) + measured_skew * skew_alpha;
-                    }
-                }
-            }
+        rejected = 0;
+        return true;
+    }
+
+    NtpClient::ClockFilter::StepResult NtpClient::ClockFilter::Step(std::chrono::steady_clock::time_point now,
+                                                                    double measured_ms, double variance_ms2,
+                                                                    double &innovation_ms, double &innovation_sigma_ms)
+    {
+        Predict(std::chrono::duration<double>(now - last_update).count());
+        // 协方差已推进到 now：样本被拒绝时也要记下，否则下次会把这段时间重复预测一遍
+        last_update = now;
+
+        innovation_ms = measured_ms - phase_ms;
+        innovation_sigma_ms = std::sqrt(p00 + variance_ms2);
+        if (std::abs(innovation_ms) > HARD_STEP_MS)
+        {
+            return StepResult::HardStep;
         }
+        if (!Update(measured_ms, variance_ms2))
+        {
+            return (++rejected < MAX_CONSECUTIVE_REJECTS) ? StepResult::Rejected : StepResult::RejectLimit;
+        }
+        return StepResult::Accepted;
+    }
 
-        const auto count = s_sync_count.fetch_add(1) + 1;
-        // abs_err_ms defined above
+    bool NtpClient::Sync(long &offset_sec)
+    {
+        LOG_DEBUG("[NtpClient] 开始同步");
 
-        std::chrono::system_clock::time_point new_base_ntp;
-        std::chrono::steady_clock::time_point new_base_steady = steady_now;
+        offset_sec = 0;
 
-        // 平滑更新策略：
-        // 如果是初次同步或误差巨大 (>5s)，直接硬更新
-        // 否则，应用 EWMA 平滑 (alpha = 0.2)，逐步逼近真实时间
-        if (!s_synced.load() || abs_err_ms > 5000)
+        if (!Net::Startup())
         {
-            new_base_ntp = now_est;
+            LOG_ERROR("套接字初始化失败");
+            return false;
         }
-        else
-        {
-            // 限制最大单次调整幅度，防止时间跳变
-            // 计算目标调整量
-            double adjust_ms = (double)std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(error).count();
 
-            // EWMA 因子：越小越平滑，但也越慢
-            double alpha = 0.2;
-            double smooth_adjust_ms = adjust_ms * alpha;
+        // 1. 并发收集所有服务器的样本
+        // 快速启动策略：如果未同步，使用快速模式（更少轮次、更短窗口）
+        const bool fast_mode = !s_synced.load();
+        std::vector<Sample> all_samples;
+        CollectSamples(fast_mode, all_samples);
+
+        Net::Cleanup();
 
-            // 再次限制最大步长 (例如每次最多修 5ms)
-            if (smooth_adjust_ms > 5.0)
-                smooth_adjust_ms = 5.0;
-            if (smooth_adjust_ms < -5.0)
-                smooth_adjust_ms = -5.0;
+        if (s_auto_sync_stop.load())
+        {
+            return false;
+        }
 
-            auto adjust = std::chrono::duration_cast<std::chrono::system_clock::duration>(
-                std::chrono::duration<double, std::milli>(smooth_adjust_ms));
-            new_base_ntp = current_now + adjust;
+        if (all_samples.empty())
+        {
+            LOG_WARN("NTP 同步失败: 无有效样本");
+            return false;
         }
 
+        // 2. 服务器间交叉校验：剔除与多数服务器不一致的 falseticker
+        const std::vector<bool> truechimers = SelectTruechimers(all_samples);
+
+        // 3-4. 过滤高时延样本后加权平均
+        double final_offset_ms = 0.0;
+        double final_delay_ms = 0.0;
+        CombineSamples(all_samples, truechimers, final_offset_ms, final_delay_ms);
+
+        // 5. 时钟滤波：以锚点为参考，测量值为 NTP 时间相对稳定时钟的相位偏差
+        const auto steady_now = std::chrono::steady_clock::now();
+        const auto local_now = std::chrono::system_clock::now();
+        const auto now_est = local_now + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                             std::chrono::duration<double, std::milli>(final_offset_ms));
+
+        // 往返时延内真实偏差近似均匀分布于 ±delay/2
+        const double variance_ms2 = final_delay_ms * final_delay_ms / 12.0 + MIN_MEASUREMENT_VARIANCE_MS2;
+
         {
             std::lock_guard<std::mutex> lock(s_mutex);
-            s_base_ntp = new_base_ntp;
-            s_base_steady = new_base_steady;
+
+            bool reset = !s_synced.load() || !s_filter.initialized;
+            double measured_ms = 0.0;
+            if (!reset)
+            {
+                measured_ms = std::chrono::duration<double, std::milli>(now_est - s_anchor_ntp).count() -
+                              std::chrono::duration<double, std::milli>(steady_now - s_anchor_steady).count();
+                double innovation_ms = 0.0;
+                double innovation_sigma_ms = 0.0;
+                switch (s_filter.Step(steady_now, measured_ms, variance_ms2, innovation_ms, innovation_sigma_ms))
+                {
+                case ClockFilter::StepResult::Accepted:
+                    s_clock_stable.store(std::abs(innovation_ms) <= STABLE_INNOVATION_SIGMAS * innovation_sigma_ms &&
+                                         std::sqrt(s_filter.p00) < STABLE_PHASE_SIGMA_MS);
+                    break;
+                case ClockFilter::StepResult::Rejected:
+                    s_clock_stable.store(false);
+                    LOG_WARN("NTP 样本被滤波器拒绝: innovation=" << innovation_ms << "ms, delay=" << final_delay_ms << "ms");
+                    return false;
+                case ClockFilter::StepResult::HardStep:
+                    LOG_WARN("NTP 偏差过大 (" << innovation_ms << "ms)，重置时钟滤波器");
+                    reset = true;
+                    break;
+                case ClockFilter::StepResult::RejectLimit:
+                    LOG_WARN("NTP 样本连续被拒绝，重置时钟滤波器");
+                    reset = true;
+                    break;
+                }
+            }
+
+            if (reset)
+            {
+                s_clock_stable.store(false);
+                s_anchor_ntp = now_est;
+                s_anchor_steady = steady_now;
+                s_filter.Reset(variance_ms2);
+            }
+            s_filter.last_update = steady_now;
+
+            // 发布给 GetNow：base 为当前时刻的滤波估计，skew 由频率偏差换算
+            PublishClock(s_anchor_ntp +
+                             std::chrono::duration_cast<std::chrono::system_clock::duration>(steady_now - s_anchor_steady) +
+                             std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                 std::chrono::duration<double, std::milli>(s_filter.phase_ms)),
+                         steady_now,
+                         1.0 + s_filter.freq_ms_per_s / 1000.0);
         }
+
+        s_sync_count.fetch_add(1);
         s_synced.store(true);
 
         s_last_delay_ms.store((long long)std::llround(final_delay_ms));
         s_last_offset_ms.store((long long)std::llround(final_offset_ms));
         offset_sec = (long)std::llround(final_offset_ms / 1000.0);
 
-        LOG_INFO("NTP 同步成功: offset=" << final_offset_ms << "ms, delay=" << final_delay_ms << "ms, skew=" << s_skew);
+        LOG_INFO("NTP 同步成功: offset=" << final_offset_ms << "ms, delay=" << final_delay_ms
+                 << "ms, 相位标准差=" << std::sqrt(s_filter.p00) << "ms, 频偏=" << s_filter.freq_ms_per_s * 1000.0 << "ppm");
 
-        WSACleanup();
         return true;
     }
 
@@ -374,15 +696,28 @@ namespace Util
             return std::chrono::system_clock::now();
         }
         auto now_steady = std::chrono::steady_clock::now();
-        std::chrono::system_clock::time_point base_ntp;
-        std::chrono::steady_clock::time_point base_steady;
+        long long base_ntp_ticks = 0;
+        long long base_steady_ticks = 0;
         double skew = 1.0;
+        // 序列锁读端：写入期间（奇数）或前后序号不一致时重读，不占用 s_mutex
+        while (true)
         {
-            std::lock_guard<std::mutex> lock(s_mutex);
-            base_ntp = s_base_ntp;
-            base_steady = s_base_steady;
-            skew = s_skew;
+            const unsigned int seq = s_clock_seq.load(std::memory_order_acquire);
+            if (seq & 1u)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            base_ntp_ticks = s_base_ntp.load(std::memory_order_relaxed);
+            base_steady_ticks = s_base_steady.load(std::memory_order_relaxed);
+            skew = s_skew.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s_clock_seq.load(std::memory_order_relaxed) == seq)
+                break;
         }
+        const auto base_ntp = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(base_ntp_ticks));
+        const auto base_steady = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(base_steady_ticks));
+
         const auto diff = now_steady - base_steady;
         // Apply skew correction
         // real_diff = steady_diff * skew
@@ -392,6 +727,440 @@ namespace Util
         return base_ntp + std::chrono::microseconds(real_diff_us);
     }
 
+    void NtpClient::PublishClock(std::chrono::system_clock::time_point base_ntp,
+                                 std::chrono::steady_clock::time_point base_steady, double skew)
+    {
+        // 序列锁写端（单写者）：先置奇数序号，写入字段后再置偶数序号
+        const unsigned int seq = s_clock_seq.load(std::memory_order_relaxed);
+        s_clock_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s_base_ntp.store((long long)base_ntp.time_since_epoch().count(), std::memory_order_relaxed);
+        s_base_steady.store((long long)base_steady.time_since_epoch().count(), std::memory_order_relaxed);
+        s_skew.store(skew, std::memory_order_relaxed);
+        s_clock_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    void NtpClient::LoadDriftProfile(const DriftProfile &profile)
+    {
+        const auto local_now = std::chrono::system_clock::now();
+        const long long age_s = (long long)std::chrono::system_clock::to_time_t(local_now) - profile.saved_at;
+        if (profile.saved_at <= 0 || age_s < 0 || age_s > PROFILE_MAX_AGE_S)
+        {
+            LOG_INFO("时钟漂移档案不存在或已过期，忽略");
+            return;
+        }
+        const double freq_ms_per_s = profile.freq_ppm / 1000.0;
+        if (!std::isfinite(freq_ms_per_s) || !std::isfinite(profile.offset_ms) ||
+            std::abs(freq_ms_per_s) > MAX_FREQ_MS_PER_S || std::abs(profile.offset_ms) > HARD_STEP_MS)
+        {
+            LOG_WARN("时钟漂移档案数据异常，忽略");
+            return;
+        }
+
+        const auto steady_now = std::chrono::steady_clock::now();
+        const auto now_est = local_now + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                             std::chrono::duration<double, std::milli>(profile.offset_ms));
+
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            if (s_synced.load())
+            {
+                return;
+            }
+
+            // 偏差的不确定度随档案年龄增长，首次真实同步会据此快速修正
+            const double offset_sigma_ms = std::max(PROFILE_OFFSET_SIGMA_MS, profile.delay_ms / 2.0) +
+                                           PROFILE_OFFSET_SIGMA_MS_PER_HOUR * (double)age_s / 3600.0;
+            s_anchor_ntp = now_est;
+            s_anchor_steady = steady_now;
+            s_filter.Reset(offset_sigma_ms * offset_sigma_ms);
+            s_filter.freq_ms_per_s = freq_ms_per_s;
+            s_filter.p11 = std::min(INITIAL_FREQ_VARIANCE, profile.freq_var_ppm2 / 1e6 + FREQ_NOISE_PER_S * (double)age_s);
+            s_filter.last_update = steady_now;
+
+            PublishClock(now_est, steady_now, 1.0 + freq_ms_per_s / 1000.0);
+        }
+
+        s_profile_sync_count = profile.sync_count;
+        s_profile_loaded.store(true);
+        s_synced.store(true);
+
+        LOG_INFO("已恢复时钟漂移档案: 频偏=" << profile.freq_ppm << "ppm, offset=" << profile.offset_ms
+                 << "ms, 档案年龄=" << age_s << "s");
+    }
+
+    bool NtpClient::GetDriftProfile(DriftProfile &profile)
+    {
+        if (!s_synced.load() || s_sync_count.load() < PROFILE_MIN_SYNCS)
+        {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            profile.freq_ppm = s_filter.freq_ms_per_s * 1000.0;
+            profile.freq_var_ppm2 = s_filter.p11 * 1e6;
+        }
+
+        const auto local_now = std::chrono::system_clock::now();
+        profile.offset_ms = std::chrono::duration<double, std::milli>(GetNow() - local_now).count();
+        profile.delay_ms = (double)s_last_delay_ms.load();
+        profile.sync_count = s_profile_sync_count + s_sync_count.load();
+        profile.saved_at = (long long)std::chrono::system_clock::to_time_t(local_now);
+        return true;
+    }
+
+    void NtpClient::SetServers(const std::vector<std::string> &servers, int port)
+    {
+        std::lock_guard<std::mutex> lock(s_config_mutex);
+        if (!servers.empty())
+        {
+            s_servers = servers;
+        }
+        s_port = (port > 0 && port <= 65535) ? port : 123;
+        LOG_INFO("NTP 服务器: " << s_servers.size() << " 个, 端口 " << s_port);
+    }
+
+    void NtpClient::SetPeerMode(PeerMode mode, const std::string &leader_host, int port)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_config_mutex);
+            s_peer_leader = leader_host;
+            s_peer_port = (port > 0 && port <= 65535) ? port : 47123;
+        }
+        s_peer_mode.store(mode);
+        if (mode == PeerMode::Leader)
+        {
+            LOG_INFO("局域网对时: 主机模式, 端口 " << s_peer_port);
+        }
+        else if (mode == PeerMode::Follower)
+        {
+            LOG_INFO("局域网对时: 从机模式, 主机 " << (leader_host.empty() ? std::string("(广播)") : leader_host)
+                     << ", 端口 " << s_peer_port);
+        }
+    }
+
+    PeerMode NtpClient::GetPeerMode()
+    {
+        return s_peer_mode.load();
+    }
+
+    void NtpClient::SetGroupStartHandler(std::function<void(const GroupStart &)> handler)
+    {
+        std::lock_guard<std::mutex> lock(s_peer_mutex);
+        s_group_start_handler = std::move(handler);
+    }
+
+    int NtpClient::BroadcastGroupStart(const GroupStart &msg)
+    {
+        if (s_peer_mode.load() != PeerMode::Leader)
+        {
+            return 0;
+        }
+
+        // 消息格式：GOMIDI_START <开始时间（Unix 微秒）> <歌曲文件名>
+        const long long start_us = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                                       msg.start_time.time_since_epoch()).count();
+        const std::string text = std::string(PEER_START) + std::to_string(start_us) + " " + msg.song;
+        if (text.size() > PEER_MAX_PACKET)
+        {
+            LOG_WARN("集体开始消息过长，未发送");
+            return 0;
+        }
+
+        // 从对时端口发出（从机只接受主机地址与端口发来的集体开始消息）；
+        // 持有 s_peer_mutex 期间对时线程不会关闭该 socket
+        int reached = 0;
+        {
+            std::lock_guard<std::mutex> lock(s_peer_mutex);
+            if (s_peer_leader_socket == Net::INVALID)
+            {
+                LOG_WARN("集体开始: 局域网对时主机未运行");
+                return 0;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            for (const auto &sub : s_peer_subscribers)
+            {
+                if (now - sub.last_seen > std::chrono::milliseconds(PEER_SUBSCRIBER_TTL_MS))
+                {
+                    continue;
+                }
+                bool sent = false;
+                for (int i = 0; i < PEER_START_REPEAT; ++i)
+                {
+                    if (sendto(s_peer_leader_socket, text.data(), (int)text.size(), 0,
+                               (const struct sockaddr *)&sub.addr, sizeof(sub.addr)) >= 0)
+                    {
+                        sent = true;
+                    }
+                }
+                if (sent)
+                {
+                    reached++;
+                }
+            }
+        }
+        if (reached == 0)
+        {
+            LOG_WARN("集体开始: 没有在线的从机");
+            return 0;
+        }
+
+        LOG_INFO("集体开始消息已发送: " << msg.song << ", 从机数=" << reached);
+        return reached;
+    }
+
+    void NtpClient::PeerLeaderThread()
+    {
+        if (!Net::Startup())
+        {
+            LOG_ERROR("套接字初始化失败");
+            return;
+        }
+
+        int port = 47123;
+        {
+            std::lock_guard<std::mutex> lock(s_config_mutex);
+            port = s_peer_port;
+        }
+
+        Net::Socket sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons((uint16_t)port);
+        if (sockfd == Net::INVALID || bind(sockfd, (struct sockaddr *)&local, sizeof(local)) != 0)
+        {
+            LOG_ERROR("局域网对时主机启动失败: 无法绑定端口 " << port);
+            if (sockfd != Net::INVALID)
+                Net::Close(sockfd);
+            Net::Cleanup();
+            return;
+        }
+        LOG_INFO("局域网对时主机已启动，端口 " << port);
+        {
+            std::lock_guard<std::mutex> lock(s_peer_mutex);
+            s_peer_leader_socket = sockfd;
+        }
+
+        while (!s_auto_sync_stop.load())
+        {
+            Net::PollFd pfd = {};
+            pfd.fd = sockfd;
+            pfd.events = Net::POLL_READ;
+            const int ready = Net::Poll(&pfd, 1, PEER_POLL_MS);
+            if (ready < 0)
+            {
+                LOG_WARN("等待套接字失败，错误码: " << Net::LastError());
+                break;
+            }
+            if (ready == 0)
+            {
+                continue;
+            }
+
+            unsigned char packet[PEER_MAX_PACKET];
+            struct sockaddr_in from;
+            socklen_t fromlen = sizeof(from);
+            const int received = recvfrom(sockfd, (char *)packet, sizeof(packet), 0, (struct sockaddr *)&from, &fromlen);
+            // 接收时间戳尽量贴近收包时刻，使用本机（已对公网 NTP 校准的）时间
+            const auto t_rx = GetNow();
+            if (received < 0)
+            {
+                continue;
+            }
+
+            if (received >= 48 && (packet[0] & 0x07) == 3)
+            {
+                // NTP 客户端请求：按 RFC 5905 服务器模式应答
+                // 本机尚未对上公网 NTP 时按 RFC 5905 标记为未同步（LI=3, stratum=16），从机不会采用
+                const bool synced = s_synced.load();
+                unsigned char reply[48] = {0};
+                reply[0] = synced ? 0x24 : 0xE4;    // LI=0/3, VN=4, Mode=4 (server)
+                reply[1] = synced ? 2 : 16;         // stratum：本机以公网 NTP 为上游
+                reply[2] = packet[2];
+                reply[3] = 0xEC;    // precision ≈ 2^-20 s
+                memcpy(reply + 12, "PEER", 4);
+                memcpy(reply + 24, packet + 40, 8);  // originate = 请求的 transmit
+
+                uint32_t sec_be = 0;
+                uint32_t frac_be = 0;
+                TimePointToNtpTimestamp(t_rx, sec_be, frac_be);
+                memcpy(reply + 16, &sec_be, 4);     // reference
+                memcpy(reply + 20, &frac_be, 4);
+                memcpy(reply + 32, &sec_be, 4);     // receive
+                memcpy(reply + 36, &frac_be, 4);
+
+                TimePointToNtpTimestamp(GetNow(), sec_be, frac_be);
+                memcpy(reply + 40, &sec_be, 4);     // transmit
+                memcpy(reply + 44, &frac_be, 4);
+                sendto(sockfd, (char *)reply, 48, 0, (struct sockaddr *)&from, fromlen);
+            }
+            else if (received == (int)strlen(PEER_HELLO) && memcmp(packet, PEER_HELLO, received) == 0)
+            {
+                // 从机登记：集体开始消息发往最近登记过的地址
+                std::lock_guard<std::mutex> lock(s_peer_mutex);
+                const auto now = std::chrono::steady_clock::now();
+                auto it = std::find_if(s_peer_subscribers.begin(), s_peer_subscribers.end(), [&](const PeerSubscriber &sub)
+                                       { return sub.addr.sin_addr.s_addr == from.sin_addr.s_addr && sub.addr.sin_port == from.sin_port; });
+                if (it == s_peer_subscribers.end())
+                {
+                    char ip[INET_ADDRSTRLEN] = {0};
+                    inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                    LOG_INFO("局域网从机已连接: " << ip << ":" << ntohs(from.sin_port));
+                    s_peer_subscribers.push_back({from, now});
+                }
+                else
+                {
+                    it->last_seen = now;
+                }
+                s_peer_subscribers.erase(
+                    std::remove_if(s_peer_subscribers.begin(), s_peer_subscribers.end(), [&](const PeerSubscriber &sub)
+                                   { return now - sub.last_seen > std::chrono::milliseconds(PEER_SUBSCRIBER_TTL_MS); }),
+                    s_peer_subscribers.end());
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(s_peer_mutex);
+            s_peer_leader_socket = Net::INVALID;
+        }
+        Net::Close(sockfd);
+        Net::Cleanup();
+    }
+
+    void NtpClient::PeerFollowerThread()
+    {
+        if (!Net::Startup())
+        {
+            LOG_ERROR("套接字初始化失败");
+            return;
+        }
+
+        std::string leader;
+        int port = 47123;
+        {
+            std::lock_guard<std::mutex> lock(s_config_mutex);
+            leader = s_peer_leader.empty() ? std::string("255.255.255.255") : s_peer_leader;
+            port = s_peer_port;
+        }
+
+        // 登记与接收共用一个 socket：主机把集体开始消息发回登记时的源地址
+        Net::Socket sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sockfd == Net::INVALID)
+        {
+            LOG_WARN("创建 socket 失败");
+            Net::Cleanup();
+            return;
+        }
+        Net::EnableBroadcast(sockfd);
+
+        struct sockaddr_in leader_addr;
+        bool resolved = false;
+        auto last_hello = std::chrono::steady_clock::time_point();
+        long long last_start_us = 0;
+        std::string last_song;
+
+        while (!s_auto_sync_stop.load())
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last_hello >= std::chrono::milliseconds(PEER_HELLO_INTERVAL_MS))
+            {
+                last_hello = now;
+                if (!resolved)
+                {
+                    resolved = ResolveIPv4(leader, port, leader_addr);
+                    if (!resolved)
+                        LOG_WARN("解析局域网主机地址失败: " << leader);
+                }
+                if (resolved)
+                {
+                    sendto(sockfd, PEER_HELLO, (int)strlen(PEER_HELLO), 0, (struct sockaddr *)&leader_addr, sizeof(leader_addr));
+                }
+            }
+
+            Net::PollFd pfd = {};
+            pfd.fd = sockfd;
+            pfd.events = Net::POLL_READ;
+            const int ready = resolved ? Net::Poll(&pfd, 1, PEER_POLL_MS) : 0;
+            if (ready < 0)
+            {
+                LOG_WARN("等待套接字失败，错误码: " << Net::LastError());
+                break;
+            }
+            if (ready == 0)
+            {
+                if (!resolved)
+                {
+                    std::unique_lock<std::mutex> lock(s_mutex);
+                    s_cv.wait_for(lock, std::chrono::milliseconds(PEER_POLL_MS), []()
+                                  { return s_auto_sync_stop.load(); });
+                }
+                continue;
+            }
+
+            char packet[PEER_MAX_PACKET + 1];
+            struct sockaddr_in from;
+            socklen_t fromlen = sizeof(from);
+            const int received = recvfrom(sockfd, packet, PEER_MAX_PACKET, 0, (struct sockaddr *)&from, &fromlen);
+            const size_t prefix_len = strlen(PEER_START);
+            if (received <= (int)prefix_len || memcmp(packet, PEER_START, prefix_len) != 0)
+            {
+                continue;
+            }
+            // 只接受主机对时端口发来的消息；广播登记时主机地址事先未知，只核对端口
+            const bool broadcast_leader = leader_addr.sin_addr.s_addr == htonl(INADDR_BROADCAST);
+            if (from.sin_port != leader_addr.sin_port ||
+                (!broadcast_leader && from.sin_addr.s_addr != leader_addr.sin_addr.s_addr))
+            {
+                char ip[INET_ADDRSTRLEN] = {0};
+                inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                LOG_WARN("丢弃非主机发来的集体开始消息: " << ip << ":" << ntohs(from.sin_port));
+                continue;
+            }
+            packet[received] = '\0';
+
+            // 解析：<开始时间（Unix 微秒）> <歌曲文件名>
+            char *cursor = packet + prefix_len;
+            char *end = nullptr;
+            const long long start_us = std::strtoll(cursor, &end, 10);
+            if (end == cursor || *end != ' ' || start_us <= 0)
+            {
+                LOG_WARN("集体开始消息格式错误");
+                continue;
+            }
+            const std::string song(end + 1);
+
+            // 主机重复发送同一消息，只处理一次
+            if (start_us == last_start_us && song == last_song)
+            {
+                continue;
+            }
+            last_start_us = start_us;
+            last_song = song;
+
+            GroupStart msg;
+            msg.song = song;
+            msg.start_time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(start_us)));
+            LOG_INFO("收到集体开始消息: " << song << ", 开始时间=" << start_us << "us");
+
+            std::function<void(const GroupStart &)> handler;
+            {
+                std::lock_guard<std::mutex> lock(s_peer_mutex);
+                handler = s_group_start_handler;
+            }
+            if (handler)
+            {
+                handler(msg);
+            }
+        }
+
+        Net::Close(sockfd);
+        Net::Cleanup();
+    }
+
     bool NtpClient::IsSynced()
     {
         return s_synced;
@@ -410,6 +1179,16 @@ namespace Util
         s_sync_count.store(0); // 重置同步计数，确保每次启动都经历快速初始化阶段
         s_auto_sync_stop.store(false);
         s_auto_thread = std::thread(&NtpClient::AutoSyncThread);
+
+        const PeerMode peer_mode = s_peer_mode.load();
+        if (peer_mode == PeerMode::Leader)
+        {
+            s_peer_thread = std::thread(&NtpClient::PeerLeaderThread);
+        }
+        else if (peer_mode == PeerMode::Follower)
+        {
+            s_peer_thread = std::thread(&NtpClient::PeerFollowerThread);
+        }
     }
 
     void NtpClient::StopAutoSync()
@@ -441,6 +1220,11 @@ namespace Util
                 // 这里我们接受可能的资源泄漏以换取快速关闭
             }
         }
+        // 对时线程每 PEER_POLL_MS 检查一次退出标志
+        if (s_peer_thread.joinable())
+        {
+            s_peer_thread.join();
+        }
         s_auto_sync_running.store(false);
     }
     void NtpClient::ForceShutdown()
@@ -455,20 +1239,40 @@ namespace Util
         // 直接 join，与 PlaybackEngine::shutdown() 同理
         s_auto_thread.join();
     }
+    if (s_peer_thread.joinable())
+    {
+        s_peer_thread.join();
+    }
 
     s_auto_sync_running.store(false);
     s_synced.store(false);
+    s_profile_loaded.store(false);
     }
 
     void NtpClient::AutoSyncThread()
     {
+        int poll_interval_s = MIN_POLL_INTERVAL_S;
         while (!s_auto_sync_stop.load())
         {
             long offset_sec = 0;
-            Sync(offset_sec);
+            const bool ok = Sync(offset_sec);
 
+            // 初始化阶段每秒同步（已恢复漂移档案时跳过）；
+            // 之后时钟稳定则逐次加倍轮询间隔，同步失败或出现异常立即回落
             const int count = s_sync_count.load();
-            const auto interval = (count <= 3 || !s_synced.load()) ? std::chrono::seconds(1) : std::chrono::seconds(10);
+            int interval_s = 1;
+            if (s_synced.load() && (count > 3 || s_profile_loaded.load()))
+            {
+                const int previous = poll_interval_s;
+                if (ok && s_clock_stable.load())
+                    poll_interval_s = std::min(poll_interval_s * 2, MAX_POLL_INTERVAL_S);
+                else
+                    poll_interval_s = MIN_POLL_INTERVAL_S;
+                if (poll_interval_s != previous)
+                    LOG_DEBUG("[NtpClient] 轮询间隔调整为 " << poll_interval_s << "s");
+                interval_s = poll_interval_s;
+            }
+            const auto interval = std::chrono::seconds(interval_s);
 
             std::unique_lock<std::mutex> lock(s_mutex);
             s_cv.wait_for(lock, interval, []()
@@ -1,18 +1,65 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <chrono>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 
 namespace Util {
 
+    /// 本机时钟漂移档案：跨启动保存，启动时直接恢复频偏与偏差估计
+    struct DriftProfile {
+        double freq_ppm = 0.0;          ///< 稳定时钟相对 NTP 的频率偏差
+        double freq_var_ppm2 = 0.0;     ///< 频偏估计方差
+        double offset_ms = 0.0;         ///< NTP 时间 - 系统时间
+        double delay_ms = 0.0;          ///< 最近一次往返时延
+        int sync_count = 0;             ///< 累计成功同步次数
+        long long saved_at = 0;         ///< 保存时间（Unix 秒）
+    };
+
+    /// 局域网对时模式：主机对外提供 NTP 服务，从机以主机为唯一时间源
+    enum class PeerMode {
+        Off,
+        Leader,
+        Follower
+    };
+
+    /// 集体开始消息：由主机发给所有从机，各机按统一时间基准定时开始
+    struct GroupStart {
+        std::string song;   ///< 歌曲文件名（UTF-8）
+        std::chrono::system_clock::time_point start_time;
+    };
+
+    /// 测试钩子：由 tests/ 中的测试程序定义，直接发布时钟参数或调用服务器选择等内部步骤
+    struct NtpClientTestAccess;
+
     class NtpClient {
+        friend struct NtpClientTestAccess;
+
     public:
         // Returns true if sync successful
         static bool Sync(long& offset_sec);
 
+        /// 设置 NTP 服务器列表与端口（需在 StartAutoSync 之前调用；列表为空时保留默认服务器）
+        static void SetServers(const std::vector<std::string>& servers, int port);
+
+        /// 恢复上次保存的漂移档案（需在 StartAutoSync 之前调用），过期档案会被忽略
+        static void LoadDriftProfile(const DriftProfile& profile);
+        /// 导出当前漂移档案；本次运行的同步次数不足时返回 false，避免覆盖旧档案
+        static bool GetDriftProfile(DriftProfile& profile);
+
+        /// 设置局域网对时模式（需在 StartAutoSync 之前调用）
+        /// 从机 leader_host 为空时向广播地址发请求，由任一主机应答
+        static void SetPeerMode(PeerMode mode, const std::string& leader_host, int port);
+        static PeerMode GetPeerMode();
+        /// 集体开始回调，在对时线程中调用
+        static void SetGroupStartHandler(std::function<void(const GroupStart&)> handler);
+        /// 主机向最近活跃的从机发送集体开始消息，返回送达的从机数
+        static int BroadcastGroupStart(const GroupStart& msg);
+
         static void StartAutoSync();
         static void StopAutoSync();
         static void ForceShutdown();  // 强制关闭NTP客户端
@@ -23,18 +70,79 @@ namespace Util {
         // Check if synced
         static bool IsSynced();
 
+        /// 二维状态空间时钟滤波器（卡尔曼）：跟踪相对锚点的相位偏差与频率偏差
+        /// 不涉及网络与全局状态，可离线用合成样本驱动（见 tests/clock_filter_sim_test.cpp）
+        struct ClockFilter {
+            /// 单次测量的处理结果
+            enum class StepResult {
+                Accepted,
+                Rejected,       ///< 新息超出门限，视为离群样本，状态不变
+                HardStep,       ///< 偏差过大（休眠唤醒、系统时间被修改等），需重置
+                RejectLimit     ///< 连续被拒绝，认为时钟发生了跳变，需重置
+            };
+
+            double phase_ms = 0.0;          ///< NTP 时间 - (锚点 + 稳定时钟流逝)
+            double freq_ms_per_s = 0.0;     ///< 频率偏差（1 ms/s = 1000ppm）
+            double p00 = 0.0;               ///< 协方差矩阵
+            double p01 = 0.0;
+            double p11 = 0.0;
+            int rejected = 0;               ///< 连续被门限拒绝的样本数
+            bool initialized = false;
+            std::chrono::steady_clock::time_point last_update;
+
+            void Reset(double variance_ms2);
+            void Predict(double dt_s);
+            bool Update(double measured_ms, double variance_ms2);  ///< 新息超出门限时不更新并返回 false
+            /// 预测到 now 后吸收一次测量；无论结果如何 last_update 都推进到 now
+            /// innovation_ms / innovation_sigma_ms 输出本次新息及其标准差
+            StepResult Step(std::chrono::steady_clock::time_point now, double measured_ms, double variance_ms2,
+                            double& innovation_ms, double& innovation_sigma_ms);
+        };
+
     private:
+        struct Sample {
+            double offset_ms;
+            double delay_ms;
+            size_t server;      ///< 来源服务器下标
+        };
+
         static void AutoSyncThread();
-        static bool SyncOnceMs(const char* server_name, int timeout_ms, double& offset_ms, double& delay_ms);
+        static void PeerLeaderThread();     ///< 应答 NTP 请求并记录从机
+        static void PeerFollowerThread();   ///< 定期向主机登记并接收集体开始消息
+        /// 用单个非阻塞 UDP socket 并发向所有服务器发送请求，按 originate 时间戳匹配回复，
+        /// 在同一时间窗口内收集样本
+        static bool CollectSamples(bool fast_mode, std::vector<Sample>& samples);
+        /// 用 Marzullo 交集算法做服务器间交叉校验，返回每个服务器是否可信（按服务器下标）
+        static std::vector<bool> SelectTruechimers(const std::vector<Sample>& samples);
+        /// 只保留可信服务器中时延接近最小值的样本，按 1/delay² 加权平均得到偏差与时延
+        static void CombineSamples(const std::vector<Sample>& samples, const std::vector<bool>& truechimers,
+                                   double& offset_ms, double& delay_ms);
 
         static std::atomic<bool> s_synced;
-        static std::chrono::system_clock::time_point s_base_ntp;
-        static std::chrono::steady_clock::time_point s_base_steady;
-        static double s_skew; // Clock skew (drift) factor
+        /// GetNow 使用的时钟参数，通过序列锁发布：读者从不阻塞，写者只有 Sync 线程
+        /// s_clock_seq 为奇数表示正在写入，读者读到前后一致的偶数序号才采用
+        static void PublishClock(std::chrono::system_clock::time_point base_ntp,
+                                 std::chrono::steady_clock::time_point base_steady, double skew);
+        static std::atomic<unsigned int> s_clock_seq;
+        static std::atomic<long long> s_base_ntp;       ///< system_clock 计数
+        static std::atomic<long long> s_base_steady;    ///< steady_clock 计数
+        static std::atomic<double> s_skew;              ///< Clock skew (drift) factor
         
-        // Anchor points for long-term skew calculation
+        // Anchor points: 滤波器相位的参考原点（重置时更新）
         static std::chrono::system_clock::time_point s_anchor_ntp;
         static std::chrono::steady_clock::time_point s_anchor_steady;
+        static ClockFilter s_filter;  ///< 受 s_mutex 保护
+
+        static std::vector<std::string> s_servers;
+        static int s_port;
+        static std::atomic<PeerMode> s_peer_mode;
+        static std::string s_peer_leader;
+        static int s_peer_port;
+        static std::mutex s_config_mutex;   ///< 保护 s_servers / s_port / s_peer_leader / s_peer_port
+
+        static std::thread s_peer_thread;
+        static std::function<void(const GroupStart&)> s_group_start_handler;
+        static std::mutex s_peer_mutex;     ///< 保护 s_group_start_handler 与从机列表
 
         static std::mutex s_mutex;
         static std::condition_variable s_cv;
@@ -45,6 +153,9 @@ namespace Util {
         static std::atomic<long long> s_last_delay_ms;
         static std::atomic<long long> s_last_offset_ms;
         static std::atomic<int> s_sync_count;
+        static std::atomic<bool> s_clock_stable;      ///< 最近一次同步新息很小，可放宽轮询间隔
+        static std::atomic<bool> s_profile_loaded;    ///< 已从漂移档案恢复，跳过快速初始化阶段
+        static int s_profile_sync_count;              ///< 档案中的累计同步次数
     };
 
 }
@@ -0,0 +1,100 @@
+#pragma once
+
+// 最小的 UDP 套接字兼容层：Windows 上为 Winsock，其余平台为 BSD socket
+// 只覆盖 NtpClient 与测试用 NTP 应答器用到的调用；地址结构、sendto/recvfrom、
+// htonl 等两边同名的接口直接使用（接收地址长度统一用 socklen_t）
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <cstddef>
+
+namespace Util::Net
+{
+#ifdef _WIN32
+    using Socket = SOCKET;
+    using PollFd = WSAPOLLFD;
+    inline constexpr Socket INVALID = INVALID_SOCKET;
+    inline constexpr short POLL_READ = POLLRDNORM;
+#else
+    using Socket = int;
+    using PollFd = pollfd;
+    inline constexpr Socket INVALID = -1;
+    inline constexpr short POLL_READ = POLLIN;
+#endif
+
+    /// 使用套接字的线程开始前调用（Winsock 按调用次数计数，须与 Cleanup 配对）
+    inline bool Startup()
+    {
+#ifdef _WIN32
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+        return true;
+#endif
+    }
+
+    inline void Cleanup()
+    {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    inline void Close(Socket s)
+    {
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+    }
+
+    inline bool SetNonBlocking(Socket s)
+    {
+#ifdef _WIN32
+        u_long non_blocking = 1;
+        return ioctlsocket(s, FIONBIO, &non_blocking) == 0;
+#else
+        const int flags = fcntl(s, F_GETFL, 0);
+        return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    inline bool EnableBroadcast(Socket s)
+    {
+        const int enable = 1;
+        return setsockopt(s, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char *>(&enable), sizeof(enable)) == 0;
+    }
+
+    /// 等待可读，返回就绪数量；出错返回负数
+    inline int Poll(PollFd *fds, size_t count, int timeout_ms)
+    {
+#ifdef _WIN32
+        return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+#else
+        return poll(fds, static_cast<nfds_t>(count), timeout_ms);
+#endif
+    }
+
+    /// 最近一次套接字调用的错误码（日志用）
+    inline int LastError()
+    {
+#ifdef _WIN32
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+}
@@ -0,0 +1,221 @@
+#include "TextEncoding.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GO_MIDI_TEXT_SSE2 1
+#endif
+
+namespace Util {
+
+    namespace {
+
+        /// 跳过连续的 ASCII 字节，返回第一个 >= 0x80 的位置
+        const unsigned char* SkipAscii(const unsigned char* p, const unsigned char* end) {
+#ifdef GO_MIDI_TEXT_SSE2
+            // 每次检查 32 字节：两个 16 字节块按位或后取最高位掩码
+            while (end - p >= 32) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+                if (_mm_movemask_epi8(_mm_or_si128(a, b)) != 0)
+                    break;
+                p += 32;
+            }
+            while (end - p >= 16) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                if (_mm_movemask_epi8(a) != 0)
+                    break;
+                p += 16;
+            }
+#else
+            // 无 SSE2 时按 8 字节字检查
+            while (end - p >= 8) {
+                uint64_t word;
+                std::memcpy(&word, p, sizeof(word));
+                if (word & 0x8080808080808080ull)
+                    break;
+                p += 8;
+            }
+#endif
+            while (p < end && *p < 0x80)
+                ++p;
+            return p;
+        }
+
+        /// UTF-8 首字节描述：序列长度与第二字节允许范围（其余后续字节为 0x80-0xBF）
+        struct Utf8Lead {
+            unsigned char length;   ///< 0 表示非法首字节
+            unsigned char lo;
+            unsigned char hi;
+        };
+
+        constexpr std::array<Utf8Lead, 256> BuildUtf8LeadTable() {
+            std::array<Utf8Lead, 256> t{};
+            for (int c = 0xC2; c <= 0xDF; ++c) t[c] = {2, 0x80, 0xBF};
+            t[0xE0] = {3, 0xA0, 0xBF};                               // 排除过长编码
+            for (int c = 0xE1; c <= 0xEC; ++c) t[c] = {3, 0x80, 0xBF};
+            t[0xED] = {3, 0x80, 0x9F};                               // 排除代理区 U+D800-DFFF
+            t[0xEE] = {3, 0x80, 0xBF};
+            t[0xEF] = {3, 0x80, 0xBF};
+            t[0xF0] = {4, 0x90, 0xBF};                               // 排除过长编码
+            for (int c = 0xF1; c <= 0xF3; ++c) t[c] = {4, 0x80, 0xBF};
+            t[0xF4] = {4, 0x80, 0x8F};                               // 不超过 U+10FFFF
+            return t;
+        }
+
+        constexpr std::array<Utf8Lead, 256> kUtf8Lead = BuildUtf8LeadTable();
+
+        // 双字节编码字节类别
+        constexpr unsigned char kLead = 1;          ///< 可作首字节
+        constexpr unsigned char kTrail = 2;         ///< 可作尾字节
+        constexpr unsigned char kSingle = 4;        ///< 合法的非 ASCII 单字节字符（如半角片假名）
+        constexpr unsigned char kCommonLead = 8;    ///< 常用字首字节
+        constexpr unsigned char kCommonTrail = 16;  ///< 常用字尾字节
+
+        constexpr void MarkRange(std::array<unsigned char, 256>& t, int lo, int hi, unsigned char flag) {
+            for (int c = lo; c <= hi; ++c) t[c] = static_cast<unsigned char>(t[c] | flag);
+        }
+
+        /// GBK：首字节 0x81-0xFE，尾字节 0x40-0x7E/0x80-0xFE；常用汉字区 0xB0-0xF7 × 0xA1-0xFE
+        constexpr std::array<unsigned char, 256> BuildGbkTable() {
+            std::array<unsigned char, 256> t{};
+            MarkRange(t, 0x81, 0xFE, kLead);
+            MarkRange(t, 0x40, 0x7E, kTrail);
+            MarkRange(t, 0x80, 0xFE, kTrail);
+            MarkRange(t, 0xB0, 0xF7, kCommonLead);
+            MarkRange(t, 0xA1, 0xFE, kCommonTrail);
+            return t;
+        }
+
+        /// Big5：首字节 0xA1-0xF9，尾字节 0x40-0x7E/0xA1-0xFE；常用字区首字节 0xA4-0xC6
+        constexpr std::array<unsigned char, 256> BuildBig5Table() {
+            std::array<unsigned char, 256> t{};
+            MarkRange(t, 0xA1, 0xF9, kLead);
+            MarkRange(t, 0x40, 0x7E, kTrail | kCommonTrail);
+            MarkRange(t, 0xA1, 0xFE, kTrail | kCommonTrail);
+            MarkRange(t, 0xA4, 0xC6, kCommonLead);
+            return t;
+        }
+
+        /// Shift-JIS：半角片假名 0xA1-0xDF，首字节 0x81-0x9F/0xE0-0xFC，尾字节 0x40-0x7E/0x80-0xFC；
+        /// 假名与第一水准汉字首字节 0x82-0x9F
+        constexpr std::array<unsigned char, 256> BuildSjisTable() {
+            std::array<unsigned char, 256> t{};
+            MarkRange(t, 0xA1, 0xDF, kSingle);
+            MarkRange(t, 0x81, 0x9F, kLead);
+            MarkRange(t, 0xE0, 0xFC, kLead);
+            MarkRange(t, 0x40, 0x7E, kTrail | kCommonTrail);
+            MarkRange(t, 0x80, 0xFC, kTrail | kCommonTrail);
+            MarkRange(t, 0x82, 0x9F, kCommonLead);
+            return t;
+        }
+
+        constexpr std::array<unsigned char, 256> kGbkTable = BuildGbkTable();
+        constexpr std::array<unsigned char, 256> kBig5Table = BuildBig5Table();
+        constexpr std::array<unsigned char, 256> kSjisTable = BuildSjisTable();
+
+        /// 单个双字节编码的逐字节状态机
+        struct DbcsScorer {
+            const std::array<unsigned char, 256>& table;
+            int lead = -1;      ///< 待配对的首字节，-1 表示无
+            int score = 0;
+            int pairs = 0;
+            int invalid = 0;
+
+            void Feed(unsigned char b) {
+                const unsigned char cls = table[b];
+                if (lead >= 0) {
+                    if (cls & kTrail) {
+                        ++pairs;
+                        score += ((table[lead] & kCommonLead) && (cls & kCommonTrail)) ? 2 : 1;
+                        lead = -1;
+                        return;
+                    }
+                    ++invalid;
+                    lead = -1;
+                }
+                if (b < 0x80)
+                    return;
+                if (cls & kLead)
+                    lead = b;
+                else if (!(cls & kSingle))
+                    ++invalid;
+            }
+
+            void Finish() {
+                if (lead >= 0) {
+                    ++invalid;
+                    lead = -1;
+                }
+            }
+        };
+
+        /// 无效序列的扣分权重
+        constexpr int INVALID_PENALTY = 4;
+
+    }
+
+    bool TextEncoding::IsValidUtf8(const char* data, size_t size) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = p + size;
+
+        while (p < end) {
+            if (*p < 0x80) {
+                p = SkipAscii(p, end);
+                if (p == end)
+                    break;
+            }
+
+            const Utf8Lead& lead = kUtf8Lead[*p];
+            if (lead.length == 0 || static_cast<size_t>(end - p) < lead.length)
+                return false;
+            if (p[1] < lead.lo || p[1] > lead.hi)
+                return false;
+            for (unsigned k = 2; k < lead.length; ++k) {
+                if ((p[k] & 0xC0) != 0x80)
+                    return false;
+            }
+            p += lead.length;
+        }
+        return true;
+    }
+
+    EncodingAnalysis TextEncoding::Classify(const char* data, size_t size) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = p + size;
+
+        DbcsScorer gbk{kGbkTable};
+        DbcsScorer big5{kBig5Table};
+        DbcsScorer sjis{kSjisTable};
+        EncodingAnalysis result;
+
+        while (p < end) {
+            // ASCII 段只影响待配对的首字节（ASCII 也可能是 0x40-0x7E 尾字节），其余直接跳过
+            if (*p < 0x80 && gbk.lead < 0 && big5.lead < 0 && sjis.lead < 0) {
+                p = SkipAscii(p, end);
+                if (p == end)
+                    break;
+            }
+            const unsigned char b = *p++;
+            result.high_bytes += (b >= 0x80);
+            gbk.Feed(b);
+            big5.Feed(b);
+            sjis.Feed(b);
+        }
+        gbk.Finish();
+        big5.Finish();
+        sjis.Finish();
+
+        auto make = [](const char* name, unsigned int codepage, const DbcsScorer& s) {
+            return EncodingCandidate{name, codepage, s.score - INVALID_PENALTY * s.invalid, s.pairs, s.invalid};
+        };
+        result.ranked = {make("GBK", 936, gbk), make("Big5", 950, big5), make("Shift-JIS", 932, sjis)};
+        // 同分时保持 GBK、Big5、Shift-JIS 的顺序
+        std::stable_sort(result.ranked.begin(), result.ranked.end(),
+                         [](const EncodingCandidate& a, const EncodingCandidate& b) { return a.score > b.score; });
+        return result;
+    }
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace Util {
+
+    /// 双字节编码候选（代码页与 Windows 一致，可直接用于 MultiByteToWideChar）
+    struct EncodingCandidate {
+        const char* name;
+        unsigned int codepage;
+        int score;          ///< 结构得分（常用区字符对加权，无效序列扣分），越高越可能
+        int pairs;          ///< 符合该编码的双字节字符数
+        int invalid;        ///< 不符合该编码结构的序列数
+    };
+
+    /// 编码分析结果
+    struct EncodingAnalysis {
+        std::array<EncodingCandidate, 3> ranked;  ///< GBK / Big5 / Shift-JIS，按得分从高到低
+        size_t high_bytes = 0;                    ///< 0x80 及以上字节数
+    };
+
+    /// 文本编码检测（平台无关，不依赖 Windows API）
+    class TextEncoding {
+    public:
+        /// 严格 UTF-8 校验：ASCII 部分按 16/32 字节块跳过，
+        /// 多字节序列拒绝过长编码、UTF-16 代理区与超出 U+10FFFF 的码点
+        static bool IsValidUtf8(const char* data, size_t size);
+
+        /// 单遍扫描，同时按 GBK、Big5、Shift-JIS 的字节结构评分
+        static EncodingAnalysis Classify(const char* data, size_t size);
+    };
+
+}
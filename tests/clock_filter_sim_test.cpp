@@ -0,0 +1,249 @@
+// NtpClient::ClockFilter 离线仿真：合成带频偏、抖动与离群值的测量序列，
+// 校验相位/频偏收敛精度与收敛时间、离群样本全部被拒绝，以及拒绝样本后不会重复预测
+//   1. 单服务器：测量直接送入滤波器
+//   2. 多服务器：每轮各服务器多个样本，其中一个服务器恒定偏离（falseticker），
+//      经 SelectTruechimers（Marzullo 交集）剔除后按 CombineSamples 合并再送入滤波器；
+//      不剔除时合并结果带有偏差，相位误差远超容差
+
+#include "util/NtpClient.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Util
+{
+    struct NtpClientTestAccess
+    {
+        using Sample = NtpClient::Sample;
+
+        static std::vector<bool> SelectTruechimers(const std::vector<Sample> &samples)
+        {
+            return NtpClient::SelectTruechimers(samples);
+        }
+
+        static void CombineSamples(const std::vector<Sample> &samples, const std::vector<bool> &truechimers,
+                                   double &offset_ms, double &delay_ms)
+        {
+            NtpClient::CombineSamples(samples, truechimers, offset_ms, delay_ms);
+        }
+    };
+}
+
+using Util::NtpClient;
+using Util::NtpClientTestAccess;
+using Filter = NtpClient::ClockFilter;
+using TestSupport::Check;
+
+namespace
+{
+    constexpr double DRIFT_PPM = 47.0;          // 本机稳定时钟相对 NTP 的真实频偏
+    constexpr double INITIAL_PHASE_MS = 3.0;    // 首个样本之后的真实相位
+    constexpr double DELAY_MS = 12.0;           // 往返时延，真实偏差均匀分布于 ±delay/2
+    constexpr double POLL_S = 32.0;
+    constexpr int SAMPLES = 400;
+    constexpr int WARMUP = 60;                  // 收敛前的样本不计入误差统计
+    constexpr double OUTLIER_RATE = 0.05;
+    constexpr double MAX_RMS_PHASE_ERROR_MS = 2.0;
+    constexpr double MAX_FREQ_ERROR_PPM = 2.0;
+    constexpr double CONVERGED_ERROR_MS = 2.0;  // 此后相位误差一直不超过该值即视为收敛
+    constexpr double MAX_CONVERGE_S = WARMUP * POLL_S;
+
+    constexpr size_t SERVERS = 4;
+    constexpr size_t FALSETICKER = 2;
+    constexpr double FALSETICKER_OFFSET_MS = 250.0;
+    constexpr int SAMPLES_PER_SERVER = 3;
+
+    /// 一次测量：给定真实相位，返回测量值与方差；is_outlier 标记注入的离群样本
+    using Measure = std::function<double(double truth_ms, double &variance_ms2, bool &is_outlier)>;
+
+    struct SimResult
+    {
+        int outliers = 0;
+        int outliers_accepted = 0;
+        int clean_rejected = 0;
+        int resets = 0;
+        double rms_ms = 0.0;
+        double freq_error_ppm = 0.0;
+        double phase_sigma_ms = 0.0;
+        double converge_s = -1.0;   ///< 最后一次超出 CONVERGED_ERROR_MS 之后的首个测量时刻，-1 表示未收敛
+    };
+
+    SimResult Simulate(const Measure &measure)
+    {
+        const auto t0 = std::chrono::steady_clock::time_point{} + std::chrono::hours(1);
+        SimResult r;
+
+        Filter filter;
+        filter.Reset(DELAY_MS * DELAY_MS / 12.0 + 0.01);
+        filter.phase_ms = INITIAL_PHASE_MS;
+        filter.last_update = t0;
+
+        double sq_error = 0.0;
+        int error_count = 0;
+        int last_outside = 0;
+
+        for (int i = 1; i <= SAMPLES; ++i)
+        {
+            const double t_s = i * POLL_S;
+            const auto now = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(t_s));
+            const double truth_ms = INITIAL_PHASE_MS + DRIFT_PPM / 1000.0 * t_s;
+
+            double variance_ms2 = 0.0;
+            bool is_outlier = false;
+            const double measured_ms = measure(truth_ms, variance_ms2, is_outlier);
+
+            Filter predicted = filter;
+            predicted.Predict(t_s - std::chrono::duration<double>(filter.last_update - t0).count());
+
+            double innovation_ms = 0.0;
+            double innovation_sigma_ms = 0.0;
+            const auto result = filter.Step(now, measured_ms, variance_ms2, innovation_ms, innovation_sigma_ms);
+
+            Check(filter.last_update == now, "Step 之后 last_update 未推进到测量时刻");
+            switch (result)
+            {
+            case Filter::StepResult::Accepted:
+                if (is_outlier)
+                    r.outliers_accepted++;
+                break;
+            case Filter::StepResult::Rejected:
+                if (!is_outlier)
+                    r.clean_rejected++;
+                // 被拒绝的样本只推进一次预测，状态与单独 Predict 的结果一致
+                Check(filter.p00 == predicted.p00 && filter.p01 == predicted.p01 && filter.p11 == predicted.p11 &&
+                          filter.phase_ms == predicted.phase_ms,
+                      "拒绝样本后协方差与单次预测不一致");
+                break;
+            case Filter::StepResult::HardStep:
+            case Filter::StepResult::RejectLimit:
+                r.resets++;
+                break;
+            }
+            r.outliers += is_outlier ? 1 : 0;
+
+            const double error_ms = filter.phase_ms - truth_ms;
+            if (std::fabs(error_ms) > CONVERGED_ERROR_MS)
+                last_outside = i;
+            if (i > WARMUP)
+            {
+                sq_error += error_ms * error_ms;
+                error_count++;
+            }
+        }
+
+        r.rms_ms = std::sqrt(sq_error / error_count);
+        r.freq_error_ppm = filter.freq_ms_per_s * 1000.0 - DRIFT_PPM;
+        r.phase_sigma_ms = std::sqrt(filter.p00);
+        r.converge_s = last_outside < SAMPLES ? (last_outside + 1) * POLL_S : -1.0;
+        return r;
+    }
+
+    void Report(const char *name, const SimResult &r)
+    {
+        printf("[%s] outliers=%d (accepted %d) clean_rejected=%d resets=%d\n", name, r.outliers, r.outliers_accepted,
+               r.clean_rejected, r.resets);
+        printf("[%s] rms phase error=%.3fms, freq error=%.3fppm, phase sigma=%.3fms, 收敛(|误差|<=%.1fms)=%.0fs\n", name,
+               r.rms_ms, r.freq_error_ppm, r.phase_sigma_ms, CONVERGED_ERROR_MS, r.converge_s);
+    }
+
+    void CheckConverged(const std::string &name, const SimResult &r)
+    {
+        if (r.resets != 0)
+            TestSupport::Fail(name + ": 滤波器发生了重置");
+        if (r.rms_ms >= MAX_RMS_PHASE_ERROR_MS)
+            TestSupport::Fail(name + ": 相位误差过大");
+        if (std::fabs(r.freq_error_ppm) >= MAX_FREQ_ERROR_PPM)
+            TestSupport::Fail(name + ": 频偏估计误差过大");
+        if (r.converge_s < 0.0 || r.converge_s > MAX_CONVERGE_S)
+            TestSupport::Fail(name + ": 收敛时间超过 " + std::to_string(MAX_CONVERGE_S) + "s");
+    }
+
+    /// 单服务器：抖动均匀分布于 ±delay/2，离群样本不连续出现两次以上（避免触发连续拒绝后的重置）
+    void SingleServer()
+    {
+        std::mt19937 rng(20240611);
+        std::uniform_real_distribution<double> jitter(-DELAY_MS / 2.0, DELAY_MS / 2.0);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_real_distribution<double> outlier(80.0, 400.0);
+        bool previous_outlier = false;
+
+        const SimResult r = Simulate([&](double truth_ms, double &variance_ms2, bool &is_outlier)
+        {
+            variance_ms2 = DELAY_MS * DELAY_MS / 12.0 + 0.01;
+            is_outlier = !previous_outlier && unit(rng) < OUTLIER_RATE;
+            previous_outlier = is_outlier;
+            double measured_ms = truth_ms + jitter(rng);
+            if (is_outlier)
+                measured_ms += (unit(rng) < 0.5 ? -1.0 : 1.0) * outlier(rng);
+            return measured_ms;
+        });
+        Report("单服务器", r);
+
+        Check(r.outliers > 0, "仿真未产生离群样本");
+        Check(r.outliers_accepted == 0, "离群样本被滤波器接受");
+        CheckConverged("单服务器", r);
+    }
+
+    /// 多服务器：select 为 false 时跳过交叉校验（所有服务器视为可信），用于对照
+    SimResult MultiServer(bool select, int &misclassified_rounds)
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        misclassified_rounds = 0;
+
+        return Simulate([&](double truth_ms, double &variance_ms2, bool &)
+        {
+            std::vector<NtpClientTestAccess::Sample> samples;
+            for (size_t server = 0; server < SERVERS; ++server)
+            {
+                for (int k = 0; k < SAMPLES_PER_SERVER; ++k)
+                {
+                    const double delay_ms = DELAY_MS * (1.0 + 0.5 * unit(rng));
+                    double offset_ms = truth_ms + (unit(rng) - 0.5) * delay_ms;
+                    if (server == FALSETICKER)
+                        offset_ms += FALSETICKER_OFFSET_MS;
+                    samples.push_back({offset_ms, delay_ms, server});
+                }
+            }
+
+            std::vector<bool> truechimers = NtpClientTestAccess::SelectTruechimers(samples);
+            bool misclassified = truechimers.size() != SERVERS;
+            for (size_t server = 0; !misclassified && server < SERVERS; ++server)
+                misclassified = truechimers[server] != (server != FALSETICKER);
+            misclassified_rounds += misclassified ? 1 : 0;
+            if (!select)
+                truechimers.assign(SERVERS, true);
+
+            double offset_ms = 0.0;
+            double delay_ms = 0.0;
+            NtpClientTestAccess::CombineSamples(samples, truechimers, offset_ms, delay_ms);
+            variance_ms2 = delay_ms * delay_ms / 12.0 + 0.01;
+            return offset_ms;
+        });
+    }
+}
+
+int main()
+{
+    SingleServer();
+
+    int misclassified = 0;
+    const SimResult selected = MultiServer(true, misclassified);
+    Report("多服务器", selected);
+    printf("[多服务器] falseticker 识别错误 %d / %d 轮\n", misclassified, SAMPLES);
+    Check(misclassified == 0, "SelectTruechimers 未剔除 falseticker 或误剔除了可信服务器");
+    CheckConverged("多服务器", selected);
+
+    const SimResult unselected = MultiServer(false, misclassified);
+    Report("多服务器（不剔除）", unselected);
+    Check(unselected.rms_ms > 10.0 * MAX_RMS_PHASE_ERROR_MS, "不剔除 falseticker 时相位误差应明显偏大");
+
+    return TestSupport::Finish();
+}
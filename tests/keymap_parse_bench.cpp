@@ -0,0 +1,99 @@
+// 键位文件解析基准：生成大型键位文件文本，按 load_config 的逐行流程
+// （trim、跳过注释、normalize_line、解析键位行、解析音名/编号）分别用手写解析与旧版 std::regex 实现处理
+// 用法：keymap_parse_bench [行数]（默认 200000）
+
+#include "util/KeymapSyntax.h"
+#include "keymap_regex_oracle.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+namespace KS = Util::KeymapSyntax;
+namespace Oracle = KeymapRegexOracle;
+
+namespace
+{
+    std::string MakeKeymapText(int lines)
+    {
+        static const char *const names[] = {"C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B"};
+        static const char *const keys[] = {"z", "x", "c", "v", "b", "n", "m", "a", "s", "d", "f", "g", "q", "w"};
+        std::string text;
+        for (int i = 0; i < lines; ++i)
+        {
+            const int pitch = 36 + i % 60;
+            const std::string name = std::string(names[pitch % 12]) + std::to_string(pitch / 12 - 1);
+            const char *key = keys[i % 14];
+            switch (i % 8)
+            {
+            case 0:
+                text += "# 第 " + std::to_string(i / 8) + " 组\n";
+                break;
+            case 1:
+                text += name + ": " + key + "\n";
+                break;
+            case 2:
+                text += u8"音符 " + name + u8"（中央区）：" + key + u8"＋\n";
+                break;
+            case 3:
+                text += std::to_string(pitch) + " = " + key + "-\n";
+                break;
+            case 4:
+                text += u8"音符　" + std::to_string(pitch) + " (" + name + ") - " + key + "\n";
+                break;
+            case 5:
+                text += "  " + name + "\t=\t" + key + "+  \n";
+                break;
+            case 6:
+                text += u8"无效行 " + std::to_string(i) + "\n";
+                break;
+            default:
+                text += "\n";
+                break;
+            }
+        }
+        return text;
+    }
+
+    template <typename ParseLine, typename ParseName>
+    double LoadMs(const std::string &text, ParseLine parse_line, ParseName parse_name, int &mapped)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::istringstream lines(text);
+        std::string line, key_part, value_part;
+        mapped = 0;
+        while (std::getline(lines, line))
+        {
+            const size_t begin = line.find_first_not_of(" \t\r\n\v\f");
+            if (begin == std::string::npos || line[begin] == '#' || line[begin] == '-')
+                continue;
+            line = KS::normalize_line(line);
+            if (!parse_line(line, key_part, value_part))
+                continue;
+            int pitch = -1;
+            const bool numeric = key_part.find_first_not_of("0123456789") == std::string::npos;
+            if (numeric ? KS::parse_decimal(key_part, 0, key_part.size(), pitch) : parse_name(key_part, pitch))
+                mapped++;
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int line_count = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const std::string text = MakeKeymapText(line_count);
+
+    int mapped_new = 0;
+    int mapped_old = 0;
+    const double new_ms = LoadMs(text, KS::parse_keymap_line, KS::parse_note_name, mapped_new);
+    const double old_ms = LoadMs(text, Oracle::parse_keymap_line, Oracle::parse_note_name, mapped_old);
+
+    std::printf("%d 行, %.1f KB\n", line_count, text.size() / 1024.0);
+    std::printf("手写解析:   %8.2f ms (%d 个映射)\n", new_ms, mapped_new);
+    std::printf("std::regex: %8.2f ms (%d 个映射)\n", old_ms, mapped_old);
+    std::printf("加速比: %.1fx\n", old_ms / new_ms);
+    return mapped_new == mapped_old ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+// 旧版 KeyManager 的 std::regex 实现，作为 KeymapSyntax 差分测试与基准的参照
+
+#include <cctype>
+#include <map>
+#include <regex>
+#include <string>
+
+namespace KeymapRegexOracle
+{
+    /// 旧版 load_config 的键位行正则
+    inline const std::regex &line_regex()
+    {
+        static const std::regex re(
+            R"((?:音符\s+)?([A-G][#bB]?\d+|\d+)(?:\s*\(.*?\))?[\s]*[:=\-\s]+[\s]*([^\s]+))",
+            std::regex::icase | std::regex::optimize);
+        return re;
+    }
+
+    /// 旧版正则去掉「音符」前缀后的部分（对应 match_note_entry，从指定位置锚定匹配）
+    inline const std::regex &entry_regex()
+    {
+        static const std::regex re(R"(([A-G][#bB]?\d+|\d+)(?:\s*\(.*?\))?[\s]*[:=\-\s]+[\s]*([^\s]+))",
+                                   std::regex::icase | std::regex::optimize);
+        return re;
+    }
+
+    /// 旧版正则的「分隔符 + 按键」部分（对应 match_key_value）
+    inline const std::regex &key_value_regex()
+    {
+        static const std::regex re(R"([\s]*[:=\-\s]+[\s]*([^\s]+))", std::regex::icase | std::regex::optimize);
+        return re;
+    }
+
+    inline bool parse_keymap_line(const std::string &line, std::string &key_part, std::string &value_part)
+    {
+        std::smatch match;
+        if (!std::regex_search(line, match, line_regex()))
+            return false;
+        key_part = match[1].str();
+        value_part = match[2].str();
+        return true;
+    }
+
+    inline bool match_note_entry(const std::string &s, size_t pos, std::string &key_part, std::string &value_part)
+    {
+        std::smatch match;
+        if (!std::regex_search(s.begin() + pos, s.end(), match, entry_regex(), std::regex_constants::match_continuous))
+            return false;
+        key_part = match[1].str();
+        value_part = match[2].str();
+        return true;
+    }
+
+    inline bool match_key_value(const std::string &s, size_t pos, size_t &value_begin, size_t &value_end)
+    {
+        std::smatch match;
+        if (!std::regex_search(s.begin() + pos, s.end(), match, key_value_regex(),
+                               std::regex_constants::match_continuous))
+            return false;
+        value_begin = pos + static_cast<size_t>(match.position(1));
+        value_end = value_begin + static_cast<size_t>(match.length(1));
+        return true;
+    }
+
+    /// 旧版 get_pitch_from_name（每次调用都编译正则）
+    /// 旧版对超长八度数字抛出异常或整数溢出，这里统一视为拒绝，其余输入行为不变
+    inline bool parse_note_name(const std::string &name, int &pitch)
+    {
+        std::regex re(R"(^\s*([A-Ga-g])([#bB]?)(-?\d+)\s*$)");
+        std::smatch match;
+        if (!std::regex_match(name, match, re))
+            return false;
+
+        std::string key(1, static_cast<char>(std::tolower(static_cast<unsigned char>(match[1].str()[0]))));
+        const std::string acc = match[2].str();
+        if (!acc.empty())
+            key += (acc[0] == '#') ? "#" : "b";
+
+        static const std::map<std::string, int> notes_map = {
+            {"c", 0}, {"c#", 1}, {"db", 1}, {"d", 2}, {"d#", 3}, {"eb", 3}, {"e", 4}, {"f", 5}, {"f#", 6}, {"gb", 6}, {"g", 7}, {"g#", 8}, {"ab", 8}, {"a", 9}, {"a#", 10}, {"bb", 10}, {"b", 11}};
+        auto it = notes_map.find(key);
+        if (it == notes_map.end())
+            return false;
+
+        long long octave = 0;
+        try
+        {
+            octave = std::stoll(match[3].str());
+        }
+        catch (...)
+        {
+            return false;
+        }
+        if (octave > 100 || octave < -100)
+            return false;
+        const long long value = (octave + 1) * 12 + it->second;
+        if (value < 0 || value > 127)
+            return false;
+        pitch = static_cast<int>(value);
+        return true;
+    }
+}
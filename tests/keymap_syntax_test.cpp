@@ -0,0 +1,96 @@
+// KeymapSyntax 差分测试：随机拼接键位文件中会出现的记号（音名、数字、全角标点、备注括号、
+// 「音符」前缀、修饰符后缀等），经 normalize_line 后分别交给手写解析与旧版 std::regex 实现，
+// 要求 parse_keymap_line / match_note_entry / match_key_value / parse_note_name 的结果完全一致
+
+#include "util/KeymapSyntax.h"
+#include "keymap_regex_oracle.h"
+#include "test_support.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace KS = Util::KeymapSyntax;
+namespace Oracle = KeymapRegexOracle;
+
+namespace
+{
+    constexpr int CASES = 30000;
+
+    const char *const kLineTokens[] = {
+        u8"音符", u8"音", u8"符", " ", "  ", "\t", "\v", "\r", ":", "=", "-", "+", "(", ")", "#", "b", "B", "C",
+        "c", "E", "g", "h", "A", "0", "1", "4", "6", "9", "60", "127", "99999999999", "q", "z", "x", ",", "[", "\\",
+        u8"：", u8"＝", u8"－", u8"＋", u8"（", u8"）", u8"　", "Ab", "C#4", "Bb-1", u8"音符 ", u8"中央C", "Shift+",
+        "Ctrl-", "#comment"};
+
+    const char *const kNameTokens[] = {" ",  "\t", "C", "c", "D", "e", "G", "a", "B", "H", "#", "b", "B",
+                                       "-",  "--", "0", "1", "4", "9", "10", "11", "100", "101", "999999999999"};
+
+    template <size_t N>
+    std::string RandomText(std::mt19937 &rng, const char *const (&tokens)[N], int max_tokens)
+    {
+        std::string s;
+        const int count = 1 + static_cast<int>(rng() % static_cast<unsigned>(max_tokens));
+        for (int i = 0; i < count; ++i)
+            s += tokens[rng() % N];
+        return s;
+    }
+
+    void Report(const char *what, const std::string &input)
+    {
+        std::string message = std::string("MISMATCH ") + what + ": [";
+        for (unsigned char c : input)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), c < 0x20 ? "\\x%02X" : "%c", c);
+            message += escaped;
+        }
+        TestSupport::Fail(message + "]");
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(20240611);
+    int lines_matched = 0;
+
+    for (int i = 0; i < CASES; ++i)
+    {
+        const std::string line = KS::normalize_line(RandomText(rng, kLineTokens, 10));
+
+        std::string k1, v1, k2, v2;
+        const bool a = KS::parse_keymap_line(line, k1, v1);
+        const bool b = Oracle::parse_keymap_line(line, k2, v2);
+        if (a != b || (a && (k1 != k2 || v1 != v2)))
+            Report("parse_keymap_line", line);
+        lines_matched += b;
+
+        const size_t pos = rng() % (line.size() + 1);
+        const bool c = KS::match_note_entry(line, pos, k1, v1);
+        const bool d = Oracle::match_note_entry(line, pos, k2, v2);
+        if (c != d || (c && (k1 != k2 || v1 != v2)))
+            Report("match_note_entry", line.substr(pos));
+
+        size_t b1 = 0, e1 = 0, b2 = 0, e2 = 0;
+        const bool e = KS::match_key_value(line, pos, b1, e1);
+        const bool f = Oracle::match_key_value(line, pos, b2, e2);
+        if (e != f || (e && (b1 != b2 || e1 != e2)))
+            Report("match_key_value", line.substr(pos));
+
+        const std::string name = RandomText(rng, kNameTokens, 5);
+        int p1 = -1, p2 = -1;
+        const bool g = KS::parse_note_name(name, p1);
+        const bool h = Oracle::parse_note_name(name, p2);
+        if (g != h || (g && p1 != p2))
+            Report("parse_note_name", name);
+    }
+
+    // 全角标点归一化
+    std::string key, value;
+    if (!KS::parse_keymap_line(KS::normalize_line(u8"音符　C4（中央C）：q＋"), key, value) || key != "C4" ||
+        value != "q+")
+        Report("normalize_line", u8"音符　C4（中央C）：q＋");
+
+    std::printf("cases=%d 正则匹配行=%d mismatches=%d\n", CASES, lines_matched, TestSupport::FailureCount());
+    return TestSupport::Finish();
+}
@@ -0,0 +1,188 @@
+// 二进制日志往返测试：编码器写出的记录经 DecodeLogBinary 还原后，
+// 必须与写线程直接格式化的文本逐字节一致；截断的文件报错，零填充尾部视为正常结束；
+// 编号或长度字段损坏的文件报错而不按损坏的值分配内存。
+// 另校验 AppendLogEvent 对常见说明符的直接转换与 snprintf 结果一致
+
+#include "util/LogFormat.h"
+#include "test_support.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace Util;
+using Clock = std::chrono::system_clock;
+using TestSupport::Check;
+
+namespace
+{
+    const LogSite kKeySite{LogLevel::Debug, "D:\\GO_Midi\\src\\core\\KeyboardSimulator.cpp", 126, "send_events",
+                           "%s: VK=0x%X, 修饰符=%d, 窗口=%p"};
+    const LogSite kTimingSite{LogLevel::Info, "src/core/PlaybackEngine.cpp", 2001, "playback_loop",
+                              "延迟 %.3fms (%u 个事件, 周期 %lld, %5.1f%%) %c"};
+
+    /// 同时写出二进制记录与写线程会生成的文本行
+    struct Pair
+    {
+        LogBinaryEncoder encoder;
+        std::string binary;
+        std::string text;
+
+        template <typename... Args>
+        void Event(const LogSite& site, Clock::time_point time, const std::string& thread, const Args&... args)
+        {
+            const LogArg packed[] = {MakeLogArg(args)..., LogArg{}};
+            encoder.AppendEvent(binary, site, time, thread, packed, sizeof...(Args));
+            AppendLogLinePrefix(text, site.level, time, thread, site.file, site.line, site.func);
+            AppendLogEvent(text, site.format, packed, sizeof...(Args));
+            text += '\n';
+        }
+
+        void Text(LogLevel level, Clock::time_point time, const std::string& thread, const char* file, int line,
+                  const char* func, const std::string& message)
+        {
+            encoder.AppendText(binary, level, time, thread, file, line, func, message);
+            AppendLogLinePrefix(text, level, time, thread, file, line, func);
+            text += message;
+            text += '\n';
+        }
+
+        void Note(const std::string& message)
+        {
+            encoder.AppendNote(binary, message);
+            text += message;
+            text += '\n';
+        }
+    };
+
+    bool Decode(const std::string& binary, std::string& text, std::string& error)
+    {
+        std::istringstream in(binary);
+        std::ostringstream out;
+        const bool ok = DecodeLogBinary(in, out, error);
+        text = out.str();
+        return ok;
+    }
+
+    /// 改写 offset 处的 u32 字段（小端序，与编码器一致）
+    std::string Patch(std::string binary, size_t offset, uint32_t value)
+    {
+        std::memcpy(&binary[offset], &value, sizeof(value));
+        return binary;
+    }
+
+    /// AppendLogEvent 的结果须与 snprintf（按捕获的参数类型）一致
+    template <typename... Args>
+    void CheckFormat(const char* format, const char* printf_format, const Args&... args)
+    {
+        const LogArg packed[] = {MakeLogArg(args)..., LogArg{}};
+        std::string actual;
+        AppendLogEvent(actual, format, packed, sizeof...(Args));
+        char expected[1024];
+        std::snprintf(expected, sizeof(expected), printf_format, args...);
+        if (actual != expected)
+            TestSupport::Fail(std::string("格式化不一致: \"") + format + "\" -> \"" + actual + "\"，期望 \"" + expected + "\"");
+    }
+
+    /// 损坏的文件必须解码失败并给出原因
+    void CheckCorrupt(const std::string& binary, const char* what)
+    {
+        std::string decoded;
+        std::string error;
+        if (Decode(binary, decoded, error) || error.empty())
+            TestSupport::Fail(what);
+    }
+}
+
+int main()
+{
+    const Clock::time_point epoch = Clock::now();
+    const auto at = [&](int ms) { return epoch + std::chrono::milliseconds(ms); };
+    int dummy = 0;
+
+    Pair file;
+    file.encoder.Begin(file.binary, epoch);
+    file.Text(LogLevel::Info, at(0), "1234", "", 0, "", "Logger initialized. Level: DEBUG");
+    for (int i = 0; i < 100; ++i)
+    {
+        const std::string thread = (i % 3 == 0) ? "1234" : "5678";
+        file.Event(kKeySite, at(i * 7), thread, (i % 2) ? "按键按下" : "按键释放", 0x41 + i % 26, i % 3, &dummy);
+        if (i % 10 == 0)
+            file.Event(kTimingSite, at(i * 7 + 1), thread, 0.125 * i, static_cast<unsigned>(i), -1234567890123LL * i,
+                       99.95, 'x');
+    }
+    file.Text(LogLevel::Warning, at(800), "5678", "src/util/NtpClient.cpp", 642, "Sync", "NTP 样本被滤波器拒绝: 中文消息");
+    file.Note("[Logger] 线程 5678 日志缓冲已满，丢弃 3 条日志");
+    // 负的相对时间：轮转前已入队、时间早于文件头基准的记录
+    file.Event(kKeySite, epoch - std::chrono::milliseconds(5), "9999", "按键按下", 0x20, 0, nullptr);
+
+    std::string decoded;
+    std::string error;
+    Check(Decode(file.binary, decoded, error), "完整文件解码失败");
+    Check(decoded == file.text, "解码文本与写线程格式化结果不一致");
+
+    // 轮转后的新文件：格式化点与线程表重新定义
+    Pair rotated;
+    rotated.encoder = file.encoder;
+    rotated.encoder.Begin(rotated.binary, at(1000));
+    rotated.Event(kTimingSite, at(1001), "5678", 1.5, 2u, 3LL, 4.0, 'y');
+    Check(Decode(rotated.binary, decoded, error) && decoded == rotated.text, "轮转后的文件解码不一致");
+
+    // 内存映射写入崩溃后尾部的零填充
+    Check(Decode(file.binary + std::string(4096, '\0'), decoded, error) && decoded == file.text,
+          "零填充尾部未视为正常结束");
+
+    // 截断：已解码的行照常输出并报告错误
+    const std::string truncated = file.binary.substr(0, file.binary.size() - 3);
+    Check(!Decode(truncated, decoded, error), "截断的文件未报告错误");
+    Check(!decoded.empty() && file.text.compare(0, decoded.size(), decoded) == 0, "截断前的行未正确输出");
+
+    Check(!Decode("GO_MIDI text log\n", decoded, error), "文本文件被当作二进制日志");
+
+    // 损坏的编号与长度字段：文件头 20 字节之后，rotated 首条为格式化点定义，single 首条为线程定义
+    //   格式化点 u8 类型 | u32 编号 (+1) | u8 级别 | i32 行号 | u32 文件名长度 (+10)
+    //   线程     u8 类型 | u32 编号 (+1) | u32 线程标识长度 (+5)
+    constexpr size_t kHeader = 20;
+    Pair single;
+    single.encoder.Begin(single.binary, epoch);
+    single.Text(LogLevel::Info, at(0), "1234", "", 0, "", "单条文本");
+    Check(Decode(single.binary, decoded, error) && decoded == single.text, "单条文本记录解码不一致");
+
+    CheckCorrupt(Patch(rotated.binary, kHeader + 1, 0xFFFFFFF0u), "超大格式化点编号未报告错误");
+    CheckCorrupt(Patch(rotated.binary, kHeader + 1, 5), "不连续的格式化点编号未报告错误");
+    CheckCorrupt(Patch(single.binary, kHeader + 1, 0xFFFFFFF0u), "超大线程编号未报告错误");
+    CheckCorrupt(Patch(single.binary, kHeader + 1, 1), "不连续的线程编号未报告错误");
+    CheckCorrupt(Patch(rotated.binary, kHeader + 10, 0xFFFFFFFFu), "超大字符串长度未报告错误");
+    CheckCorrupt(Patch(single.binary, kHeader + 5, static_cast<uint32_t>(single.binary.size())),
+                 "超出剩余数据的字符串长度未报告错误");
+
+    // 不带标志的说明符走直接转换，带宽度/精度的仍经 snprintf
+    for (const long long v : {0LL, 7LL, -1LL, 1234567890123LL, std::numeric_limits<long long>::min(),
+                              std::numeric_limits<long long>::max()})
+    {
+        CheckFormat("v=%d|%i|%lld 尾部", "v=%lld|%lld|%lld 尾部", v, v, v);
+        CheckFormat("%u %x %X", "%llu %llx %llX", static_cast<unsigned long long>(v), static_cast<unsigned long long>(v),
+                    static_cast<unsigned long long>(v));
+        CheckFormat("[%5d] [%-4x] [%08X]", "[%5lld] [%-4llx] [%08llX]", v, static_cast<unsigned long long>(v),
+                    static_cast<unsigned long long>(v));
+    }
+    CheckFormat("%s:%s|%s", "%s:%s|%s", "按键按下", "", "100%");
+    CheckFormat("%% 前缀 %s %%", "%% 前缀 %s %%", "x");
+    CheckFormat("[%-6s][%.2s]", "[%-6s][%.2s]", "ab", "abcdef");
+    const std::string longText(300, 'L');
+    std::string truncated_text;
+    const LogArg longArg[] = {MakeLogArg(longText.c_str()), LogArg{}};
+    AppendLogEvent(truncated_text, "%s", longArg, 1);
+    Check(truncated_text == std::string(255, 'L'), "超长字符串参数未截断为 255 字节");
+    std::string null_text;
+    const LogArg nullArg[] = {MakeLogArg(static_cast<const char*>(nullptr)), LogArg{}};
+    AppendLogEvent(null_text, "%s", nullArg, 1);
+    Check(null_text == "(null)", "空字符串指针未输出 (null)");
+
+    std::printf("binary=%zu 字节, text=%zu 字节 (%.1f%%)\n", file.binary.size(), file.text.size(),
+                100.0 * file.binary.size() / file.text.size());
+    return TestSupport::Finish();
+}
@@ -0,0 +1,71 @@
+// 日志级别过滤开销基准：比较热路径上三种 LOG_DEBUG 调用点的单次开销
+//   空循环      不含日志调用，作为基线
+//   编译期裁剪  Engine 模块以 GO_MIDI_LOG_MIN_LEVEL_ENGINE=1 编译，调用整体消失
+//   运行期过滤  General 模块保留 Debug 调用，运行期级别为 Info（一次原子读取 + 分支）
+// 期望：编译期裁剪与空循环一致，运行期过滤稍高
+
+#include "util/Logger.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+    constexpr int ITERATIONS = 50000000;
+
+    volatile int g_sink = 0;
+
+    template <typename Body>
+    double NsPerCall(Body body)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            body(i);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+    }
+
+    void Baseline(int i)
+    {
+        g_sink = i;
+    }
+
+#undef LOG_MODULE
+#define LOG_MODULE Engine
+    void Stripped(int i)
+    {
+        g_sink = i;
+        LOG_DEBUG_FMT("seek: 事件索引 %d", i);
+    }
+
+#undef LOG_MODULE
+#define LOG_MODULE General
+    void RuntimeFiltered(int i)
+    {
+        g_sink = i;
+        LOG_DEBUG_FMT("seek: 事件索引 %d", i);
+    }
+}
+
+int main()
+{
+    static_assert(Util::CompiledMinLevel(Util::LogModule::Engine) >= 1, "Engine 模块需以编译期裁剪 Debug 编译");
+    static_assert(Util::CompiledMinLevel(Util::LogModule::General) == 0, "General 模块需保留 Debug 调用");
+
+    Logger::Instance().Initialize(LogLevel::Info, "./logs/", false);
+    Logger::Instance().SetConsoleOutput(false);
+
+    NsPerCall([](int i) { Baseline(i); }); // 预热
+    const double baseline = NsPerCall([](int i) { Baseline(i); });
+    const double stripped = NsPerCall([](int i) { Stripped(i); });
+    const double filtered = NsPerCall([](int i) { RuntimeFiltered(i); });
+
+    std::printf("空循环:     %.3f ns/次\n", baseline);
+    std::printf("编译期裁剪: %.3f ns/次 (%+.3f)\n", stripped, stripped - baseline);
+    std::printf("运行期过滤: %.3f ns/次 (%+.3f)\n", filtered, filtered - baseline);
+
+    Logger::Instance().Shutdown();
+    return 0;
+}
@@ -0,0 +1,67 @@
+// 编译期日志裁剪验证：本文件以 GO_MIDI_LOG_MIN_LEVEL=1 编译（见 CMakeLists.txt），
+// 其中的 LOG_DEBUG / LOG_DEBUG_FMT 必须整体消失：
+//   1. 参数表达式不求值（副作用计数器保持为 0）
+//   2. 不引用 Logger（本程序不链接 Logger.cpp，未裁剪的调用会导致链接失败）
+//   3. 消息中的字符串常量不出现在可执行文件中
+
+#define LOG_MODULE Engine
+
+#include "util/Logger.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#if GO_MIDI_LOG_MIN_LEVEL < 1
+#error "log_strip_test 需以 GO_MIDI_LOG_MIN_LEVEL=1 编译"
+#endif
+
+namespace
+{
+    int g_evaluated = 0;
+
+    int SideEffect()
+    {
+        return ++g_evaluated;
+    }
+
+    void HotPath(int i)
+    {
+        LOG_DEBUG("stripped-marker-q7Zx 按键 " << SideEffect() << " 索引 " << i);
+        LOG_DEBUG_FMT("stripped-marker-q7Zx seek %d -> %d", SideEffect(), i);
+    }
+
+    /// 在可执行文件中查找标记串（标记倒序保存，避免查找用的常量本身命中）
+    bool BinaryContainsMarker(const char* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::printf("无法读取可执行文件 %s，跳过字符串检查\n", path);
+            return false;
+        }
+        const std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::string marker = "xZ7q-rekram-deppirts";
+        std::reverse(marker.begin(), marker.end());
+        return image.find(marker) != std::string::npos;
+    }
+}
+
+int main(int, char** argv)
+{
+    static_assert(Util::CompiledMinLevel(Util::LogModule::Engine) == 1, "Engine 模块编译期级别应为 Info");
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        HotPath(i);
+    }
+
+    if (g_evaluated != 0)
+        TestSupport::Fail("被裁剪的日志参数被求值 " + std::to_string(g_evaluated) + " 次");
+    TestSupport::Check(!BinaryContainsMarker(argv[0]), "被裁剪的日志消息仍在可执行文件中");
+
+    return TestSupport::Finish();
+}
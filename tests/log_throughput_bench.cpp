@@ -0,0 +1,101 @@
+// 日志写入吞吐基准：Debug 级别的按键跟踪负载（与 KeyboardSimulator 相同的 LOG_DEBUG_FMT 调用），
+// 单个回放线程按给定速率持续写入，分别使用流式写入与内存映射追加写入
+//   提交    调用线程完成全部 LOG_DEBUG_FMT 的耗时（按速率节拍，约为 行数 / 速率）
+//   落盘    从第一条日志到 Flush 返回（写线程格式化并写出全部记录）的耗时
+//   吞吐    实际写入文件的按键行数 / 落盘耗时；缓冲满时被丢弃的行不计入
+// 调用线程从不等待写线程，写线程跟不上时日志被丢弃：
+//   1M 行/秒   目标负载，报告丢弃行数
+//   2M 行/秒   超出写线程能力的负载，吞吐即写线程的持续写出速率
+// 目标：两种写入方式在 2M 行/秒负载下的吞吐均不低于 1M 行/秒
+
+#define LOG_MODULE Keyboard
+#include "util/Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    constexpr int LINES = 2000000;
+    constexpr double TARGET_LINES_PER_S = 1e6;
+    constexpr int PACE_BATCH = 64;  ///< 每写入该数量的日志检查一次节拍
+
+    /// 统计目录下所有日志文件中的按键跟踪行
+    long long CountTraceLines(const std::filesystem::path &dir)
+    {
+        long long count = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(dir))
+        {
+            std::ifstream in(entry.path(), std::ios::binary);
+            std::string line;
+            while (std::getline(in, line))
+            {
+                if (line.find("VK=0x") != std::string::npos)
+                    count++;
+            }
+        }
+        return count;
+    }
+
+    /// 以 rate 行/秒写入 LINES 行，返回吞吐（行/秒）
+    double Run(const char *name, bool mapped, double rate)
+    {
+        const auto dir = std::filesystem::temp_directory_path() / "go_midi_log_throughput_bench";
+        std::filesystem::remove_all(dir);
+
+        Util::LogFileOptions options;
+        options.mappedWriter = mapped;
+        options.maxFileBytes = 0;  // 不轮转，全部写入同一文件
+        Logger::Instance().Initialize(LogLevel::Debug, dir.string(), true, true, options);
+        Logger::Instance().SetConsoleOutput(false);
+
+        void *const window = reinterpret_cast<void *>(0x00120A3C);
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LINES; ++i)
+        {
+            if (i % PACE_BATCH == 0)
+            {
+                const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                             std::chrono::duration<double>(i / rate));
+                // 让出处理器而非空转：核心较少时写线程仍能按时排空缓冲
+                while (std::chrono::steady_clock::now() < due)
+                    std::this_thread::yield();
+            }
+            const bool down = (i & 1) == 0;
+            LOG_DEBUG_FMT("%s: VK=0x%X, 修饰符=%d, 窗口=%p", down ? "按键按下" : "按键释放", 0x41 + (i >> 1) % 26,
+                          (i >> 1) % 3, window);
+        }
+        const auto submitted = std::chrono::steady_clock::now();
+        Logger::Instance().Flush();
+        const auto flushed = std::chrono::steady_clock::now();
+        Logger::Instance().Shutdown();
+
+        const double submit_s = std::chrono::duration<double>(submitted - start).count();
+        const double total_s = std::chrono::duration<double>(flushed - start).count();
+        const long long written = CountTraceLines(dir);
+        const double lines_per_s = written / total_s;
+        std::filesystem::remove_all(dir);
+
+        std::printf("%-8s 负载 %.0fM 行/秒  提交 %.3fs  落盘 %.3fs  写入 %lld / %d 行（丢弃 %lld）  吞吐 %.2fM 行/秒\n",
+                    name, rate / 1e6, submit_s, total_s, written, LINES, LINES - written, lines_per_s / 1e6);
+        return lines_per_s;
+    }
+}
+
+int main()
+{
+    bool ok = true;
+    for (const bool mapped : {false, true})
+    {
+        const char *name = mapped ? "内存映射" : "流式";
+        Run(name, mapped, TARGET_LINES_PER_S);
+        ok = Run(name, mapped, 2 * TARGET_LINES_PER_S) >= TARGET_LINES_PER_S && ok;
+    }
+    std::printf("%s\n", ok ? "PASS" : "FAIL: 写线程持续吞吐低于 1M 行/秒");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+// 异步日志的字符串参数测试：LOG_*_FMT 传入临时字符串（栈上缓冲、std::string、c_str()）后立即改写或释放，
+// 写线程输出的文本日志与二进制日志（经 DecodeLogBinary 还原）中仍应是调用时的内容
+//   1. 栈上缓冲在调用后被覆盖
+//   2. std::string 临时对象及其 c_str() 在调用后析构
+//   3. 超过 MAX_LOG_STRING_BYTES 的字符串被截断；空指针输出 "(null)"
+
+#define LOG_MODULE Engine
+#include "util/Logger.h"
+#include "util/LogFormat.h"
+#include "test_support.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using TestSupport::Check;
+
+namespace
+{
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 500;
+
+    std::string Expected(int thread, int i)
+    {
+        return "t" + std::to_string(thread) + "-" + std::to_string(i);
+    }
+
+    /// 以异步模式写入一批临时字符串参数，关闭后返回日志目录中唯一的日志文件内容（二进制日志先解码）
+    std::string WriteAndRead(const std::filesystem::path &dir, bool binary)
+    {
+        std::filesystem::remove_all(dir);
+
+        Util::LogFileOptions options;
+        options.binaryRecords = binary;
+        options.maxFileBytes = 0;
+        Logger::Instance().Initialize(LogLevel::Debug, dir.string(), true, true, options);
+        Logger::Instance().SetConsoleOutput(false);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([t]
+            {
+                char buffer[64];
+                for (int i = 0; i < PER_THREAD; ++i)
+                {
+                    std::snprintf(buffer, sizeof(buffer), "%s", Expected(t, i).c_str());
+                    LOG_INFO_FMT("stack=%s", buffer);
+                    std::memset(buffer, 'X', sizeof(buffer) - 1);
+
+                    LOG_INFO_FMT("string=%s c_str=%s", Expected(t, i), Expected(t, i).c_str());
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        const std::string longText(Logger::MAX_LOG_STRING_BYTES + 100, 'L');
+        LOG_INFO_FMT("long=%s|", longText);
+        const char *missing = nullptr;
+        LOG_INFO_FMT("null=%s|", missing);
+
+        Logger::Instance().Shutdown();
+
+        std::string content;
+        for (const auto &entry : std::filesystem::directory_iterator(dir))
+        {
+            std::ifstream in(entry.path(), std::ios::binary);
+            if (binary)
+            {
+                std::ostringstream out;
+                std::string error;
+                Check(Util::DecodeLogBinary(in, out, error), "二进制日志解码失败");
+                content += out.str();
+            }
+            else
+            {
+                content.append(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+        }
+        std::filesystem::remove_all(dir);
+        return content;
+    }
+
+    void CheckContent(const std::string &content, const char *mode)
+    {
+        int missing = 0;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            for (int i = 0; i < PER_THREAD; ++i)
+            {
+                const std::string text = Expected(t, i);
+                if (content.find("stack=" + text + "\n") == std::string::npos &&
+                    content.find("stack=" + text + "\r\n") == std::string::npos)
+                    missing++;
+                if (content.find("string=" + text + " c_str=" + text) == std::string::npos)
+                    missing++;
+            }
+        }
+        if (missing)
+            TestSupport::Fail(std::string(mode) + ": " + std::to_string(missing) + " 条日志的字符串参数已失效");
+        if (content.find("XXXX") != std::string::npos)
+            TestSupport::Fail(std::string(mode) + ": 输出了调用后被覆盖的栈上缓冲");
+
+        const std::string truncated = "long=" + std::string(Logger::MAX_LOG_STRING_BYTES, 'L') + "|";
+        if (content.find(truncated) == std::string::npos)
+            TestSupport::Fail(std::string(mode) + ": 超长字符串未按 MAX_LOG_STRING_BYTES 截断");
+        if (content.find("null=(null)|") == std::string::npos)
+            TestSupport::Fail(std::string(mode) + ": 空字符串指针未输出 (null)");
+    }
+}
+
+int main()
+{
+    const auto base = std::filesystem::temp_directory_path() / "go_midi_logger_async_test";
+    CheckContent(WriteAndRead(base / "text", false), "文本日志");
+    CheckContent(WriteAndRead(base / "binary", true), "二进制日志");
+    std::filesystem::remove_all(base);
+    return TestSupport::Finish();
+}
@@ -0,0 +1,155 @@
+// NtpClient 时钟参数序列锁压力测试：单写者以最高频率发布参数，多个读者线程同时调用 GetNow，
+// 每组参数都能由 GetNow 的结果反推出来，读到撕裂（不同组字段混合）的结果即失败。
+// 同时输出读者在写者持续发布时的 GetNow 耗时，作为争用基准
+// 参数经 NtpClientTestAccess 直接发布（PublishClock / s_synced 为私有成员）
+
+#include "util/NtpClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Util
+{
+    struct NtpClientTestAccess
+    {
+        static void PublishClock(std::chrono::system_clock::time_point base_ntp,
+                                 std::chrono::steady_clock::time_point base_steady, double skew)
+        {
+            NtpClient::PublishClock(base_ntp, base_steady, skew);
+        }
+
+        static void SetSynced(bool synced)
+        {
+            NtpClient::s_synced.store(synced);
+        }
+    };
+}
+
+using Util::NtpClient;
+using Util::NtpClientTestAccess;
+using namespace std::chrono;
+
+namespace
+{
+    // 第 i 组参数：base_ntp = N0 + i*D，base_steady = S0 - i*P，skew = 1 + (i 为奇数 ? EPS : 0)
+    // 一致的一组在 t 时刻给出 N0 + i*D + (t - S0 + i*P) * skew；
+    // 混入其它组的 base_ntp/base_steady 会偏离 P 的整数倍，混入另一 skew 会偏离 (t - S0 + i*P) * EPS
+    constexpr long long GROUPS = 100000;
+    constexpr double D_NS = 1e9;
+    constexpr double P_NS = 1e6;
+    constexpr double EPS = 1e-4;
+    constexpr double TOLERANCE_NS = 20000.0;  // GetNow 按微秒截断，另留读取时刻的余量
+    constexpr auto DURATION = seconds(2);
+
+    system_clock::time_point g_n0;
+    steady_clock::time_point g_s0;
+
+    double Skew(long long i)
+    {
+        return 1.0 + ((i & 1) ? EPS : 0.0);
+    }
+
+    void Publish(long long i)
+    {
+        NtpClientTestAccess::PublishClock(g_n0 + duration_cast<system_clock::duration>(nanoseconds((long long)(i * D_NS))),
+                                g_s0 - nanoseconds((long long)(i * P_NS)), Skew(i));
+    }
+
+    // t 时刻第 i 组参数应得的结果（相对 N0，纳秒）
+    double Expected(long long i, steady_clock::time_point t)
+    {
+        const double since_s0 = (double)duration_cast<nanoseconds>(t - g_s0).count() + i * P_NS;
+        return i * D_NS + since_s0 * Skew(i);
+    }
+
+    struct ReaderStats
+    {
+        long long reads = 0;
+        long long torn = 0;
+        double total_ns = 0.0;
+    };
+}
+
+int main()
+{
+    g_n0 = system_clock::now();
+    g_s0 = steady_clock::now();
+    Publish(0);
+    NtpClientTestAccess::SetSynced(true);
+
+    const unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+    const unsigned readers = std::max(2u, hw - 1);
+
+    std::atomic<bool> stop{false};
+    std::atomic<long long> published{0};
+    std::vector<ReaderStats> stats(readers);
+    std::vector<std::thread> threads;
+
+    for (unsigned r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]
+        {
+            ReaderStats& s = stats[r];
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const auto before = steady_clock::now();
+                const auto now = NtpClient::GetNow();
+                const auto after = steady_clock::now();
+
+                const double got = (double)duration_cast<nanoseconds>(now - g_n0).count();
+                const double since_s0 = (double)duration_cast<nanoseconds>(before - g_s0).count();
+                const long long i = std::llround((got - since_s0) / (D_NS + P_NS));
+                const bool ok = i >= 0 && i < GROUPS &&
+                                got >= Expected(i, before) - TOLERANCE_NS &&
+                                got <= Expected(i, after) + TOLERANCE_NS;
+                if (!ok && s.torn++ < 3)
+                    printf("撕裂读取: 组 %lld, 偏差 %.0fns\n", i, got - Expected(i, before));
+                s.reads++;
+                s.total_ns += (double)duration_cast<nanoseconds>(after - before).count();
+            }
+        });
+    }
+
+    // 单写者（与 Sync 线程相同）：不间断地发布新参数
+    threads.emplace_back([&]
+    {
+        long long n = 0;
+        const auto end = steady_clock::now() + DURATION;
+        while (steady_clock::now() < end)
+            Publish(++n % GROUPS);
+        published = n;
+        stop = true;
+    });
+
+    for (auto& t : threads)
+        t.join();
+
+    long long reads = 0;
+    long long torn = 0;
+    double total_ns = 0.0;
+    for (const auto& s : stats)
+    {
+        reads += s.reads;
+        torn += s.torn;
+        total_ns += s.total_ns;
+    }
+
+    printf("readers=%u publishes=%lld reads=%lld torn=%lld GetNow=%.1fns/次（含写者争用）\n",
+           readers, published.load(), reads, torn, reads ? total_ns / reads : 0.0);
+    if (torn != 0 || reads == 0 || published.load() == 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// 测试用 NTP 应答器：在本机回环地址上应答 NtpClient 的请求，时间与时延可配置
+//   offset_ms  应答时间相对本机 system_clock 的偏差
+//   delay_ms   模拟的往返时延，去程与回程各一半（对称时延不影响偏差估计）
+//   forge      每个请求先由另一端口抢答一个 originate 正确、时间偏差 forged_offset_ms 的伪造回复
+//   unsynced   应答未同步（LI=3, stratum=16）
+// 套接字调用经 util/SocketCompat.h，Windows 与 BSD socket 平台均可编译
+
+#include "util/SocketCompat.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace TestSupport
+{
+    class NtpResponder
+    {
+    public:
+        std::atomic<double> offset_ms{0.0};
+        std::atomic<double> delay_ms{0.0};
+        std::atomic<bool> forge{false};
+        std::atomic<double> forged_offset_ms{-3000.0};
+        std::atomic<bool> unsynced{false};
+        std::atomic<int> requests{0};
+        std::atomic<int> forged{0};
+
+        ~NtpResponder() { Stop(); }
+
+        /// 绑定 127.0.0.1:port 并启动应答线程，绑定失败返回 false
+        bool Start(int port)
+        {
+            if (!Util::Net::Startup())
+                return false;
+            m_started = true;
+            m_server = OpenUdp(port);
+            m_forger = OpenUdp(0);
+            if (m_server == Util::Net::INVALID || m_forger == Util::Net::INVALID)
+                return false;
+            m_thread = std::thread([this] { Run(); });
+            return true;
+        }
+
+        void Stop()
+        {
+            m_stop = true;
+            if (m_thread.joinable())
+                m_thread.join();
+            if (m_server != Util::Net::INVALID)
+                Util::Net::Close(m_server);
+            if (m_forger != Util::Net::INVALID)
+                Util::Net::Close(m_forger);
+            m_server = m_forger = Util::Net::INVALID;
+            if (m_started)
+                Util::Net::Cleanup();
+            m_started = false;
+        }
+
+    private:
+        static Util::Net::Socket OpenUdp(int port)
+        {
+            Util::Net::Socket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (s != Util::Net::INVALID && bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            {
+                Util::Net::Close(s);
+                return Util::Net::INVALID;
+            }
+            return s;
+        }
+
+        /// system_clock 时刻 + 偏差 → NTP 时间戳（网络字节序）
+        static void WriteTimestamp(unsigned char *out, double offset)
+        {
+            const auto now = std::chrono::system_clock::now() +
+                             std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                 std::chrono::duration<double, std::milli>(offset));
+            const double ntp_s = std::chrono::duration<double>(now.time_since_epoch()).count() + 2208988800.0;
+            const uint32_t sec = static_cast<uint32_t>(ntp_s);
+            const uint32_t sec_be = htonl(sec);
+            const uint32_t frac_be = htonl(static_cast<uint32_t>((ntp_s - sec) * 4294967296.0));
+            std::memcpy(out, &sec_be, 4);
+            std::memcpy(out + 4, &frac_be, 4);
+        }
+
+        /// 填写回复头部与 originate；receive / transmit 时间戳由调用方在对应时刻写入
+        static void BuildHeader(const unsigned char *request, unsigned char *reply, bool synced)
+        {
+            std::memset(reply, 0, 48);
+            reply[0] = synced ? 0x24 : 0xE4; // LI=0/3, VN=4, Mode=4
+            reply[1] = synced ? 2 : 16;
+            std::memcpy(reply + 24, request + 40, 8); // originate = 请求的 transmit
+        }
+
+        static void SleepMs(double ms)
+        {
+            if (ms > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+        }
+
+        void Run()
+        {
+            while (!m_stop.load())
+            {
+                Util::Net::PollFd pfd = {};
+                pfd.fd = m_server;
+                pfd.events = Util::Net::POLL_READ;
+                if (Util::Net::Poll(&pfd, 1, 50) <= 0)
+                    continue;
+
+                unsigned char request[48];
+                sockaddr_in client{};
+                socklen_t len = sizeof(client);
+                if (recvfrom(m_server, reinterpret_cast<char *>(request), 48, 0, reinterpret_cast<sockaddr *>(&client),
+                             &len) < 48)
+                    continue;
+                requests++;
+
+                const double offset = offset_ms.load();
+                const double half_delay = delay_ms.load() / 2.0;
+                unsigned char reply[48];
+                if (unsynced.load())
+                {
+                    BuildHeader(request, reply, false);
+                    WriteTimestamp(reply + 32, forged_offset_ms.load());
+                    WriteTimestamp(reply + 40, forged_offset_ms.load());
+                    Send(m_server, reply, client, len);
+                    continue;
+                }
+
+                if (forge.load())
+                {
+                    BuildHeader(request, reply, true);
+                    WriteTimestamp(reply + 32, forged_offset_ms.load());
+                    WriteTimestamp(reply + 40, forged_offset_ms.load());
+                    Send(m_forger, reply, client, len);
+                    forged++;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+
+                // 去程时延：请求在 half_delay 之后才"到达"服务器
+                SleepMs(half_delay);
+                BuildHeader(request, reply, true);
+                WriteTimestamp(reply + 32, offset);
+                WriteTimestamp(reply + 40, offset);
+                SleepMs(half_delay);
+                Send(m_server, reply, client, len);
+            }
+        }
+
+        static void Send(Util::Net::Socket s, const unsigned char *reply, const sockaddr_in &client, socklen_t len)
+        {
+            sendto(s, reinterpret_cast<const char *>(reply), 48, 0, reinterpret_cast<const sockaddr *>(&client), len);
+        }
+
+        std::atomic<bool> m_stop{false};
+        bool m_started = false;
+        Util::Net::Socket m_server = Util::Net::INVALID;
+        Util::Net::Socket m_forger = Util::Net::INVALID;
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,69 @@
+// NtpClient 替身服务器测试：本机起一个 NTP 应答器（时间快 400ms，见 ntp_responder.h）
+//   1. 应答器带 100ms 对称往返时延，且每个请求先由另一端口抢答一个携带正确 originate、时间慢 3s 的伪造回复：
+//      Sync 只采用真正服务器的回复，偏差估计不受时延影响（首次同步，滤波器尚无先验）
+//   2. 去掉时延与伪造回复后再次同步，偏差保持
+//   3. 应答器改为应答未同步（LI=3, stratum=16），Sync 不采用，时钟保持不变
+// 非 Windows 平台不链接 Logger.cpp，NtpClient 的日志在编译期裁剪（见 CMakeLists.txt）
+
+#include "util/NtpClient.h"
+#include "ntp_responder.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    constexpr int SERVER_PORT = 12399;
+    constexpr double SERVER_OFFSET_MS = 400.0;
+    constexpr double ROUND_TRIP_MS = 100.0;
+    constexpr double TOLERANCE_MS = 30.0;  // 小于时延的一半：按非对称时延计算会超出
+
+    double ClockOffsetMs()
+    {
+        return std::chrono::duration<double, std::milli>(Util::NtpClient::GetNow() - std::chrono::system_clock::now())
+            .count();
+    }
+
+    void CheckOffset(const char *what, bool synced, bool expect_synced)
+    {
+        const double offset_ms = ClockOffsetMs();
+        std::printf("%s: sync=%d offset=%.3fms (期望 %.0fms)\n", what, synced, offset_ms, SERVER_OFFSET_MS);
+        if (synced != expect_synced)
+            TestSupport::Fail(std::string(what) + ": Sync 返回 " + std::to_string(synced));
+        if (std::fabs(offset_ms - SERVER_OFFSET_MS) > TOLERANCE_MS)
+            TestSupport::Fail(std::string(what) + ": 偏差 " + std::to_string(offset_ms) + "ms");
+    }
+}
+
+int main()
+{
+    TestSupport::NtpResponder responder;
+    responder.offset_ms = SERVER_OFFSET_MS;
+    responder.delay_ms = ROUND_TRIP_MS;
+    responder.forge = true;
+    if (!responder.Start(SERVER_PORT))
+    {
+        TestSupport::Fail("无法绑定测试端口");
+        return TestSupport::Finish();
+    }
+
+    Util::NtpClient::SetServers({"127.0.0.1"}, SERVER_PORT);
+    long offset_sec = 0;
+
+    CheckOffset("时延与伪造回复", Util::NtpClient::Sync(offset_sec), true);
+    TestSupport::Check(responder.forged.load() > 0, "未发出伪造回复");
+
+    responder.forge = false;
+    responder.delay_ms = 0.0;
+    CheckOffset("无时延", Util::NtpClient::Sync(offset_sec), true);
+
+    responder.unsynced = true;
+    CheckOffset("未同步服务器", Util::NtpClient::Sync(offset_sec), false);
+
+    responder.Stop();
+    std::printf("请求 %d 个, 伪造回复 %d 个\n", responder.requests.load(), responder.forged.load());
+    return TestSupport::Finish();
+}
@@ -0,0 +1,132 @@
+// 音高分析缓存持久化测试：Save 写出的条目由新的缓存实例 Load 读回
+//   1. 直方图与已计算的移调值逐项相同，未预先计算的音域仍可按直方图计算
+//   2. 源文件修改（大小或修改时间变化）后读回的条目失效
+//   3. 截断或计数被改写的缓存文件不加载任何条目
+
+#include "core/PitchAnalysis.h"
+#include "pitch_histogram_reference.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+using TestSupport::Check;
+
+namespace
+{
+    constexpr size_t TRACKS = 6;
+
+    void WriteFile(const std::filesystem::path &path, const std::string &content)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+
+    std::string ReadFile(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    bool SameAnalysis(const Core::PitchAnalysis &a, const Core::PitchAnalysis &b)
+    {
+        if (a.track_histograms() != b.track_histograms() || a.global_histogram() != b.global_histogram())
+            return false;
+        // 36-96 为内置预设之外的音域：a 在保存前已查询过，b 读回后按直方图重新计算
+        for (auto [low, high] : {std::pair{48, 83}, std::pair{36, 96}, std::pair{60, 71}})
+        {
+            if (a.global_shift(low, high) != b.global_shift(low, high))
+                return false;
+            for (int t = 0; t < static_cast<int>(TRACKS); ++t)
+            {
+                if (a.track_shift(t, low, high) != b.track_shift(t, low, high))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /// 改写缓存文件中 offset 处的 4 字节后读回，应不加载任何条目
+    void CheckCorrupt(const std::filesystem::path &file, const std::string &original, size_t offset,
+                      uint32_t value, const char *what)
+    {
+        std::string data = original;
+        std::memcpy(&data[offset], &value, sizeof(value));
+        WriteFile(file, data);
+        Core::PitchAnalysisCache cache;
+        if (cache.Load(file) != 0)
+            TestSupport::Fail(std::string(what) + ": 损坏的缓存文件被加载");
+    }
+}
+
+int main()
+{
+    const auto dir = std::filesystem::temp_directory_path() / "go_midi_pitch_cache_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto cache_file = dir / "pitch_cache.bin";
+    const auto midi_a = dir / std::filesystem::u8path(u8"曲目 A.mid");
+    const auto midi_b = dir / std::filesystem::u8path(u8"曲目 B.mid");
+    WriteFile(midi_a, "MThd-a");
+    WriteFile(midi_b, "MThd-bb");
+
+    std::mt19937 rng(7);
+    auto analysis_a = Core::PitchAnalysis::Build(PitchHistogramReference::RandomNotes(rng, 4000, TRACKS, 60.0f), TRACKS);
+    auto analysis_b = Core::PitchAnalysis::Build(PitchHistogramReference::RandomNotes(rng, 4000, TRACKS, 70.0f), TRACKS);
+    analysis_a->global_shift(36, 96);
+
+    {
+        Core::PitchAnalysisCache cache;
+        cache.Store(midi_a.wstring(), analysis_a);
+        cache.Store(midi_b.wstring(), analysis_b);
+        Check(cache.Save(cache_file), "Save 失败");
+    }
+
+    // 1. 读回后与原分析相同
+    {
+        Core::PitchAnalysisCache cache;
+        Check(cache.Load(cache_file) == 2, "读回条目数不符");
+        auto loaded_a = cache.Find(midi_a.wstring());
+        auto loaded_b = cache.Find(midi_b.wstring());
+        Check(loaded_a && SameAnalysis(*analysis_a, *loaded_a), "读回的分析 A 与原分析不同");
+        Check(loaded_b && SameAnalysis(*analysis_b, *loaded_b), "读回的分析 B 与原分析不同");
+    }
+
+    // 2. 源文件修改后失效：A 改写内容，B 只改修改时间
+    WriteFile(midi_a, "MThd-changed");
+    std::filesystem::last_write_time(midi_b, std::filesystem::last_write_time(midi_b) + std::chrono::seconds(5));
+    {
+        Core::PitchAnalysisCache cache;
+        cache.Load(cache_file);
+        Check(!cache.Find(midi_a.wstring()), "文件大小变化后仍命中缓存");
+        Check(!cache.Find(midi_b.wstring()), "修改时间变化后仍命中缓存");
+    }
+
+    // 3. 损坏的缓存文件
+    const std::string original = ReadFile(cache_file);
+    WriteFile(cache_file, original.substr(0, original.size() - 3));
+    {
+        Core::PitchAnalysisCache cache;
+        Check(cache.Load(cache_file) == 0, "截断的缓存文件被加载");
+    }
+    const size_t first_entry = 12;
+    CheckCorrupt(cache_file, original, 8, 0xFFFFFFFFu, "条目数");
+    CheckCorrupt(cache_file, original, first_entry, 0x7FFFFFFFu, "路径长度");
+    uint32_t path_bytes = 0;
+    std::memcpy(&path_bytes, &original[first_entry], sizeof(path_bytes));
+    CheckCorrupt(cache_file, original, first_entry + 4 + path_bytes + 16, 0x00100000u, "音轨数");
+    CheckCorrupt(cache_file, original, 4, 0u, "版本");
+
+    {
+        Core::PitchAnalysisCache cache;
+        Check(cache.Load(dir / "missing.bin") == 0, "不存在的缓存文件返回了条目");
+    }
+
+    std::filesystem::remove_all(dir);
+    return TestSupport::Finish();
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// 向量化之前的 PitchAnalysis 直方图构建（逐音符标量累加、两遍偏态、逐格查找最高/最低音），
+// 作为等价性测试与基准的参照
+
+#include "midi/MidiParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace PitchHistogramReference
+{
+    constexpr float kHighNoteBaseBoost = 1.2f;
+    constexpr float kHighNoteStepDecay = 0.1f;
+    constexpr int kMinBoostDepth = 4;
+    constexpr int kBoostDepthPercent = 15;
+
+    inline float compute_skewness(const std::vector<float> &hist, int low, int high)
+    {
+        double sum_w = 0.0, sum_pw = 0.0;
+        for (int p = low; p <= high; ++p)
+        {
+            if (hist[p] > 0.0f)
+            {
+                double w = hist[p];
+                sum_w += w;
+                sum_pw += static_cast<double>(p) * w;
+            }
+        }
+        if (sum_w < 1e-10)
+            return 0.0f;
+        double mean = sum_pw / sum_w;
+        double var = 0.0, skew = 0.0;
+        for (int p = low; p <= high; ++p)
+        {
+            if (hist[p] > 0.0f)
+            {
+                double d = static_cast<double>(p) - mean;
+                double w = hist[p];
+                var += d * d * w;
+                skew += d * d * d * w;
+            }
+        }
+        var /= sum_w;
+        if (var < 1e-10)
+            return 0.0f;
+        double sigma = std::sqrt(var);
+        skew /= sum_w;
+        return static_cast<float>(skew / (sigma * sigma * sigma));
+    }
+
+    inline void apply_high_note_boost(std::vector<float> &hist)
+    {
+        int highest_pitch = 60;
+        for (int p = 127; p >= 0; --p)
+        {
+            if (hist[p] > 0.0f)
+            {
+                highest_pitch = p;
+                break;
+            }
+        }
+
+        int lowest_pitch = highest_pitch;
+        for (int p = 0; p < highest_pitch; ++p)
+        {
+            if (hist[p] > 0.0f)
+            {
+                lowest_pitch = p;
+                break;
+            }
+        }
+        int pitch_range = highest_pitch - lowest_pitch;
+
+        float skewness = compute_skewness(hist, lowest_pitch, highest_pitch);
+        float skew_adjust = 1.0f + std::clamp(-skewness * 0.12f, -0.3f, 0.5f);
+
+        int boost_depth =
+            std::max(kMinBoostDepth, static_cast<int>(pitch_range * kBoostDepthPercent / 100 * skew_adjust));
+        float base_boost = 1.0f + (kHighNoteBaseBoost - 1.0f) * skew_adjust;
+
+        int start_pitch = highest_pitch - boost_depth + 1;
+        if (start_pitch < 0)
+            start_pitch = 0;
+        for (int p = start_pitch; p <= highest_pitch; ++p)
+        {
+            if (hist[p] > 0.0f)
+            {
+                float distance = static_cast<float>(highest_pitch - p);
+                float boost = base_boost - kHighNoteStepDecay * distance;
+                if (boost > 1.0f)
+                    hist[p] *= boost;
+            }
+        }
+    }
+
+    /// 各音轨直方图与全局直方图（已加固最高音）
+    struct Histograms
+    {
+        std::vector<std::vector<float>> tracks;
+        std::vector<float> global;
+    };
+
+    inline Histograms Build(const std::vector<Midi::RawNote> &sorted_notes, size_t track_count)
+    {
+        Histograms out;
+        out.tracks.resize(track_count, std::vector<float>(128, 0.0f));
+        out.global.resize(128, 0.0f);
+
+        for (const auto &raw : sorted_notes)
+        {
+            if (raw.pitch >= 0 && raw.pitch < 128)
+            {
+                if (raw.track_index >= 0 && raw.track_index < static_cast<int>(out.tracks.size()))
+                {
+                    out.tracks[raw.track_index][raw.pitch] += std::sqrt(raw.duration) * raw.velocity;
+                }
+                if (raw.channel != 10 && raw.program != 43 && (raw.program < 33 || raw.program > 40))
+                {
+                    out.global[raw.pitch] += std::sqrt(raw.duration) * raw.velocity;
+                }
+            }
+        }
+
+        for (auto &hist : out.tracks)
+        {
+            apply_high_note_boost(hist);
+        }
+        apply_high_note_boost(out.global);
+        return out;
+    }
+
+    /// 随机音符：音高按正态分布（可偏向高音或低音），含越界音高/音轨与被全局直方图排除的乐器
+    template <typename Rng>
+    std::vector<Midi::RawNote> RandomNotes(Rng &rng, size_t count, int track_count, float pitch_mean)
+    {
+        std::normal_distribution<float> pitch(pitch_mean, 10.0f);
+        std::vector<Midi::RawNote> notes(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Midi::RawNote &raw = notes[i];
+            raw.start_s = static_cast<float>(i) * 0.01f;
+            raw.pitch = static_cast<int>(pitch(rng));
+            if (rng() % 1000 == 0)
+                raw.pitch = (rng() % 2) ? -1 : 128;
+            raw.duration = static_cast<float>(rng() % 4000) / 1000.0f;
+            // 0..track_count，其中 track_count 与偶尔出现的 -1 为越界音轨
+            raw.track_index = static_cast<int>(rng() % static_cast<unsigned>(track_count + 1));
+            if (rng() % 500 == 0)
+                raw.track_index = -1;
+            raw.channel = static_cast<int>(rng() % 16) + 1;
+            raw.velocity = static_cast<int>(rng() % 128);
+            raw.program = static_cast<int>(rng() % 129) - 1;
+        }
+        return notes;
+    }
+}
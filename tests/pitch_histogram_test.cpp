@@ -0,0 +1,128 @@
+// PitchAnalysis 直方图等价性测试：逐音符累加到连续直方图（大文件分块到各线程私有直方图后合并）
+// 与单遍矩统计（SSE2）必须与原逐音符标量实现（tests/pitch_histogram_reference.h）给出相同的直方图与移调结果。
+// 单线程路径累加顺序不变，只允许偏态计算方式不同带来的舍入差异；多线程路径另允许合并顺序带来的差异；
+// 限定单线程（批量分析的工作线程）时大文件也走单线程路径
+
+#include "core/PitchAnalysis.h"
+#include "pitch_histogram_reference.h"
+#include "test_support.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace Ref = PitchHistogramReference;
+using TestSupport::Fail;
+
+namespace
+{
+    /// 逐格比较，返回最大相对误差
+    double CompareHistogram(const std::vector<float> &actual, const std::vector<float> &expected, double tolerance,
+                            const std::string &name)
+    {
+        double worst = 0.0;
+        for (int p = 0; p < 128; ++p)
+        {
+            const double a = actual[p];
+            const double e = expected[p];
+            if ((a > 0.0) != (e > 0.0))
+            {
+                Fail(name + " 第 " + std::to_string(p) + " 格非零状态不一致");
+                continue;
+            }
+            const double err = std::fabs(a - e) / std::max(1e-30, std::fabs(e));
+            worst = std::max(worst, err);
+            if (err > tolerance)
+                Fail(name + " 第 " + std::to_string(p) + " 格相对误差 " + std::to_string(err));
+        }
+        return worst;
+    }
+
+    /// 比较一组音符的构建结果，返回最大相对误差
+    double CompareBuild(const char *label, const std::vector<Midi::RawNote> &notes, size_t track_count,
+                        double tolerance, size_t max_threads = 0)
+    {
+        const auto analysis = Core::PitchAnalysis::Build(notes, track_count, max_threads);
+        const Ref::Histograms expected = Ref::Build(notes, track_count);
+
+        double worst = CompareHistogram(analysis->global_histogram(), expected.global, tolerance,
+                                        std::string(label) + " 全局");
+        for (size_t t = 0; t < track_count; ++t)
+        {
+            worst = std::max(worst, CompareHistogram(analysis->track_histograms()[t], expected.tracks[t], tolerance,
+                                                     std::string(label) + " 音轨 " + std::to_string(t)));
+        }
+
+        // 常见音域下的移调结果（与参照直方图上的 BestShift 一致）
+        static const int ranges[][2] = {{48, 84}, {60, 83}, {36, 96}, {21, 108}, {55, 67}};
+        for (const auto &range : ranges)
+        {
+            if (analysis->global_shift(range[0], range[1]) !=
+                Core::PitchAnalysis::BestShift(expected.global, range[0], range[1]))
+                Fail(std::string(label) + " 全局移调不一致");
+            for (size_t t = 0; t < track_count; ++t)
+            {
+                if (analysis->track_shift(static_cast<int>(t), range[0], range[1]) !=
+                    Core::PitchAnalysis::BestShift(expected.tracks[t], range[0], range[1]))
+                    Fail(std::string(label) + " 音轨 " + std::to_string(t) + " 移调不一致");
+            }
+        }
+
+        return worst;
+    }
+
+    void CheckCase(const char *label, const std::vector<Midi::RawNote> &notes, size_t track_count, double tolerance,
+                   size_t max_threads = 0)
+    {
+        const double worst = CompareBuild(label, notes, track_count, tolerance, max_threads);
+        std::printf("%-20s 音符 %8zu, 音轨 %2zu, 最大相对误差 %.2e\n", label, notes.size(), track_count, worst);
+    }
+
+    Midi::RawNote Note(int pitch, int track, float duration = 1.0f, int velocity = 100, int channel = 1,
+                       int program = 0)
+    {
+        return Midi::RawNote{0.0f, pitch, duration, track, channel, velocity, program};
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(46);
+
+    // 边界情况：空、单音、单一音高、全音域、全部被全局直方图排除
+    CheckCase("空", {}, 2, 0.0);
+    CheckCase("单音", {Note(64, 0)}, 1, 1e-6);
+    CheckCase("单一音高", std::vector<Midi::RawNote>(50, Note(72, 1, 0.5f)), 2, 1e-6);
+    {
+        std::vector<Midi::RawNote> all;
+        for (int p = 0; p < 128; ++p)
+            all.push_back(Note(p, p % 3, 0.25f + p * 0.01f, p));
+        CheckCase("全音域", all, 3, 1e-5);
+    }
+    CheckCase("全部排除", {Note(60, 0, 1.0f, 90, 10), Note(40, 0, 1.0f, 90, 1, 35), Note(45, 0, 1.0f, 90, 1, 43)}, 1,
+              1e-6);
+
+    // 随机曲目：偏向低音/中音/高音（偏态不同，加固深度随之变化），单线程路径
+    for (float mean : {40.0f, 62.0f, 100.0f})
+    {
+        const std::string label = "随机(中心 " + std::to_string(static_cast<int>(mean)) + ")";
+        double worst = 0.0;
+        for (int round = 0; round < 20; ++round)
+        {
+            const size_t count = 1 + rng() % 20000;
+            const int tracks = 1 + static_cast<int>(rng() % 16);
+            const auto notes = Ref::RandomNotes(rng, count, tracks, mean);
+            worst = std::max(worst, CompareBuild(label.c_str(), notes, tracks, 1e-5));
+        }
+        std::printf("%-20s 20 组, 最大相对误差 %.2e\n", label.c_str(), worst);
+    }
+
+    // 大文件：超过分块并行阈值，走多线程私有直方图合并
+    const auto large = Ref::RandomNotes(rng, size_t{1} << 20, 16, 62.0f);
+    CheckCase("并行累加", large, 16, 1e-4);
+    // 同一大文件限定单线程：累加顺序与参照实现相同，容差与单线程路径一致
+    CheckCase("限定单线程", large, 16, 1e-5, 1);
+
+    return TestSupport::Finish();
+}
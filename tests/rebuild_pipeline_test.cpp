@@ -0,0 +1,273 @@
+// 事件重建流水线测试：经 PlaybackEngineTestAccess 以合成音符驱动 rebuild_events，检查最终事件列表
+//   1. 和弦分解 + 复音上限：分解后的单音流不应被抢占（和弦在音符列表中按高音在前存放时也一样）
+//   2. 任意配置下每个窗口同时按住的按键数不超过复音上限，任意限速区间内的按键数不超过限速上限
+//   3. 启用帧量化时，复音与限速之后的事件仍在帧网格上，同一按键至少按住一帧、释放后至少空出一帧
+
+#include "core/PlaybackEngine.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core
+{
+    struct PlaybackEngineTestAccess
+    {
+        struct Event
+        {
+            double time;
+            bool on;
+            void *hwnd;
+            int vk;
+        };
+
+        /// 等播放线程完成自身的重建与键位改写后，持锁以 notes 重建事件列表并取回结果
+        static std::vector<Event> Rebuild(PlaybackEngine &engine, const std::vector<Midi::RawNote> &notes)
+        {
+            for (;;)
+            {
+                std::unique_lock<std::mutex> lock(engine.m_mutex);
+                if (engine.m_config_version == engine.m_built_version && !engine.keymap_stale())
+                {
+                    engine.rebuild_events(notes, nullptr, {});
+                    std::vector<Event> events;
+                    events.reserve(engine.m_events.size());
+                    for (const auto &e : engine.m_events)
+                        events.push_back({e.time, e.is_note_on, e.window_handle, e.vk_code});
+                    return events;
+                }
+                lock.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    };
+}
+
+using Core::PlaybackEngine;
+using Core::VoiceStealPolicy;
+using Event = Core::PlaybackEngineTestAccess::Event;
+
+namespace
+{
+    void *const kWindowA = reinterpret_cast<void *>(0x1000);
+    void *const kWindowB = reinterpret_cast<void *>(0x2000);
+
+    struct Config
+    {
+        bool decompose = false;
+        int max_voices = 0;
+        VoiceStealPolicy policy = VoiceStealPolicy::Oldest;
+        int tick_rate = 0;
+        int rate_limit = 0;
+    };
+
+    constexpr int kRateWindowMs = 100;
+
+    std::string Describe(const Config &config)
+    {
+        return "分解=" + std::to_string(config.decompose) + " 复音=" + std::to_string(config.max_voices) +
+               " 策略=" + std::to_string(static_cast<int>(config.policy)) + " 帧率=" +
+               std::to_string(config.tick_rate) + " 限速=" + std::to_string(config.rate_limit);
+    }
+
+    /// 通道 0 → 音轨 0 / 窗口 A，通道 1 → 音轨 1 / 窗口 B，其余通道关闭；48-84 每个音高一个按键
+    void SetupEngine(PlaybackEngine &engine)
+    {
+        for (int ch = 2; ch < 16; ++ch)
+            engine.set_channel_enable(ch, false);
+        engine.set_channel_track(0, 0);
+        engine.set_channel_window(0, kWindowA);
+        engine.set_channel_track(1, 1);
+        engine.set_channel_window(1, kWindowB);
+
+        std::map<int, Util::KeyMapping> map;
+        for (int pitch = 48; pitch <= 84; ++pitch)
+            map[pitch] = {0x100 + pitch, 0};
+        engine.get_key_manager().set_map(map);
+        engine.notify_keymap_changed();
+    }
+
+    void Apply(PlaybackEngine &engine, const Config &config)
+    {
+        engine.set_decompose(config.decompose);
+        engine.set_decompose_timing(30, 50, 0);
+        engine.set_polyphony(config.max_voices, config.policy);
+        engine.set_tick_rate(config.tick_rate);
+        engine.set_rate_limit(config.rate_limit, kRateWindowMs);
+    }
+
+    int CountNotes(const std::vector<Event> &events)
+    {
+        int count = 0;
+        for (const Event &e : events)
+            count += e.on;
+        return count;
+    }
+
+    /// 每个窗口任意时刻按住的按键数（同一时刻先释放后按下）
+    int MaxHeld(const std::vector<Event> &events)
+    {
+        std::map<void *, int> held;
+        int worst = 0;
+        for (const Event &e : events)
+        {
+            int &count = held[e.hwnd];
+            count += e.on ? 1 : -1;
+            worst = std::max(worst, count);
+        }
+        return worst;
+    }
+
+    /// 每个窗口任意 window_s 区间 (t - window_s, t] 内的按下次数
+    int MaxPressesInWindow(const std::vector<Event> &events, double window_s)
+    {
+        std::map<void *, std::vector<double>> presses;
+        for (const Event &e : events)
+        {
+            if (e.on)
+                presses[e.hwnd].push_back(e.time);
+        }
+        int worst = 0;
+        for (auto &entry : presses)
+        {
+            std::vector<double> &times = entry.second;
+            std::sort(times.begin(), times.end());
+            size_t first = 0;
+            for (size_t last = 0; last < times.size(); ++last)
+            {
+                while (times[first] <= times[last] - window_s)
+                    first++;
+                worst = std::max(worst, static_cast<int>(last - first + 1));
+            }
+        }
+        return worst;
+    }
+
+    /// 帧量化的保证：事件在网格上；同一按键至少按住一帧，释放后至少空出一帧再按下
+    bool QuantizedKeysValid(const std::vector<Event> &events, int tick_rate)
+    {
+        const double tick = 1.0 / tick_rate;
+        std::map<std::pair<void *, int>, std::vector<const Event *>> keys;
+        for (const Event &e : events)
+        {
+            const double ticks = e.time * tick_rate;
+            if (std::abs(ticks - std::round(ticks)) > 1e-6)
+                return false;
+            keys[{e.hwnd, e.vk}].push_back(&e);
+        }
+        for (auto &entry : keys)
+        {
+            std::vector<const Event *> &list = entry.second;
+            std::stable_sort(list.begin(), list.end(), [](const Event *a, const Event *b) { return a->time < b->time; });
+            for (size_t k = 0; k < list.size(); ++k)
+            {
+                if (list[k]->on != (k % 2 == 0))
+                    return false;
+                if (k > 0 && list[k]->time - list[k - 1]->time < tick - 1e-9)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /// 随机曲目：两条音轨，每步 1-4 个起音相差 20ms 以内的音符（和弦内音高顺序随机）
+    std::vector<Midi::RawNote> RandomNotes(std::mt19937 &rng, int steps)
+    {
+        std::vector<Midi::RawNote> notes;
+        for (int track = 0; track < 2; ++track)
+        {
+            double t = 0.0;
+            for (int step = 0; step < steps; ++step)
+            {
+                t += static_cast<double>(rng() % 300) / 1000.0;
+                const int chord = 1 + static_cast<int>(rng() % 4);
+                for (int k = 0; k < chord; ++k)
+                {
+                    Midi::RawNote n{};
+                    n.start_s = static_cast<float>(t + static_cast<double>(rng() % 20) / 1000.0);
+                    n.pitch = 48 + static_cast<int>(rng() % 37);
+                    n.duration = static_cast<float>(50 + rng() % 1450) / 1000.0f;
+                    n.track_index = track;
+                    n.channel = 1;
+                    n.velocity = 1 + static_cast<int>(rng() % 127);
+                    n.program = 0;
+                    notes.push_back(n);
+                }
+            }
+        }
+        std::stable_sort(notes.begin(), notes.end(), [](const Midi::RawNote &a, const Midi::RawNote &b)
+                         { return a.start_s < b.start_s; });
+        return notes;
+    }
+
+    void DecomposedChordSurvivesMonophony(PlaybackEngine &engine)
+    {
+        // 同时起音的和弦按高音在前存放：分解后低音先发声，高音随后
+        const std::vector<Midi::RawNote> chord = {{0.0f, 64, 1.0f, 0, 1, 100, 0}, {0.0f, 60, 1.0f, 0, 1, 100, 0}};
+        Apply(engine, {true, 1, VoiceStealPolicy::Oldest});
+        const auto events = Core::PlaybackEngineTestAccess::Rebuild(engine, chord);
+        TestSupport::Check(CountNotes(events) == 2, "分解后的和弦在复音上限 1 下丢失音符");
+        TestSupport::Check(engine.get_rebuild_stats().stolen_voices == 0, "分解后的单音流发生了抢占");
+        TestSupport::Check(MaxHeld(events) <= 1, "复音上限 1 下同时按住多个按键");
+    }
+
+    void RandomPipelines(PlaybackEngine &engine)
+    {
+        std::mt19937 rng(48);
+        int cases = 0;
+        for (int round = 0; round < 40; ++round)
+        {
+            const auto notes = RandomNotes(rng, 200);
+            for (bool decompose : {false, true})
+            {
+                // 帧量化与限速随机组合；复音上限为 0 的结果作为对照
+                const int tick_rate = (rng() % 2) ? 60 : 0;
+                const int rate_limit = (rng() % 3) ? 0 : 3 + static_cast<int>(rng() % 6);
+                Apply(engine, {decompose, 0, VoiceStealPolicy::Oldest, tick_rate, rate_limit});
+                const int unlimited = CountNotes(Core::PlaybackEngineTestAccess::Rebuild(engine, notes));
+
+                for (int voices = 1; voices <= 4; ++voices)
+                {
+                    const Config config{decompose, voices, static_cast<VoiceStealPolicy>(rng() % 3), tick_rate,
+                                        rate_limit};
+                    Apply(engine, config);
+                    const auto events = Core::PlaybackEngineTestAccess::Rebuild(engine, notes);
+                    const int stolen = engine.get_rebuild_stats().stolen_voices;
+                    cases++;
+
+                    if (MaxHeld(events) > voices)
+                        TestSupport::Fail("同时按住的按键超过复音上限 (" + Describe(config) + ")");
+                    if (rate_limit > 0 && MaxPressesInWindow(events, kRateWindowMs / 1000.0) > rate_limit)
+                        TestSupport::Fail("限速区间内的按键超过上限 (" + Describe(config) + ")");
+                    if (tick_rate > 0 && !QuantizedKeysValid(events, tick_rate))
+                        TestSupport::Fail("量化后的事件偏离帧网格或释放间隔不足一帧 (" + Describe(config) + ")");
+                    // 分解后每个窗口已是单音，任何复音上限都不应抢占或丢弃音符
+                    // （量化会把短于一帧的分解音延长到一帧，可能与下一音重叠，此时不作要求）
+                    if (decompose && tick_rate == 0 && (stolen != 0 || CountNotes(events) != unlimited))
+                        TestSupport::Fail("分解后的单音流被抢占 " + std::to_string(stolen) + " 个 (" +
+                                          Describe(config) + ")");
+                }
+            }
+        }
+        std::printf("随机流水线: %d 组配置\n", cases);
+    }
+}
+
+int main()
+{
+    PlaybackEngine engine;
+    SetupEngine(engine);
+
+    DecomposedChordSurvivesMonophony(engine);
+    RandomPipelines(engine);
+
+    engine.shutdown();
+    return TestSupport::Finish();
+}
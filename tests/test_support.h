@@ -0,0 +1,39 @@
+#pragma once
+
+// 测试程序共用的失败记录与结果输出：
+//   Check / Fail 记录失败（只打印前 MAX_REPORTED 条，避免大量重复输出），
+//   Finish 打印 PASS / FAIL 并返回 main 的退出码（ctest 按非 0 判定失败）
+
+#include <cstdio>
+#include <string>
+
+namespace TestSupport
+{
+    constexpr int MAX_REPORTED = 10;
+
+    inline int &FailureCount()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline void Fail(const std::string &what)
+    {
+        if (FailureCount()++ < MAX_REPORTED)
+            std::printf("FAIL: %s\n", what.c_str());
+    }
+
+    /// 条件不成立时记录失败；what 只在失败时才被使用，热循环中可传字面量
+    inline bool Check(bool ok, const char *what)
+    {
+        if (!ok)
+            Fail(what);
+        return ok;
+    }
+
+    inline int Finish()
+    {
+        std::printf(FailureCount() ? "FAIL\n" : "PASS\n");
+        return FailureCount() ? 1 : 0;
+    }
+}
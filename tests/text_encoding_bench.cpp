@@ -0,0 +1,59 @@
+// TextEncoding 基准：大型文本（以 ASCII 为主，夹杂中文）上 IsValidUtf8 与逐字节参照实现的吞吐量，
+// 以及 Classify 单遍评分的吞吐量
+// 用法：text_encoding_bench [MB]（默认 64）
+
+#include "util/TextEncoding.h"
+#include "utf8_reference.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using Util::TextEncoding;
+
+namespace
+{
+    template <typename Body>
+    double GBPerSecond(size_t bytes, Body body)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return bytes / seconds / 1e9;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t megabytes = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 64;
+
+    // 键位文件风格：每 100 字节一行，每 5000 字节一个汉字
+    std::string utf8(megabytes << 20, 'a');
+    for (size_t i = 0; i < utf8.size(); i += 100)
+        utf8[i] = '\n';
+    for (size_t i = 1000; i + 3 < utf8.size(); i += 5000)
+        utf8.replace(i, 3, u8"中");
+
+    // GBK 文本：每行一半为双字节字符
+    std::string gbk(megabytes << 20, 'a');
+    for (size_t i = 0; i + 1 < gbk.size(); i += 4)
+    {
+        gbk[i] = '\xD6';
+        gbk[i + 1] = '\xD0';
+    }
+
+    bool ok_fast = false;
+    bool ok_ref = false;
+    const double fast = GBPerSecond(utf8.size(), [&] { ok_fast = TextEncoding::IsValidUtf8(utf8.data(), utf8.size()); });
+    const double ref = GBPerSecond(utf8.size(), [&] { ok_ref = Utf8Reference::ReferenceUtf8(utf8); });
+
+    Util::EncodingAnalysis analysis;
+    const double classify = GBPerSecond(gbk.size(), [&] { analysis = TextEncoding::Classify(gbk.data(), gbk.size()); });
+
+    std::printf("%zu MB\n", megabytes);
+    std::printf("IsValidUtf8:  %6.2f GB/s (%d)\n", fast, ok_fast);
+    std::printf("逐字节参照:   %6.2f GB/s (%d)\n", ref, ok_ref);
+    std::printf("Classify:     %6.2f GB/s (首选 %s)\n", classify, analysis.ranked[0].name);
+    return ok_fast == ok_ref ? 0 : 1;
+}
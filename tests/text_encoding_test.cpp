@@ -0,0 +1,138 @@
+// TextEncoding 测试：
+//   1. IsValidUtf8 与逐码点严格解码的参照实现做差分模糊测试（随机拼接合法/非法片段并随机翻转位）
+//   2. 非法字节落在 16/32 字节块边界前后的每个位置，覆盖 ASCII 快速路径与多字节检查的衔接
+//   3. Classify 对 GBK / Big5 / Shift-JIS 编码的键位文件片段给出正确的首选编码
+
+#include "util/TextEncoding.h"
+#include "utf8_reference.h"
+#include "test_support.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+using Util::TextEncoding;
+
+namespace
+{
+    constexpr int FUZZ_CASES = 300000;
+
+    void Check(bool ok, const char *what, size_t detail = 0)
+    {
+        if (!ok)
+            TestSupport::Fail(std::string(what) + " (" + std::to_string(detail) + ")");
+    }
+
+    bool Valid(const std::string &s)
+    {
+        return TextEncoding::IsValidUtf8(s.data(), s.size());
+    }
+
+    void FuzzAgainstReference()
+    {
+        static const char *const fragments[] = {
+            "a", "abcdefghijklmnopqrstuvwxyz0123456789", u8"音符 60 (C4)：a\n", u8"中", "\xF0\x9F\x8E\xB9", "\xC3\xA9",
+            "\xED\x9F\xBF", "\xEE\x80\x80", "\xF4\x8F\xBF\xBF", "\xF0\x90\x80\x80",
+            // 非法：代理区、过长编码、超出范围、孤立续字节、截断序列、无效首字节
+            "\xED\xA0\x80", "\xE0\x80\xAF", "\xC0\xAF", "\xC1\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\x80",
+            "\xBF", "\xE4\xB8", "\xF0\x9F", "\xFF", "\xFE"};
+        constexpr size_t count = sizeof(fragments) / sizeof(*fragments);
+
+        std::mt19937 rng(7);
+        long valid = 0;
+        for (int i = 0; i < FUZZ_CASES; i++)
+        {
+            std::string s;
+            const int pieces = static_cast<int>(rng() % 16);
+            for (int j = 0; j < pieces; j++)
+                s += fragments[rng() % count];
+            if (rng() % 4 == 0 && !s.empty())
+                s[rng() % s.size()] ^= static_cast<char>(1u << (rng() % 8));
+
+            const bool expected = Utf8Reference::ReferenceUtf8(s);
+            valid += expected;
+            Check(Valid(s) == expected, "IsValidUtf8 与参照实现不一致", s.size());
+        }
+        std::printf("模糊测试: %d 例, 合法 %ld 例\n", FUZZ_CASES, valid);
+    }
+
+    void BlockBoundaries()
+    {
+        static const char *const sequences[] = {u8"中", "\xF0\x9F\x8E\xB9", "\xC3\xA9"};
+        static const char *const invalid[] = {"\x80", "\xE4\xB8", "\xED\xA0\x80", "\xFF", "\xC0\xAF"};
+
+        for (size_t offset = 0; offset < 70; offset++)
+        {
+            for (const char *seq : sequences)
+            {
+                std::string s(offset, 'a');
+                s += seq;
+                s += std::string(70, 'b');
+                Check(Valid(s), "块边界处的合法多字节序列被拒绝", offset);
+                s.resize(offset + std::strlen(seq) - 1);
+                Check(!Valid(s), "结尾处截断的多字节序列被接受", offset);
+            }
+            for (const char *bad : invalid)
+            {
+                std::string s(offset, 'a');
+                s += bad;
+                s += std::string(70, 'b');
+                Check(!Valid(s), "块边界处的非法序列被接受", offset);
+            }
+        }
+    }
+
+    void Classification()
+    {
+        struct Sample
+        {
+            const char *expected;
+            const char *bytes;
+        };
+        // 「音符 60 (C4)：a」与一行注释，分别以 GBK / Big5 / Shift-JIS 编码
+        static const Sample samples[] = {
+            {"GBK", "\xD2\xF4\xB7\xFB 60 (C4)\xA3\xBA"
+                    "a\n\xD6\xD0\xCE\xC4\xD7\xA2\xCA\xCD\xA3\xAC\xB2\xE2\xCA\xD4"
+                    "\xB3\xA3\xD3\xC3\xBA\xBA\xD7\xD6\xB5\xC4\xB1\xE0\xC2\xEB\xCA\xB6\xB1\xF0\xA1\xA3\xB8\xD6\xC7"
+                    "\xD9\xD1\xDD\xD7\xE0\xBC\xFC\xC5\xCC\xD3\xB3\xC9\xE4\xC5\xE4\xD6\xC3\xCE\xC4\xBC\xFE\xCB\xB5"
+                    "\xC3\xF7\n"},
+            {"Big5", "\xAD\xB5\xB2\xC5 60 (C4)\xA1Ga\n\xA4\xA4\xA4\xE5\xB5\xF9\xC4\xC0\xA1"
+                     "A\xB4\xFA\xB8\xD5\xB1"
+                     "`\xA5\xCE\xBA~\xA6r\xAA\xBA\xBDs\xBDX\xC3\xD1\xA7O\xA1"
+                     "C\xBF\xFB\xB5^\xBAt\xAB\xB5\xC1\xE4"
+                     "\xBDL\xACM\xAEg\xB0t\xB8m\xC0\xC9\xAE\xD7\xBB\xA1\xA9\xFA\n"},
+            {"Shift-JIS", "\x89\xB9\x95\x84 60 (C4)\x81"
+                          "Fa\n\x93\xFA\x96{\x8C\xEA\x82\xCC\x83R\x83\x81\x83\x93\x83g\x82"
+                          "\xC5\x82\xB7\x81"
+                          "B\x83s\x83"
+                          "A\x83m\x89\x89\x91t\x97p\x83L\x81[\x83}\x83"
+                          "b\x83v\x90\xDD"
+                          "\x92\xE8\x83t\x83@\x83"
+                          "C\x83\x8B\n"},
+        };
+
+        for (const Sample &sample : samples)
+        {
+            std::string text;
+            for (int i = 0; i < 4; i++)
+                text += sample.bytes;
+            const Util::EncodingAnalysis analysis = TextEncoding::Classify(text.data(), text.size());
+            std::printf("%-9s -> %s(%d) %s(%d) %s(%d)\n", sample.expected, analysis.ranked[0].name,
+                        analysis.ranked[0].score, analysis.ranked[1].name, analysis.ranked[1].score,
+                        analysis.ranked[2].name, analysis.ranked[2].score);
+            Check(!Valid(text), "双字节编码文本被当作 UTF-8");
+            Check(std::strcmp(analysis.ranked[0].name, sample.expected) == 0, "首选编码错误");
+            Check(analysis.ranked[0].invalid == 0, "正确编码下出现无效序列");
+        }
+    }
+}
+
+int main()
+{
+    FuzzAgainstReference();
+    BlockBoundaries();
+    Classification();
+
+    return TestSupport::Finish();
+}
@@ -0,0 +1,176 @@
+// 事件调度基准：按播放线程的方式以 1ms 步长推进，比较时间轮与按下标遍历排好序的事件列表
+//   静态时间线：事件列表不变。顺序遍历只需移动游标；时间轮由游标提前 1 秒送入，再按到期发送
+//   频繁改动的时间线：每步把若干未到期事件挪到新时间（通道偏移、微调等运行时改动）。
+//   顺序遍历须在有序列表中删除再插入以保持有序；时间轮取消旧条目后重新插入
+// 用法：timing_wheel_bench [事件数] [每步改动数]（默认 100000、2）
+
+#include "core/TimingWheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Core::TimingWheel;
+
+namespace
+{
+    constexpr double DURATION = 600.0;      // 乐曲时长（秒）
+    constexpr double STEP = 0.001;          // 播放线程的推进步长
+    constexpr double FEED_AHEAD = 1.0;      // 时间轮提前送入的时长（秒）
+    constexpr double MAX_MOVE = 0.05;       // 改动时挪动的最大幅度（秒）
+
+    struct Event
+    {
+        double time;
+        uint32_t id;
+        bool operator<(const Event &other) const
+        {
+            return time < other.time || (time == other.time && id < other.id);
+        }
+    };
+
+    struct Result
+    {
+        double ms = 0.0;
+        size_t dispatched = 0;
+        double checksum = 0.0;  // 发送时间之和，两种实现应一致
+    };
+
+    template <typename Body>
+    Result Measure(Body body)
+    {
+        Result result;
+        const auto start = std::chrono::steady_clock::now();
+        body(result);
+        result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    /// 本步要挪动的事件：只挑选下一步之后才到期的事件，挪到下一步之后的新时间
+    template <typename Rng, typename Move>
+    void Mutate(Rng &rng, std::vector<double> &times, double now, int count, Move move)
+    {
+        std::uniform_real_distribution<double> delta(-MAX_MOVE, MAX_MOVE);
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t id = static_cast<uint32_t>(rng() % times.size());
+            const double old_time = times[id];
+            if (old_time <= now + STEP)
+                continue;
+            const double new_time = std::min(DURATION, std::max(now + 2 * STEP, old_time + delta(rng)));
+            times[id] = new_time;
+            move(id, old_time, new_time);
+        }
+    }
+
+    Result VectorWalk(const std::vector<double> &initial, int mutations)
+    {
+        return Measure([&](Result &result)
+        {
+            std::mt19937 rng(2);
+            std::vector<double> times = initial;
+            std::vector<Event> events;
+            events.reserve(times.size());
+            for (uint32_t id = 0; id < times.size(); ++id)
+                events.push_back({times[id], id});
+            std::sort(events.begin(), events.end());
+
+            size_t cursor = 0;
+            for (double now = 0.0; now < DURATION; now += STEP)
+            {
+                if (mutations > 0)
+                {
+                    Mutate(rng, times, now, mutations, [&](uint32_t id, double old_time, double new_time)
+                    {
+                        events.erase(std::lower_bound(events.begin() + cursor, events.end(), Event{old_time, id}));
+                        const Event moved{new_time, id};
+                        events.insert(std::upper_bound(events.begin() + cursor, events.end(), moved), moved);
+                    });
+                }
+                for (; cursor < events.size() && events[cursor].time <= now; ++cursor)
+                {
+                    result.dispatched++;
+                    result.checksum += events[cursor].time;
+                }
+            }
+        });
+    }
+
+    Result Wheel(const std::vector<double> &initial, int mutations)
+    {
+        return Measure([&](Result &result)
+        {
+            std::mt19937 rng(2);
+            std::vector<double> times = initial;
+            std::vector<uint32_t> order(times.size());
+            for (uint32_t id = 0; id < order.size(); ++id)
+                order[id] = id;
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return times[a] < times[b]; });
+
+            // 尚未送入时间轮的事件被改动时直接插入（之后游标跳过），已送入的取消后重新插入
+            std::vector<TimingWheel::Handle> handles(times.size(), TimingWheel::INVALID_HANDLE);
+            std::vector<bool> fed(times.size(), false);
+            TimingWheel wheel;
+            wheel.reset(0.0);
+
+            size_t feed = 0;
+            for (double now = 0.0; now < DURATION; now += STEP)
+            {
+                if (mutations > 0)
+                {
+                    Mutate(rng, times, now, mutations, [&](uint32_t id, double, double new_time)
+                    {
+                        if (handles[id] != TimingWheel::INVALID_HANDLE)
+                            wheel.cancel(handles[id]);
+                        handles[id] = wheel.insert(new_time, id);
+                        fed[id] = true;
+                    });
+                }
+                for (; feed < order.size() && initial[order[feed]] <= now + FEED_AHEAD; ++feed)
+                {
+                    const uint32_t id = order[feed];
+                    if (!fed[id])
+                        handles[id] = wheel.insert(times[id], id);
+                    fed[id] = true;
+                }
+                wheel.expire(now, true, [&](uint32_t id, double time)
+                {
+                    handles[id] = TimingWheel::INVALID_HANDLE;
+                    result.dispatched++;
+                    result.checksum += time;
+                });
+            }
+        });
+    }
+
+    bool Report(const char *label, const Result &vector, const Result &wheel)
+    {
+        std::printf("%-12s 顺序遍历 %9.1f ms   时间轮 %9.1f ms   (%.2fx, 发送 %zu / %zu)\n", label, vector.ms, wheel.ms,
+                    vector.ms / wheel.ms, vector.dispatched, wheel.dispatched);
+        return vector.dispatched == wheel.dispatched &&
+               std::abs(vector.checksum - wheel.checksum) <= 1e-9 * std::max(1.0, std::abs(vector.checksum));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 100000;
+    const int mutations = argc > 2 ? std::atoi(argv[2]) : 2;
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> time(0.0, DURATION);
+    std::vector<double> times(count);
+    for (double &t : times)
+        t = time(rng);
+
+    std::printf("%zu 个事件, %.0f 秒, 步长 %.0f ms\n", count, DURATION, STEP * 1000.0);
+    bool ok = Report("静态", VectorWalk(times, 0), Wheel(times, 0));
+    char label[32];
+    std::snprintf(label, sizeof(label), "每步改动 %d", mutations);
+    ok = Report(label, VectorWalk(times, mutations), Wheel(times, mutations)) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// TimingWheel 测试：随机插入（近期/跨层远期/已过期）、取消与推进，与按时间排序的参照集合比较
+//   1. 每次 expire 发出的条目集合与参照一致，且按刻度非递减
+//   2. 取消未到期条目成功，已到期/已取消的句柄（包括节点已被新条目复用的）返回 false
+//   3. next_due 不晚于最早待到期条目，size 与参照一致
+
+#include "core/TimingWheel.h"
+#include "test_support.h"
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using Core::TimingWheel;
+
+namespace
+{
+    constexpr int ROUNDS = 300;
+    constexpr int STEPS = 400;
+    constexpr double TICK = 0.0001;
+
+    void Check(bool ok, const char *what, int round, int step)
+    {
+        if (!ok)
+            TestSupport::Fail(std::string(what) + " (第 " + std::to_string(round) + " 轮第 " + std::to_string(step) +
+                              " 步)");
+    }
+}
+
+int main()
+{
+    std::mt19937_64 rng(49);
+    long dispatched = 0;
+
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        TimingWheel wheel;
+        double now = static_cast<double>(rng() % 1000) / 10.0;
+        wheel.reset(now);
+
+        std::multimap<double, uint32_t> expected;  // 到期时间 -> 负载
+        std::map<uint32_t, TimingWheel::Handle> handles;
+        std::vector<TimingWheel::Handle> stale;  // 已到期或已取消的句柄
+        uint32_t next_payload = 0;
+
+        for (int step = 0; step < STEPS; ++step)
+        {
+            const int op = static_cast<int>(rng() % 10);
+            if (op < 5)
+            {
+                // 三分之一为跨层的远期条目（最远约 20000 秒），其余在 2 秒内；少量略早于当前时间
+                const double ahead = (rng() % 3 == 0) ? static_cast<double>(rng() % 2000000) / 100.0
+                                                      : static_cast<double>(rng() % 20000) / 10000.0;
+                const double time = now + ahead - 0.01;
+                const uint32_t payload = next_payload++;
+                handles[payload] = wheel.insert(time, payload);
+                expected.insert({time, payload});
+            }
+            else if (op < 7 && !handles.empty())
+            {
+                auto it = handles.begin();
+                std::advance(it, rng() % handles.size());
+                Check(wheel.cancel(it->second), "取消未到期条目失败", round, step);
+                Check(!wheel.cancel(it->second), "重复取消返回 true", round, step);
+                if (!stale.empty())
+                    Check(!wheel.cancel(stale[rng() % stale.size()]), "失效句柄取消了复用节点上的条目", round, step);
+                stale.push_back(it->second);
+                for (auto e = expected.begin(); e != expected.end(); ++e)
+                {
+                    if (e->second == it->first)
+                    {
+                        expected.erase(e);
+                        break;
+                    }
+                }
+                handles.erase(it);
+            }
+            else
+            {
+                // 偶尔大步推进（最远约 10000 秒），使高层的槽逐层下放；其余推进 10 秒以内
+                const int jump = static_cast<int>(rng() % 30);
+                const double limit = now + (jump == 0   ? static_cast<double>(rng() % 100000) / 10.0
+                                            : jump < 10 ? static_cast<double>(rng() % 100000) / 10000.0
+                                                        : static_cast<double>(rng() % 500) / 10000.0);
+                const bool inclusive = rng() % 2 != 0;
+
+                std::vector<std::pair<double, uint32_t>> got;
+                std::vector<TimingWheel::Handle> expired_handles;
+                wheel.expire(limit, inclusive, [&](uint32_t payload, double time)
+                {
+                    got.push_back({time, payload});
+                    expired_handles.push_back(handles[payload]);
+                    handles.erase(payload);
+                });
+
+                std::multiset<uint32_t> want;
+                for (auto e = expected.begin(); e != expected.end();)
+                {
+                    if (inclusive ? e->first <= limit : e->first < limit)
+                    {
+                        want.insert(e->second);
+                        e = expected.erase(e);
+                    }
+                    else
+                    {
+                        ++e;
+                    }
+                }
+                std::multiset<uint32_t> have;
+                for (const auto &entry : got)
+                    have.insert(entry.second);
+                Check(have == want, "到期条目与参照不一致", round, step);
+
+                for (size_t k = 1; k < got.size(); ++k)
+                {
+                    // 已过期的条目在当前刻度立即到期，不参与顺序比较
+                    if (got[k].first > now &&
+                        std::floor(got[k].first / TICK) < std::floor(got[k - 1].first / TICK))
+                    {
+                        Check(false, "到期顺序早于前一条目", round, step);
+                        break;
+                    }
+                }
+                for (TimingWheel::Handle handle : expired_handles)
+                {
+                    Check(!wheel.cancel(handle), "已到期的句柄仍可取消", round, step);
+                    stale.push_back(handle);
+                }
+
+                dispatched += static_cast<long>(got.size());
+                now = limit;
+
+                if (!expected.empty() && expected.begin()->first > now)
+                    Check(wheel.next_due() <= expected.begin()->first + 1e-9, "next_due 晚于最早条目", round, step);
+            }
+
+            Check(wheel.size() == expected.size(), "size 与参照不一致", round, step);
+            Check(wheel.empty() == expected.empty(), "empty 与参照不一致", round, step);
+        }
+    }
+
+    std::printf("%d 轮, 到期条目 %ld\n", ROUNDS, dispatched);
+    return TestSupport::Finish();
+}
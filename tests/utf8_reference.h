@@ -0,0 +1,61 @@
+#pragma once
+
+// UTF-8 严格校验的参照实现（逐码点解码），供 TextEncoding 测试与基准对照
+
+#include <cstddef>
+#include <string>
+
+namespace Utf8Reference
+{
+    /// 参照实现：逐码点解码，拒绝过长编码、UTF-16 代理区与超出 U+10FFFF 的码点
+    inline bool ReferenceUtf8(const std::string &s)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());
+        const size_t n = s.size();
+        size_t i = 0;
+        while (i < n)
+        {
+            const unsigned c = p[i];
+            if (c < 0x80)
+            {
+                i++;
+                continue;
+            }
+            size_t len;
+            unsigned cp;
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                len = 2;
+                cp = c & 0x1F;
+            }
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                len = 3;
+                cp = c & 0x0F;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                len = 4;
+                cp = c & 0x07;
+            }
+            else
+            {
+                return false;
+            }
+            if (i + len > n)
+                return false;
+            for (size_t k = 1; k < len; k++)
+            {
+                if ((p[i + k] & 0xC0) != 0x80)
+                    return false;
+                cp = (cp << 6) | (p[i + k] & 0x3F);
+            }
+            if ((len == 3 && cp < 0x800) || (len == 4 && (cp < 0x10000 || cp > 0x10FFFF)))
+                return false;
+            if (cp >= 0xD800 && cp <= 0xDFFF)
+                return false;
+            i += len;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,46 @@
+// 二进制日志解码工具：把 LogBinary=1 时写出的 .binlog 文件还原为文本日志
+// 用法：log_decode <输入.binlog> [输出.log]，未指定输出时写到标准输出
+
+#include "util/LogFormat.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::fprintf(stderr, "用法: %s <输入.binlog> [输出.log]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in)
+    {
+        std::fprintf(stderr, "无法打开输入文件: %s\n", argv[1]);
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc == 3)
+    {
+        file.open(argv[2], std::ios::binary);
+        if (!file)
+        {
+            std::fprintf(stderr, "无法创建输出文件: %s\n", argv[2]);
+            return 1;
+        }
+    }
+    std::ostream& out = (argc == 3) ? static_cast<std::ostream&>(file) : std::cout;
+
+    std::string error;
+    if (!Util::DecodeLogBinary(in, out, error))
+    {
+        out.flush();
+        std::fprintf(stderr, "解码失败: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}